@@ -0,0 +1,246 @@
+#include "BenchServers.h"
+#include <QNetworkDatagram>
+#include <QPointer>
+#include <QTimer>
+#include <QFile>
+#ifndef QT_NO_SSL
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QSslSocket>
+#endif
+#include <memory>
+
+void TcpAcceptServer::incomingConnection(qintptr fd) {
+    ++accepted_;
+    QTcpSocket socket;
+    if (socket.setSocketDescriptor(fd)) socket.abort();
+}
+
+void HttpHeadServer::incomingConnection(qintptr fd) {
+    auto* socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(fd)) {
+        socket->deleteLater();
+        return;
+    }
+    ++connections_;
+    auto buffer = std::make_shared<QByteArray>();
+    QObject::connect(socket, &QTcpSocket::readyRead, this, [this, socket, buffer]{
+        *buffer += socket->readAll();
+        serve_(socket, *buffer);
+    });
+    QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+}
+
+void HttpHeadServer::serve_(QTcpSocket* socket, QByteArray& buffer) {
+    for (;;) {
+        const int end = int(buffer.indexOf("\r\n\r\n"));
+        if (end < 0) return;
+        const QByteArray head = buffer.left(end).toLower();
+        buffer.remove(0, end + 4);
+        ++requests_;
+
+        const bool close = head.contains("\r\nconnection: close");
+        QByteArray reply("HTTP/1.1 200 OK\r\nContent-Length: 0\r\nServer: qt_netmon_bench\r\n");
+        reply += close ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+        socket->write(reply);
+        if (close) {
+            socket->disconnectFromHost();
+            return;
+        }
+    }
+}
+
+namespace {
+
+// HTTP/2 frame types and flags used by the stand-in
+enum H2Frame : quint8 { H2Headers = 0x1, H2Settings = 0x4, H2Ping = 0x6, H2GoAway = 0x7, H2Continuation = 0x9 };
+enum H2Flag : quint8 { H2Ack = 0x1, H2EndStream = 0x1, H2EndHeaders = 0x4 };
+
+constexpr char kH2Preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+constexpr int kH2PrefaceSize = int(sizeof(kH2Preface)) - 1;
+
+} // namespace
+
+void H2cServer::incomingConnection(qintptr fd) {
+    auto* socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(fd)) {
+        socket->deleteLater();
+        return;
+    }
+    ++connections_;
+    socket->write(frame_(H2Settings, 0, 0));
+    auto conn = std::make_shared<Connection>();
+    QObject::connect(socket, &QTcpSocket::readyRead, this, [this, socket, conn]{
+        conn->buffer += socket->readAll();
+        serve_(socket, *conn);
+    });
+    QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+}
+
+QByteArray H2cServer::frame_(quint8 type, quint8 flags, quint32 stream, const QByteArray& payload) {
+    const quint32 len = quint32(payload.size());
+    QByteArray f;
+    f.reserve(9 + payload.size());
+    f += char(len >> 16);
+    f += char(len >> 8);
+    f += char(len);
+    f += char(type);
+    f += char(flags);
+    f += char((stream >> 24) & 0x7f);
+    f += char(stream >> 16);
+    f += char(stream >> 8);
+    f += char(stream);
+    f += payload;
+    return f;
+}
+
+void H2cServer::serve_(QTcpSocket* socket, Connection& c) {
+    if (!c.prefaceSeen) {
+        if (c.buffer.size() < kH2PrefaceSize) return;
+        if (!c.buffer.startsWith(kH2Preface)) {
+            socket->abort();
+            return;
+        }
+        c.buffer.remove(0, kH2PrefaceSize);
+        c.prefaceSeen = true;
+    }
+    QByteArray out;
+    int pos = 0;
+    while (c.buffer.size() - pos >= 9) {
+        const auto* h = reinterpret_cast<const uchar*>(c.buffer.constData() + pos);
+        const int len = (h[0] << 16) | (h[1] << 8) | h[2];
+        if (c.buffer.size() - pos < 9 + len) break;
+        const quint8 type = h[3];
+        const quint8 flags = h[4];
+        const quint32 stream = (quint32(h[5] & 0x7f) << 24) | (quint32(h[6]) << 16) | (quint32(h[7]) << 8) | h[8];
+        switch (type) {
+            case H2Settings:
+                if (!(flags & H2Ack)) out += frame_(H2Settings, H2Ack, 0);
+                break;
+            case H2Ping:
+                if (!(flags & H2Ack)) out += frame_(H2Ping, H2Ack, 0, c.buffer.mid(pos + 9, len));
+                break;
+            case H2Headers:
+            case H2Continuation:
+                if (flags & H2EndHeaders) {
+                    ++requests_;
+                    out += frame_(H2Headers, H2EndStream | H2EndHeaders, stream, QByteArray(1, char(0x88)));
+                }
+                break;
+            case H2GoAway:
+                socket->write(out);
+                socket->disconnectFromHost();
+                return;
+            default:                      // WINDOW_UPDATE, PRIORITY, RST_STREAM, DATA
+                break;
+        }
+        pos += 9 + len;
+    }
+    c.buffer.remove(0, pos);
+    if (!out.isEmpty()) socket->write(out);
+}
+
+void FaultInjector::incomingConnection(qintptr fd) {
+    auto* client = new QTcpSocket(this);
+    if (!client->setSocketDescriptor(fd)) {
+        client->deleteLater();
+        return;
+    }
+    QObject::connect(client, &QTcpSocket::disconnected, client, &QObject::deleteLater);
+
+    if (cfg_.dropRate > 0 && rng_.generateDouble() < cfg_.dropRate) {
+        ++dropped_;
+        if (cfg_.dropMode == DropMode::Reset) client->abort();
+        // Silent: keep the socket open and never answer.
+        return;
+    }
+
+    ++forwarded_;
+    const int delay = cfg_.delayMs + (cfg_.jitterMs > 0 ? int(rng_.bounded(cfg_.jitterMs + 1)) : 0);
+    if (delay <= 0) {
+        forward_(client);
+        return;
+    }
+    QPointer<QTcpSocket> guard(client);
+    QTimer::singleShot(delay, this, [this, guard]{ if (guard) forward_(guard); });
+}
+
+void FaultInjector::forward_(QTcpSocket* client) {
+    auto* upstream = new QTcpSocket(client);
+    // Writes made while connecting are buffered by QAbstractSocket.
+    upstream->connectToHost(QHostAddress::LocalHost, cfg_.upstreamPort);
+    upstream->write(client->readAll());
+
+    QObject::connect(client, &QTcpSocket::readyRead, upstream, [client, upstream]{
+        upstream->write(client->readAll());
+    });
+    QObject::connect(upstream, &QTcpSocket::readyRead, client, [client, upstream]{
+        client->write(upstream->readAll());
+    });
+    QObject::connect(upstream, &QTcpSocket::disconnected, client, [client]{
+        client->disconnectFromHost();
+    });
+    QObject::connect(client, &QTcpSocket::disconnected, upstream, [upstream]{
+        upstream->disconnectFromHost();
+    });
+}
+
+UdpEchoServer::UdpEchoServer(QObject* parent)
+        : QObject(parent) {
+    QObject::connect(&socket_, &QUdpSocket::readyRead, this, &UdpEchoServer::read_);
+}
+
+void UdpEchoServer::read_() {
+    while (socket_.hasPendingDatagrams()) {
+        const QNetworkDatagram d = socket_.receiveDatagram();
+        if (!d.isValid()) continue;
+        socket_.writeDatagram(d.makeReply(d.data()));
+        ++echoed_;
+    }
+}
+
+#ifndef QT_NO_SSL
+bool TlsAcceptServer::start(const QString& certPath, const QString& keyPath, QString* error) {
+    QFile certFile(certPath);
+    QFile keyFile(keyPath);
+    if (!certFile.open(QIODevice::ReadOnly) || !keyFile.open(QIODevice::ReadOnly)) {
+        *error = QStringLiteral("cannot read %1 / %2").arg(certPath, keyPath);
+        return false;
+    }
+    const QSslCertificate cert(&certFile, QSsl::Pem);
+    const QSslKey key(&keyFile, QSsl::Rsa, QSsl::Pem);
+    if (cert.isNull() || key.isNull()) {
+        *error = QStringLiteral("bad PEM certificate or RSA key");
+        return false;
+    }
+    cfg_ = QSslConfiguration::defaultConfiguration();
+    cfg_.setLocalCertificate(cert);
+    cfg_.setPrivateKey(key);
+    cfg_.setPeerVerifyMode(QSslSocket::VerifyNone);
+    if (!listen(QHostAddress::LocalHost, 0)) {
+        *error = errorString();
+        return false;
+    }
+    return true;
+}
+
+void TlsAcceptServer::incomingConnection(qintptr fd) {
+    auto* socket = new QSslSocket(this);
+    if (!socket->setSocketDescriptor(fd)) {
+        socket->deleteLater();
+        return;
+    }
+    socket->setSslConfiguration(cfg_);
+    QObject::connect(socket, &QSslSocket::encrypted, this, [this, socket]{
+        ++handshakes_;
+        socket->disconnectFromHost();
+    });
+    QObject::connect(socket, &QSslSocket::disconnected, socket, &QObject::deleteLater);
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    QObject::connect(socket, &QSslSocket::errorOccurred, socket, &QObject::deleteLater);
+#else
+    QObject::connect(socket, qOverload<QAbstractSocket::SocketError>(&QAbstractSocket::error), socket, &QObject::deleteLater);
+#endif
+    socket->startServerEncryption();
+}
+#endif
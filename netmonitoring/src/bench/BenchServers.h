@@ -0,0 +1,153 @@
+#pragma once
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUdpSocket>
+#ifndef QT_NO_SSL
+#include <QSslConfiguration>
+#endif
+#include <QRandomGenerator>
+
+// Loopback stand-ins for qt_netmon_bench. Every server listens on 127.0.0.1 with an
+// ephemeral port, see serverPort().
+
+// Accepts a connection and closes it right away: the target for TCP connect probes.
+class TcpAcceptServer : public QTcpServer {
+    Q_OBJECT
+public:
+    explicit TcpAcceptServer(QObject* parent = nullptr) : QTcpServer(parent) {}
+
+    bool start() { return listen(QHostAddress::LocalHost, 0); }
+    quint64 accepted() const { return accepted_; }
+
+protected:
+    void incomingConnection(qintptr fd) override;
+
+private:
+    quint64 accepted_ = 0;
+};
+
+// Minimal HTTP/1.1 server: answers every request with an empty 200 and honours
+// "Connection: close", so both fresh-connection and keep-alive probes work.
+class HttpHeadServer : public QTcpServer {
+    Q_OBJECT
+public:
+    explicit HttpHeadServer(QObject* parent = nullptr) : QTcpServer(parent) {}
+
+    bool start() { return listen(QHostAddress::LocalHost, 0); }
+    quint64 requests() const { return requests_; }
+    quint64 connections() const { return connections_; }
+
+protected:
+    void incomingConnection(qintptr fd) override;
+
+private:
+    void serve_(QTcpSocket* socket, QByteArray& buffer);
+
+    quint64 requests_ = 0;
+    quint64 connections_ = 0;
+};
+
+// Cleartext HTTP/2 with prior knowledge (h2c, RFC 9113 section 3.3): accepts the
+// client preface, acknowledges SETTINGS and PING, and answers every request
+// stream with a bare ":status: 200" (HPACK static index 8) that ends the stream.
+// Request headers are not decoded, so every path is a 200; enough for HEAD.
+class H2cServer : public QTcpServer {
+    Q_OBJECT
+public:
+    explicit H2cServer(QObject* parent = nullptr) : QTcpServer(parent) {}
+
+    bool start() { return listen(QHostAddress::LocalHost, 0); }
+    quint64 requests() const { return requests_; }
+    quint64 connections() const { return connections_; }
+
+protected:
+    void incomingConnection(qintptr fd) override;
+
+private:
+    struct Connection {
+        QByteArray buffer;
+        bool prefaceSeen = false;
+    };
+
+    void serve_(QTcpSocket* socket, Connection& c);
+    static QByteArray frame_(quint8 type, quint8 flags, quint32 stream, const QByteArray& payload = QByteArray());
+
+    quint64 requests_ = 0;
+    quint64 connections_ = 0;
+};
+
+// UDP echo (RFC 862): every datagram goes back to its sender unchanged.
+class UdpEchoServer : public QObject {
+    Q_OBJECT
+public:
+    explicit UdpEchoServer(QObject* parent = nullptr);
+
+    bool start() { return socket_.bind(QHostAddress::LocalHost, 0); }
+    quint16 serverPort() const { return socket_.localPort(); }
+    quint64 echoed() const { return echoed_; }
+
+private:
+    void read_();
+
+    QUdpSocket socket_;
+    quint64 echoed_ = 0;
+};
+
+#ifndef QT_NO_SSL
+// TLS server with a caller-supplied (usually self-signed) certificate: completes
+// the handshake and closes the connection. Every QSslSocket gets its own OpenSSL
+// context, so offered sessions are not resumed here; use `openssl s_server` to
+// time resumption.
+class TlsAcceptServer : public QTcpServer {
+    Q_OBJECT
+public:
+    explicit TlsAcceptServer(QObject* parent = nullptr) : QTcpServer(parent) {}
+
+    bool start(const QString& certPath, const QString& keyPath, QString* error);
+    quint64 handshakes() const { return handshakes_; }
+
+protected:
+    void incomingConnection(qintptr fd) override;
+
+private:
+    QSslConfiguration cfg_;
+    quint64 handshakes_ = 0;
+};
+#endif
+
+// TCP proxy in front of another stand-in that delays and drops connections.
+// The delay is applied before the upstream connection is opened, so it adds to
+// the time to first byte; a dropped connection is accepted and then either held
+// silently (the client runs into its timeout) or reset. The TCP handshake with
+// the proxy itself is done by the kernel and cannot be delayed from here.
+class FaultInjector : public QTcpServer {
+    Q_OBJECT
+public:
+    enum class DropMode { Silent, Reset };
+
+    struct Config {
+        quint16 upstreamPort = 0;
+        int delayMs = 0;
+        int jitterMs = 0;                 // задержка равномерно в [delay, delay + jitter]
+        double dropRate = 0.0;            // доля соединений, 0..1
+        DropMode dropMode = DropMode::Silent;
+    };
+
+    explicit FaultInjector(const Config& cfg, QObject* parent = nullptr)
+            : QTcpServer(parent), cfg_(cfg) {}
+
+    bool start() { return listen(QHostAddress::LocalHost, 0); }
+    quint64 forwarded() const { return forwarded_; }
+    quint64 dropped() const { return dropped_; }
+
+protected:
+    void incomingConnection(qintptr fd) override;
+
+private:
+    void forward_(QTcpSocket* client);
+
+    Config cfg_;
+    QRandomGenerator rng_{0x5eed};        // воспроизводимые прогоны
+    quint64 forwarded_ = 0;
+    quint64 dropped_ = 0;
+};
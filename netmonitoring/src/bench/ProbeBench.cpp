@@ -0,0 +1,54 @@
+#include "ProbeBench.h"
+
+ProbeBench::ProbeBench(const Config& cfg, QObject* parent)
+        : QObject(parent)
+        , cfg_(cfg) {
+    result_.name = cfg_.name;
+    pool_.setInitializer([this](INetProbe* probe){
+        QObject::connect(probe, &INetProbe::finished, this,
+                         [this, probe](const ProbeResult& r){ onFinished_(probe, r); });
+    });
+}
+
+void ProbeBench::start() {
+    result_.latencyUs.reserve(size_t(cfg_.count));
+    result_.overheadUs.reserve(size_t(cfg_.count));
+    clock_.start();
+    const int initial = qMin(cfg_.concurrency, cfg_.count);
+    for (int i = 0; i < initial; ++i) launch_();
+    if (cfg_.count <= 0) emit done();
+}
+
+void ProbeBench::launch_() {
+    ++launched_;
+    INetProbe* probe = pool_.acquire(cfg_.target.mode);
+    probe->setTag(quint32(launched_));
+    probe->configure(cfg_.target);
+    startedNs_.insert(probe, clock_.nsecsElapsed());
+    probe->start(cfg_.target.host, cfg_.target.port, cfg_.target.timeoutMs);
+}
+
+void ProbeBench::onFinished_(INetProbe* probe, const ProbeResult& r) {
+    const qint64 now = clock_.nsecsElapsed();
+    const qint64 wallUs = (now - startedNs_.take(probe)) / 1000;
+
+    ++result_.count;
+    if (r.status == ProbeResult::Status::Up) {
+        ++result_.up;
+        const qint64 latencyUs = r.latencyNs >= 0 ? r.latencyNs / 1000 : r.latencyMs * 1000;
+        result_.latencyUs.push_back(latencyUs);
+        result_.overheadUs.push_back(qMax<qint64>(0, wallUs - latencyUs));
+    } else if (r.status == ProbeResult::Status::Timeout) {
+        ++result_.timeouts;
+    } else {
+        ++result_.failed;
+    }
+
+    pool_.release(probe);
+    if (launched_ < cfg_.count) {
+        launch_();
+    } else if (result_.count == cfg_.count) {
+        result_.wallNs = now;
+        emit done();
+    }
+}
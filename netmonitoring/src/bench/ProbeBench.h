@@ -0,0 +1,52 @@
+#pragma once
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <vector>
+#include "core/ProbePool.h"
+#include "core/ProbeTarget.h"
+
+// Drives one probe mode against a stand-in: keeps `concurrency` probes in flight
+// until `count` have finished. Per probe it records the latency the probe reports
+// and the overhead on top of it (wall time from start() to finished() minus the
+// reported latency: DNS cache, event loop and signal delivery).
+class ProbeBench : public QObject {
+    Q_OBJECT
+public:
+    struct Config {
+        QString name;
+        ProbeTarget target;
+        int count = 2000;
+        int concurrency = 64;
+    };
+
+    struct Result {
+        QString name;
+        int count = 0;
+        int up = 0;
+        int timeouts = 0;
+        int failed = 0;
+        qint64 wallNs = 0;
+        std::vector<qint64> latencyUs;    // только успешные
+        std::vector<qint64> overheadUs;
+    };
+
+    explicit ProbeBench(const Config& cfg, QObject* parent = nullptr);
+
+    void start();
+    const Result& result() const { return result_; }
+
+signals:
+    void done();
+
+private:
+    void launch_();
+    void onFinished_(INetProbe* probe, const ProbeResult& r);
+
+    Config cfg_;
+    ProbePool pool_;
+    QElapsedTimer clock_;
+    QHash<INetProbe*, qint64> startedNs_;
+    int launched_ = 0;
+    Result result_;
+};
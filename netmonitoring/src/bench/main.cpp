@@ -0,0 +1,391 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QSysInfo>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "bench/BenchServers.h"
+#include "bench/ProbeBench.h"
+#include "core/AgentUplink.h"
+#include "core/Aggregator.h"
+#include "core/DnsCache.h"
+#include "core/MonitorController.h"
+#include "core/StatsCalculator.h"
+#include "core/StubResolverBackend.h"
+#include "core/SystemResolverBackend.h"
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
+static constexpr auto kSkipEmpty = Qt::SkipEmptyParts;
+#else
+static constexpr auto kSkipEmpty = QString::SkipEmptyParts;
+#endif
+
+static int fail(const QString& msg) {
+    std::fprintf(stderr, "qt_netmon_bench: %s\n", qPrintable(msg));
+    return 2;
+}
+
+static qint64 percentileOf(std::vector<qint64> v, double q) {
+    if (v.empty()) return -1;
+    std::sort(v.begin(), v.end());
+    const size_t rank = size_t(std::max(1.0, std::ceil(q / 100.0 * double(v.size()))));
+    return v[std::min(rank, v.size()) - 1];
+}
+
+static QJsonObject distribution(const std::vector<qint64>& v) {
+    QJsonObject o;
+    o.insert("p50", percentileOf(v, 50));
+    o.insert("p90", percentileOf(v, 90));
+    o.insert("p99", percentileOf(v, 99));
+    o.insert("max", v.empty() ? qint64(-1) : *std::max_element(v.begin(), v.end()));
+    return o;
+}
+
+// Keeps the optimizer from dropping the measured calls.
+static volatile qint64 g_sink = 0;
+
+static QJsonObject benchStats(int window, int ops) {
+    std::vector<qint64> values(4096);
+    for (auto& v : values) v = 1 + QRandomGenerator::global()->bounded(2000);
+
+    StatsCalculator stats;
+    stats.setMaxSamples(window);
+    for (int i = 0; i < window; ++i) stats.addSample(values[size_t(i) & 4095]);
+
+    QElapsedTimer t;
+    t.start();
+    for (int i = 0; i < ops; ++i) stats.addSample(values[size_t(i) & 4095]);
+    const double addNs = double(t.nsecsElapsed()) / ops;
+
+    qint64 acc = 0;
+    t.restart();
+    for (int i = 0; i < ops; ++i) acc += stats.min() + stats.max() + stats.avg();
+    const double minMaxAvgNs = double(t.nsecsElapsed()) / ops;
+
+    const int pOps = qMax(1, ops / 10);
+    t.restart();
+    for (int i = 0; i < pOps; ++i) acc += stats.percentile(99);
+    const double percentileNs = double(t.nsecsElapsed()) / pOps;
+    g_sink = g_sink + acc;
+
+    QJsonObject o;
+    o.insert("window", window);
+    o.insert("ops", ops);
+    o.insert("addNsPerOp", addNs);
+    o.insert("minMaxAvgNsPerOp", minMaxAvgNs);
+    o.insert("p99NsPerOp", percentileNs);
+    return o;
+}
+
+static QJsonObject runProbes(const ProbeBench::Config& cfg) {
+    ProbeBench bench(cfg);
+    QEventLoop loop;
+    QObject::connect(&bench, &ProbeBench::done, &loop, &QEventLoop::quit);
+    bench.start();
+    if (bench.result().count < cfg.count) loop.exec();
+
+    const ProbeBench::Result& r = bench.result();
+    QJsonObject o;
+    o.insert("name", r.name);
+    o.insert("mode", QString::fromLatin1(probeModeName(cfg.target.mode)));
+    o.insert("keepAlive", cfg.target.keepAlive);
+    o.insert("concurrency", cfg.concurrency);
+    o.insert("count", r.count);
+    o.insert("up", r.up);
+    o.insert("timeouts", r.timeouts);
+    o.insert("failed", r.failed);
+    o.insert("wallMs", double(r.wallNs) / 1e6);
+    o.insert("throughputPerSec", r.wallNs > 0 ? double(r.count) * 1e9 / double(r.wallNs) : 0.0);
+    o.insert("latencyUs", distribution(r.latencyUs));
+    o.insert("overheadUs", distribution(r.overheadUs));
+    std::fprintf(stderr, "%-16s %6d probes  %9.1f/s  up %d  timeout %d  failed %d\n", qPrintable(r.name),
+                 r.count, o.value("throughputPerSec").toDouble(), r.up, r.timeouts, r.failed);
+    return o;
+}
+
+// AgentUplink -> Aggregator over loopback: encoding, the socket, decoding and the
+// merge into vantages, fed with synthetic records. The records go in whole batches,
+// so none waits for the uplink's flush timer; the aggregator has to count exactly
+// as many as were sent.
+static QJsonObject benchAgent(int records, int targets, int timeoutMs) {
+    QJsonObject o;
+    o.insert("targets", targets);
+    Aggregator aggregator;
+    if (!aggregator.listen(QHostAddress::LocalHost, 0)) {
+        o.insert("error", aggregator.errorString());
+        return o;
+    }
+    MonitorController controller;         // only names the targets; never started
+    QVector<quint32> ids;
+    for (int i = 0; i < targets; ++i) {
+        ProbeTarget t;
+        t.host = QStringLiteral("10.%1.%2.%3").arg((i >> 16) & 0xff).arg((i >> 8) & 0xff).arg(i & 0xff);
+        ids.push_back(controller.addTarget(t));
+    }
+    AgentUplink uplink;
+    uplink.setAgentName(QStringLiteral("bench"));
+    uplink.attach(&controller);
+
+    QEventLoop loop;
+    QTimer deadline;
+    deadline.setSingleShot(true);
+    QObject::connect(&deadline, &QTimer::timeout, &loop, &QEventLoop::quit);
+    deadline.start(timeoutMs);
+    {
+        QMetaObject::Connection c = QObject::connect(&uplink, &AgentUplink::connected, &loop, &QEventLoop::quit);
+        uplink.connectTo(QStringLiteral("127.0.0.1"), aggregator.port());
+        loop.exec();
+        QObject::disconnect(c);
+    }
+    if (!uplink.isConnected()) {
+        o.insert("error", QStringLiteral("no connection to the aggregator"));
+        return o;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    const qint64 baseMs = QDateTime::currentMSecsSinceEpoch();
+    QVector<ProbeRecord> batch;
+    int queued = 0;
+    QTimer feeder;                        // по пачке за проход цикла, пока очередь аплинка короткая
+    QObject::connect(&feeder, &QTimer::timeout, &loop, [&]{
+        if (queued < records && uplink.pending() < AgentUplink::kBatchRecords * 4) {
+            batch.resize(0);
+            for (int i = 0; i < AgentUplink::kBatchRecords; ++i, ++queued) {
+                ProbeRecord r;
+                r.target = ids[queued % targets];
+                r.status = quint8(queued % 50 ? ProbeResult::Status::Up : ProbeResult::Status::Timeout);
+                r.finishedMs = baseMs + queued;
+                r.latencyNs = 200000 + 1000 * qint64(QRandomGenerator::global()->bounded(800));
+                batch.push_back(r);
+            }
+            uplink.enqueue(batch);
+        }
+        if (aggregator.records() >= quint64(queued) && queued >= records) loop.quit();
+    });
+    feeder.start(0);
+    deadline.start(timeoutMs);
+    loop.exec();
+    const qint64 wallNs = clock.nsecsElapsed();
+    feeder.stop();
+
+    const quint64 received = aggregator.records();
+    o.insert("records", queued);
+    o.insert("sent", qint64(uplink.recordsSent()));
+    o.insert("received", qint64(received));
+    o.insert("dropped", qint64(uplink.dropped()));
+    const int vantages = int(aggregator.snapshot().size());
+    o.insert("vantages", vantages);
+    o.insert("match", received == quint64(queued) && vantages == targets);
+    o.insert("bytesPerRecord", received ? double(aggregator.bytes()) / double(received) : 0.0);
+    o.insert("wallMs", double(wallNs) / 1e6);
+    o.insert("recordsPerSec", wallNs > 0 ? double(received) * 1e9 / double(wallNs) : 0.0);
+    std::fprintf(stderr, "%-16s %6d records %9.1f/s  received %llu  dropped %llu  %.1f B/record\n", "agent-loopback",
+                 queued, o.value("recordsPerSec").toDouble(), static_cast<unsigned long long>(received),
+                 static_cast<unsigned long long>(uplink.dropped()), o.value("bytesPerRecord").toDouble());
+    uplink.close();
+    return o;
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("qt_netmon_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks for StatsCalculator, the probes against loopback stand-in servers and the agent-to-aggregator stream.");
+    parser.addHelpOption();
+
+    const QCommandLineOption outputOpt({"o", "output"}, "Write the JSON report to <file> instead of stdout.", "file");
+    const QCommandLineOption windowsOpt("windows", "StatsCalculator window sizes, comma separated.", "list", "50,1000,10000,100000");
+    const QCommandLineOption opsOpt("stats-ops", "Operations per StatsCalculator measurement.", "n", "2000000");
+    const QCommandLineOption countOpt({"n", "count"}, "Probes per scenario.", "n", "2000");
+    const QCommandLineOption concurrentOpt({"c", "concurrency"}, "Probes in flight per scenario.", "n", "64");
+    const QCommandLineOption timeoutOpt({"t", "timeout"}, "Probe timeout in milliseconds.", "ms", "1000");
+    const QCommandLineOption delayOpt("delay", "Injected delay before the upstream, ms.", "ms", "20");
+    const QCommandLineOption jitterOpt("jitter", "Extra random delay, ms.", "ms", "10");
+    const QCommandLineOption dropOpt("drop", "Share of connections the injector drops (0..1).", "rate", "0.02");
+    const QCommandLineOption dnsDelayOpt("dns-delay", "Answer delay of the stub resolver, ms.", "ms", "5");
+    const QCommandLineOption tlsCertOpt("tls-cert", "PEM certificate for the TLS stand-in (enables the tls scenarios).", "file");
+    const QCommandLineOption tlsKeyOpt("tls-key", "PEM RSA key of --tls-cert.", "file");
+    const QCommandLineOption noStatsOpt("skip-stats", "Do not run the StatsCalculator benchmarks.");
+    const QCommandLineOption noProbesOpt("skip-probes", "Do not run the probe benchmarks.");
+    const QCommandLineOption agentRecordsOpt("agent-records", "Records streamed from an agent to an aggregator over loopback.", "n", "200000");
+    const QCommandLineOption noAgentOpt("skip-agent", "Do not run the agent/aggregator loopback benchmark.");
+    for (const auto& o : {outputOpt, windowsOpt, opsOpt, countOpt, concurrentOpt, timeoutOpt,
+                          delayOpt, jitterOpt, dropOpt, dnsDelayOpt, tlsCertOpt, tlsKeyOpt, noStatsOpt, noProbesOpt,
+                          agentRecordsOpt, noAgentOpt}) {
+        parser.addOption(o);
+    }
+    parser.process(app);
+
+    QJsonObject report;
+    QJsonObject meta;
+    meta.insert("ts", QDateTime::currentDateTime().toString(Qt::ISODateWithMs));
+    meta.insert("qt", QString::fromLatin1(qVersion()));
+    meta.insert("cpu", QSysInfo::currentCpuArchitecture());
+    meta.insert("os", QSysInfo::prettyProductName());
+    report.insert("meta", meta);
+
+    if (!parser.isSet(noStatsOpt)) {
+        const int ops = qMax(1, parser.value(opsOpt).toInt());
+        QJsonArray stats;
+        for (const QString& w : parser.value(windowsOpt).split(',', kSkipEmpty)) {
+            bool ok = false;
+            const int window = w.trimmed().toInt(&ok);
+            if (!ok || window <= 0) return fail("bad window size: " + w);
+            stats.append(benchStats(window, ops));
+        }
+        report.insert("stats", stats);
+    }
+
+    if (!parser.isSet(noProbesOpt)) {
+        TcpAcceptServer tcpServer;
+        HttpHeadServer httpServer;
+        H2cServer h2cServer;
+        UdpEchoServer udpServer;
+        if (!tcpServer.start() || !httpServer.start() || !h2cServer.start() || !udpServer.start()) {
+            return fail("cannot listen on loopback");
+        }
+
+        FaultInjector::Config faults;
+        faults.upstreamPort = httpServer.serverPort();
+        faults.delayMs = qMax(0, parser.value(delayOpt).toInt());
+        faults.jitterMs = qMax(0, parser.value(jitterOpt).toInt());
+        faults.dropRate = qBound(0.0, parser.value(dropOpt).toDouble(), 1.0);
+        FaultInjector injector(faults);
+        if (!injector.start()) return fail("cannot listen on loopback");
+
+        // A port nobody listens on: the refused-connection path.
+        quint16 closedPort = 0;
+        {
+            QTcpServer probe;
+            if (probe.listen(QHostAddress::LocalHost, 0)) closedPort = probe.serverPort();
+        }
+
+        ProbeTarget base;
+        base.host = QStringLiteral("127.0.0.1");
+        base.timeoutMs = qMax(1, parser.value(timeoutOpt).toInt());
+        const int count = qMax(1, parser.value(countOpt).toInt());
+        const int concurrency = qMax(1, parser.value(concurrentOpt).toInt());
+
+        auto scenario = [&](const char* name, ProbeTarget::Mode mode, quint16 port, bool keepAlive) {
+            ProbeBench::Config cfg;
+            cfg.name = QString::fromLatin1(name);
+            cfg.target = base;
+            cfg.target.mode = mode;
+            cfg.target.port = port;
+            cfg.target.keepAlive = keepAlive;
+            cfg.count = count;
+            cfg.concurrency = concurrency;
+            return cfg;
+        };
+
+        QVector<ProbeBench::Config> scenarios;
+        scenarios << scenario("tcp", ProbeTarget::Mode::TcpConnect, tcpServer.serverPort(), false);
+#ifdef QT_NETMON_HAVE_EPOLL
+        scenarios << scenario("tcp-native", ProbeTarget::Mode::TcpConnectNative, tcpServer.serverPort(), false)
+                  << scenario("udp-echo", ProbeTarget::Mode::UdpEcho, udpServer.serverPort(), false);
+#endif
+        scenarios << scenario("tcp-refused", ProbeTarget::Mode::TcpConnect, closedPort, false)
+                  << scenario("http", ProbeTarget::Mode::HttpHead, httpServer.serverPort(), false)
+                  << scenario("http-keepalive", ProbeTarget::Mode::HttpHead, httpServer.serverPort(), true)
+                  << scenario("http-faults", ProbeTarget::Mode::HttpHead, injector.serverPort(), false);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+        // Eight paths per probe as h2c streams, over one connection and spread over four
+        ProbeBench::Config multi = scenario("http-multi", ProbeTarget::Mode::HttpMulti, h2cServer.serverPort(), false);
+        for (int i = 0; i < 8; ++i) multi.target.paths << QStringLiteral("/p%1").arg(i);
+        ProbeBench::Config multi4 = multi;
+        multi4.name = QStringLiteral("http-multi-4conn");
+        multi4.target.httpConnections = 4;
+        scenarios << multi << multi4;
+#endif
+
+#ifndef QT_NO_SSL
+        TlsAcceptServer tlsServer;
+        if (parser.isSet(tlsCertOpt)) {
+            QString error;
+            if (!tlsServer.start(parser.value(tlsCertOpt), parser.value(tlsKeyOpt), &error)) return fail(error);
+            ProbeBench::Config full = scenario("tls-full", ProbeTarget::Mode::TlsHandshake, tlsServer.serverPort(), false);
+            full.target.tlsResume = false;
+            full.target.tlsInsecure = true;
+            ProbeBench::Config resumed = full;
+            resumed.name = QStringLiteral("tls-resume");
+            resumed.target.tlsResume = true;
+            scenarios << full << resumed;
+        }
+#endif
+
+        QJsonArray probes;
+        for (const auto& cfg : scenarios) probes.append(runProbes(cfg));
+
+        // Names resolved through DnsCache against the stub backend: no network, and
+        // .invalid never reaches a real resolver even if the stub were not in place.
+        auto* stub = new StubResolverBackend;
+        stub->setAddress(QStringLiteral("tcp.bench.invalid"), QHostAddress(QHostAddress::LocalHost), 60,
+                         qMax(0, parser.value(dnsDelayOpt).toInt()));
+        DnsCache::instance().setBackend(stub);    // забирает владение, чистит кэш
+        ProbeBench::Config stubbed = scenario("dns-stub", ProbeTarget::Mode::TcpMultiAddress, tcpServer.serverPort(), false);
+        stubbed.target.host = QStringLiteral("tcp.bench.invalid");
+        ProbeBench::Config missing = stubbed;
+        missing.name = QStringLiteral("dns-stub-nxdomain");
+        missing.target.host = QStringLiteral("missing.bench.invalid");
+        probes.append(runProbes(stubbed));
+        probes.append(runProbes(missing));
+        const DnsCache::Stats dns = DnsCache::instance().stats();
+        QJsonObject dnsStats;
+        dnsStats.insert("stubQueries", stub->queryCount());
+        dnsStats.insert("hits", qint64(dns.hits));
+        dnsStats.insert("negativeHits", qint64(dns.negativeHits));
+        dnsStats.insert("misses", qint64(dns.misses));
+        dnsStats.insert("coalesced", qint64(dns.coalesced));
+        DnsCache::instance().setBackend(new SystemResolverBackend);
+        report.insert("probes", probes);
+        report.insert("dns", dnsStats);
+
+        QJsonObject servers;
+        servers.insert("tcpAccepted", qint64(tcpServer.accepted()));
+        servers.insert("httpRequests", qint64(httpServer.requests()));
+        servers.insert("httpConnections", qint64(httpServer.connections()));
+        servers.insert("h2cRequests", qint64(h2cServer.requests()));
+        servers.insert("h2cConnections", qint64(h2cServer.connections()));
+        servers.insert("udpEchoed", qint64(udpServer.echoed()));
+#ifndef QT_NO_SSL
+        servers.insert("tlsHandshakes", qint64(tlsServer.handshakes()));
+#endif
+        servers.insert("injectorForwarded", qint64(injector.forwarded()));
+        servers.insert("injectorDropped", qint64(injector.dropped()));
+        report.insert("servers", servers);
+    }
+
+    bool agentOk = true;
+    if (!parser.isSet(noAgentOpt)) {
+        // Whole batches: a partial one would wait for the uplink's flush timer
+        const int batches = qMax(1, (parser.value(agentRecordsOpt).toInt() + AgentUplink::kBatchRecords - 1)
+                                            / AgentUplink::kBatchRecords);
+        const QJsonObject agent = benchAgent(batches * AgentUplink::kBatchRecords, 1000, 60000);
+        agentOk = agent.value("match").toBool();
+        if (!agentOk) std::fprintf(stderr, "qt_netmon_bench: agent loopback lost records\n");
+        report.insert("agent", agent);
+    }
+
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outputOpt)) {
+        QFile f(parser.value(outputOpt));
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate) || f.write(json) != json.size()) {
+            return fail("cannot write " + parser.value(outputOpt) + ": " + f.errorString());
+        }
+    } else {
+        std::fwrite(json.constData(), 1, size_t(json.size()), stdout);
+    }
+    return agentOk ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+#include "AggregateRunner.h"
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cstdio>
+
+namespace {
+
+// UP: every connected agent sees the target up; DOWN: none does; PARTIAL: some
+// do; STALE: no connected agent reports it
+const char* verdict(const Aggregator::TargetSummary& s) {
+    if (s.agentsUp + s.agentsDown == 0) return "STALE";
+    if (s.agentsDown == 0) return "UP";
+    if (s.agentsUp == 0) return "DOWN";
+    return "PARTIAL";
+}
+
+QString millis(qint64 us) {
+    return QString("%1ms").arg(us / 1e3, 0, 'f', 3);
+}
+
+} // namespace
+
+AggregateRunner::AggregateRunner(const Options& opts, QObject* parent)
+        : QObject(parent)
+        , opts_(opts) {
+    reportTimer_.setInterval(qMax(1, opts_.reportIntervalSec) * 1000);
+    QObject::connect(&reportTimer_, &QTimer::timeout, this, &AggregateRunner::report_);
+
+    QObject::connect(&aggregator_, &Aggregator::agentConnected, this, [](const QString& agent, const QString& peer){
+        std::fprintf(stderr, "qt_netmon_cli: agent %s connected from %s\n", qPrintable(agent), qPrintable(peer));
+    });
+    QObject::connect(&aggregator_, &Aggregator::agentDisconnected, this, [](const QString& agent, const QString& why){
+        std::fprintf(stderr, "qt_netmon_cli: agent %s disconnected: %s\n", qPrintable(agent), qPrintable(why));
+    });
+}
+
+AggregateRunner::~AggregateRunner() {
+    ts_.flush();
+}
+
+bool AggregateRunner::open(QString* error) {
+    bool ok = false;
+    if (opts_.outputPath.isEmpty() || opts_.outputPath == QLatin1String("-")) {
+        ok = out_.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    } else {
+        out_.setFileName(opts_.outputPath);
+        ok = out_.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+    }
+    if (!ok) {
+        if (error) *error = out_.errorString();
+        return false;
+    }
+    ts_.setDevice(&out_);
+
+    if (!aggregator_.listen(opts_.address, opts_.port)) {
+        if (error) *error = QString("aggregate %1:%2: %3").arg(opts_.address.toString())
+                                    .arg(opts_.port).arg(aggregator_.errorString());
+        return false;
+    }
+    return true;
+}
+
+void AggregateRunner::run() {
+    reportTimer_.start();
+}
+
+void AggregateRunner::report_() {
+    const QString now = QDateTime::currentDateTime().toString(Qt::ISODateWithMs);
+    for (const auto& s : aggregator_.snapshot()) {
+        if (opts_.format == CliRunner::Format::JsonLines) {
+            ts_ << formatJson_(s, now) << '\n';
+        } else {
+            ts_ << formatText_(s, now) << '\n';
+        }
+    }
+    ts_.flush();
+}
+
+QString AggregateRunner::formatText_(const Aggregator::TargetSummary& s, const QString& ts) const {
+    QString line = QString("%1 %2 %3 agents_up=%4/%5 probes=%6 failed=%7")
+            .arg(ts, s.key, QString::fromLatin1(verdict(s)))
+            .arg(s.agentsUp).arg(s.agentsUp + s.agentsDown)
+            .arg(s.probes).arg(s.failed);
+    if (s.p50Us >= 0) line += QString(" p50=%1 p99=%2").arg(millis(s.p50Us), millis(s.p99Us));
+    QStringList parts;
+    for (const auto& v : s.vantages) {
+        QString part = QString("%1/%2").arg(v.agent, QString::fromLatin1(probeStatusName(v.status)));
+        if (v.p50Us >= 0) part += QString("/%1").arg(millis(v.p50Us));
+        if (!v.connected) part += QStringLiteral("/offline");
+        parts << part;
+    }
+    line += QString(" vantages=%1").arg(parts.join(','));
+    return line;
+}
+
+QByteArray AggregateRunner::formatJson_(const Aggregator::TargetSummary& s, const QString& ts) const {
+    QJsonObject o;
+    o.insert("ts", ts);
+    o.insert("target", s.key);
+    o.insert("status", QString::fromLatin1(verdict(s)));
+    o.insert("agentsUp", s.agentsUp);
+    o.insert("agentsDown", s.agentsDown);
+    o.insert("probes", qint64(s.probes));
+    o.insert("failed", qint64(s.failed));
+    if (s.p50Us >= 0) {
+        o.insert("p50Us", s.p50Us);
+        o.insert("p99Us", s.p99Us);
+    }
+    QJsonArray vantages;
+    for (const auto& v : s.vantages) {
+        QJsonObject vo;
+        vo.insert("agent", v.agent);
+        vo.insert("connected", v.connected);
+        vo.insert("status", QString::fromLatin1(probeStatusName(v.status)));
+        vo.insert("lastMs", v.lastMs);
+        vo.insert("probes", qint64(v.probes));
+        vo.insert("failed", qint64(v.failed));
+        if (v.lastLatencyUs >= 0) vo.insert("latencyUs", v.lastLatencyUs);
+        if (v.p50Us >= 0) {
+            vo.insert("p50Us", v.p50Us);
+            vo.insert("p99Us", v.p99Us);
+        }
+        vantages.append(vo);
+    }
+    o.insert("vantages", vantages);
+    return QJsonDocument(o).toJson(QJsonDocument::Compact);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <QObject>
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+#include <QHostAddress>
+#include "cli/CliRunner.h"
+#include "core/Aggregator.h"
+
+// Headless aggregator (--aggregate): accepts agents and writes a vantage report
+// every reportIntervalSec, one line per target: how many agents see it up or down,
+// merged percentiles and each agent's own view. Probes nothing itself.
+class AggregateRunner : public QObject {
+    Q_OBJECT
+public:
+    struct Options {
+        QString outputPath;               // пусто — stdout
+        CliRunner::Format format = CliRunner::Format::Text;
+        QHostAddress address = QHostAddress::Any;
+        quint16 port = AgentProtocol::kDefaultPort;
+        int reportIntervalSec = 10;
+    };
+
+    explicit AggregateRunner(const Options& opts, QObject* parent = nullptr);
+    ~AggregateRunner() override;
+
+    bool open(QString* error);
+    void run();
+
+private:
+    void report_();
+    QString formatText_(const Aggregator::TargetSummary& s, const QString& ts) const;
+    QByteArray formatJson_(const Aggregator::TargetSummary& s, const QString& ts) const;
+
+    Options opts_;
+    Aggregator aggregator_;
+    QFile out_;
+    QTextStream ts_;
+    QTimer reportTimer_;
+};
@@ -0,0 +1,271 @@
+#include "CliRunner.h"
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cstdio>
+#include "core/TargetListLoader.h"
+#include "core/TraceRecorder.h"
+
+static QString nowIso() {
+    return QDateTime::currentDateTime().toString(Qt::ISODateWithMs);
+}
+
+CliRunner::CliRunner(const Options& opts, QObject* parent)
+        : QObject(parent)
+        , opts_(opts) {
+    controller_.clearTargets();
+    controller_.setMaxConcurrent(opts_.maxConcurrent);
+    controller_.setMaxPerHost(opts_.maxPerHost);
+    controller_.setWorkerThreads(opts_.workerThreads);
+    // Every line shows the whole result, addresses, paths and TLS included
+    controller_.setResultDetail(true);
+    controller_.setRateLimit(opts_.rateLimit, opts_.rateBurst);
+    controller_.setMaxSockets(opts_.maxSockets);
+    QObject::connect(&controller_, &MonitorController::targetProbeFinished, this, &CliRunner::onResult_);
+
+    flushTimer_.setInterval(1000);
+    QObject::connect(&flushTimer_, &QTimer::timeout, this, [this]{
+        ts_.flush();
+        // Killed rather than quit, the trace still holds everything up to the last second.
+        TraceRecorder::instance().flush();
+    });
+}
+
+CliRunner::~CliRunner() {
+    ts_.flush();
+    history_.close();
+}
+
+bool CliRunner::open(QString* error) {
+    bool ok = false;
+    if (opts_.outputPath.isEmpty() || opts_.outputPath == QLatin1String("-")) {
+        ok = out_.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    } else {
+        out_.setFileName(opts_.outputPath);
+        ok = out_.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+    }
+    if (!ok) {
+        if (error) *error = out_.errorString();
+        return false;
+    }
+    ts_.setDevice(&out_);
+
+    if (!opts_.historyDir.isEmpty()) {
+        QString historyError;
+        if (!history_.open(opts_.historyDir, &historyError)) {
+            if (error) *error = QString("history %1: %2").arg(opts_.historyDir, historyError);
+            return false;
+        }
+        controller_.setHistoryStore(&history_);
+    }
+
+    if (opts_.metricsPort != 0) {
+        if (!metrics_.listen(opts_.metricsAddress, opts_.metricsPort)) {
+            if (error) *error = QString("metrics %1:%2: %3").arg(opts_.metricsAddress.toString())
+                                        .arg(opts_.metricsPort).arg(metrics_.errorString());
+            return false;
+        }
+        metrics_.attach(&controller_);
+    }
+
+    if (!opts_.agentHost.isEmpty()) {
+        if (!opts_.agentName.isEmpty()) uplink_.setAgentName(opts_.agentName);
+        const QString to = QString("%1:%2").arg(opts_.agentHost).arg(opts_.agentPort);
+        QObject::connect(&uplink_, &AgentUplink::connected, this, [this, to]{
+            std::fprintf(stderr, "qt_netmon_cli: agent %s connected to %s\n",
+                         qPrintable(uplink_.agentName()), qPrintable(to));
+        });
+        QObject::connect(&uplink_, &AgentUplink::disconnected, this, [this, to](const QString& why){
+            std::fprintf(stderr, "qt_netmon_cli: aggregator %s: %s; %d results queued, %llu dropped\n",
+                         qPrintable(to), qPrintable(why), uplink_.pending(),
+                         static_cast<unsigned long long>(uplink_.dropped()));
+        });
+        uplink_.attach(&controller_);
+        uplink_.connectTo(opts_.agentHost, opts_.agentPort);
+    }
+    return true;
+}
+
+void CliRunner::addTarget(const ProbeTarget& target) {
+    controller_.addTarget(target);
+}
+
+bool CliRunner::loadTargets(const QString& path, const ProbeTarget& defaults, bool watch, QString* error) {
+    delete list_;
+    list_ = new TargetListWatcher(&controller_, path, defaults, this);
+    QObject::connect(list_, &TargetListWatcher::reloaded, this,
+                     [this](const MonitorController::ReloadStats& st, int duplicates, qint64 elapsedMs){
+        std::fprintf(stderr, "qt_netmon_cli: %s: +%d -%d ~%d =%d targets, %d duplicates, %lld ms\n",
+                     qPrintable(list_->path()), st.added, st.removed, st.changed, st.unchanged, duplicates,
+                     static_cast<long long>(elapsedMs));
+    });
+    QObject::connect(list_, &TargetListWatcher::failed, this, [](const QString& why){
+        std::fprintf(stderr, "qt_netmon_cli: reload failed, keeping the current targets: %s\n", qPrintable(why));
+    });
+    if (!list_->reload(error)) return false;
+    if (watch && !opts_.once) list_->watch();
+    return true;
+}
+
+void CliRunner::run() {
+    flushTimer_.start();
+    if (!opts_.once) {
+        controller_.start();
+        return;
+    }
+    pending_ = controller_.targetCount();
+    if (pending_ == 0) {
+        emit done(0);
+        return;
+    }
+    for (auto id : controller_.targetIds()) controller_.checkTarget(id);
+}
+
+void CliRunner::onResult_(quint32 id, const ProbeResult& r) {
+    const ProbeTarget t = controller_.target(id);
+    if (opts_.format == Format::JsonLines) {
+        ts_ << formatJson_(t, r) << '\n';
+    } else {
+        ts_ << formatText_(t, r) << '\n';
+    }
+
+    if (!opts_.once) return;
+    if (r.status != ProbeResult::Status::Up) allUp_ = false;
+    if (--pending_ == 0) {
+        ts_.flush();
+        history_.flush();
+        emit done(allUp_ ? 0 : 1);
+    }
+}
+
+QString CliRunner::formatText_(const ProbeTarget& t, const ProbeResult& r) const {
+    QString line = QString("%1 %2 %3:%4 %5")
+            .arg(nowIso(), QString::fromLatin1(probeModeName(t.mode)), t.host, QString::number(t.port),
+                 QString::fromLatin1(probeStatusName(r.status)));
+    if (r.latencyNs >= 0) line += QString(" latency=%1ms").arg(r.latencyNs / 1e6, 0, 'f', 3);
+    else if (r.latencyMs >= 0) line += QString(" latency=%1ms").arg(r.latencyMs);
+    if (r.dnsMs >= 0) line += QString(" dns=%1ms%2").arg(r.dnsMs).arg(r.dnsCached ? QStringLiteral("(cached)") : QString());
+    if (!r.ip.isEmpty()) line += QString(" ip=%1").arg(r.ip);
+    if (r.httpCode) line += QString(" http=%1").arg(*r.httpCode);
+    if (r.phases.totalUs >= 0) {
+        const PhaseTimings& p = r.phases;
+        line += QString(" phases_us=dns:%1,connect:%2,tls:%3,ttfb:%4,total:%5%6")
+                .arg(p.dnsUs).arg(p.connectUs).arg(p.tlsUs).arg(p.ttfbUs).arg(p.totalUs)
+                .arg(p.reusedConnection ? QStringLiteral(",reused") : QString());
+    }
+    if (!r.addresses.isEmpty()) {
+        QStringList parts;
+        for (const auto& a : r.addresses) {
+            parts << (a.latencyNs >= 0 ? QString("%1/%2/%3ms").arg(a.ip, QString::fromLatin1(probeStatusName(a.status)))
+                                                 .arg(a.latencyNs / 1e6, 0, 'f', 3)
+                                       : QString("%1/%2").arg(a.ip, QString::fromLatin1(probeStatusName(a.status))));
+        }
+        line += QString(" addrs=%1").arg(parts.join(','));
+    }
+    if (!r.paths.isEmpty()) {
+        QStringList parts;
+        for (const auto& p : r.paths) {
+            QString part = QString("%1/%2").arg(p.path, QString::fromLatin1(probeStatusName(p.status)));
+            if (p.httpCode > 0) part += QString("/%1").arg(p.httpCode);
+            if (p.ttfbUs >= 0) part += QString("/%1ms").arg(p.ttfbUs / 1e3, 0, 'f', 3);
+            if (p.http2) part += QStringLiteral("/h2");
+            parts << part;
+        }
+        line += QString(" paths=%1").arg(parts.join(','));
+    }
+    if (r.packetsSent > 0) {
+        line += QString(" loss=%1/%2").arg(r.packetsSent - r.packetsReceived).arg(r.packetsSent);
+        if (r.jitterUs >= 0) line += QString(" jitter=%1ms").arg(r.jitterUs / 1e3, 0, 'f', 3);
+    }
+    if (r.tls) {
+        const QString resume = r.tls->resumed ? QStringLiteral(",resumed")
+                             : r.tls->resumeOffered ? QStringLiteral(",resume-refused") : QString();
+        line += QString(" tls=%1,%2%3").arg(r.tls->protocol, r.tls->cipher, resume);
+        if (r.tls->certNotAfterMs >= 0) {
+            line += QString(" cert_expires=%1").arg(QDateTime::fromMSecsSinceEpoch(r.tls->certNotAfterMs).toUTC()
+                                                            .toString(Qt::ISODate));
+        }
+    }
+    if (!r.message.isEmpty()) line += QString(" msg=\"%1\"").arg(r.message);
+    return line;
+}
+
+QByteArray CliRunner::formatJson_(const ProbeTarget& t, const ProbeResult& r) const {
+    QJsonObject o;
+    o.insert("ts", nowIso());
+    o.insert("host", t.host);
+    o.insert("port", int(t.port));
+    o.insert("mode", QString::fromLatin1(probeModeName(t.mode)));
+    o.insert("status", QString::fromLatin1(probeStatusName(r.status)));
+    if (r.latencyMs >= 0) o.insert("latencyMs", r.latencyMs);
+    if (r.latencyNs >= 0) o.insert("latencyNs", r.latencyNs);
+    if (r.dnsMs >= 0) {
+        o.insert("dnsMs", r.dnsMs);
+        o.insert("dnsCached", r.dnsCached);
+    }
+    if (!r.ip.isEmpty()) o.insert("ip", r.ip);
+    if (r.httpCode) o.insert("httpCode", *r.httpCode);
+    if (r.phases.totalUs >= 0) {
+        const PhaseTimings& p = r.phases;
+        QJsonObject phases;
+        if (p.dnsUs >= 0) phases.insert("dnsUs", p.dnsUs);
+        if (p.connectUs >= 0) phases.insert("connectUs", p.connectUs);
+        if (p.tlsUs >= 0) phases.insert("tlsUs", p.tlsUs);
+        if (p.ttfbUs >= 0) phases.insert("ttfbUs", p.ttfbUs);
+        phases.insert("totalUs", p.totalUs);
+        phases.insert("reused", p.reusedConnection);
+        o.insert("phases", phases);
+    }
+    if (!r.addresses.isEmpty()) {
+        QJsonArray addrs;
+        for (const auto& a : r.addresses) {
+            QJsonObject ao;
+            ao.insert("ip", a.ip);
+            ao.insert("status", QString::fromLatin1(probeStatusName(a.status)));
+            if (a.latencyNs >= 0) ao.insert("latencyNs", a.latencyNs);
+            if (!a.message.isEmpty()) ao.insert("message", a.message);
+            addrs.append(ao);
+        }
+        o.insert("addresses", addrs);
+    }
+    if (!r.paths.isEmpty()) {
+        QJsonArray paths;
+        for (const auto& p : r.paths) {
+            QJsonObject po;
+            po.insert("path", p.path);
+            po.insert("status", QString::fromLatin1(probeStatusName(p.status)));
+            if (p.httpCode > 0) po.insert("httpCode", p.httpCode);
+            if (p.ttfbUs >= 0) po.insert("ttfbUs", p.ttfbUs);
+            if (p.totalUs >= 0) po.insert("totalUs", p.totalUs);
+            po.insert("http2", p.http2);
+            if (!p.message.isEmpty()) po.insert("message", p.message);
+            paths.append(po);
+        }
+        o.insert("paths", paths);
+    }
+    if (r.packetsSent >= 0) {
+        o.insert("packetsSent", r.packetsSent);
+        o.insert("packetsReceived", r.packetsReceived);
+        if (r.jitterUs >= 0) o.insert("jitterUs", r.jitterUs);
+    }
+    if (r.tls) {
+        QJsonObject tls;
+        tls.insert("protocol", r.tls->protocol);
+        tls.insert("cipher", r.tls->cipher);
+        tls.insert("resumeOffered", r.tls->resumeOffered);
+        tls.insert("resumed", r.tls->resumed);
+        if (r.tls->certNotAfterMs >= 0) tls.insert("certNotAfterMs", r.tls->certNotAfterMs);
+        if (!r.tls->verifyError.isEmpty()) tls.insert("verifyError", r.tls->verifyError);
+        o.insert("tls", tls);
+    }
+    if (!r.message.isEmpty()) o.insert("message", r.message);
+    return QJsonDocument(o).toJson(QJsonDocument::Compact);
+}
+
+bool CliRunner::parseTargetSpec(const QString& spec, const ProbeTarget& defaults, ProbeTarget* out) {
+    ProbeTarget t = defaults;
+    if (!TargetListLoader::parseSpec(spec, &t)) return false;
+    *out = t;
+    return true;
+}
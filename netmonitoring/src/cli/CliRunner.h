@@ -0,0 +1,72 @@
+#pragma once
+#include <QObject>
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+#include <QHostAddress>
+#include "core/AgentUplink.h"
+#include "core/MetricsExporter.h"
+#include "core/MonitorController.h"
+#include "core/TargetListWatcher.h"
+#include "core/TimeSeriesStore.h"
+
+// Headless front-end: feeds targets to MonitorController and writes one line per
+// probe result to stdout or a file. With agentHost set it also runs as an agent,
+// streaming every result to an aggregator (see AggregateRunner).
+class CliRunner : public QObject {
+    Q_OBJECT
+public:
+    enum class Format { Text, JsonLines };
+
+    struct Options {
+        QString outputPath;               // пусто — stdout
+        Format format = Format::Text;
+        bool once = false;                // одна проверка каждой цели и выход
+        int maxConcurrent = 256;
+        int maxPerHost = 4;
+        int workerThreads = 0;            // 0 — пробы в главном потоке
+        double rateLimit = 0;             // запусков проверок в секунду, 0 — без ограничения
+        int rateBurst = 0;                // 0 — десятая доля секундного бюджета
+        int maxSockets = 0;               // проверок в полёте на весь процесс, 0 — без ограничения
+        QString historyDir;               // пусто — без истории на диске
+        QHostAddress metricsAddress = QHostAddress::Any;
+        quint16 metricsPort = 0;          // 0 — без /metrics
+        QString agentHost;                // пусто — результаты никуда не отправляются
+        quint16 agentPort = AgentProtocol::kDefaultPort;
+        QString agentName;                // пусто — имя машины
+    };
+
+    explicit CliRunner(const Options& opts, QObject* parent = nullptr);
+    ~CliRunner() override;
+
+    bool open(QString* error);
+    void addTarget(const ProbeTarget& target);
+    // Targets from a list file (TargetListLoader formats); with `watch` the file is
+    // reloaded on every change and applied as a diff
+    bool loadTargets(const QString& path, const ProbeTarget& defaults, bool watch, QString* error);
+    int targetCount() const { return controller_.targetCount(); }
+    void run();
+
+    // "host", "host:port", "[v6addr]:port"; port/mode fall back to defaults
+    static bool parseTargetSpec(const QString& spec, const ProbeTarget& defaults, ProbeTarget* out);
+
+signals:
+    void done(int exitCode);
+
+private:
+    void onResult_(quint32 id, const ProbeResult& r);
+    QString formatText_(const ProbeTarget& t, const ProbeResult& r) const;
+    QByteArray formatJson_(const ProbeTarget& t, const ProbeResult& r) const;
+
+    Options opts_;
+    TimeSeriesStore history_;             // объявлен раньше контроллера: переживает его
+    MonitorController controller_;
+    MetricsExporter metrics_;
+    AgentUplink uplink_;
+    TargetListWatcher* list_ = nullptr;
+    QFile out_;
+    QTextStream ts_;
+    QTimer flushTimer_;
+    int pending_ = 0;
+    bool allUp_ = true;
+};
@@ -0,0 +1,112 @@
+#include "HistoryQuery.h"
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+namespace {
+
+QString isoOf(qint64 ms) {
+    return QDateTime::fromMSecsSinceEpoch(ms).toString(Qt::ISODateWithMs);
+}
+
+QString millis(qint64 us) {
+    return QString("%1ms").arg(us / 1e3, 0, 'f', 3);
+}
+
+const char* statusOf(const TsRecord& r) {
+    return probeStatusName(ProbeResult::Status(r.status));
+}
+
+} // namespace
+
+int HistoryQuery::run(const Options& opts, QString* error) {
+    TimeSeriesStore store;
+    TimeSeriesStore::Options so;
+    so.readOnly = true;
+    store.setOptions(so);
+    if (!store.open(opts.dir, error)) return -1;
+    const quint32 series = store.findSeries(opts.key);
+    if (series == 0) {
+        if (error) *error = QString("no history for %1 in %2").arg(opts.key, opts.dir);
+        return -1;
+    }
+
+    QFile out;
+    bool ok = false;
+    if (opts.outputPath.isEmpty() || opts.outputPath == QLatin1String("-")) {
+        ok = out.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    } else {
+        out.setFileName(opts.outputPath);
+        ok = out.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+    }
+    if (!ok) {
+        if (error) *error = out.errorString();
+        return -1;
+    }
+    QTextStream ts(&out);
+    const bool json = opts.format == CliRunner::Format::JsonLines;
+
+    int rows = 0;
+    if (opts.resolution == TimeSeriesStore::Resolution::Raw) {
+        for (const TsRecord& r : store.queryRaw(series, opts.fromMs, opts.toMs)) {
+            if (json) ts << formatJson_(opts.key, r) << '\n';
+            else ts << formatText_(r) << '\n';
+            ++rows;
+        }
+    } else {
+        for (const TsRollup& r : store.queryRollup(series, opts.resolution, opts.fromMs, opts.toMs)) {
+            if (json) ts << formatJson_(opts.key, r) << '\n';
+            else ts << formatText_(r) << '\n';
+            ++rows;
+        }
+    }
+    ts.flush();
+    return rows;
+}
+
+QString HistoryQuery::formatText_(const TsRecord& r) {
+    QString line = QString("%1 %2").arg(isoOf(r.tsMs), QString::fromLatin1(statusOf(r)));
+    if (r.latencyUs >= 0) line += QString(" latency=%1").arg(millis(r.latencyUs));
+    if (r.httpCode) line += QString(" http=%1").arg(r.httpCode);
+    if (r.flags & TsRecord::DnsCached) line += QStringLiteral(" dns=cached");
+    if (r.flags & TsRecord::ReusedConnection) line += QStringLiteral(" reused");
+    return line;
+}
+
+QString HistoryQuery::formatText_(const TsRollup& r) {
+    QString line = QString("%1 probes=%2 up=%3").arg(isoOf(r.bucketMs)).arg(r.count).arg(r.up);
+    if (r.samples > 0) {
+        line += QString(" min=%1 avg=%2 max=%3")
+                .arg(millis(r.minUs), millis(r.sumUs / qint64(r.samples)), millis(r.maxUs));
+    }
+    return line;
+}
+
+QByteArray HistoryQuery::formatJson_(const QString& key, const TsRecord& r) {
+    QJsonObject o;
+    o.insert("ts", isoOf(r.tsMs));
+    o.insert("target", key);
+    o.insert("status", QString::fromLatin1(statusOf(r)));
+    if (r.latencyUs >= 0) o.insert("latencyUs", r.latencyUs);
+    if (r.httpCode) o.insert("httpCode", int(r.httpCode));
+    o.insert("dnsCached", bool(r.flags & TsRecord::DnsCached));
+    o.insert("reused", bool(r.flags & TsRecord::ReusedConnection));
+    return QJsonDocument(o).toJson(QJsonDocument::Compact);
+}
+
+QByteArray HistoryQuery::formatJson_(const QString& key, const TsRollup& r) {
+    QJsonObject o;
+    o.insert("ts", isoOf(r.bucketMs));
+    o.insert("target", key);
+    o.insert("probes", qint64(r.count));
+    o.insert("up", qint64(r.up));
+    o.insert("latencySamples", qint64(r.samples));
+    if (r.samples > 0) {
+        o.insert("minUs", r.minUs);
+        o.insert("avgUs", r.sumUs / qint64(r.samples));
+        o.insert("maxUs", r.maxUs);
+    }
+    return QJsonDocument(o).toJson(QJsonDocument::Compact);
+}
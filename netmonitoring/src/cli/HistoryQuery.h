@@ -0,0 +1,30 @@
+#pragma once
+#include <QString>
+#include "cli/CliRunner.h"
+#include "core/TimeSeriesStore.h"
+
+// Offline reader for a --history directory (--history-query): writes one target's
+// stored results over [fromMs, toMs], raw or as minute/hour rollups, and returns.
+// The store is opened read-only, so a monitor may keep writing to the directory;
+// records it has not flushed yet are not seen.
+class HistoryQuery {
+public:
+    struct Options {
+        QString dir;
+        QString key;                      // TimeSeriesStore::seriesKey цели
+        TimeSeriesStore::Resolution resolution = TimeSeriesStore::Resolution::Raw;
+        qint64 fromMs = 0;
+        qint64 toMs = 0;
+        QString outputPath;               // пусто — stdout
+        CliRunner::Format format = CliRunner::Format::Text;
+    };
+
+    // Rows written, or -1 with `error` set
+    static int run(const Options& opts, QString* error);
+
+private:
+    static QString formatText_(const TsRecord& r);
+    static QString formatText_(const TsRollup& r);
+    static QByteArray formatJson_(const QString& key, const TsRecord& r);
+    static QByteArray formatJson_(const QString& key, const TsRollup& r);
+};
@@ -0,0 +1,266 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QThread>
+#include <cstdio>
+#include "cli/AggregateRunner.h"
+#include "cli/CliRunner.h"
+#include "cli/HistoryQuery.h"
+#include "core/DnsCache.h"
+#include "core/NetworkAccessPool.h"
+#include "core/ProbeScript.h"
+#include "core/SystemResolverBackend.h"
+#include "core/TargetListLoader.h"
+#include "core/TraceRecorder.h"
+
+static int fail(const QString& msg) {
+    std::fprintf(stderr, "qt_netmon_cli: %s\n", qPrintable(msg));
+    return 2;
+}
+
+// "[addr:]port" or "[v6addr]:port"; without an address `addr` is left as is
+static bool parseListenSpec(const QString& spec, QHostAddress* addr, quint16* port) {
+    const int colon = spec.lastIndexOf(':');
+    bool ok = false;
+    const uint p = spec.mid(colon + 1).toUInt(&ok);
+    if (!ok || p == 0 || p > 65535) return false;
+    *port = static_cast<quint16>(p);
+    if (colon <= 0) return true;
+    QString a = spec.left(colon);
+    if (a.startsWith('[') && a.endsWith(']')) a = a.mid(1, a.size() - 2);
+    return addr->setAddress(a);
+}
+
+// "host", "host:port" or "[v6addr]:port"; without a port `port` is left as is
+static bool parseHostSpec(const QString& spec, QString* host, quint16* port) {
+    QString h = spec;
+    const int colon = spec.lastIndexOf(':');
+    const bool bracketed = spec.startsWith('[');
+    if (colon > 0 && (bracketed ? spec.at(colon - 1) == ']' : spec.indexOf(':') == colon)) {
+        bool ok = false;
+        const uint p = spec.mid(colon + 1).toUInt(&ok);
+        if (!ok || p == 0 || p > 65535) return false;
+        *port = static_cast<quint16>(p);
+        h = spec.left(colon);
+    }
+    if (h.startsWith('[') && h.endsWith(']')) h = h.mid(1, h.size() - 2);
+    if (h.isEmpty()) return false;
+    *host = h;
+    return true;
+}
+
+// "now", "-<n>[s|m|h|d]" relative to now, or an ISO 8601 date/time
+static bool parseTimeSpec(const QString& spec, qint64 nowMs, qint64* outMs) {
+    const QString s = spec.trimmed();
+    if (s == QLatin1String("now")) {
+        *outMs = nowMs;
+        return true;
+    }
+    if (s.startsWith('-') && s.size() > 1) {
+        qint64 unitMs = 1000;
+        QString n = s.mid(1);
+        switch (n.at(n.size() - 1).toLatin1()) {
+            case 's': unitMs = 1000; n.chop(1); break;
+            case 'm': unitMs = 60 * 1000; n.chop(1); break;
+            case 'h': unitMs = 3600 * 1000; n.chop(1); break;
+            case 'd': unitMs = 86400 * 1000LL; n.chop(1); break;
+            default: break;
+        }
+        bool ok = false;
+        const double v = n.toDouble(&ok);
+        if (!ok || v < 0) return false;
+        *outMs = nowMs - qint64(v * double(unitMs));
+        return true;
+    }
+    const QDateTime t = QDateTime::fromString(s, Qt::ISODateWithMs);
+    if (!t.isValid()) return false;
+    *outMs = t.toMSecsSinceEpoch();
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("qt_netmon_cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless network monitor: TCP connect / HTTP HEAD probes, standalone or as agents of an aggregator.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("targets", "Targets as host[:port] or [ipv6]:port.", "[targets...]");
+
+    const QCommandLineOption fileOpt({"f", "targets-file"}, "Read targets from <file>: JSON (array or one object per line), CSV with a header row, or text lines host[:port] [mode].", "file");
+    const QCommandLineOption watchOpt("watch", "-f: reload the targets file when it changes; unchanged targets keep running.");
+    const QCommandLineOption modeOpt({"m", "mode"}, "Default probe mode: tcp, http, tcp-native (epoll engine, Linux), tcp-multi (every resolved address), udp-echo or udp-dns (packet trains, Linux), tls (handshake), script (multi-step check, see --script), http-multi (--paths over shared HTTP/2 connections).", "mode", "tcp");
+    const QCommandLineOption portOpt({"p", "port"}, "Default port.", "port", "80");
+    const QCommandLineOption intervalOpt({"i", "interval"}, "Probe interval in seconds.", "sec", "5");
+    const QCommandLineOption adaptiveOpt("adaptive", "Adapt each target's interval: slower while stable, faster after a change, backing off while down.");
+    const QCommandLineOption minIntervalOpt("min-interval", "--adaptive: shortest interval in seconds (default: interval/4, at least 0.5).", "sec");
+    const QCommandLineOption maxIntervalOpt("max-interval", "--adaptive: longest interval in seconds (default: interval*8).", "sec");
+    const QCommandLineOption timeoutOpt({"t", "timeout"}, "Probe timeout in milliseconds.", "ms", "3000");
+    const QCommandLineOption outputOpt({"o", "output"}, "Append results to <file> instead of stdout.", "file");
+    const QCommandLineOption formatOpt("format", "Output format: text or jsonl.", "format", "text");
+    const QCommandLineOption keepAliveOpt("keep-alive", "HTTP: reuse connections between probes instead of sending Connection: close.");
+    const QCommandLineOption onceOpt("once", "Probe every target once and exit (exit code 1 if any is not UP).");
+    const QCommandLineOption concurrentOpt("max-concurrent", "Maximum probes in flight.", "n", "256");
+    const QCommandLineOption perHostOpt("max-per-host", "Maximum probes in flight per host.", "n", "4");
+    const QCommandLineOption rateOpt("rate", "Start at most <n> probes per second over all targets and threads (0: no limit).", "n", "0");
+    const QCommandLineOption burstOpt("rate-burst", "--rate: probes that may start back to back (default: a tenth of the rate).", "n", "0");
+    const QCommandLineOption socketsOpt("max-sockets", "Maximum probes in flight over all threads (0: no limit).", "n", "0");
+    const QCommandLineOption addressesOpt("max-addresses", "tcp-multi: probe at most <n> resolved addresses (0: all).", "n", "0");
+    const QCommandLineOption udpPacketsOpt("udp-packets", "udp-*: packets per probe; loss and jitter are taken over them.", "n", "5");
+    const QCommandLineOption udpSpacingOpt("udp-spacing", "udp-*: milliseconds between the packets of one probe.", "ms", "20");
+    const QCommandLineOption udpQueryOpt("udp-query", "udp-dns: name to ask for (A record); empty asks the root for NS.", "name");
+    const QCommandLineOption noResumeOpt("no-tls-resume", "tls: always do a full handshake instead of resuming the last session.");
+    const QCommandLineOption insecureOpt("insecure", "tls: report certificate errors but do not count them as DOWN (self-signed test servers).");
+    const QCommandLineOption scriptOpt("script", "script: steps of the check, e.g. 'send \"PING\\r\\n\"; expect \"+PONG\" 500', or a preset: redis, smtp, http, https.", "steps");
+    const QCommandLineOption pathsOpt("paths", "http-multi: paths to request on every host, comma separated (default: /).", "list");
+    const QCommandLineOption httpConnsOpt("http-connections", "http-multi: connections per host the paths are spread over.", "n", "1");
+    const QCommandLineOption metricsOpt("metrics", "Serve OpenMetrics on http://[<addr>:]<port>/metrics.", "[addr:]port");
+    const QCommandLineOption threadsOpt({"j", "threads"}, "Probe worker threads, each with its own shard of targets (0: main thread).", "n",
+                                        QString::number(qBound(1, QThread::idealThreadCount() - 1, 8)));
+    const QCommandLineOption traceOpt("trace", "Write spans of probes and of the monitor's own callbacks to <file> (Chrome trace JSON, opens in ui.perfetto.dev).", "file");
+    const QCommandLineOption agentOpt("agent", "Also stream every result to the aggregator at <host>[:port] (default port 7710), reconnecting as needed.", "host:port");
+    const QCommandLineOption agentNameOpt("agent-name", "--agent: name this agent reports under (default: the machine's host name).", "name");
+    const QCommandLineOption aggregateOpt("aggregate", "Run as the aggregator only: accept agents on [<addr>:]<port> and report every target as all agents see it. Takes no targets.", "[addr:]port");
+    const QCommandLineOption reportOpt("report-interval", "--aggregate: seconds between reports.", "sec", "10");
+    const QCommandLineOption strictNxOpt("strict-nxdomain", "Take a DNS NXDOMAIN as final instead of asking the system resolver (hosts file, search domains) again.");
+    const QCommandLineOption historyOpt("history", "Keep probe history in <dir> (binary segments with minute/hour rollups).", "dir");
+    const QCommandLineOption queryOpt("history-query", "Print the stored results of <target> (host[:port], mode from -m) from --history and exit.", "target");
+    const QCommandLineOption fromOpt("from", "--history-query: start of the range: now, -<n>[s|m|h|d] or ISO 8601.", "time", "-1h");
+    const QCommandLineOption toOpt("to", "--history-query: end of the range, as --from.", "time", "now");
+    const QCommandLineOption resolutionOpt("resolution", "--history-query: raw, minute or hour.", "res", "raw");
+    for (const auto& o : {fileOpt, watchOpt, modeOpt, portOpt, intervalOpt, adaptiveOpt, minIntervalOpt, maxIntervalOpt,
+                          timeoutOpt, outputOpt, formatOpt, rateOpt, burstOpt, socketsOpt,
+                          keepAliveOpt, addressesOpt, udpPacketsOpt, udpSpacingOpt, udpQueryOpt, noResumeOpt, insecureOpt, scriptOpt,
+                          pathsOpt, httpConnsOpt,
+                          onceOpt, concurrentOpt, perHostOpt, threadsOpt, strictNxOpt, historyOpt, metricsOpt, traceOpt,
+                          agentOpt, agentNameOpt, aggregateOpt, reportOpt, queryOpt, fromOpt, toOpt, resolutionOpt}) {
+        parser.addOption(o);
+    }
+    parser.process(app);
+
+    ProbeTarget defaults;
+    if (!parseProbeMode(parser.value(modeOpt), &defaults.mode)) return fail("unknown mode: " + parser.value(modeOpt));
+    bool ok = false;
+    const uint port = parser.value(portOpt).toUInt(&ok);
+    if (!ok || port == 0 || port > 65535) return fail("bad port: " + parser.value(portOpt));
+    defaults.port = static_cast<quint16>(port);
+    defaults.intervalMs = qMax(1, parser.value(intervalOpt).toInt()) * 1000;
+    defaults.adaptive = parser.isSet(adaptiveOpt);
+    if (parser.isSet(minIntervalOpt)) defaults.minIntervalMs = qMax(1, int(parser.value(minIntervalOpt).toDouble() * 1000));
+    if (parser.isSet(maxIntervalOpt)) defaults.maxIntervalMs = qMax(1, int(parser.value(maxIntervalOpt).toDouble() * 1000));
+    defaults.timeoutMs = qMax(1, parser.value(timeoutOpt).toInt());
+    defaults.keepAlive = parser.isSet(keepAliveOpt);
+    defaults.maxAddresses = qMax(0, parser.value(addressesOpt).toInt());
+    defaults.udpPackets = qBound(1, parser.value(udpPacketsOpt).toInt(), 1000);
+    defaults.udpSpacingMs = qMax(0, parser.value(udpSpacingOpt).toInt());
+    defaults.udpQuery = parser.value(udpQueryOpt);
+    defaults.tlsResume = !parser.isSet(noResumeOpt);
+    defaults.tlsInsecure = parser.isSet(insecureOpt);
+    defaults.script = parser.value(scriptOpt).trimmed();
+    if (!TargetListLoader::setField(&defaults, QStringLiteral("paths"), parser.value(pathsOpt))) {
+        return fail("bad paths: " + parser.value(pathsOpt));
+    }
+    defaults.httpConnections = qBound(1, parser.value(httpConnsOpt).toInt(), NetworkAccessPool::kMaxSlots);
+    if (defaults.mode == ProbeTarget::Mode::Script) {
+        ProbeScript script;
+        QString why;
+        if (!ProbeScript::parse(defaults.script, &script, &why)) return fail("bad script: " + why);
+    }
+
+    CliRunner::Options opts;
+    opts.outputPath = parser.value(outputOpt);
+    opts.once = parser.isSet(onceOpt);
+    opts.maxConcurrent = qMax(1, parser.value(concurrentOpt).toInt());
+    opts.maxPerHost = qMax(1, parser.value(perHostOpt).toInt());
+    opts.workerThreads = qMax(0, parser.value(threadsOpt).toInt());
+    opts.rateLimit = qMax(0.0, parser.value(rateOpt).toDouble());
+    opts.rateBurst = qMax(0, parser.value(burstOpt).toInt());
+    opts.maxSockets = qMax(0, parser.value(socketsOpt).toInt());
+    opts.historyDir = parser.value(historyOpt);
+    if (parser.isSet(metricsOpt) && !parseListenSpec(parser.value(metricsOpt), &opts.metricsAddress, &opts.metricsPort)) {
+        return fail("bad metrics address: " + parser.value(metricsOpt));
+    }
+    if (parser.isSet(agentOpt)) {
+        if (!parseHostSpec(parser.value(agentOpt), &opts.agentHost, &opts.agentPort)) {
+            return fail("bad aggregator address: " + parser.value(agentOpt));
+        }
+        // Results of the last probes would still be queued when --once exits
+        if (opts.once) return fail("--agent streams continuously and cannot be combined with --once");
+        opts.agentName = parser.value(agentNameOpt).trimmed();
+    }
+    const QString format = parser.value(formatOpt).toLower();
+    if (format == QLatin1String("jsonl")) opts.format = CliRunner::Format::JsonLines;
+    else if (format != QLatin1String("text")) return fail("unknown format: " + format);
+
+    if (parser.isSet(aggregateOpt)) {
+        AggregateRunner::Options agg;
+        agg.outputPath = opts.outputPath;
+        agg.format = opts.format;
+        agg.reportIntervalSec = qMax(1, parser.value(reportOpt).toInt());
+        if (!parseListenSpec(parser.value(aggregateOpt), &agg.address, &agg.port)) {
+            return fail("bad aggregate address: " + parser.value(aggregateOpt));
+        }
+        if (!parser.positionalArguments().isEmpty() || parser.isSet(fileOpt)) return fail("--aggregate takes no targets");
+        AggregateRunner aggregator(agg);
+        QString error;
+        if (!aggregator.open(&error)) return fail(error);
+        aggregator.run();
+        return app.exec();
+    }
+
+    if (parser.isSet(queryOpt)) {
+        if (opts.historyDir.isEmpty()) return fail("--history-query needs --history <dir>");
+        ProbeTarget t;
+        if (!CliRunner::parseTargetSpec(parser.value(queryOpt), defaults, &t)) {
+            return fail("bad target: " + parser.value(queryOpt));
+        }
+        HistoryQuery::Options q;
+        q.dir = opts.historyDir;
+        q.key = TimeSeriesStore::seriesKey(t);
+        q.outputPath = opts.outputPath;
+        q.format = opts.format;
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        if (!parseTimeSpec(parser.value(fromOpt), now, &q.fromMs)) return fail("bad time: " + parser.value(fromOpt));
+        if (!parseTimeSpec(parser.value(toOpt), now, &q.toMs)) return fail("bad time: " + parser.value(toOpt));
+        const QString res = parser.value(resolutionOpt).toLower();
+        if (res == QLatin1String("minute")) q.resolution = TimeSeriesStore::Resolution::Minute;
+        else if (res == QLatin1String("hour")) q.resolution = TimeSeriesStore::Resolution::Hour;
+        else if (res != QLatin1String("raw")) return fail("unknown resolution: " + res);
+        QString error;
+        const int rows = HistoryQuery::run(q, &error);
+        if (rows < 0) return fail(error);
+        return rows > 0 ? 0 : 1;
+    }
+
+    QVector<ProbeTarget> targets;
+    for (const QString& spec : parser.positionalArguments()) {
+        ProbeTarget t;
+        if (!CliRunner::parseTargetSpec(spec, defaults, &t)) return fail("bad target: " + spec);
+        targets.push_back(t);
+    }
+
+    if (parser.isSet(strictNxOpt)) {
+        auto* resolver = new SystemResolverBackend;
+        resolver->setNxDomainFinal(true);
+        DnsCache::instance().setBackend(resolver);
+    }
+
+    CliRunner runner(opts);
+    QString error;
+    if (!runner.open(&error)) return fail("cannot open output: " + error);
+    for (const auto& t : targets) runner.addTarget(t);
+    if (parser.isSet(fileOpt) && !runner.loadTargets(parser.value(fileOpt), defaults, parser.isSet(watchOpt), &error)) {
+        return fail(error);
+    }
+    if (runner.targetCount() == 0 && !parser.isSet(watchOpt)) return fail("no targets given (see --help)");
+
+    if (parser.isSet(traceOpt) && !TraceRecorder::instance().start(parser.value(traceOpt), &error)) {
+        return fail("cannot open trace: " + error);
+    }
+
+    QObject::connect(&runner, &CliRunner::done, &app, [](int code){ QCoreApplication::exit(code); });
+    runner.run();
+    const int code = app.exec();
+    TraceRecorder::instance().stop();
+    return code;
+}
@@ -0,0 +1,71 @@
+#include "AdaptiveInterval.h"
+#include <cmath>
+
+namespace {
+
+constexpr double kAvgWeight = 0.2;        // EWMA: вес нового отсчёта
+
+} // namespace
+
+void AdaptiveInterval::configure(const ProbeTarget& target) {
+    baseMs_ = qMax(1, target.intervalMs);
+    minMs_ = target.minIntervalMs > 0 ? target.minIntervalMs : qMax(500, baseMs_ / 4);
+    minMs_ = qMin(minMs_, baseMs_);
+    maxMs_ = target.maxIntervalMs > 0 ? qMax(baseMs_, target.maxIntervalMs) : baseMs_ * 8;
+    reset();
+}
+
+void AdaptiveInterval::reset() {
+    currentMs_ = baseMs_;
+    burstLeft_ = stableRuns_ = downRuns_ = 0;
+    avgUs_ = -1;
+}
+
+void AdaptiveInterval::burst_() {
+    burstLeft_ = kBurstProbes;
+    stableRuns_ = 0;
+    currentMs_ = minMs_;
+}
+
+int AdaptiveInterval::update(const ProbeResult& r) {
+    if (r.status != ProbeResult::Status::Up) {
+        stableRuns_ = 0;
+        if (downRuns_++ == 0) {
+            // Fresh failure: confirm it (or see it clear) quickly.
+            burst_();
+        }
+        if (burstLeft_ > 0) {
+            --burstLeft_;
+            currentMs_ = minMs_;
+        } else {
+            // Still down: the base interval, doubled for every further failure.
+            const int shift = qMin(downRuns_ - kBurstProbes - 1, 30);
+            const qint64 backoff = qint64(baseMs_) << qMax(0, shift);
+            currentMs_ = int(qMin<qint64>(backoff, maxMs_));
+        }
+        return currentMs_;
+    }
+
+    const qint64 us = r.latencyNs >= 0 ? r.latencyNs / 1000 : r.latencyMs * 1000;
+    const bool recovered = downRuns_ > 0;
+    downRuns_ = 0;
+    bool shifted = false;
+    if (avgUs_ >= 0 && us >= 0) {
+        const double delta = std::abs(double(us) - avgUs_);
+        shifted = delta > kShiftRatio * avgUs_ && delta > double(kShiftFloorUs);
+    }
+    if (us >= 0) avgUs_ = avgUs_ < 0 ? double(us) : avgUs_ + kAvgWeight * (double(us) - avgUs_);
+
+    if (recovered || shifted) burst_();
+    if (burstLeft_ > 0) {
+        --burstLeft_;
+        currentMs_ = minMs_;
+        return currentMs_;
+    }
+    if (currentMs_ < baseMs_) currentMs_ = baseMs_;   // после всплеска — обратно к базовому
+    if (++stableRuns_ >= kStableRuns) {
+        stableRuns_ = 0;
+        currentMs_ = qMin(maxMs_, currentMs_ * 2);
+    }
+    return currentMs_;
+}
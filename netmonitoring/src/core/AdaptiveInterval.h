@@ -0,0 +1,43 @@
+#pragma once
+#include <QtGlobal>
+#include "ProbeResult.h"
+#include "ProbeTarget.h"
+
+// Per-target probe interval that follows the target's behaviour:
+//  - a healthy target with steady latency is probed less and less often, the
+//    interval doubling every `kStableRuns` such results up to maxIntervalMs;
+//  - a failure, a recovery or a latency shift (more than `kShiftRatio` off the
+//    running average) switches to minIntervalMs for the next `kBurstProbes` probes;
+//  - a target still down after that burst backs off exponentially from the base
+//    interval up to maxIntervalMs.
+// Zero bounds in ProbeTarget mean base/4 (at least 500 ms) and base*8.
+class AdaptiveInterval {
+public:
+    static constexpr int kStableRuns = 5;
+    static constexpr int kBurstProbes = 3;
+    static constexpr double kShiftRatio = 0.5;
+    static constexpr qint64 kShiftFloorUs = 5000;   // сдвиги меньше 5 мс — шум
+
+    void configure(const ProbeTarget& target);
+    void reset();
+
+    // Next interval after this result
+    int update(const ProbeResult& r);
+    int intervalMs() const { return currentMs_; }
+
+    int minIntervalMs() const { return minMs_; }
+    int maxIntervalMs() const { return maxMs_; }
+
+private:
+    void burst_();
+
+    int baseMs_ = 5000;
+    int minMs_ = 1250;
+    int maxMs_ = 40000;
+    int currentMs_ = 5000;
+
+    int burstLeft_ = 0;                   // проверок до конца учащённого режима
+    int stableRuns_ = 0;                  // подряд ровных UP с последнего изменения интервала
+    int downRuns_ = 0;                    // подряд неудачных
+    double avgUs_ = -1;                   // EWMA задержки по UP
+};
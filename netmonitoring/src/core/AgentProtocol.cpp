@@ -0,0 +1,191 @@
+#include "AgentProtocol.h"
+
+namespace {
+
+void putVarint(QByteArray& out, quint64 v) {
+    while (v >= 0x80) {
+        out += char(quint8(v) | 0x80);
+        v >>= 7;
+    }
+    out += char(v);
+}
+
+void putSigned(QByteArray& out, qint64 v) {
+    putVarint(out, (quint64(v) << 1) ^ quint64(v >> 63));
+}
+
+void putString(QByteArray& out, const QString& s) {
+    const QByteArray utf8 = s.toUtf8();
+    putVarint(out, quint64(utf8.size()));
+    out += utf8;
+}
+
+QByteArray& frameEnd(QByteArray& frame) {
+    const quint32 len = quint32(frame.size() - 4);
+    frame[0] = char(len >> 24);
+    frame[1] = char(len >> 16);
+    frame[2] = char(len >> 8);
+    frame[3] = char(len);
+    return frame;
+}
+
+// Length placeholder and type; frameEnd() fills in the length once the payload is there
+QByteArray frameStart(AgentProtocol::Type type, int reserve) {
+    QByteArray frame;
+    frame.reserve(5 + reserve);
+    frame.append(4, '\0');
+    frame += char(type);
+    return frame;
+}
+
+bool getVarint(const char*& p, const char* end, quint64* v) {
+    quint64 out = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) return false;
+        const quint8 b = quint8(*p++);
+        out |= quint64(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = out;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool getSigned(const char*& p, const char* end, qint64* v) {
+    quint64 u = 0;
+    if (!getVarint(p, end, &u)) return false;
+    *v = qint64(u >> 1) ^ -qint64(u & 1);
+    return true;
+}
+
+bool getString(const char*& p, const char* end, QString* s) {
+    quint64 len = 0;
+    if (!getVarint(p, end, &len) || len > quint64(end - p)) return false;
+    *s = QString::fromUtf8(p, int(len));
+    p += len;
+    return true;
+}
+
+// value + 1 on the wire, 0 for "not measured"
+quint64 optional(qint64 v) {
+    return v < 0 ? 0 : quint64(v) + 1;
+}
+
+} // namespace
+
+QByteArray AgentProtocol::Encoder::hello(const QString& agent) {
+    reset();
+    QByteArray f = frameStart(Type::Hello, 64);
+    putVarint(f, kVersion);
+    putString(f, agent);
+    return frameEnd(f);
+}
+
+QByteArray AgentProtocol::Encoder::target(quint32 id, const QString& key) {
+    QByteArray f = frameStart(Type::Target, 64);
+    putVarint(f, id);
+    putString(f, key);
+    return frameEnd(f);
+}
+
+QByteArray AgentProtocol::Encoder::batch(const ProbeRecord* records, int count) {
+    QByteArray f = frameStart(Type::Batch, count * 10);
+    putVarint(f, quint64(count));
+    qint64 prevId = 0;
+    for (int i = 0; i < count; ++i) {
+        const ProbeRecord& r = records[i];
+        putSigned(f, qint64(r.target) - prevId);
+        prevId = r.target;
+        f += char(quint8(r.status & 0x7) | quint8((r.flags & 0x1f) << 3));
+        putSigned(f, r.finishedMs - prevMs_);
+        prevMs_ = r.finishedMs;
+        putVarint(f, optional(r.latencyUs()));
+        putVarint(f, optional(r.dnsUs));
+        putVarint(f, optional(r.httpCode));
+    }
+    return frameEnd(f);
+}
+
+void AgentProtocol::Decoder::feed(const QByteArray& bytes) {
+    // Consumed frames are dropped once they are most of the buffer. Done here rather
+    // than in next(), so a stream that always ends in a partial frame compacts too.
+    if (pos_ > 0 && pos_ * 2 >= buffer_.size()) {
+        buffer_.remove(0, pos_);
+        pos_ = 0;
+    }
+    buffer_ += bytes;
+}
+
+bool AgentProtocol::Decoder::next(Message* out) {
+    if (failed()) return false;
+    if (buffer_.size() - pos_ < 5) return false;
+    const auto* h = reinterpret_cast<const uchar*>(buffer_.constData() + pos_);
+    const quint32 len = (quint32(h[0]) << 24) | (quint32(h[1]) << 16) | (quint32(h[2]) << 8) | h[3];
+    if (len < 1 || len > quint32(kMaxFrame)) {
+        error_ = QStringLiteral("bad frame length %1").arg(len);
+        return false;
+    }
+    if (quint32(buffer_.size() - pos_ - 4) < len) return false;
+
+    const char* p = buffer_.constData() + pos_ + 5;
+    const char* end = buffer_.constData() + pos_ + 4 + len;
+    const Type type = Type(h[4]);
+    pos_ += int(4 + len);
+    *out = Message();
+    out->type = type;
+    if (!parse_(type, p, end, out)) {
+        if (error_.isEmpty()) error_ = QStringLiteral("truncated frame of type %1").arg(int(type));
+        return false;
+    }
+    return true;
+}
+
+bool AgentProtocol::Decoder::parse_(Type type, const char* p, const char* end, Message* out) {
+    quint64 v = 0;
+    switch (type) {
+        case Type::Hello:
+            if (!getVarint(p, end, &v)) return false;
+            if (v != kVersion) {
+                error_ = QStringLiteral("protocol version %1, expected %2").arg(v).arg(kVersion);
+                return false;
+            }
+            prevMs_ = 0;
+            return getString(p, end, &out->text);
+
+        case Type::Target:
+            if (!getVarint(p, end, &v)) return false;
+            out->id = quint32(v);
+            return getString(p, end, &out->text);
+
+        case Type::Batch: {
+            if (!getVarint(p, end, &v) || v > quint64(end - p)) return false;   // a record is at least a byte
+            out->records.resize(int(v));
+            qint64 prevId = 0;
+            for (ProbeRecord& r : out->records) {
+                qint64 d = 0;
+                quint64 latency = 0, dns = 0, http = 0;
+                if (!getSigned(p, end, &d) || p == end) return false;
+                r.target = quint32(prevId + d);
+                prevId = r.target;
+                const quint8 packed = quint8(*p++);
+                r.status = packed & 0x7;
+                r.flags = packed >> 3;
+                if (r.status > quint8(ProbeResult::Status::Error)) {
+                    error_ = QStringLiteral("bad status %1").arg(r.status);
+                    return false;
+                }
+                if (!getSigned(p, end, &d)) return false;
+                r.finishedMs = prevMs_ + d;
+                prevMs_ = r.finishedMs;
+                if (!getVarint(p, end, &latency) || !getVarint(p, end, &dns) || !getVarint(p, end, &http)) return false;
+                r.latencyNs = latency ? qint64(latency - 1) * 1000 : -1;
+                r.dnsUs = dns ? qint32(dns - 1) : -1;
+                r.httpCode = http ? qint16(http - 1) : qint16(-1);
+            }
+            return true;
+        }
+    }
+    // Unknown types are skipped, so newer agents can add frames.
+    return true;
+}
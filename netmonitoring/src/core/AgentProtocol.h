@@ -0,0 +1,62 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include "ProbeRecord.h"
+
+// Wire format between an agent (AgentUplink) and the aggregator (Aggregator), over
+// one TCP connection. Every frame is a 4-byte big-endian length, a type byte and
+// the payload; integers in payloads are LEB128 varints, signed ones zigzagged.
+//   Hello   version, agent name                    first frame of a connection
+//   Target  id, probeTargetKey                     before the id's first record
+//   Batch   count, then per record:
+//           target id (delta to the previous record), status | flags << 3,
+//           finishedMs (delta to the previous record, across batches),
+//           latencyUs + 1, dnsUs + 1, httpCode + 1  (0 — not measured)
+// A typical record takes 8-10 bytes. Delta state lives as long as the connection:
+// both sides start from zero after Hello.
+class AgentProtocol {
+public:
+    enum class Type : quint8 { Hello = 1, Target = 2, Batch = 3 };
+
+    static constexpr quint32 kVersion = 1;
+    static constexpr quint16 kDefaultPort = 7710;
+    static constexpr int kMaxFrame = 1 << 20;
+
+    // Agent side
+    class Encoder {
+    public:
+        QByteArray hello(const QString& agent);
+        QByteArray target(quint32 id, const QString& key);
+        QByteArray batch(const ProbeRecord* records, int count);
+        void reset() { prevMs_ = 0; }
+
+    private:
+        qint64 prevMs_ = 0;
+    };
+
+    struct Message {
+        Type type = Type::Hello;
+        QString text;                     // hello: имя агента, target: ключ цели
+        quint32 id = 0;                   // target
+        QVector<ProbeRecord> records;     // batch; заполнены только передаваемые поля
+    };
+
+    // Aggregator side: feed() what the socket delivered, then next() until it
+    // returns false. A malformed stream sets `error` and stays failed.
+    class Decoder {
+    public:
+        void feed(const QByteArray& bytes);
+        bool next(Message* out);
+        bool failed() const { return !error_.isEmpty(); }
+        QString error() const { return error_; }
+
+    private:
+        bool parse_(Type type, const char* p, const char* end, Message* out);
+
+        QByteArray buffer_;
+        int pos_ = 0;
+        qint64 prevMs_ = 0;
+        QString error_;
+    };
+};
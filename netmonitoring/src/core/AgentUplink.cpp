@@ -0,0 +1,149 @@
+#include "AgentUplink.h"
+#include "MonitorController.h"
+#include <QSysInfo>
+
+AgentUplink::AgentUplink(QObject* parent)
+        : QObject(parent)
+        , name_(QSysInfo::machineHostName()) {
+    socket_.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    QObject::connect(&socket_, &QTcpSocket::connected, this, &AgentUplink::onConnected_);
+    QObject::connect(&socket_, &QTcpSocket::disconnected, this, &AgentUplink::onLost_);
+    // A refused or failed connect never reaches disconnected()
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    QObject::connect(&socket_, &QTcpSocket::errorOccurred, this, [this](QAbstractSocket::SocketError){
+        if (socket_.state() != QAbstractSocket::ConnectedState) onLost_();
+    });
+#else
+    QObject::connect(&socket_, qOverload<QAbstractSocket::SocketError>(&QAbstractSocket::error), this,
+                     [this](QAbstractSocket::SocketError){
+        if (socket_.state() != QAbstractSocket::ConnectedState) onLost_();
+    });
+#endif
+    // Data arriving from the aggregator is not expected; keep the buffer empty.
+    QObject::connect(&socket_, &QTcpSocket::readyRead, this, [this]{ socket_.readAll(); });
+    QObject::connect(&socket_, &QTcpSocket::bytesWritten, this, &AgentUplink::onWritten_);
+
+    flushTimer_.setInterval(kFlushMs);
+    QObject::connect(&flushTimer_, &QTimer::timeout, this, &AgentUplink::flush_);
+
+    reconnectTimer_.setSingleShot(true);
+    QObject::connect(&reconnectTimer_, &QTimer::timeout, this, [this]{
+        if (!closing_ && socket_.state() == QAbstractSocket::UnconnectedState) socket_.connectToHost(host_, port_);
+    });
+}
+
+void AgentUplink::connectTo(const QString& host, quint16 port) {
+    host_ = host;
+    port_ = port;
+    closing_ = false;
+    backoffMs_ = kMinBackoffMs;
+    abort_();
+    flushTimer_.start();
+    socket_.connectToHost(host_, port_);
+}
+
+void AgentUplink::close() {
+    closing_ = true;
+    reconnectTimer_.stop();
+    if (isConnected()) flush_();
+    socket_.disconnectFromHost();
+}
+
+void AgentUplink::attach(MonitorController* controller) {
+    if (controller_) QObject::disconnect(controller_, nullptr, this, nullptr);
+    controller_ = controller;
+    if (!controller_) return;
+    QObject::connect(controller, &MonitorController::resultsReady, this, &AgentUplink::enqueue);
+    QObject::connect(controller, &MonitorController::targetRemoved, this, [this](quint32 id){
+        // Its records still queued are skipped by declare_()
+        declared_.remove(id);
+    });
+}
+
+void AgentUplink::enqueue(const QVector<ProbeRecord>& batch) {
+    for (const ProbeRecord& r : batch) pending_.push_back(r);
+    if (pending_.size() > size_t(kMaxPending)) {
+        const size_t excess = pending_.size() - size_t(kMaxPending);
+        pending_.erase(pending_.begin(), pending_.begin() + std::ptrdiff_t(excess));
+        dropped_ += excess;
+    }
+    if (pending_.size() >= size_t(kBatchRecords)) flush_();
+}
+
+void AgentUplink::flush_() {
+    // Behind a slow aggregator records queue here rather than in the socket buffer
+    while (isConnected() && !pending_.empty() && socket_.bytesToWrite() < kMaxUnsentBytes) {
+        const int n = int(qMin(pending_.size(), size_t(kBatchRecords)));
+        chunk_.resize(0);
+        quint32 last = MonitorController::kNoTarget;
+        bool known = false;
+        for (int i = 0; i < n; ++i) {
+            const ProbeRecord& r = pending_[size_t(i)];
+            if (r.target != last) {
+                last = r.target;
+                known = declare_(last);
+            }
+            if (known) chunk_.push_back(r);
+        }
+        pending_.erase(pending_.begin(), pending_.begin() + n);
+        if (chunk_.isEmpty()) continue;
+        write_(encoder_.batch(chunk_.constData(), chunk_.size()), chunk_.size());
+    }
+}
+
+bool AgentUplink::declare_(quint32 id) {
+    if (!controller_) return false;
+    const ProbeTarget t = controller_->target(id);
+    if (t.host.isEmpty()) return false;   // removed while its results were queued
+    // updateTarget() may change what an id probes; the key says what it is now
+    const QString key = probeTargetKey(t);
+    auto it = declared_.find(id);
+    if (it != declared_.end() && it.value() == key) return true;
+    declared_.insert(id, key);
+    write_(encoder_.target(id, key));
+    return true;
+}
+
+void AgentUplink::write_(const QByteArray& frame, int records) {
+    socket_.write(frame);
+    unsent_.push_back(Unsent{frame.size(), records});
+}
+
+void AgentUplink::onWritten_(qint64 bytes) {
+    bytesSent_ += quint64(bytes);
+    while (bytes > 0 && !unsent_.empty()) {
+        Unsent& u = unsent_.front();
+        const qint64 n = qMin(bytes, u.bytes);
+        u.bytes -= n;
+        bytes -= n;
+        if (u.bytes > 0) break;
+        recordsSent_ += quint64(u.records);
+        unsent_.pop_front();
+    }
+    if (pending_.size() >= size_t(kBatchRecords)) flush_();
+}
+
+void AgentUplink::onConnected_() {
+    backoffMs_ = kMinBackoffMs;
+    declared_.clear();
+    write_(encoder_.hello(name_));
+    emit connected();
+    flush_();
+}
+
+void AgentUplink::abort_() {
+    socket_.abort();
+    // Whatever the socket had not written yet is gone with it
+    for (const Unsent& u : unsent_) dropped_ += quint64(u.records);
+    unsent_.clear();
+}
+
+void AgentUplink::onLost_() {
+    if (reconnectTimer_.isActive()) return;
+    const QString reason = socket_.errorString();
+    abort_();
+    emit disconnected(reason);
+    if (closing_) return;
+    reconnectTimer_.start(backoffMs_);
+    backoffMs_ = qMin(backoffMs_ * 2, kMaxBackoffMs);
+}
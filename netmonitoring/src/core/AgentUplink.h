@@ -0,0 +1,88 @@
+#pragma once
+#include <QObject>
+#include <QHash>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QVector>
+#include <deque>
+#include "AgentProtocol.h"
+#include "ProbeRecord.h"
+
+class MonitorController;
+
+// Agent side of a distributed setup: streams the attached controller's results to
+// an Aggregator over one TCP connection (AgentProtocol). Records are sent in batches
+// of up to kBatchRecords, at least once per kFlushMs. While the aggregator is
+// unreachable, or the socket is backed up, they wait in a bounded queue; past
+// kMaxPending the oldest are dropped and counted. The socket buffer holds no more
+// than a few batches; records still in it when the connection is lost count as
+// dropped too, and a record counts as sent once its batch has been written out.
+// The connection is re-established with exponential backoff, and every target is
+// declared again on the new one.
+class AgentUplink : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int kBatchRecords = 512;
+    static constexpr int kFlushMs = 1000;
+    static constexpr int kMaxPending = 100000;
+    static constexpr qint64 kMaxUnsentBytes = 64 << 10;   // в буфере сокета: несколько пачек
+    static constexpr int kMinBackoffMs = 1000;
+    static constexpr int kMaxBackoffMs = 30000;
+
+    explicit AgentUplink(QObject* parent = nullptr);
+
+    void setAgentName(const QString& name) { name_ = name; }
+    QString agentName() const { return name_; }
+
+    void connectTo(const QString& host, quint16 port);
+    void close();
+    bool isConnected() const { return socket_.state() == QAbstractSocket::ConnectedState; }
+
+    // Follows the controller's results and target removals
+    void attach(MonitorController* controller);
+    void enqueue(const QVector<ProbeRecord>& batch);
+
+    quint64 recordsSent() const { return recordsSent_; }
+    quint64 bytesSent() const { return bytesSent_; }
+    quint64 dropped() const { return dropped_; }
+    int pending() const { return int(pending_.size()); }
+
+signals:
+    void connected();
+    void disconnected(const QString& reason);
+
+private:
+    void flush_();
+    void onConnected_();
+    void onLost_();
+    void abort_();
+    bool declare_(quint32 id);            // false — цели больше нет
+    void write_(const QByteArray& frame, int records = 0);
+    void onWritten_(qint64 bytes);
+
+    QString name_;
+    QString host_;
+    quint16 port_ = 0;
+    QTcpSocket socket_;
+    QTimer flushTimer_;
+    QTimer reconnectTimer_;
+    int backoffMs_ = kMinBackoffMs;
+    bool closing_ = false;
+
+    MonitorController* controller_ = nullptr;
+    AgentProtocol::Encoder encoder_;
+    std::deque<ProbeRecord> pending_;
+    QVector<ProbeRecord> chunk_;          // одна пачка, ёмкость сохраняется
+    QHash<quint32, QString> declared_;    // id → ключ, объявленные в текущем соединении
+
+    // Кадр в буфере сокета, ещё не записанный целиком
+    struct Unsent {
+        qint64 bytes = 0;                 // осталось записать
+        int records = 0;                  // записей в кадре, 0 — служебный
+    };
+    std::deque<Unsent> unsent_;
+
+    quint64 recordsSent_ = 0;
+    quint64 bytesSent_ = 0;
+    quint64 dropped_ = 0;
+};
@@ -0,0 +1,150 @@
+#include "Aggregator.h"
+#include <QTcpSocket>
+
+Aggregator::Aggregator(QObject* parent)
+        : QObject(parent) {
+    QObject::connect(&server_, &QTcpServer::newConnection, this, &Aggregator::onConnection_);
+}
+
+Aggregator::~Aggregator() {
+    close();
+}
+
+bool Aggregator::listen(const QHostAddress& address, quint16 port) {
+    server_.close();
+    return server_.listen(address, port);
+}
+
+void Aggregator::close() {
+    server_.close();
+    const auto sockets = connections_.keys();
+    for (QTcpSocket* s : sockets) drop_(s, QStringLiteral("aggregator closed"));
+}
+
+void Aggregator::onConnection_() {
+    while (QTcpSocket* socket = server_.nextPendingConnection()) {
+        if (connections_.size() >= kMaxConnections) {
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+        connections_.insert(socket, Connection());
+        QObject::connect(socket, &QTcpSocket::readyRead, this, [this, socket]{ read_(socket); });
+        QObject::connect(socket, &QTcpSocket::disconnected, this, [this, socket]{
+            drop_(socket, socket->errorString());
+        });
+    }
+}
+
+void Aggregator::read_(QTcpSocket* socket) {
+    auto it = connections_.find(socket);
+    if (it == connections_.end()) return;
+    Connection& c = it.value();
+    const QByteArray bytes = socket->readAll();
+    bytes_ += quint64(bytes.size());
+    c.decoder.feed(bytes);
+
+    AgentProtocol::Message m;
+    while (c.decoder.next(&m)) {
+        if (c.agent.isEmpty() && m.type != AgentProtocol::Type::Hello) {
+            drop_(socket, QStringLiteral("no hello"));
+            return;
+        }
+        apply_(socket, c, m);
+    }
+    if (c.decoder.failed()) drop_(socket, c.decoder.error());
+}
+
+void Aggregator::apply_(QTcpSocket* socket, Connection& c, const AgentProtocol::Message& m) {
+    switch (m.type) {
+        case AgentProtocol::Type::Hello: {
+            if (!c.agent.isEmpty()) return;
+            c.agent = m.text.isEmpty() ? QStringLiteral("agent") : m.text;
+            ++online_[c.agent];
+            emit agentConnected(c.agent, socket->peerAddress().toString());
+            return;
+        }
+        case AgentProtocol::Type::Target:
+            c.keys.insert(m.id, m.text);
+            return;
+        case AgentProtocol::Type::Batch:
+            break;
+    }
+
+    // Consecutive records of one target share the lookups
+    quint32 lastId = 0;
+    Vantage* v = nullptr;
+    for (const ProbeRecord& r : m.records) {
+        if (!v || r.target != lastId) {
+            lastId = r.target;
+            const auto key = c.keys.constFind(r.target);
+            v = key != c.keys.constEnd() ? &targets_[key.value()][c.agent] : nullptr;
+            if (!v) continue;                 // never declared: not attributable
+        }
+        ++records_;
+        ++v->probes;
+        v->status = r.statusValue();
+        v->lastMs = qMax(v->lastMs, r.finishedMs);
+        v->lastLatencyUs = r.latencyUs();
+        if (r.isUp()) {
+            if (v->lastLatencyUs >= 0) v->latency.record(v->lastLatencyUs);
+        } else {
+            ++v->failed;
+        }
+    }
+}
+
+void Aggregator::drop_(QTcpSocket* socket, const QString& reason) {
+    auto it = connections_.find(socket);
+    if (it == connections_.end()) return;
+    const QString agent = it.value().agent;
+    connections_.erase(it);
+    QObject::disconnect(socket, nullptr, this, nullptr);
+    socket->abort();
+    socket->deleteLater();
+    if (agent.isEmpty()) return;
+    if (--online_[agent] <= 0) online_.remove(agent);
+    emit agentDisconnected(agent, reason);
+}
+
+QStringList Aggregator::agents() const {
+    QStringList out = online_.keys();
+    out.sort();
+    return out;
+}
+
+QVector<Aggregator::TargetSummary> Aggregator::snapshot() const {
+    QVector<TargetSummary> out;
+    out.reserve(targets_.size());
+    LatencyHistogram merged;
+    for (auto t = targets_.constBegin(); t != targets_.constEnd(); ++t) {
+        TargetSummary s;
+        s.key = t.key();
+        merged.clear();
+        for (auto a = t.value().constBegin(); a != t.value().constEnd(); ++a) {
+            const Vantage& v = a.value();
+            VantageView view;
+            view.agent = a.key();
+            view.connected = online_.contains(a.key());
+            view.status = v.status;
+            view.lastMs = v.lastMs;
+            view.probes = v.probes;
+            view.failed = v.failed;
+            view.lastLatencyUs = v.lastLatencyUs;
+            view.p50Us = v.latency.percentile(50);
+            view.p99Us = v.latency.percentile(99);
+            if (view.connected) {
+                if (v.status == ProbeResult::Status::Up) ++s.agentsUp;
+                else ++s.agentsDown;
+            }
+            s.probes += v.probes;
+            s.failed += v.failed;
+            merged.merge(v.latency);
+            s.vantages.push_back(view);
+        }
+        s.p50Us = merged.percentile(50);
+        s.p99Us = merged.percentile(99);
+        out.push_back(s);
+    }
+    return out;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <QObject>
+#include <QHash>
+#include <QHostAddress>
+#include <QMap>
+#include <QStringList>
+#include <QTcpServer>
+#include <QVector>
+#include "AgentProtocol.h"
+#include "LatencyHistogram.h"
+#include "ProbeResult.h"
+
+class QTcpSocket;
+
+// Collector side of a distributed setup: accepts AgentUplink connections and keeps,
+// per target (probeTargetKey) and per agent, a vantage: the last status, counters
+// and a latency histogram. Targets are matched across agents on their key, so the
+// same host probed from several places merges into one summary. Histograms are
+// cumulative since the aggregator started; a vantage whose agent disconnects is
+// kept, marked as not connected, and is left out of the up/down counts.
+class Aggregator : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int kMaxConnections = 1024;
+
+    struct VantageView {
+        QString agent;
+        bool connected = false;
+        ProbeResult::Status status = ProbeResult::Status::Error;   // последний результат
+        qint64 lastMs = 0;
+        quint64 probes = 0;
+        quint64 failed = 0;
+        qint64 lastLatencyUs = -1;
+        qint64 p50Us = -1;
+        qint64 p99Us = -1;
+    };
+
+    struct TargetSummary {
+        QString key;                      // mode://host:port
+        int agentsUp = 0;                 // среди подключённых агентов
+        int agentsDown = 0;
+        quint64 probes = 0;
+        quint64 failed = 0;
+        qint64 p50Us = -1;                // по объединённой гистограмме всех агентов
+        qint64 p99Us = -1;
+        QVector<VantageView> vantages;    // по имени агента
+    };
+
+    explicit Aggregator(QObject* parent = nullptr);
+    ~Aggregator() override;
+
+    bool listen(const QHostAddress& address, quint16 port);
+    void close();
+    bool isListening() const { return server_.isListening(); }
+    quint16 port() const { return server_.serverPort(); }
+    QString errorString() const { return server_.errorString(); }
+
+    QVector<TargetSummary> snapshot() const;    // по ключу цели
+    QStringList agents() const;                 // подключённые сейчас
+    quint64 records() const { return records_; }
+    quint64 bytes() const { return bytes_; }
+
+signals:
+    void agentConnected(const QString& agent, const QString& peer);
+    void agentDisconnected(const QString& agent, const QString& reason);
+
+private:
+    struct Vantage {
+        ProbeResult::Status status = ProbeResult::Status::Error;
+        qint64 lastMs = 0;
+        quint64 probes = 0;
+        quint64 failed = 0;
+        qint64 lastLatencyUs = -1;
+        LatencyHistogram latency;         // мкс, только UP
+    };
+
+    struct Connection {
+        QString agent;                    // пусто до Hello
+        AgentProtocol::Decoder decoder;
+        QHash<quint32, QString> keys;     // id цели у агента → ключ
+    };
+
+    void onConnection_();
+    void read_(QTcpSocket* socket);
+    void apply_(QTcpSocket* socket, Connection& c, const AgentProtocol::Message& m);
+    void drop_(QTcpSocket* socket, const QString& reason);
+
+    QTcpServer server_;
+    QHash<QTcpSocket*, Connection> connections_;
+    QHash<QString, int> online_;                      // агент → число соединений после Hello
+    QMap<QString, QMap<QString, Vantage>> targets_;   // ключ цели → агент → вид
+    quint64 records_ = 0;
+    quint64 bytes_ = 0;
+};
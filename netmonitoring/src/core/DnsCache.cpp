@@ -0,0 +1,183 @@
+#include "DnsCache.h"
+#include "SystemResolverBackend.h"
+#include <QCoreApplication>
+#include <QThread>
+
+DnsCache& DnsCache::instance() {
+    // Owned by the application object so it is torn down while the event loop still exists.
+    // Its timer and backend need a thread that lives as long as the cache: the first call
+    // has to come from the application thread (ProbeWorkerPool makes it), never a shard.
+    static DnsCache* cache = [] {
+        QCoreApplication* app = QCoreApplication::instance();
+        Q_ASSERT_X(!app || QThread::currentThread() == app->thread(), "DnsCache::instance",
+                   "first used off the application thread");
+        return new DnsCache(app);
+    }();
+    return *cache;
+}
+
+DnsCache::DnsCache(QObject* parent)
+        : QObject(parent) {
+    clock_.start();
+    setBackend(new SystemResolverBackend());
+
+    sweepTimer_.setInterval(30000);
+    QObject::connect(&sweepTimer_, &QTimer::timeout, this, &DnsCache::sweep_);
+    sweepTimer_.start();
+}
+
+void DnsCache::setBackend(IResolverBackend* backend) {
+    if (!backend || backend_ == backend) return;
+    if (backend_) {
+        QObject::disconnect(backend_, nullptr, this, nullptr);
+        backend_->deleteLater();
+    }
+    backend_ = backend;
+    backend_->setParent(this);
+    QObject::connect(backend_, &IResolverBackend::resolved, this, &DnsCache::onResolved_);
+    clear();
+
+    // Queries still owed by the old backend are asked again.
+    QStringList pending;
+    {
+        QMutexLocker lock(&mutex_);
+        for (auto it = entries_.cbegin(); it != entries_.cend(); ++it) pending.push_back(it.key());
+    }
+    for (const auto& key : pending) query_(key);
+}
+
+void DnsCache::setTtlBounds(quint32 minSec, quint32 maxSec) {
+    QMutexLocker lock(&mutex_);
+    minTtlSec_ = minSec;
+    maxTtlSec_ = qMax(minSec, maxSec);
+}
+
+void DnsCache::setNegativeTtl(quint32 nxDomainSec, quint32 servFailSec) {
+    QMutexLocker lock(&mutex_);
+    nxDomainTtlSec_ = nxDomainSec;
+    servFailTtlSec_ = servFailSec;
+}
+
+void DnsCache::setRefreshAhead(double fraction, int minHits) {
+    QMutexLocker lock(&mutex_);
+    refreshFraction_ = qBound(0.0, fraction, 1.0);
+    refreshMinHits_ = qMax(1, minHits);
+}
+
+void DnsCache::lookup(const QString& name, QObject* context, Callback cb) {
+    const QString key = name.trimmed().toLower();
+    const qint64 now = clock_.elapsed();
+    bool startQuery = false;
+
+    {
+        QMutexLocker lock(&mutex_);
+        Entry& e = entries_[key];
+
+        if (e.valid && now < e.expiresAtMs) {
+            const DnsAnswer answer = e.answer;
+            ++e.hits;
+            if (answer.status == DnsAnswer::Status::Ok) ++stats_.hits; else ++stats_.negativeHits;
+
+            const qint64 ttlMs = e.expiresAtMs - e.fetchedAtMs;
+            const bool nearExpiry = (e.expiresAtMs - now) < qint64(double(ttlMs) * refreshFraction_);
+            if (answer.status == DnsAnswer::Status::Ok && nearExpiry && !e.inFlight
+                && e.hits >= quint32(refreshMinHits_)) {
+                e.inFlight = true;
+                startQuery = true;
+                ++stats_.refreshes;
+            }
+            lock.unlock();
+            deliver_(Waiter{context, std::move(cb)}, answer, true);
+            if (startQuery) query_(key);
+            return;
+        }
+
+        e.waiters.push_back(Waiter{context, std::move(cb)});
+        if (e.inFlight) {
+            ++stats_.coalesced;
+        } else {
+            e.inFlight = true;
+            startQuery = true;
+            ++stats_.misses;
+        }
+    }
+    if (startQuery) query_(key);
+}
+
+void DnsCache::query_(const QString& key) {
+    // The backend lives in the cache's thread; hop there if called from a probe worker.
+    QMetaObject::invokeMethod(this, [this, key]{ backend_->resolve(key); }, Qt::AutoConnection);
+}
+
+void DnsCache::onResolved_(const QString& name, const DnsAnswer& answer) {
+    const QString key = name.toLower();
+    const qint64 now = clock_.elapsed();
+    std::vector<Waiter> waiters;
+
+    {
+        QMutexLocker lock(&mutex_);
+        Entry& e = entries_[key];
+
+        quint32 ttl = 0;
+        switch (answer.status) {
+            case DnsAnswer::Status::Ok:       ttl = qBound(minTtlSec_, answer.ttlSec, maxTtlSec_); break;
+            case DnsAnswer::Status::NxDomain: ttl = nxDomainTtlSec_; break;
+            case DnsAnswer::Status::ServFail: ttl = servFailTtlSec_; break;
+        }
+
+        // A failed background refresh keeps serving the still-valid answer.
+        const bool keepOld = e.valid && now < e.expiresAtMs && e.waiters.empty()
+                             && answer.status != DnsAnswer::Status::Ok;
+        if (!keepOld) {
+            e.answer = answer;
+            e.valid = true;
+            e.fetchedAtMs = now;
+            e.expiresAtMs = now + qint64(ttl) * 1000;
+            e.hits = 0;
+        }
+        e.inFlight = false;
+        waiters.swap(e.waiters);
+    }
+
+    for (const auto& w : waiters) deliver_(w, answer, false);
+}
+
+void DnsCache::deliver_(const Waiter& w, const DnsAnswer& answer, bool fromCache) {
+    if (!w.context) return;
+    Callback cb = w.cb;
+    QMetaObject::invokeMethod(w.context.data(), [cb, answer, fromCache]{ cb(answer, fromCache); },
+                              Qt::QueuedConnection);
+}
+
+void DnsCache::sweep_() {
+    const qint64 now = clock_.elapsed();
+    QMutexLocker lock(&mutex_);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        const Entry& e = it.value();
+        if (!e.inFlight && e.waiters.empty() && (!e.valid || now >= e.expiresAtMs)) {
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void DnsCache::clear() {
+    QMutexLocker lock(&mutex_);
+    // Names with a query in flight stay, so their waiters still get an answer.
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it.value().inFlight) {
+            it.value().valid = false;
+            ++it;
+        } else {
+            it = entries_.erase(it);
+        }
+    }
+}
+
+DnsCache::Stats DnsCache::stats() const {
+    QMutexLocker lock(&mutex_);
+    Stats s = stats_;
+    s.entries = entries_.size();
+    return s;
+}
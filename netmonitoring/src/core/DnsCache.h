@@ -0,0 +1,85 @@
+#pragma once
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "IResolverBackend.h"
+
+// Process-wide resolver cache shared by all probes.
+//  - positive answers live for their record TTL (clamped to [minTtl, maxTtl]);
+//  - NXDOMAIN and SERVFAIL are cached for their own, shorter TTLs;
+//  - concurrent lookups of one name share a single backend query;
+//  - names that keep getting hits are re-resolved in the background shortly
+//    before they expire, so hot entries never go cold.
+// Callbacks are always delivered asynchronously in the thread of `context`.
+class DnsCache : public QObject {
+    Q_OBJECT
+public:
+    using Callback = std::function<void(const DnsAnswer& answer, bool fromCache)>;
+
+    struct Stats {
+        quint64 hits = 0;
+        quint64 negativeHits = 0;
+        quint64 misses = 0;
+        quint64 coalesced = 0;
+        quint64 refreshes = 0;
+        int entries = 0;
+    };
+
+    static DnsCache& instance();
+
+    explicit DnsCache(QObject* parent = nullptr);
+
+    void setBackend(IResolverBackend* backend);   // takes ownership
+    IResolverBackend* backend() const { return backend_; }
+
+    void setTtlBounds(quint32 minSec, quint32 maxSec);
+    void setNegativeTtl(quint32 nxDomainSec, quint32 servFailSec);
+    // Refresh when less than `fraction` of the TTL is left and the entry got >= minHits since the last fetch
+    void setRefreshAhead(double fraction, int minHits);
+
+    void lookup(const QString& name, QObject* context, Callback cb);
+    void clear();
+    Stats stats() const;
+
+private:
+    struct Waiter {
+        QPointer<QObject> context;
+        Callback cb;
+    };
+
+    struct Entry {
+        DnsAnswer answer;
+        bool valid = false;               // answer заполнен хотя бы раз
+        qint64 fetchedAtMs = 0;
+        qint64 expiresAtMs = 0;
+        quint32 hits = 0;                 // попадания с последнего обновления
+        bool inFlight = false;
+        std::vector<Waiter> waiters;
+    };
+
+    void query_(const QString& key);
+    void onResolved_(const QString& name, const DnsAnswer& answer);
+    void sweep_();
+    static void deliver_(const Waiter& w, const DnsAnswer& answer, bool fromCache);
+
+    mutable QMutex mutex_;
+    QHash<QString, Entry> entries_;
+    IResolverBackend* backend_ = nullptr;
+    QElapsedTimer clock_;
+    QTimer sweepTimer_;
+
+    quint32 minTtlSec_ = 5;
+    quint32 maxTtlSec_ = 3600;
+    quint32 nxDomainTtlSec_ = 30;
+    quint32 servFailTtlSec_ = 5;
+    double refreshFraction_ = 0.2;
+    int refreshMinHits_ = 2;
+
+    Stats stats_;
+};
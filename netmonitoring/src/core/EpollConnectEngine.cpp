@@ -0,0 +1,325 @@
+#include "EpollConnectEngine.h"
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QThreadStorage>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+namespace {
+
+constexpr quint64 kWakeTag = 0;
+constexpr int kMaxEvents = 1024;
+
+qint64 monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+socklen_t toSockaddr(const QHostAddress& addr, quint16 port, sockaddr_storage* out) {
+    std::memset(out, 0, sizeof(*out));
+    if (addr.protocol() == QAbstractSocket::IPv6Protocol) {
+        auto* sa = reinterpret_cast<sockaddr_in6*>(out);
+        sa->sin6_family = AF_INET6;
+        sa->sin6_port = htons(port);
+        const Q_IPV6ADDR v6 = addr.toIPv6Address();
+        std::memcpy(&sa->sin6_addr, &v6, sizeof(sa->sin6_addr));
+        return sizeof(sockaddr_in6);
+    }
+    auto* sa = reinterpret_cast<sockaddr_in*>(out);
+    sa->sin_family = AF_INET;
+    sa->sin_port = htons(port);
+    sa->sin_addr.s_addr = htonl(addr.toIPv4Address());
+    return sizeof(sockaddr_in);
+}
+
+void closeAborting(int fd) {
+    // RST instead of FIN: tens of thousands of probes must not leave TIME_WAIT behind.
+    linger lg{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    ::close(fd);
+}
+
+} // namespace
+
+// Per-thread receiver of engine results. Lives in the submitting thread.
+class EpollConnectEngine::Sink : public QObject {
+public:
+    Sink(EpollConnectEngine* engine, quint32 id) : engine_(engine), id_(id) {}
+    ~Sink() override { engine_->unregisterSink_(id_); }
+
+    quint32 id() const { return id_; }
+
+    void add(quint64 ticket, Callback cb) { callbacks_.insert(ticket, std::move(cb)); }
+    void remove(quint64 ticket) { callbacks_.remove(ticket); }
+
+    // Worker thread, with the engine's sink registry locked.
+    void post(std::vector<Result>& batch) {
+        QMutexLocker lock(&inboxMutex_);
+        if (inbox_.empty()) inbox_.swap(batch);
+        else inbox_.insert(inbox_.end(), batch.begin(), batch.end());
+        if (!drainPosted_) {
+            drainPosted_ = true;
+            QMetaObject::invokeMethod(this, [this]{ drain_(); }, Qt::QueuedConnection);
+        }
+    }
+
+private:
+    void drain_() {
+        std::vector<Result> batch;
+        {
+            QMutexLocker lock(&inboxMutex_);
+            batch.swap(inbox_);
+            drainPosted_ = false;
+        }
+        for (const Result& r : batch) {
+            auto it = callbacks_.find(r.ticket);
+            if (it == callbacks_.end()) continue;   // cancelled
+            Callback cb = std::move(it.value());
+            callbacks_.erase(it);
+            cb(r);
+        }
+    }
+
+    EpollConnectEngine* engine_;
+    quint32 id_;
+    QHash<quint64, Callback> callbacks_;
+    QMutex inboxMutex_;
+    std::vector<Result> inbox_;
+    bool drainPosted_ = false;
+};
+
+EpollConnectEngine& EpollConnectEngine::instance() {
+    static EpollConnectEngine engine;
+    return engine;
+}
+
+EpollConnectEngine::EpollConnectEngine() {
+    // Half-open connections are file descriptors: lift the soft limit as far as allowed.
+    rlimit rl;
+    if (::getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    epfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    evfd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = kWakeTag;
+    ::epoll_ctl(epfd_, EPOLL_CTL_ADD, evfd_, &ev);
+
+    worker_ = std::thread([this]{ run_(); });
+}
+
+EpollConnectEngine::~EpollConnectEngine() {
+    stop_ = true;
+    wake_();
+    if (worker_.joinable()) worker_.join();
+    for (const auto& kv : pending_) closeAborting(kv.second.fd);
+    ::close(evfd_);
+    ::close(epfd_);
+}
+
+EpollConnectEngine::Sink* EpollConnectEngine::sinkForCurrentThread_() {
+    static QThreadStorage<Sink*> storage;
+    if (!storage.hasLocalData()) {
+        auto* sink = new Sink(this, nextSink_++);
+        QMutexLocker lock(&sinkMutex_);
+        sinks_.emplace(sink->id(), sink);
+        storage.setLocalData(sink);
+    }
+    return storage.localData();
+}
+
+void EpollConnectEngine::unregisterSink_(quint32 id) {
+    QMutexLocker lock(&sinkMutex_);
+    sinks_.erase(id);
+}
+
+quint64 EpollConnectEngine::connect(const QHostAddress& addr, quint16 port, int timeoutMs, Callback cb) {
+    Sink* sink = sinkForCurrentThread_();
+    const quint64 ticket = nextTicket_++;
+    sink->add(ticket, std::move(cb));
+
+    bool wake = false;
+    {
+        QMutexLocker lock(&queueMutex_);
+        submitQ_.push_back(Submit{ticket, addr, port, qint64(qMax(1, timeoutMs)) * 1000000LL, sink->id()});
+        wake = !wakePending_;
+        wakePending_ = true;
+    }
+    // One eventfd write per batch of submissions, not per connect.
+    if (wake) wake_();
+    return ticket;
+}
+
+void EpollConnectEngine::cancel(quint64 ticket) {
+    sinkForCurrentThread_()->remove(ticket);
+    bool wake = false;
+    {
+        QMutexLocker lock(&queueMutex_);
+        cancelQ_.push_back(ticket);
+        wake = !wakePending_;
+        wakePending_ = true;
+    }
+    if (wake) wake_();
+}
+
+EpollConnectEngine::Stats EpollConnectEngine::stats() const {
+    QMutexLocker lock(&statsMutex_);
+    return stats_;
+}
+
+void EpollConnectEngine::wake_() {
+    const quint64 one = 1;
+    [[maybe_unused]] const ssize_t n = ::write(evfd_, &one, sizeof(one));
+}
+
+void EpollConnectEngine::run_() {
+    epoll_event events[kMaxEvents];
+    while (!stop_) {
+        const int n = ::epoll_wait(epfd_, events, kMaxEvents, nextTimeoutMs_(monotonicNs()));
+        const qint64 now = monotonicNs();
+
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.u64 == kWakeTag) {
+                quint64 counter;
+                [[maybe_unused]] const ssize_t r = ::read(evfd_, &counter, sizeof(counter));
+                continue;
+            }
+            complete_(events[i].data.u64, now);
+        }
+        drainQueues_();
+        expire_(monotonicNs());
+        flush_();
+    }
+}
+
+int EpollConnectEngine::nextTimeoutMs_(qint64 nowNs) const {
+    if (deadlines_.empty()) return -1;
+    const qint64 left = deadlines_.top().first - nowNs;
+    if (left <= 0) return 0;
+    return int((left + 999999) / 1000000);
+}
+
+void EpollConnectEngine::drainQueues_() {
+    std::vector<Submit> submits;
+    std::vector<quint64> cancels;
+    {
+        QMutexLocker lock(&queueMutex_);
+        submits.swap(submitQ_);
+        cancels.swap(cancelQ_);
+        wakePending_ = false;
+    }
+    for (quint64 ticket : cancels) {
+        auto it = pending_.find(ticket);
+        if (it == pending_.end()) continue;
+        closeAborting(it->second.fd);
+        pending_.erase(it);
+    }
+    for (const Submit& s : submits) begin_(s);
+
+    QMutexLocker lock(&statsMutex_);
+    stats_.submitted += submits.size();
+}
+
+void EpollConnectEngine::begin_(const Submit& s) {
+    sockaddr_storage sa;
+    const socklen_t len = toSockaddr(s.addr, s.port, &sa);
+
+    const int fd = ::socket(sa.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        outbox_[s.sink].push_back(Result{s.ticket, errno, -1});
+        return;
+    }
+
+    const qint64 start = monotonicNs();
+    const int rc = ::connect(fd, reinterpret_cast<const sockaddr*>(&sa), len);
+    if (rc == 0) {
+        const qint64 latency = monotonicNs() - start;
+        closeAborting(fd);
+        outbox_[s.sink].push_back(Result{s.ticket, 0, latency});
+        return;
+    }
+    if (errno != EINPROGRESS) {
+        const int err = errno;
+        ::close(fd);
+        outbox_[s.sink].push_back(Result{s.ticket, err, -1});
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLOUT | EPOLLERR | EPOLLHUP | EPOLLONESHOT;
+    ev.data.u64 = s.ticket;
+    if (::epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        const int err = errno;
+        ::close(fd);
+        outbox_[s.sink].push_back(Result{s.ticket, err, -1});
+        return;
+    }
+    pending_.emplace(s.ticket, Pending{fd, start, start + s.timeoutNs, s.sink});
+    deadlines_.emplace(start + s.timeoutNs, s.ticket);
+}
+
+void EpollConnectEngine::complete_(quint64 ticket, qint64 nowNs) {
+    auto it = pending_.find(ticket);
+    if (it == pending_.end()) return;
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (::getsockopt(it->second.fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) err = errno;
+    finishPending_(ticket, err, err == 0 ? nowNs - it->second.startNs : -1);
+}
+
+void EpollConnectEngine::expire_(qint64 nowNs) {
+    while (!deadlines_.empty() && deadlines_.top().first <= nowNs) {
+        const quint64 ticket = deadlines_.top().second;
+        deadlines_.pop();
+        // Completed and cancelled tickets are simply gone from pending_.
+        if (pending_.count(ticket)) finishPending_(ticket, ETIMEDOUT, -1);
+    }
+}
+
+void EpollConnectEngine::finishPending_(quint64 ticket, int error, qint64 latencyNs) {
+    auto it = pending_.find(ticket);
+    if (it == pending_.end()) return;
+    closeAborting(it->second.fd);   // closing also drops it from the epoll set
+    outbox_[it->second.sink].push_back(Result{ticket, error, latencyNs});
+    pending_.erase(it);
+}
+
+void EpollConnectEngine::flush_() {
+    if (outbox_.empty()) return;
+    quint64 connected = 0, failed = 0, timedOut = 0, batches = 0;
+    {
+        QMutexLocker lock(&sinkMutex_);
+        for (auto& kv : outbox_) {
+            for (const Result& r : kv.second) {
+                if (r.error == 0) ++connected;
+                else if (r.error == ETIMEDOUT) ++timedOut;
+                else ++failed;
+            }
+            auto sink = sinks_.find(kv.first);
+            if (sink == sinks_.end()) continue;   // submitting thread is gone
+            sink->second->post(kv.second);
+            ++batches;
+        }
+    }
+    outbox_.clear();
+
+    QMutexLocker lock(&statsMutex_);
+    stats_.connected += connected;
+    stats_.failed += failed;
+    stats_.timedOut += timedOut;
+    stats_.batches += batches;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <QtGlobal>
+#include <QHostAddress>
+#include <QMutex>
+#include <atomic>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Linux-only TCP connect engine. A dedicated thread issues non-blocking connect()
+// calls in batches, waits for completions with epoll and times every attempt with
+// CLOCK_MONOTONIC in nanoseconds. Completed attempts are handed back in batches,
+// one queued event per submitting thread, and the callbacks run in the thread that
+// submitted them (it needs an event loop).
+class EpollConnectEngine {
+public:
+    struct Result {
+        quint64 ticket = 0;
+        int error = 0;                    // errno; 0 — соединение установлено, ETIMEDOUT — таймаут
+        qint64 latencyNs = -1;
+    };
+    using Callback = std::function<void(const Result&)>;
+
+    struct Stats {
+        quint64 submitted = 0;
+        quint64 connected = 0;
+        quint64 failed = 0;
+        quint64 timedOut = 0;
+        quint64 batches = 0;              // пачки, переданные потокам-получателям
+    };
+
+    static EpollConnectEngine& instance();
+    ~EpollConnectEngine();
+
+    quint64 connect(const QHostAddress& addr, quint16 port, int timeoutMs, Callback cb);
+    void cancel(quint64 ticket);          // the callback is never called after this
+
+    Stats stats() const;
+
+private:
+    class Sink;
+
+    struct Submit {
+        quint64 ticket;
+        QHostAddress addr;
+        quint16 port;
+        qint64 timeoutNs;
+        quint32 sink;
+    };
+
+    struct Pending {
+        int fd;
+        qint64 startNs;
+        qint64 deadlineNs;
+        quint32 sink;
+    };
+
+    EpollConnectEngine();
+    Sink* sinkForCurrentThread_();
+    void unregisterSink_(quint32 id);
+    void wake_();
+
+    // Worker thread only
+    void run_();
+    void drainQueues_();
+    void begin_(const Submit& s);
+    void complete_(quint64 ticket, qint64 nowNs);
+    void expire_(qint64 nowNs);
+    void finishPending_(quint64 ticket, int error, qint64 latencyNs);
+    void flush_();
+    int nextTimeoutMs_(qint64 nowNs) const;
+
+    int epfd_ = -1;
+    int evfd_ = -1;
+    std::thread worker_;
+    std::atomic<bool> stop_{false};
+    std::atomic<quint64> nextTicket_{1};
+    std::atomic<quint32> nextSink_{1};
+
+    QMutex queueMutex_;                   // submit/cancel очереди
+    std::vector<Submit> submitQ_;
+    std::vector<quint64> cancelQ_;
+    bool wakePending_ = false;
+
+    QMutex sinkMutex_;                    // реестр получателей
+    std::unordered_map<quint32, Sink*> sinks_;
+
+    std::unordered_map<quint64, Pending> pending_;
+    std::priority_queue<std::pair<qint64, quint64>, std::vector<std::pair<qint64, quint64>>,
+                        std::greater<std::pair<qint64, quint64>>> deadlines_;
+    std::unordered_map<quint32, std::vector<Result>> outbox_;
+
+    mutable QMutex statsMutex_;
+    Stats stats_;
+};
@@ -1,4 +1,7 @@
 #include "HttpHeadProbe.h"
+#include "DnsCache.h"
+#include "NetworkAccessPool.h"
+#include <QNetworkAccessManager>
 #include <QUrl>
 #include <QNetworkRequest>
 
@@ -7,16 +10,11 @@ HttpHeadProbe::HttpHeadProbe(QObject* parent)
     timeout_.setSingleShot(true);
     QObject::connect(&timeout_, &QTimer::timeout, this, [this]{
         if (!active_) return;
-        if (reply_) {
-            QObject::disconnect(reply_, nullptr, this, nullptr);
-            reply_->abort();
-            reply_->deleteLater();
-            reply_ = nullptr;
-        }
+        dropReply_();
         ProbeResult r;
         r.status = ProbeResult::Status::Timeout;
         r.message = tr("Timeout");
-        r.dnsMs = dnsElapsed_.isValid() ? dnsElapsed_.elapsed() : -1;
+        r.dnsMs = dnsMs_;
         r.ip = ip_;
         finish_(r);
     });
@@ -34,84 +32,164 @@ void HttpHeadProbe::start(const QString& host, quint16 port, int timeoutMs) {
 
     active_ = true;
     ip_.clear();
+    dnsMs_ = -1;
+    dnsCached_ = false;
+    dnsNs_ = requestNs_ = connectingNs_ = encryptedNs_ = sentNs_ = headersNs_ = -1;
     elapsed_.restart();
     dnsElapsed_.restart();
 
     timeout_.start(timeoutMs_);
 
     QPointer<HttpHeadProbe> self(this);
-    QHostInfo::lookupHost(host_, this, [this, self](const QHostInfo& info){
-        if (!self || !active_) return;
-        if (info.error() != QHostInfo::NoError || info.addresses().isEmpty()) {
+    const quint64 run = ++run_;
+    DnsCache::instance().lookup(host_, this, [this, self, run](const DnsAnswer& answer, bool fromCache){
+        if (!self || !active_ || run != run_) return;
+        dnsCached_ = fromCache;
+        if (answer.status != DnsAnswer::Status::Ok || answer.addresses.isEmpty()) {
             ProbeResult r;
             r.status = ProbeResult::Status::DnsFail;
-            r.message = info.errorString();
+            r.message = answer.errorString;
             r.dnsMs = -1;
             finish_(r);
             return;
         }
         QHostAddress addr;
-        for (const auto& a : info.addresses()) {
+        for (const auto& a : answer.addresses) {
             if (a.protocol() == QAbstractSocket::IPv4Protocol) { addr = a; break; }
         }
-        if (addr.isNull()) addr = info.addresses().first();
+        if (addr.isNull()) addr = answer.addresses.first();
         ip_ = addr.toString();
-        emit progressDnsResolved(dnsElapsed_.elapsed(), ip_);
+        dnsNs_ = dnsElapsed_.nsecsElapsed();
+        dnsMs_ = dnsNs_ / 1000000;
+        emit progressDnsResolved(dnsMs_, ip_);
 
-        const bool useHttps = (port_ == 443);
-        const QString scheme = useHttps ? "https" : "http";
-        const QUrl url(QString("%1://%2:%3/").arg(scheme, host_, QString::number(port_)));
+        sendRequest_();
+    });
+}
 
-        QNetworkRequest req(url);
+void HttpHeadProbe::sendRequest_() {
+    const bool useHttps = (port_ == 443);
+    // Connect to the address DnsCache answered with: given the name, QNAM would look
+    // it up again and that lookup would land in the connect phase. The name still
+    // goes out as Host and, for HTTPS, as SNI and the certificate's expected name.
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+    const bool pinned = !ip_.isEmpty();
+#else
+    // No peer verify name before 5.13: HTTPS keeps the name, its phases include a lookup
+    const bool pinned = !ip_.isEmpty() && !useHttps;
+#endif
+    QUrl url;
+    url.setScheme(useHttps ? QStringLiteral("https") : QStringLiteral("http"));
+    url.setHost(pinned ? ip_ : host_);
+    url.setPort(port_);
+    url.setPath(QStringLiteral("/"));
+
+    QNetworkRequest req(url);
+    if (pinned) {
+        const QString name = host_.contains(':') ? QStringLiteral("[%1]").arg(host_) : host_;
+        req.setRawHeader("Host", (port_ == (useHttps ? 443 : 80) ? name : QStringLiteral("%1:%2").arg(name).arg(port_)).toUtf8());
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+        if (useHttps) req.setPeerVerifyName(host_);
+#endif
+    }
 #if QT_VERSION >= QT_VERSION_CHECK(5, 9, 0)
-        req.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    req.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
 #endif
-        req.setHeader(QNetworkRequest::UserAgentHeader, "SimpleQtNetMon/1.0");
+    req.setHeader(QNetworkRequest::UserAgentHeader, "SimpleQtNetMon/1.0");
+    // Without keep-alive every probe measures a fresh connection, as before.
+    if (!keepAlive_) req.setRawHeader("Connection", "close");
 
-        if (reply_) {
-            QObject::disconnect(reply_, nullptr, this, nullptr);
-            reply_->abort();
-            reply_->deleteLater();
-            reply_ = nullptr;
-        }
+    dropReply_();
 
-        reply_ = nam_.sendCustomRequest(req, "HEAD");
+    requestNs_ = elapsed_.nsecsElapsed();
+    reply_ = NetworkAccessPool::forCurrentThread()->sendCustomRequest(req, "HEAD");
 
-        QObject::connect(reply_, &QNetworkReply::finished, this, [this]{
-            if (!active_) { if (reply_) { reply_->deleteLater(); reply_ = nullptr; } return; }
-            ProbeResult r;
-            r.dnsMs = dnsElapsed_.isValid() ? dnsElapsed_.elapsed() : -1;
-            r.ip = ip_;
-
-            const int code = reply_->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-            r.httpCode = code > 0 ? std::optional<int>(code) : std::nullopt;
-
-            if (reply_->error() == QNetworkReply::NoError && code >= 100) {
-                r.status = ProbeResult::Status::Up;
-                r.latencyMs = elapsed_.elapsed();
-                r.message = QString();
-            } else {
-                r.status = ProbeResult::Status::Down;
-                r.message = reply_->errorString();
-            }
-
-            reply_->deleteLater();
-            reply_ = nullptr;
-            finish_(r);
-        });
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    QObject::connect(reply_, &QNetworkReply::socketStartedConnecting, this, [this]{
+        if (connectingNs_ < 0) connectingNs_ = elapsed_.nsecsElapsed();
+    });
+    QObject::connect(reply_, &QNetworkReply::requestSent, this, [this]{
+        if (sentNs_ < 0) sentNs_ = elapsed_.nsecsElapsed();
+    });
+#endif
+    QObject::connect(reply_, &QNetworkReply::encrypted, this, [this]{
+        if (encryptedNs_ < 0) encryptedNs_ = elapsed_.nsecsElapsed();
+    });
+    QObject::connect(reply_, &QNetworkReply::metaDataChanged, this, [this]{
+        if (headersNs_ < 0) headersNs_ = elapsed_.nsecsElapsed();
+    });
+
+    QObject::connect(reply_, &QNetworkReply::finished, this, [this]{
+        if (!active_) { dropReply_(); return; }
+        if (headersNs_ < 0) headersNs_ = elapsed_.nsecsElapsed();
+        ProbeResult r;
+        r.dnsMs = dnsMs_;
+        r.ip = ip_;
+
+        const int code = reply_->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        r.httpCode = code > 0 ? std::optional<int>(code) : std::nullopt;
+
+        if (reply_->error() == QNetworkReply::NoError && code >= 100) {
+            r.status = ProbeResult::Status::Up;
+            r.latencyMs = elapsed_.elapsed();
+            r.message = QString();
+        } else {
+            r.status = ProbeResult::Status::Down;
+            r.message = reply_->errorString();
+        }
+
+        dropReply_();
+        finish_(r);
     });
 }
 
+void HttpHeadProbe::fillPhases_(ProbeResult& r) const {
+    auto us = [](qint64 fromNs, qint64 toNs) -> qint64 {
+        return (fromNs >= 0 && toNs >= fromNs) ? (toNs - fromNs) / 1000 : -1;
+    };
+    PhaseTimings& p = r.phases;
+    p.dnsUs = dnsNs_ >= 0 ? dnsNs_ / 1000 : -1;
+    p.totalUs = elapsed_.nsecsElapsed() / 1000;
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    // QNAM does not report socketStartedConnecting when it reuses a pooled connection.
+    p.reusedConnection = (sentNs_ >= 0 && connectingNs_ < 0);
+    if (connectingNs_ >= 0) {
+        if (encryptedNs_ >= 0) {
+            // The TCP/TLS boundary is not exposed by QNAM: for HTTPS this is connect + handshake.
+            p.tlsUs = us(connectingNs_, encryptedNs_);
+        } else {
+            p.connectUs = us(connectingNs_, sentNs_);
+        }
+    }
+    p.ttfbUs = us(sentNs_ >= 0 ? sentNs_ : requestNs_, headersNs_);
+#else
+    // Older Qt has no connect/sent events; TTFB then includes connection setup.
+    p.ttfbUs = us(requestNs_, headersNs_);
+#endif
+}
+
+void HttpHeadProbe::dropReply_() {
+    if (!reply_) return;
+    QObject::disconnect(reply_, nullptr, this, nullptr);
+    // A finished reply is left alone so its keep-alive connection goes back to the pool.
+    if (!reply_->isFinished()) reply_->abort();
+    reply_->deleteLater();
+    reply_ = nullptr;
+}
+
 void HttpHeadProbe::abort() {
     if (!active_) return;
     active_ = false;
     timeout_.stop();
-    if (reply_) { reply_->abort(); reply_->deleteLater(); reply_ = nullptr; }
+    dropReply_();
 }
 
-void HttpHeadProbe::finish_(const ProbeResult& r) {
+void HttpHeadProbe::finish_(ProbeResult r) {
+    r.dnsCached = dnsCached_;
+    fillPhases_(r);
     active_ = false;
     timeout_.stop();
-    if (reply_) { reply_->abort(); reply_->deleteLater(); reply_ = nullptr; }
+    dropReply_();
     emit finished(r);
-}
\ No newline at end of file
+}
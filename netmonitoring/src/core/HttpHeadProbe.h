@@ -1,11 +1,9 @@
 #pragma once
 #include "INetProbe.h"
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QPointer>
 #include <QTimer>
 #include <QElapsedTimer>
-#include <QHostInfo>
 
 class HttpHeadProbe : public INetProbe {
     Q_OBJECT
@@ -13,13 +11,18 @@ public:
     explicit HttpHeadProbe(QObject* parent = nullptr);
     ~HttpHeadProbe() override;
 
+    void configure(const ProbeTarget& target) override { keepAlive_ = target.keepAlive; }
     void start(const QString& host, quint16 port, int timeoutMs) override;
     void abort() override;
 
+    void setKeepAlive(bool on) { keepAlive_ = on; }
+
 private:
-    void finish_(const ProbeResult& r);
+    void sendRequest_();
+    void dropReply_();
+    void fillPhases_(ProbeResult& r) const;
+    void finish_(ProbeResult r);
 
-    QNetworkAccessManager nam_;
     QPointer<QNetworkReply> reply_ = nullptr;
     QTimer timeout_;
     QElapsedTimer elapsed_;
@@ -28,6 +31,18 @@ private:
     QString host_;
     quint16 port_ = 0;
     int timeoutMs_ = 3000;
+    bool keepAlive_ = false;
     QString ip_;
+    qint64 dnsMs_ = -1;
+    bool dnsCached_ = false;
     bool active_ = false;
-};
\ No newline at end of file
+    quint64 run_ = 0;                     // номер запуска: отсекает колбэки прошлых запусков
+
+    // Отметки фаз, нс от начала проверки; -1 — событие не наступило
+    qint64 dnsNs_ = -1;
+    qint64 requestNs_ = -1;
+    qint64 connectingNs_ = -1;
+    qint64 encryptedNs_ = -1;
+    qint64 sentNs_ = -1;
+    qint64 headersNs_ = -1;
+};
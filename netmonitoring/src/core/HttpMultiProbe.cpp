@@ -0,0 +1,221 @@
+#include "HttpMultiProbe.h"
+#include "DnsCache.h"
+#include "NetworkAccessPool.h"
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QUrl>
+
+HttpMultiProbe::HttpMultiProbe(QObject* parent)
+        : INetProbe(parent) {
+    timeout_.setSingleShot(true);
+    QObject::connect(&timeout_, &QTimer::timeout, this, [this]{
+        if (!active_) return;
+        for (int i = 0; i < results_.size(); ++i) {
+            if (requests_[size_t(i)].doneNs >= 0) continue;
+            results_[i].status = ProbeResult::Status::Timeout;
+            results_[i].message = tr("Timeout");
+        }
+        dropReplies_();
+        if (results_.isEmpty()) {
+            // Still resolving
+            ProbeResult r;
+            r.status = ProbeResult::Status::Timeout;
+            r.message = tr("Timeout");
+            finish_(r);
+            return;
+        }
+        report_();
+    });
+}
+
+HttpMultiProbe::~HttpMultiProbe() {
+    abort();
+}
+
+void HttpMultiProbe::configure(const ProbeTarget& target) {
+    paths_ = target.paths.isEmpty() ? QStringList{QStringLiteral("/")} : target.paths.mid(0, kMaxPaths);
+    connections_ = qBound(1, target.httpConnections, NetworkAccessPool::kMaxSlots);
+}
+
+void HttpMultiProbe::start(const QString& host, quint16 port, int timeoutMs) {
+    if (active_) return;
+    if (paths_.isEmpty()) paths_ << QStringLiteral("/");
+    host_ = host;
+    port_ = port;
+
+    active_ = true;
+    ip_.clear();
+    dnsMs_ = dnsNs_ = -1;
+    dnsCached_ = false;
+    results_.clear();
+    pending_ = 0;
+    elapsed_.restart();
+    timeout_.start(timeoutMs);
+
+    QPointer<HttpMultiProbe> self(this);
+    const quint64 run = ++run_;
+    DnsCache::instance().lookup(host_, this, [this, self, run](const DnsAnswer& answer, bool fromCache){
+        if (!self || !active_ || run != run_) return;
+        dnsCached_ = fromCache;
+        if (answer.status != DnsAnswer::Status::Ok || answer.addresses.isEmpty()) {
+            ProbeResult r;
+            r.status = ProbeResult::Status::DnsFail;
+            r.message = answer.errorString;
+            finish_(r);
+            return;
+        }
+        QHostAddress addr;
+        for (const auto& a : answer.addresses) {
+            if (a.protocol() == QAbstractSocket::IPv4Protocol) { addr = a; break; }
+        }
+        if (addr.isNull()) addr = answer.addresses.first();
+        ip_ = addr.toString();
+        dnsNs_ = elapsed_.nsecsElapsed();
+        dnsMs_ = dnsNs_ / 1000000;
+        emit progressDnsResolved(dnsMs_, ip_);
+
+        sendAll_();
+    });
+}
+
+void HttpMultiProbe::sendAll_() {
+    const bool useHttps = (port_ == 443);
+    const QString base = QStringLiteral("%1://%2:%3")
+            .arg(useHttps ? QStringLiteral("https") : QStringLiteral("http"),
+                 host_.contains(':') ? QStringLiteral("[%1]").arg(host_) : host_)
+            .arg(port_);
+
+    const int n = paths_.size();
+    requests_.resize(size_t(n));
+    results_.resize(n);
+    pending_ = n;
+    for (int i = 0; i < n; ++i) {
+        requests_[size_t(i)] = Request();
+        results_[i] = ProbeResult::PathResult();
+        results_[i].path = paths_[i];
+
+        QNetworkRequest req(QUrl(base + paths_[i]));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 9, 0)
+        req.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+        // Older Qt speaks HTTP/1.1 here, over QNAM's usual six connections per host.
+        req.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+        if (!useHttps) req.setAttribute(QNetworkRequest::Http2DirectAttribute, true);
+#endif
+        req.setHeader(QNetworkRequest::UserAgentHeader, "SimpleQtNetMon/1.0");
+
+        Request& q = requests_[size_t(i)];
+        q.sentNs = elapsed_.nsecsElapsed();
+        QNetworkReply* reply = NetworkAccessPool::forCurrentThread(i % connections_)->head(req);
+        q.reply = reply;
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+        QObject::connect(reply, &QNetworkReply::socketStartedConnecting, this, [this, i, reply]{
+            if (active_ && requests_[size_t(i)].reply == reply) requests_[size_t(i)].connecting = true;
+        });
+#endif
+        QObject::connect(reply, &QNetworkReply::metaDataChanged, this, [this, i, reply]{
+            Request& q = requests_[size_t(i)];
+            if (active_ && q.reply == reply && q.headersNs < 0) q.headersNs = elapsed_.nsecsElapsed();
+        });
+        QObject::connect(reply, &QNetworkReply::finished, this, [this, i, reply]{
+            if (active_ && requests_[size_t(i)].reply == reply) settle_(i);
+        });
+    }
+}
+
+void HttpMultiProbe::settle_(int index) {
+    Request& q = requests_[size_t(index)];
+    QNetworkReply* reply = q.reply;
+    q.doneNs = elapsed_.nsecsElapsed();
+    if (q.headersNs < 0) q.headersNs = q.doneNs;
+
+    ProbeResult::PathResult& p = results_[index];
+    const int code = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    p.httpCode = code > 0 ? code : -1;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    p.http2 = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+#endif
+    if (reply->error() == QNetworkReply::NoError && code >= 100) {
+        p.status = ProbeResult::Status::Up;
+    } else {
+        p.status = ProbeResult::Status::Down;
+        p.message = reply->errorString();
+    }
+    p.ttfbUs = (q.headersNs - q.sentNs) / 1000;
+    p.totalUs = (q.doneNs - q.sentNs) / 1000;
+
+    QObject::disconnect(reply, nullptr, this, nullptr);
+    reply->deleteLater();
+    q.reply = nullptr;
+    if (--pending_ == 0) report_();
+}
+
+void HttpMultiProbe::report_() {
+    ProbeResult r;
+    r.status = ProbeResult::Status::Up;
+    int failed = 0;
+    const ProbeResult::PathResult* first = nullptr;   // первый неудачный путь
+    qint64 slowestUs = -1;
+    bool reused = true;
+    for (int i = 0; i < results_.size(); ++i) {
+        const ProbeResult::PathResult& p = results_[i];
+        if (p.status != ProbeResult::Status::Up) {
+            ++failed;
+            if (!first) first = &p;
+            // A timeout anywhere makes the probe a timeout; otherwise it is down.
+            if (p.status == ProbeResult::Status::Timeout || r.status == ProbeResult::Status::Up) r.status = p.status;
+        }
+        slowestUs = qMax(slowestUs, p.totalUs);
+        r.phases.ttfbUs = qMax(r.phases.ttfbUs, p.ttfbUs);
+        if (requests_[size_t(i)].connecting) reused = false;
+    }
+    const ProbeResult::PathResult& headline = first ? *first : results_.first();
+    if (headline.httpCode > 0) r.httpCode = headline.httpCode;
+    if (first) {
+        r.message = tr("%1 of %2 paths failed, %3: %4").arg(failed).arg(results_.size())
+                .arg(first->path, first->message);
+    }
+    if (slowestUs >= 0 && failed < results_.size()) {
+        r.latencyNs = slowestUs * 1000;
+        r.latencyMs = slowestUs / 1000;
+    }
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    // QNAM does not report socketStartedConnecting for pooled connections.
+    r.phases.reusedConnection = reused;
+#else
+    Q_UNUSED(reused)
+#endif
+    r.paths = results_;
+    finish_(r);
+}
+
+void HttpMultiProbe::dropReplies_() {
+    for (auto& q : requests_) {
+        if (!q.reply) continue;
+        QNetworkReply* reply = q.reply;
+        q.reply = nullptr;
+        // abort() emits finished() synchronously; nobody listens any more.
+        QObject::disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+void HttpMultiProbe::abort() {
+    if (!active_) return;
+    active_ = false;
+    timeout_.stop();
+    dropReplies_();
+}
+
+void HttpMultiProbe::finish_(ProbeResult r) {
+    r.dnsMs = dnsMs_;
+    r.dnsCached = dnsCached_;
+    r.ip = ip_;
+    r.phases.dnsUs = dnsNs_ >= 0 ? dnsNs_ / 1000 : -1;
+    r.phases.totalUs = elapsed_.nsecsElapsed() / 1000;
+    abort();
+    emit finished(r);
+}
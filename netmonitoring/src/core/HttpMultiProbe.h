@@ -0,0 +1,67 @@
+#pragma once
+#include "INetProbe.h"
+#include <QNetworkReply>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <vector>
+
+// HEAD request to every path of a target at once (mode http-multi). Requests go
+// out as HTTP/2 streams: negotiated over ALPN for https (port 443), with prior
+// knowledge (h2c) for plain http, so all paths of a host share one connection
+// instead of opening one each. httpConnections > 1 spreads the paths round-robin
+// over that many connections (NetworkAccessPool slots). Each path is reported in
+// ProbeResult::paths with its status, code and TTFB; the target is UP only if
+// every path is. latencyMs/Ns and phases.ttfbUs are those of the slowest path,
+// without DNS.
+// Requests go to the host name: HTTP/2 takes :authority from the URL, so pinning
+// the DnsCache address would break virtual hosts. QNAM therefore resolves the
+// name itself (its own cache usually answers), and a path's TTFB, counted from
+// when its request was queued, includes QNAM's DNS, connect and TLS whenever the
+// probe opened a connection instead of reusing one. Qt 6.3+ reports this as
+// phases.reusedConnection == false; older Qt cannot tell the two cases apart.
+class HttpMultiProbe : public INetProbe {
+    Q_OBJECT
+public:
+    static constexpr int kMaxPaths = 256;
+
+    explicit HttpMultiProbe(QObject* parent = nullptr);
+    ~HttpMultiProbe() override;
+
+    void start(const QString& host, quint16 port, int timeoutMs) override;
+    void abort() override;
+    void configure(const ProbeTarget& target) override;
+
+private:
+    struct Request {
+        QPointer<QNetworkReply> reply;
+        qint64 sentNs = -1;
+        qint64 headersNs = -1;
+        qint64 doneNs = -1;               // -1 — ещё ждёт ответа
+        bool connecting = false;          // открывал своё соединение (Qt 6.3+)
+    };
+
+    void sendAll_();
+    void settle_(int index);
+    void report_();
+    void dropReplies_();
+    void finish_(ProbeResult r);
+
+    QStringList paths_;
+    int connections_ = 1;
+    std::vector<Request> requests_;       // по одному на путь, ёмкость переживает запуски
+    QVector<ProbeResult::PathResult> results_;
+    int pending_ = 0;
+
+    QTimer timeout_;
+    QElapsedTimer elapsed_;
+
+    QString host_;
+    quint16 port_ = 0;
+    QString ip_;
+    qint64 dnsMs_ = -1;
+    qint64 dnsNs_ = -1;
+    bool dnsCached_ = false;
+    bool active_ = false;
+    quint64 run_ = 0;                     // номер запуска: отсекает колбэки прошлых запусков
+};
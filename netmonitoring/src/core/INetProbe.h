@@ -2,6 +2,7 @@
 #include <QObject>
 #include <QString>
 #include "ProbeResult.h"
+#include "ProbeTarget.h"
 
 class INetProbe : public QObject {
     Q_OBJECT
@@ -12,7 +13,17 @@ public:
     virtual void start(const QString& host, quint16 port, int timeoutMs) = 0;
     virtual void abort() = 0;
 
+    // Mode-specific options from the target; called before every start()
+    virtual void configure(const ProbeTarget& target) { Q_UNUSED(target) }
+
+    // Opaque owner id (target id in ProbeScheduler), lets pooled probes stay wired once
+    void setTag(quint32 tag) { tag_ = tag; }
+    quint32 tag() const { return tag_; }
+
     signals:
             void finished(const ProbeResult& result);
     void progressDnsResolved(qint64 dnsMs, const QString& ip);
+
+private:
+    quint32 tag_ = 0;
 };
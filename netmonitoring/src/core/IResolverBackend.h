@@ -0,0 +1,28 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QHostAddress>
+
+struct DnsAnswer {
+    enum class Status { Ok, NxDomain, ServFail };
+
+    Status status = Status::ServFail;
+    QList<QHostAddress> addresses;
+    quint32 ttlSec = 0;                   // TTL из ответа (для Ok)
+    QString errorString;
+};
+
+// Source of uncached answers for DnsCache. resolve() must emit resolved() exactly
+// once per call, asynchronously.
+class IResolverBackend : public QObject {
+    Q_OBJECT
+public:
+    explicit IResolverBackend(QObject* parent = nullptr) : QObject(parent) {}
+    ~IResolverBackend() override = default;
+
+    virtual void resolve(const QString& name) = 0;
+
+signals:
+    void resolved(const QString& name, const DnsAnswer& answer);
+};
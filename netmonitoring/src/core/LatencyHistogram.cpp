@@ -0,0 +1,57 @@
+#include "LatencyHistogram.h"
+#include <QtAlgorithms>
+#include <cmath>
+
+int LatencyHistogram::bucketIndex(qint64 value) {
+    if (value < kSubCount) return value < 0 ? 0 : int(value);
+    const int magnitude = 63 - qCountLeadingZeroBits(quint64(value));
+    const int shift = magnitude - kSubBits;
+    const int sub = int(value >> shift) - kSubCount;
+    return (shift + 1) * kSubCount + sub;
+}
+
+qint64 LatencyHistogram::bucketLowerBound(int idx) {
+    if (idx < kSubCount) return idx;
+    const int shift = idx / kSubCount - 1;
+    const int sub = idx % kSubCount;
+    return qint64(kSubCount + sub) << shift;
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int idx) {
+    if (idx < kSubCount) return idx;
+    const int shift = idx / kSubCount - 1;
+    return bucketLowerBound(idx) + (qint64(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(qint64 value, quint64 n) {
+    const int idx = bucketIndex(value);
+    if (idx >= counts_.size()) counts_.resize(idx + 1);
+    counts_[idx] += n;
+    total_ += n;
+}
+
+void LatencyHistogram::remove(qint64 value, quint64 n) {
+    const int idx = bucketIndex(value);
+    if (idx >= counts_.size()) return;
+    const quint64 dropped = qMin(n, counts_.at(idx));
+    counts_[idx] -= dropped;
+    total_ -= dropped;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.counts_.size() > counts_.size()) counts_.resize(other.counts_.size());
+    for (int i = 0; i < other.counts_.size(); ++i) counts_[i] += other.counts_.at(i);
+    total_ += other.total_;
+}
+
+qint64 LatencyHistogram::percentile(double q) const {
+    if (total_ == 0) return -1;
+    const double clamped = qBound(0.0, q, 100.0);
+    const quint64 rank = qMax<quint64>(1, quint64(std::ceil(clamped / 100.0 * double(total_))));
+    quint64 seen = 0;
+    for (int i = 0; i < counts_.size(); ++i) {
+        seen += counts_.at(i);
+        if (seen >= rank) return bucketUpperBound(i);
+    }
+    return bucketUpperBound(counts_.size() - 1);
+}
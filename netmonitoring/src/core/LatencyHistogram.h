@@ -0,0 +1,35 @@
+#pragma once
+#include <QtGlobal>
+#include <QVector>
+
+// Log-linear (HDR-style) histogram: values below 2^kSubBits are exact, above that
+// every power of two is split into 2^kSubBits buckets, so the relative error stays
+// under 1/2^kSubBits. Buckets are allocated up to the largest recorded value only.
+// Histograms with the same layout merge by adding counts.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 4;
+    static constexpr int kSubCount = 1 << kSubBits;
+
+    void record(qint64 value, quint64 n = 1);
+    void remove(qint64 value, quint64 n = 1);
+    void merge(const LatencyHistogram& other);
+    void clear() { counts_.clear(); total_ = 0; }
+
+    bool empty() const { return total_ == 0; }
+    quint64 count() const { return total_; }
+
+    // q in percent (50, 99, 99.9); returns the upper bound of the matching bucket, -1 if empty
+    qint64 percentile(double q) const;
+
+    int bucketCount() const { return counts_.size(); }
+    quint64 bucketAt(int idx) const { return counts_.at(idx); }
+
+    static int bucketIndex(qint64 value);
+    static qint64 bucketLowerBound(int idx);
+    static qint64 bucketUpperBound(int idx);
+
+private:
+    QVector<quint64> counts_;
+    quint64 total_ = 0;
+};
@@ -0,0 +1,86 @@
+#include "LogFileSink.h"
+
+static constexpr int kMaxBuffered = 64 * 1024;
+
+LogFileSink::LogFileSink(QObject* parent)
+        : QObject(parent) {
+    flushTimer_.setInterval(1000);
+    QObject::connect(&flushTimer_, &QTimer::timeout, this, [this]{ flush(); });
+}
+
+LogFileSink::~LogFileSink() {
+    close();
+}
+
+bool LogFileSink::open(const QString& path) {
+    close();
+    path_ = path;
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        error_ = file_.errorString();
+        return false;
+    }
+    error_.clear();
+    written_ = file_.size();
+    flushTimer_.start();
+    return true;
+}
+
+void LogFileSink::close() {
+    if (!file_.isOpen()) return;
+    flush();
+    flushTimer_.stop();
+    file_.close();
+}
+
+void LogFileSink::setMaxFileSize(qint64 bytes) {
+    maxFileSize_ = qMax<qint64>(0, bytes);
+}
+
+void LogFileSink::setMaxFiles(int n) {
+    maxFiles_ = qMax(1, n);
+}
+
+void LogFileSink::setFlushIntervalMs(int ms) {
+    flushTimer_.setInterval(qMax(10, ms));
+}
+
+void LogFileSink::write(const QString& line) {
+    if (!file_.isOpen()) return;
+    buffer_ += line.toUtf8();
+    buffer_ += '\n';
+    if (buffer_.size() >= kMaxBuffered) flush();
+}
+
+bool LogFileSink::flush() {
+    if (!file_.isOpen() || buffer_.isEmpty()) return true;
+    if (maxFileSize_ > 0 && written_ > 0 && written_ + buffer_.size() > maxFileSize_) {
+        if (!rotate_()) return false;
+    }
+    const qint64 n = file_.write(buffer_);
+    if (n < 0) {
+        error_ = file_.errorString();
+        return false;
+    }
+    written_ += n;
+    buffer_.remove(0, int(n));
+    file_.flush();
+    return buffer_.isEmpty();
+}
+
+bool LogFileSink::rotate_() {
+    file_.close();
+    QFile::remove(QStringLiteral("%1.%2").arg(path_).arg(maxFiles_));
+    for (int i = maxFiles_ - 1; i >= 1; --i)
+        QFile::rename(QStringLiteral("%1.%2").arg(path_).arg(i), QStringLiteral("%1.%2").arg(path_).arg(i + 1));
+    QFile::rename(path_, path_ + QStringLiteral(".1"));
+
+    file_.setFileName(path_);
+    if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        error_ = file_.errorString();
+        flushTimer_.stop();
+        return false;
+    }
+    written_ = 0;
+    return true;
+}
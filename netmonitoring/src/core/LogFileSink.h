@@ -0,0 +1,38 @@
+#pragma once
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+
+// Streaming text log: lines are buffered in memory, written in chunks and the file
+// is rotated by size (log, log.1 ... log.N).
+class LogFileSink : public QObject {
+    Q_OBJECT
+public:
+    explicit LogFileSink(QObject* parent = nullptr);
+    ~LogFileSink() override;
+
+    bool open(const QString& path);
+    void close();
+    bool isOpen() const { return file_.isOpen(); }
+    QString path() const { return path_; }
+    QString errorString() const { return error_; }
+
+    void setMaxFileSize(qint64 bytes);    // 0 — без ротации
+    void setMaxFiles(int n);              // сколько старых файлов хранить
+    void setFlushIntervalMs(int ms);
+
+    void write(const QString& line);
+    bool flush();
+
+private:
+    bool rotate_();
+
+    QFile file_;
+    QString path_;
+    QString error_;
+    QByteArray buffer_;
+    QTimer flushTimer_;
+    qint64 written_ = 0;                  // размер текущего файла
+    qint64 maxFileSize_ = 10 * 1024 * 1024;
+    int maxFiles_ = 5;
+};
@@ -0,0 +1,443 @@
+#include "MetricsExporter.h"
+#include "MonitorController.h"
+#include "SelfMetrics.h"
+#include <QTcpSocket>
+
+namespace {
+
+// Latency histogram bounds, seconds
+constexpr double kBounds[] = {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+constexpr int kBoundCount = int(sizeof(kBounds) / sizeof(kBounds[0]));
+
+constexpr const char* kStatusLabel[] = {"up", "down", "dns_fail", "timeout", "error"};
+
+// Time windows of the netmon_window_* families
+constexpr int kWindowSec[] = {60, 300, 3600, 86400};
+constexpr const char* kWindowLabel[] = {"1m", "5m", "1h", "24h"};
+
+// Family headers, in Family order
+constexpr const char* kHeaders[] = {
+    "# TYPE netmon_up gauge\n"
+    "# HELP netmon_up Whether the last probe of the target succeeded.\n",
+    "# TYPE netmon_probe_latency_seconds histogram\n"
+    "# UNIT netmon_probe_latency_seconds seconds\n"
+    "# HELP netmon_probe_latency_seconds Latency of successful probes.\n",
+    "# TYPE netmon_dns_duration_seconds gauge\n"
+    "# UNIT netmon_dns_duration_seconds seconds\n"
+    "# HELP netmon_dns_duration_seconds DNS resolution time of the last probe.\n",
+    "# TYPE netmon_probes counter\n"
+    "# HELP netmon_probes Finished probes by result.\n",
+    "# TYPE netmon_http_responses counter\n"
+    "# HELP netmon_http_responses HTTP responses by status code.\n",
+    "# TYPE netmon_udp_packets counter\n"
+    "# HELP netmon_udp_packets UDP probe packets by outcome (sent, lost).\n",
+    "# TYPE netmon_udp_jitter_seconds gauge\n"
+    "# UNIT netmon_udp_jitter_seconds seconds\n"
+    "# HELP netmon_udp_jitter_seconds RTT jitter of the last UDP probe.\n",
+    "# TYPE netmon_tls_handshake_seconds gauge\n"
+    "# UNIT netmon_tls_handshake_seconds seconds\n"
+    "# HELP netmon_tls_handshake_seconds Last TLS handshake time, full or resumed (the server accepted the saved session).\n",
+    "# TYPE netmon_tls_cert_expiry_timestamp_seconds gauge\n"
+    "# UNIT netmon_tls_cert_expiry_timestamp_seconds seconds\n"
+    "# HELP netmon_tls_cert_expiry_timestamp_seconds Expiry of the server certificate.\n",
+    "# TYPE netmon_path_up gauge\n"
+    "# HELP netmon_path_up Whether the last request to the path succeeded (http-multi).\n",
+    "# TYPE netmon_path_ttfb_seconds gauge\n"
+    "# UNIT netmon_path_ttfb_seconds seconds\n"
+    "# HELP netmon_path_ttfb_seconds Time to the response headers of the last request to the path (http-multi).\n",
+    "# TYPE netmon_window_availability_ratio gauge\n"
+    "# UNIT netmon_window_availability_ratio ratio\n"
+    "# HELP netmon_window_availability_ratio Share of probes that were UP over the window.\n",
+    "# TYPE netmon_window_latency_seconds gauge\n"
+    "# UNIT netmon_window_latency_seconds seconds\n"
+    "# HELP netmon_window_latency_seconds Latency percentiles over the window (log bins at sqrt(2) steps, about 41% wide).\n",
+    "# TYPE netmon_window_failed_probes gauge\n"
+    "# HELP netmon_window_failed_probes Probes that were not UP over the window.\n",
+    "# TYPE netmon_last_probe_timestamp_seconds gauge\n"
+    "# UNIT netmon_last_probe_timestamp_seconds seconds\n"
+    "# HELP netmon_last_probe_timestamp_seconds Completion time of the last probe.\n",
+};
+
+QByteArray escapeLabel(const QString& v) {
+    QByteArray out;
+    const QByteArray raw = v.toUtf8();
+    out.reserve(raw.size());
+    for (char c : raw) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '"') out += "\\\"";
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+    return out;
+}
+
+QByteArray num(double v) {
+    return QByteArray::number(v, 'g', 10);
+}
+
+// Summary sample lines (p50, p99, sum, count) of a SelfMetrics distribution
+QByteArray summary(const char* name, const QByteArray& labels, const SelfMetrics::Distribution& d) {
+    const QByteArray sep = labels.isEmpty() ? QByteArray() : labels + ',';
+    QByteArray out;
+    for (double q : {50.0, 99.0}) {
+        out += QByteArray(name) + '{' + sep + "quantile=\"" + num(q / 100) + "\"} "
+                + num(d.hist.empty() ? 0.0 : double(d.hist.percentile(q)) / 1e6) + '\n';
+    }
+    const QByteArray braces = labels.isEmpty() ? QByteArray() : '{' + labels + '}';
+    out += QByteArray(name) + "_sum" + braces + ' ' + num(double(d.sumUs) / 1e6) + '\n';
+    out += QByteArray(name) + "_count" + braces + ' ' + QByteArray::number(d.hist.count()) + '\n';
+    return out;
+}
+
+} // namespace
+
+MetricsExporter::MetricsExporter(QObject* parent)
+        : QObject(parent) {
+    publishTimer_.setSingleShot(true);
+    publishTimer_.setInterval(1000);
+    QObject::connect(&publishTimer_, &QTimer::timeout, this, &MetricsExporter::publish);
+    QObject::connect(&server_, &QTcpServer::newConnection, this, &MetricsExporter::onConnection_);
+    selfTimer_.setInterval(publishTimer_.interval());
+    QObject::connect(&selfTimer_, &QTimer::timeout, this, [this]{
+        // Idle monitors keep the body they have
+        QByteArray self = renderSelf_();
+        if (self == selfPart_) return;
+        selfPart_ = self;
+        assemble_();
+    });
+    selfPart_ = renderSelf_();
+    publish();
+}
+
+bool MetricsExporter::listen(const QHostAddress& address, quint16 port) {
+    return server_.listen(address, port);
+}
+
+void MetricsExporter::close() {
+    server_.close();
+}
+
+void MetricsExporter::setPublishIntervalMs(int ms) {
+    publishTimer_.setInterval(qMax(10, ms));
+    selfTimer_.setInterval(publishTimer_.interval());
+}
+
+void MetricsExporter::attach(MonitorController* controller) {
+    controller_ = controller;
+    selfTimer_.start();
+    QObject::connect(controller, &MonitorController::targetChanged, this, [this, controller](quint32 id){
+        setTarget(id, controller->target(id));
+    });
+    QObject::connect(controller, &MonitorController::resultsReady, this, &MetricsExporter::recordResults);
+    // http-multi results always come in full, whatever the controller's detail setting
+    QObject::connect(controller, &MonitorController::targetProbeFinished, this,
+                     [this](quint32 id, const ProbeResult& r){
+                         if (!r.paths.isEmpty()) recordPaths(id, r);
+                     });
+    QObject::connect(controller, &MonitorController::targetRemoved, this, &MetricsExporter::removeTarget);
+}
+
+void MetricsExporter::recordResults(const QVector<ProbeRecord>& batch) {
+    for (const ProbeRecord& r : batch) recordResult(r);
+}
+
+void MetricsExporter::setTarget(quint32 id, const ProbeTarget& target) {
+    const QByteArray labels = QByteArray("target=\"") + escapeLabel(QStringLiteral("%1:%2").arg(target.host).arg(target.port))
+            + "\",mode=\"" + probeModeName(target.mode) + '"';
+    Series& s = series_[id];
+    if (labels == s.labels) return;
+    // Retargeted: the old counters belong to another series.
+    const bool shown = !s.labels.isEmpty();
+    s = Series();
+    s.labels = labels;
+    s.buckets.assign(size_t(kBoundCount + 1), 0);
+    if (shown) schedulePublish_();
+}
+
+MetricsExporter::Series* MetricsExporter::seriesFor_(quint32 id) {
+    auto it = series_.find(id);
+    if (it != series_.end()) return &it->second;
+    // Added before attach(): the only lookup this target ever gets
+    if (!controller_) return nullptr;
+    const ProbeTarget target = controller_->target(id);
+    if (target.host.isEmpty()) return nullptr;
+    setTarget(id, target);
+    return &series_[id];
+}
+
+void MetricsExporter::markDirty_(quint32 id, Series& s) {
+    if (!s.dirty) {
+        s.dirty = true;
+        dirty_.push_back(id);
+    }
+    schedulePublish_();
+}
+
+void MetricsExporter::recordPaths(quint32 id, const ProbeResult& r) {
+    Series* series = seriesFor_(id);
+    if (!series) return;
+    Series& s = *series;
+    s.paths.clear();
+    for (const auto& p : r.paths) {
+        PathView& v = s.paths[p.path];
+        v.up = (p.status == ProbeResult::Status::Up);
+        v.ttfbSec = p.ttfbUs >= 0 ? double(p.ttfbUs) / 1e6 : -1;
+    }
+    markDirty_(id, s);
+}
+
+void MetricsExporter::recordResult(const ProbeRecord& r) {
+    Series* series = seriesFor_(r.target);
+    if (!series) return;
+    Series& s = *series;
+    s.up = r.isUp();
+    s.lastMs = r.finishedMs;
+    ++s.results[r.status];
+    if (s.up && r.latencyNs >= 0) {
+        const double sec = double(r.latencyNs) / 1e9;
+        int b = 0;
+        while (b < kBoundCount && sec > kBounds[b]) ++b;
+        ++s.buckets[size_t(b)];
+        s.latencySum += sec;
+        ++s.latencyCount;
+    }
+    if (r.dnsUs >= 0) s.dnsSec = double(r.dnsUs) / 1e6;
+    if (r.httpCode >= 0) ++s.httpCodes[r.httpCode];
+    if (r.packetsSent >= 0) {
+        s.udpSent += quint64(r.packetsSent);
+        s.udpLost += quint64(qMax(0, r.packetsSent - r.packetsReceived));
+        if (r.jitterUs >= 0) s.jitterSec = double(r.jitterUs) / 1e6;
+    }
+    if (r.flags & ProbeRecord::HasTls) {
+        if (r.tlsUs >= 0) s.tlsSec[(r.flags & ProbeRecord::TlsResumed) ? 1 : 0] = double(r.tlsUs) / 1e6;
+        s.certNotAfterMs = r.certNotAfterMs;
+    }
+    markDirty_(r.target, s);
+}
+
+void MetricsExporter::removeTarget(quint32 id) {
+    if (series_.erase(id) == 0) return;
+    schedulePublish_();
+}
+
+void MetricsExporter::schedulePublish_() {
+    stale_ = true;
+    if (!publishTimer_.isActive()) publishTimer_.start();
+}
+
+void MetricsExporter::render_(Series& s) const {
+    const QByteArray& l = s.labels;
+
+    s.frag[Up] = "netmon_up{" + l + "} " + (s.up ? "1\n" : "0\n");
+
+    QByteArray& h = s.frag[Latency];
+    h.clear();
+    quint64 cumulative = 0;
+    for (int b = 0; b <= kBoundCount; ++b) {
+        cumulative += s.buckets[size_t(b)];
+        h += "netmon_probe_latency_seconds_bucket{" + l + ",le=\"";
+        h += b < kBoundCount ? num(kBounds[b]) : QByteArray("+Inf");
+        h += "\"} " + QByteArray::number(cumulative) + '\n';
+    }
+    h += "netmon_probe_latency_seconds_count{" + l + "} " + QByteArray::number(s.latencyCount) + '\n';
+    h += "netmon_probe_latency_seconds_sum{" + l + "} " + num(s.latencySum) + '\n';
+
+    s.frag[Dns] = s.dnsSec >= 0 ? "netmon_dns_duration_seconds{" + l + "} " + num(s.dnsSec) + '\n' : QByteArray();
+
+    QByteArray& p = s.frag[Probes];
+    p.clear();
+    for (int i = 0; i < 5; ++i) {
+        p += "netmon_probes_total{" + l + ",result=\"" + kStatusLabel[i] + "\"} " + QByteArray::number(s.results[i]) + '\n';
+    }
+
+    QByteArray& c = s.frag[HttpResponses];
+    c.clear();
+    for (auto it = s.httpCodes.cbegin(); it != s.httpCodes.cend(); ++it) {
+        c += "netmon_http_responses_total{" + l + ",code=\"" + QByteArray::number(it.key()) + "\"} "
+             + QByteArray::number(it.value()) + '\n';
+    }
+
+    if (s.udpSent > 0) {
+        s.frag[UdpPackets] = "netmon_udp_packets_total{" + l + ",result=\"sent\"} " + QByteArray::number(s.udpSent) + '\n'
+                + "netmon_udp_packets_total{" + l + ",result=\"lost\"} " + QByteArray::number(s.udpLost) + '\n';
+    } else {
+        s.frag[UdpPackets].clear();
+    }
+    s.frag[Jitter] = s.jitterSec >= 0 ? "netmon_udp_jitter_seconds{" + l + "} " + num(s.jitterSec) + '\n' : QByteArray();
+
+    QByteArray& t = s.frag[TlsHandshake];
+    t.clear();
+    for (int k = 0; k < 2; ++k) {
+        if (s.tlsSec[k] < 0) continue;
+        t += "netmon_tls_handshake_seconds{" + l + ",kind=\"" + (k ? "resumed" : "full") + "\"} " + num(s.tlsSec[k]) + '\n';
+    }
+    s.frag[CertExpiry] = s.certNotAfterMs >= 0
+            ? "netmon_tls_cert_expiry_timestamp_seconds{" + l + "} " + QByteArray::number(s.certNotAfterMs / 1000) + '\n'
+            : QByteArray();
+
+    QByteArray& pu = s.frag[PathUp];
+    QByteArray& pt = s.frag[PathTtfb];
+    pu.clear();
+    pt.clear();
+    for (auto it = s.paths.cbegin(); it != s.paths.cend(); ++it) {
+        const QByteArray pathLabels = l + ",path=\"" + escapeLabel(it.key()) + '"';
+        pu += "netmon_path_up{" + pathLabels + "} " + (it.value().up ? "1\n" : "0\n");
+        if (it.value().ttfbSec >= 0) pt += "netmon_path_ttfb_seconds{" + pathLabels + "} " + num(it.value().ttfbSec) + '\n';
+    }
+
+    QByteArray& wa = s.frag[WindowAvailability];
+    QByteArray& wl = s.frag[WindowLatency];
+    QByteArray& wf = s.frag[WindowFailed];
+    wa.clear();
+    wl.clear();
+    wf.clear();
+    for (int w = 0; w < kWindowCount; ++w) {
+        const WindowView& v = s.windows[w];
+        if (v.probes == 0) continue;
+        const QByteArray windowLabels = l + ",window=\"" + kWindowLabel[w] + '"';
+        wa += "netmon_window_availability_ratio{" + windowLabels + "} " + num(v.availability) + '\n';
+        wf += "netmon_window_failed_probes{" + windowLabels + "} " + QByteArray::number(v.failed) + '\n';
+        if (v.p50Us < 0) continue;
+        wl += "netmon_window_latency_seconds{" + windowLabels + ",quantile=\"0.5\"} " + num(double(v.p50Us) / 1e6) + '\n';
+        wl += "netmon_window_latency_seconds{" + windowLabels + ",quantile=\"0.99\"} " + num(double(v.p99Us) / 1e6) + '\n';
+    }
+
+    s.frag[LastProbe] = "netmon_last_probe_timestamp_seconds{" + l + "} " + QByteArray::number(double(s.lastMs) / 1000.0, 'f', 3) + '\n';
+    s.dirty = false;
+}
+
+void MetricsExporter::publish() {
+    publishTimer_.stop();
+    // Only targets that produced results since the last publish are rendered again.
+    for (quint32 id : dirty_) {
+        auto it = series_.find(id);
+        if (it == series_.end() || !it->second.dirty) continue;
+        if (controller_) {
+            for (int w = 0; w < kWindowCount; ++w) {
+                const WindowStats::Summary sum = controller_->windowStats(id, kWindowSec[w]);
+                WindowView& v = it->second.windows[w];
+                v.probes = sum.probes;
+                v.failed = sum.failed();
+                v.availability = sum.probes ? double(sum.up) / double(sum.probes) : -1;
+                v.p50Us = sum.percentileUs(50);
+                v.p99Us = sum.percentileUs(99);
+            }
+        }
+        render_(it->second);
+    }
+    dirty_.clear();
+    if (!stale_) return;
+
+    QByteArray part;
+    part.reserve(targetsPart_.size() + 256);
+    for (int f = 0; f < FamilyCount; ++f) {
+        part += kHeaders[f];
+        for (const auto& kv : series_) part += kv.second.frag[f];
+    }
+    targetsPart_ = part;
+    stale_ = false;
+    assemble_();
+}
+
+void MetricsExporter::assemble_() {
+    // The old body may still be in flight to a scraper: build a fresh buffer.
+    QByteArray next;
+    next.reserve(targetsPart_.size() + selfPart_.size() + 8);
+    next += targetsPart_;
+    next += selfPart_;
+    next += "# EOF\n";
+    body_ = next;
+}
+
+QByteArray MetricsExporter::renderSelf_() const {
+    const SelfMetrics::Snapshot snap = SelfMetrics::instance().snapshot();
+    QByteArray out;
+
+    out += "# TYPE netmon_self_loop_lag_seconds summary\n"
+           "# UNIT netmon_self_loop_lag_seconds seconds\n"
+           "# HELP netmon_self_loop_lag_seconds How late a 100 ms heartbeat timer fires on each event loop.\n";
+    for (auto it = snap.loopLag.cbegin(); it != snap.loopLag.cend(); ++it) {
+        out += summary("netmon_self_loop_lag_seconds", "loop=\"" + escapeLabel(it.key()) + '"', it.value());
+    }
+    out += "# TYPE netmon_self_schedule_skew_seconds summary\n"
+           "# UNIT netmon_self_schedule_skew_seconds seconds\n"
+           "# HELP netmon_self_schedule_skew_seconds Probe start minus its scheduled time.\n";
+    out += summary("netmon_self_schedule_skew_seconds", QByteArray(), snap.scheduleSkew);
+    out += "# TYPE netmon_self_queue_wait_seconds summary\n"
+           "# UNIT netmon_self_queue_wait_seconds seconds\n"
+           "# HELP netmon_self_queue_wait_seconds Time due probes wait for concurrency, per-host and rate limits.\n";
+    out += summary("netmon_self_queue_wait_seconds", QByteArray(), snap.queueWait);
+
+    out += "# TYPE netmon_self_callback_seconds counter\n"
+           "# UNIT netmon_self_callback_seconds seconds\n"
+           "# HELP netmon_self_callback_seconds Wall time spent in the monitor's own callbacks, by site.\n";
+    for (int i = 0; i < SelfMetrics::SiteCount; ++i) {
+        out += QByteArray("netmon_self_callback_seconds_total{site=\"") + SelfMetrics::siteName(SelfMetrics::Site(i))
+                + "\"} " + num(double(snap.sites[i].totalUs) / 1e6) + '\n';
+    }
+    out += "# TYPE netmon_self_callbacks counter\n"
+           "# HELP netmon_self_callbacks Calls of the monitor's own callbacks, by site.\n";
+    for (int i = 0; i < SelfMetrics::SiteCount; ++i) {
+        out += QByteArray("netmon_self_callbacks_total{site=\"") + SelfMetrics::siteName(SelfMetrics::Site(i))
+                + "\"} " + QByteArray::number(snap.sites[i].calls) + '\n';
+    }
+    out += "# TYPE netmon_self_callback_max_seconds gauge\n"
+           "# UNIT netmon_self_callback_max_seconds seconds\n"
+           "# HELP netmon_self_callback_max_seconds Longest single callback, by site.\n";
+    for (int i = 0; i < SelfMetrics::SiteCount; ++i) {
+        out += QByteArray("netmon_self_callback_max_seconds{site=\"") + SelfMetrics::siteName(SelfMetrics::Site(i))
+                + "\"} " + num(double(snap.sites[i].maxUs) / 1e6) + '\n';
+    }
+
+    if (controller_) {
+        const ProbeWorkerPool::Stats pool = controller_->probes().stats();
+        out += "# TYPE netmon_self_probes_in_flight gauge\n"
+               "# HELP netmon_self_probes_in_flight Probes started and not yet finished.\n"
+               "netmon_self_probes_in_flight " + QByteArray::number(pool.inFlight) + '\n';
+        out += "# TYPE netmon_self_probes_queued gauge\n"
+               "# HELP netmon_self_probes_queued Due probes waiting for a free slot.\n"
+               "netmon_self_probes_queued " + QByteArray::number(pool.queued) + '\n';
+        out += "# TYPE netmon_self_probes_skipped counter\n"
+               "# HELP netmon_self_probes_skipped Deadlines dropped because the previous probe had not finished.\n"
+               "netmon_self_probes_skipped_total " + QByteArray::number(pool.skipped) + '\n';
+    }
+    return out;
+}
+
+void MetricsExporter::onConnection_() {
+    while (QTcpSocket* socket = server_.nextPendingConnection()) {
+        QObject::connect(socket, &QTcpSocket::readyRead, this, [this, socket]{ serve_(socket); });
+        QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void MetricsExporter::serve_(QTcpSocket* socket) {
+    // Only the request line matters; wait until the header is complete.
+    if (!socket->canReadLine()) return;
+    if (socket->property("served").toBool()) return;
+    const QByteArray line = socket->readLine().trimmed();
+    const QList<QByteArray> parts = line.split(' ');
+    socket->setProperty("served", true);
+
+    QByteArray status = "200 OK";
+    QByteArray type = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    QByteArray payload;
+    const QByteArray path = parts.size() >= 2 ? parts.at(1) : QByteArray();
+    if (parts.size() < 2 || (parts.at(0) != "GET" && parts.at(0) != "HEAD")) {
+        status = "405 Method Not Allowed";
+        type = "text/plain; charset=utf-8";
+    } else if (path == "/metrics" || path.startsWith("/metrics?")) {
+        payload = body_;                  // shared, not copied
+        ++scrapes_;
+    } else {
+        status = "404 Not Found";
+        type = "text/plain; charset=utf-8";
+        payload = "see /metrics\n";
+    }
+
+    QByteArray head = "HTTP/1.1 " + status + "\r\nContent-Type: " + type
+            + "\r\nContent-Length: " + QByteArray::number(payload.size()) + "\r\nConnection: close\r\n\r\n";
+    socket->write(head);
+    if (parts.value(0) != "HEAD") socket->write(payload);
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <QObject>
+#include <QTcpServer>
+#include <QHostAddress>
+#include <QTimer>
+#include <QMap>
+#include <QByteArray>
+#include <QVector>
+#include <unordered_map>
+#include <vector>
+#include "ProbeRecord.h"
+#include "ProbeResult.h"
+#include "ProbeTarget.h"
+
+class MonitorController;
+class QTcpSocket;
+
+// Embedded OpenMetrics endpoint (GET /metrics). Exposition text is kept ready:
+// every result re-renders only its own target's lines, and the full body is
+// reassembled from those fragments at most once per publish interval. A scrape
+// writes the last published body (an implicitly shared buffer) and never renders.
+// Label sets are built when a target is added or changed, not per result.
+// The monitor's own health (SelfMetrics, scheduler queue) is appended under
+// netmon_self_*, refreshed once per publish interval when it changed.
+class MetricsExporter : public QObject {
+    Q_OBJECT
+public:
+    explicit MetricsExporter(QObject* parent = nullptr);
+
+    bool listen(const QHostAddress& address, quint16 port);
+    void close();
+    bool isListening() const { return server_.isListening(); }
+    quint16 port() const { return server_.serverPort(); }
+    QString errorString() const { return server_.errorString(); }
+
+    void setPublishIntervalMs(int ms);
+
+    // Follows the controller's targets and results
+    void attach(MonitorController* controller);
+
+    // Labels of a target's series; a different host, port or mode starts the series over
+    void setTarget(quint32 id, const ProbeTarget& target);
+    // Targets never passed to setTarget() are looked up in the attached controller
+    void recordResult(const ProbeRecord& r);
+    void recordResults(const QVector<ProbeRecord>& batch);
+    // Per-path outcome of an http-multi probe (ProbeResult::paths)
+    void recordPaths(quint32 id, const ProbeResult& r);
+    void removeTarget(quint32 id);
+
+    QByteArray body() const { return body_; }
+    quint64 scrapes() const { return scrapes_; }
+
+public slots:
+    void publish();                       // reassemble the body right away
+
+private:
+    enum Family { Up, Latency, Dns, Probes, HttpResponses, UdpPackets, Jitter, TlsHandshake, CertExpiry,
+                  PathUp, PathTtfb, WindowAvailability, WindowLatency, WindowFailed, LastProbe, FamilyCount };
+
+    static constexpr int kWindowCount = 4;         // 1m, 5m, 1h, 24h
+
+    // Снимок WindowStats на момент публикации
+    struct WindowView {
+        quint64 probes = 0;
+        quint64 failed = 0;
+        double availability = -1;         // доля 0..1
+        qint64 p50Us = -1;
+        qint64 p99Us = -1;
+    };
+
+    // http-multi: последний ответ по пути
+    struct PathView {
+        bool up = false;
+        double ttfbSec = -1;
+    };
+
+    struct Series {
+        QByteArray labels;                // target="host:port",mode="tcp"
+        bool up = false;
+        qint64 lastMs = 0;
+        std::vector<quint64> buckets;     // накопительно по kBounds + +Inf
+        double latencySum = 0;            // секунды
+        quint64 latencyCount = 0;
+        double dnsSec = -1;
+        quint64 results[5] = {};          // по ProbeResult::Status
+        QMap<int, quint64> httpCodes;
+        quint64 udpSent = 0;              // udp-*: пакетов отправлено
+        quint64 udpLost = 0;              // udp-*: из них без ответа
+        double jitterSec = -1;
+        double tlsSec[2] = {-1, -1};      // последнее рукопожатие: полное, с предложенной сессией
+        qint64 certNotAfterMs = -1;
+        QMap<QString, PathView> paths;    // только из последней пробы
+        WindowView windows[kWindowCount];
+        QByteArray frag[FamilyCount];
+        bool dirty = false;
+    };
+
+    Series* seriesFor_(quint32 id);
+    void assemble_();
+    void markDirty_(quint32 id, Series& s);
+    void render_(Series& s) const;
+    QByteArray renderSelf_() const;
+    void schedulePublish_();
+    void onConnection_();
+    void serve_(QTcpSocket* socket);
+
+    QTcpServer server_;
+    QTimer publishTimer_;
+    QTimer selfTimer_;                    // netmon_self_* меняются и без результатов
+    MonitorController* controller_ = nullptr;
+    std::unordered_map<quint32, Series> series_;
+    std::vector<quint32> dirty_;
+    QByteArray targetsPart_;              // заголовки и фрагменты всех целей
+    QByteArray selfPart_;                 // netmon_self_* последнего обновления
+    QByteArray body_;
+    bool stale_ = true;                   // targetsPart_ отстаёт от фрагментов
+    quint64 scrapes_ = 0;
+};
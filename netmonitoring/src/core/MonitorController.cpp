@@ -1,81 +1,276 @@
 #include "MonitorController.h"
-#include "TcpConnectProbe.h"
-#include "HttpHeadProbe.h"
+#include "TimeSeriesStore.h"
+#include "RateLimiter.h"
+#include <QDateTime>
 
 MonitorController::MonitorController(QObject* parent)
         : QObject(parent) {
-    intervalTimer_.setSingleShot(false);
-    QObject::connect(&intervalTimer_, &QTimer::timeout, this, &MonitorController::runProbe_);
-    stats_.setMaxSamples(50);
+    QObject::connect(&probes_, &ProbeWorkerPool::eventsReady, this, &MonitorController::onEvents_);
+
+    primaryDefaults_.host = QStringLiteral("red-byte.ru");
+    primaryDefaults_.port = 80;
+    primaryDefaults_.mode = Mode::TcpConnect;
+    primaryDefaults_.timeoutMs = 3000;
+    primaryDefaults_.intervalMs = 5000;
+    noStats_.setMaxSamples(maxSamples_);
+    ensurePrimary_();
+}
+
+MonitorController::TargetId MonitorController::ensurePrimary_() {
+    if (primary_ == kNoTarget || !targets_.contains(primary_)) {
+        primary_ = addTarget(primaryDefaults_);
+        probes_.setDetailTarget(primary_);
+    }
+    return primary_;
 }
 
-void MonitorController::setMode(Mode m) { mode_ = m; }
+void MonitorController::updatePrimary_(const ProbeTarget& cfg) {
+    primaryDefaults_ = cfg;
+    updateTarget(ensurePrimary_(), cfg);
+}
+
+void MonitorController::setMode(Mode m) {
+    ProbeTarget cfg = target(ensurePrimary_());
+    cfg.mode = m;
+    updatePrimary_(cfg);
+}
 
 void MonitorController::setTarget(QString host, quint16 port) {
-    host_ = std::move(host);
-    port_ = port;
+    ProbeTarget cfg = target(ensurePrimary_());
+    cfg.host = std::move(host);
+    cfg.port = port;
+    updatePrimary_(cfg);
 }
 
 void MonitorController::setIntervalSec(int sec) {
-    intervalMs_ = qMax(1, sec) * 1000;
-    if (intervalTimer_.isActive()) {
-        intervalTimer_.start(intervalMs_);
+    ProbeTarget cfg = target(ensurePrimary_());
+    cfg.intervalMs = qMax(1, sec) * 1000;
+    updatePrimary_(cfg);
+    // Как и раньше: новый интервал отсчитывается от момента изменения
+    probes_.rephase(primary_, cfg.intervalMs);
+}
+
+void MonitorController::setRateLimit(double perSec, int burst) {
+    RateLimiter::instance().setRate(perSec, burst);
+}
+
+void MonitorController::setMaxSockets(int n) {
+    RateLimiter::instance().setMaxInFlight(n);
+}
+
+void MonitorController::setTimeoutMs(int ms) {
+    ProbeTarget cfg = target(ensurePrimary_());
+    cfg.timeoutMs = ms;
+    updatePrimary_(cfg);
+}
+
+void MonitorController::setKeepAlive(bool on) {
+    ProbeTarget cfg = target(ensurePrimary_());
+    cfg.keepAlive = on;
+    updatePrimary_(cfg);
+}
+
+void MonitorController::setMaxSamples(int n) {
+    maxSamples_ = n;
+    for (auto it = targets_.begin(); it != targets_.end(); ++it) {
+        it.value().stats.setMaxSamples(n);
+        for (auto& a : it.value().perAddress) a.setMaxSamples(n);
     }
 }
 
-void MonitorController::setTimeoutMs(int ms) { timeoutMs_ = ms; }
+MonitorController::TargetId MonitorController::addTarget(const ProbeTarget& target) {
+    const TargetId id = nextId_++;
+    TargetEntry entry;
+    entry.cfg = target;
+    entry.stats.setMaxSamples(maxSamples_);
+    targets_.insert(id, entry);
+    probes_.setTarget(id, target);
+    emit targetChanged(id);
+    return id;
+}
 
-void MonitorController::setMaxSamples(int n) { stats_.setMaxSamples(n); }
+bool MonitorController::updateTarget(TargetId id, const ProbeTarget& target) {
+    auto it = targets_.find(id);
+    if (it == targets_.end()) return false;
+    it.value().cfg = target;
+    it.value().series = 0;                // ряд определится при первом результате
+    it.value().perAddress.clear();
+    it.value().windows.clear();
+    probes_.setTarget(id, target);
+    emit targetChanged(id);
+    return true;
+}
 
-void MonitorController::start() {
-    if (intervalTimer_.isActive()) return;
-    intervalTimer_.start(intervalMs_);
-    runProbe_();
+MonitorController::ReloadStats MonitorController::applyTargetList(const QVector<ProbeTarget>& list) {
+    ReloadStats st;
+    QHash<QString, TargetId> listed;
+    for (auto it = targets_.cbegin(); it != targets_.cend(); ++it) {
+        if (it.value().listed) listed.insert(probeTargetKey(it.value().cfg), it.key());
+    }
+
+    for (const ProbeTarget& t : list) {
+        const TargetId id = listed.take(probeTargetKey(t));
+        if (id == kNoTarget) {
+            targets_[addTarget(t)].listed = true;
+            ++st.added;
+            continue;
+        }
+        TargetEntry& entry = targets_[id];
+        if (entry.cfg == t) {
+            ++st.unchanged;
+            continue;
+        }
+        // Same key, so the history series and per-address windows still apply
+        entry.cfg = t;
+        probes_.setTarget(id, t);
+        emit targetChanged(id);
+        ++st.changed;
+    }
+
+    for (auto it = listed.cbegin(); it != listed.cend(); ++it) removeTarget(it.value());
+    st.removed = listed.size();
+    return st;
 }
 
-void MonitorController::stop() {
-    intervalTimer_.stop();
+void MonitorController::removeTarget(TargetId id) {
+    if (!targets_.remove(id)) return;
+    probes_.removeTarget(id);
+    if (id == primary_) {
+        primary_ = kNoTarget;
+        probes_.setDetailTarget(kNoTarget);
+    }
+    emit targetRemoved(id);
 }
 
-void MonitorController::checkOnce() {
-    runProbe_();
+void MonitorController::clearTargets() {
+    const QVector<TargetId> ids = targetIds();
+    probes_.clear();
+    targets_.clear();
+    primary_ = kNoTarget;
+    probes_.setDetailTarget(kNoTarget);
+    for (TargetId id : ids) emit targetRemoved(id);
 }
 
-void MonitorController::runProbe_() {
-    if (probing_) return;
-    probing_ = true;
-    emit probeStarted();
+QVector<MonitorController::TargetId> MonitorController::targetIds() const {
+    QVector<TargetId> ids;
+    ids.reserve(targets_.size());
+    for (auto it = targets_.cbegin(); it != targets_.cend(); ++it) ids.push_back(it.key());
+    return ids;
+}
+
+ProbeTarget MonitorController::target(TargetId id) const {
+    auto it = targets_.constFind(id);
+    return it != targets_.constEnd() ? it.value().cfg : ProbeTarget{};
+}
+
+const StatsCalculator& MonitorController::stats(TargetId id) const {
+    auto it = targets_.constFind(id);
+    return it != targets_.constEnd() ? it.value().stats : noStats_;
+}
+
+WindowStats::Summary MonitorController::windowStats(TargetId id, int windowSec) const {
+    auto it = targets_.constFind(id);
+    if (it == targets_.constEnd()) return WindowStats::Summary();
+    return it.value().windows.query(windowSec, QDateTime::currentMSecsSinceEpoch());
+}
 
-    probe_ = makeProbe_();
+QStringList MonitorController::addresses(TargetId id) const {
+    auto it = targets_.constFind(id);
+    return it != targets_.constEnd() ? it.value().perAddress.keys() : QStringList();
+}
 
-    QObject::connect(probe_.get(), &INetProbe::progressDnsResolved, this,
-                     &MonitorController::probeProgressDns);
+const StatsCalculator& MonitorController::addressStats(TargetId id, const QString& ip) const {
+    auto it = targets_.constFind(id);
+    if (it == targets_.constEnd()) return noStats_;
+    auto a = it.value().perAddress.constFind(ip);
+    return a != it.value().perAddress.constEnd() ? a.value() : noStats_;
+}
 
-    QObject::connect(probe_.get(), &INetProbe::finished, this,
-                     [this](const ProbeResult& r){ onProbeFinished_(r); });
+void MonitorController::setHistoryStore(TimeSeriesStore* store) {
+    history_ = store;
+    for (auto it = targets_.begin(); it != targets_.end(); ++it) it.value().series = 0;
+}
 
-    probe_->start(host_, port_, timeoutMs_);
+quint32 MonitorController::historySeries(TargetId id) const {
+    auto it = targets_.constFind(id);
+    return it != targets_.constEnd() ? it.value().series : 0;
 }
 
-void MonitorController::onProbeFinished_(const ProbeResult& r) {
-    probing_ = false;
+quint32 MonitorController::seriesFor_(const ProbeTarget& cfg) {
+    if (!history_ || cfg.host.isEmpty()) return 0;
+    return history_->seriesId(TimeSeriesStore::seriesKey(cfg));
+}
+
+void MonitorController::start() {
+    if (probes_.isRunning()) return;
+    probes_.start();
+    // Основная цель проверяется сразу, остальные — со своей фазой внутри интервала
+    if (primary_ != kNoTarget) probes_.rephase(primary_, 0);
+}
 
-    if (r.latencyMs >= 0) {
-        stats_.addSample(r.latencyMs);
-        emit statsUpdated(stats_.min(), stats_.avg(), stats_.max(), stats_.count());
+void MonitorController::stop() {
+    probes_.stop();
+}
+
+void MonitorController::checkOnce() {
+    if (primary_ != kNoTarget) probes_.runNow(primary_);
+}
+
+void MonitorController::onEvents_(const QVector<ProbeWorkerPool::Event>& events) {
+    // Includes every slot on targetProbeFinished and resultsReady: UI, exporters, output
+    SelfMetrics::Scope cost(SelfMetrics::Deliver);
+    batch_.resize(0);
+    for (const auto& e : events) {
+        switch (e.kind) {
+            case ProbeWorkerPool::Event::Kind::Started:  onProbeStarted_(e.id); break;
+            case ProbeWorkerPool::Event::Kind::Dns:      onProbeDns_(e.id, e.dnsMs, e.ip); break;
+            case ProbeWorkerPool::Event::Kind::Finished: onProbeFinished_(e.id, e.result.get(), e.record); break;
+        }
     }
+    if (!batch_.isEmpty()) emit resultsReady(batch_);
+}
 
-    emit probeFinished(r);
+void MonitorController::onProbeStarted_(TargetId id) {
+    if (id == primary_) emit probeStarted();
+}
 
-    probe_.reset();
+void MonitorController::onProbeDns_(TargetId id, qint64 dnsMs, const QString& ip) {
+    if (id == primary_) emit probeProgressDns(dnsMs, ip);
 }
 
-std::unique_ptr<INetProbe> MonitorController::makeProbe_() const {
-    switch (mode_) {
-        case Mode::TcpConnect:
-            return std::make_unique<TcpConnectProbe>();
-        case Mode::HttpHead:
-            return std::make_unique<HttpHeadProbe>();
+void MonitorController::onProbeFinished_(TargetId id, const ProbeResult* r, const ProbeRecord& rec) {
+    auto it = targets_.find(id);
+    if (it == targets_.end()) return;
+    StatsCalculator& stats = it.value().stats;
+
+    const qint64 latencyMs = rec.latencyNs >= 0 ? rec.latencyNs / 1000000 : -1;
+    if (latencyMs >= 0) stats.addSample(latencyMs);
+    it.value().windows.add(rec);
+    auto& perAddress = it.value().perAddress;
+    // tcp-multi results always come with their ProbeResult
+    if (r) {
+        for (const auto& a : r->addresses) {
+            auto slot = perAddress.find(a.ip);
+            if (slot == perAddress.end()) {
+                if (perAddress.size() >= kMaxAddressStats) continue;
+                slot = perAddress.insert(a.ip, StatsCalculator());
+                slot.value().setMaxSamples(maxSamples_);
+            }
+            if (a.latencyNs >= 0) slot.value().addSample(a.latencyNs / 1000000);
+        }
+    }
+    if (history_) {
+        // Registered on first result, so hosts typed half-way in the UI never get a series.
+        if (it.value().series == 0) it.value().series = seriesFor_(it.value().cfg);
+        history_->append(it.value().series, rec);   // only queues; the store writes on its own thread
+    }
+
+    if (id == primary_) {
+        if (latencyMs >= 0) {
+            emit statsUpdated(stats.min(), stats.avg(), stats.max(), stats.count());
+        }
+        if (r) emit probeFinished(*r);
     }
-    return std::make_unique<TcpConnectProbe>();
-}
\ No newline at end of file
+    batch_.push_back(rec);
+    if (r) emit targetProbeFinished(id, *r);
+}
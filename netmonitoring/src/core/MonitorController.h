@@ -1,50 +1,135 @@
 #pragma once
 #include <QObject>
-#include <QTimer>
-#include <memory>
+#include <QHash>
+#include <QMap>
+#include <QStringList>
+#include <QVector>
 #include "StatsCalculator.h"
-#include "INetProbe.h"
+#include "WindowStats.h"
+#include "ProbeTarget.h"
+#include "ProbeWorkerPool.h"
+#include "SelfMetrics.h"
+
+class TimeSeriesStore;
 
 class MonitorController : public QObject {
     Q_OBJECT
 public:
-    enum class Mode { TcpConnect = 0, HttpHead = 1 };
+    using Mode = ProbeTarget::Mode;
+    using TargetId = ProbeWorkerPool::TargetId;
+    static constexpr TargetId kNoTarget = 0;
 
     explicit MonitorController(QObject* parent = nullptr);
 
+    // Основная цель: однотарговый API, которым пользуется виджет
     void setMode(Mode m);
     void setTarget(QString host, quint16 port);
     void setIntervalSec(int sec);
     void setTimeoutMs(int ms);
+    void setKeepAlive(bool on);
     void setMaxSamples(int n);
 
-    bool isRunning() const { return intervalTimer_.isActive(); }
+    // Таблица целей
+    TargetId addTarget(const ProbeTarget& target);
+    bool updateTarget(TargetId id, const ProbeTarget& target);
+    void removeTarget(TargetId id);
+    void clearTargets();
+    int targetCount() const { return targets_.size(); }
+    QVector<TargetId> targetIds() const;
+    ProbeTarget target(TargetId id) const;
+    TargetId primaryTarget() const { return primary_; }
+
+    // Target list reload: entries are matched on probeTargetKey against the targets
+    // earlier lists added (others are left alone). Unchanged ones keep running
+    // untouched, changed ones keep their statistics and phase, the rest are added
+    // or removed. The list is expected without repeats (TargetListLoader drops them).
+    struct ReloadStats {
+        int added = 0;
+        int removed = 0;
+        int changed = 0;
+        int unchanged = 0;
+    };
+    ReloadStats applyTargetList(const QVector<ProbeTarget>& list);
+
+    void setMaxConcurrent(int n) { probes_.setMaxConcurrent(n); }
+    void setMaxPerHost(int n) { probes_.setMaxPerHost(n); }
+    // Process-wide outbound budget (RateLimiter): launches per second with a burst
+    // allowance, and probes in flight across every worker thread; 0 — no limit
+    void setRateLimit(double perSec, int burst = 0);
+    void setMaxSockets(int n);
+    // Probe worker threads, each with its own shard of targets; 0 probes on this thread
+    void setWorkerThreads(int n) { probes_.setThreadCount(n); }
+    // Carry the full ProbeResult of every result to targetProbeFinished, not just
+    // the ones that need it; costs a copy and a signal per result
+    void setResultDetail(bool on) { probes_.setResultDetail(on); }
+    int workerThreads() const { return probes_.threadCount(); }
+
+    // Persistent history of every result (not owned); nullptr disables it
+    void setHistoryStore(TimeSeriesStore* store);
+    TimeSeriesStore* historyStore() const { return history_; }
+    quint32 historySeries(TargetId id) const;    // 0 until the target's first result
+
+    bool isRunning() const { return probes_.isRunning(); }
     void start();
     void stop();
     void checkOnce();
+    void checkTarget(TargetId id) { probes_.runNow(id); }
 
-    const StatsCalculator& stats() const { return stats_; }
+    const StatsCalculator& stats() const { return stats(primary_); }
+    const StatsCalculator& stats(TargetId id) const;
+    // Availability, errors and percentiles over the last windowSec seconds (up to 24 h)
+    WindowStats::Summary windowStats(TargetId id, int windowSec) const;
+    // tcp-multi: addresses seen so far and a window per address
+    QStringList addresses(TargetId id) const;
+    const StatsCalculator& addressStats(TargetId id, const QString& ip) const;
+    const ProbeWorkerPool& probes() const { return probes_; }
 
-    signals:
-            void probeStarted();
+signals:
+    // Сигналы по основной цели
+    void probeStarted();
     void probeProgressDns(qint64 dnsMs, const QString& ip);
     void probeFinished(const ProbeResult& result);
     void statsUpdated(qint64 minMs, qint64 avgMs, qint64 maxMs, int n);
 
+    // Full result of a table target: every result while setResultDetail(true),
+    // otherwise only the primary target's and those with per-address or per-path
+    // details (tcp-multi, http-multi). Everything reaches resultsReady as records.
+    void targetProbeFinished(quint32 id, const ProbeResult& result);
+    // Compact records of one delivery, in arrival order; the vector is reused
+    // by the next delivery, so slots copy what they keep
+    void resultsReady(const QVector<ProbeRecord>& batch);
+    void targetChanged(quint32 id);       // added, or its configuration replaced
+    void targetRemoved(quint32 id);
+
 private:
-    void runProbe_();
-    void onProbeFinished_(const ProbeResult& r);
-    std::unique_ptr<INetProbe> makeProbe_() const;
-
-    Mode mode_ = Mode::TcpConnect;
-    QString host_ = QStringLiteral("red-byte.ru");
-    quint16 port_ = 80;
-    int timeoutMs_ = 3000;
-    int intervalMs_ = 5000;
-
-    QTimer intervalTimer_;
-    bool probing_ = false;
-
-    std::unique_ptr<INetProbe> probe_;
-    StatsCalculator stats_;
-};
\ No newline at end of file
+    struct TargetEntry {
+        ProbeTarget cfg;
+        StatsCalculator stats;
+        WindowStats windows;              // по времени: минута, час, сутки
+        quint32 series = 0;               // id ряда в TimeSeriesStore, 0 — нет
+        bool listed = false;              // добавлена списком целей (applyTargetList)
+        QMap<QString, StatsCalculator> perAddress;   // по IP, только для tcp-multi
+    };
+
+    static constexpr int kMaxAddressStats = 32;    // за пределами — адреса не отслеживаются
+
+    TargetId ensurePrimary_();
+    void updatePrimary_(const ProbeTarget& cfg);
+    void onEvents_(const QVector<ProbeWorkerPool::Event>& events);
+    void onProbeStarted_(TargetId id);
+    void onProbeDns_(TargetId id, qint64 dnsMs, const QString& ip);
+    void onProbeFinished_(TargetId id, const ProbeResult* r, const ProbeRecord& rec);
+    quint32 seriesFor_(const ProbeTarget& cfg);
+
+    ProbeTarget primaryDefaults_;
+    int maxSamples_ = 50;
+    TargetId primary_ = kNoTarget;
+    TargetId nextId_ = 1;
+
+    QHash<TargetId, TargetEntry> targets_;
+    ProbeWorkerPool probes_;
+    LoopLagProbe loopLag_{QStringLiteral("main")};   // цикл потока владельца
+    StatsCalculator noStats_;
+    QVector<ProbeRecord> batch_;          // записи текущей доставки, ёмкость сохраняется
+    TimeSeriesStore* history_ = nullptr;
+};
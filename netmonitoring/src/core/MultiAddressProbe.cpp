@@ -0,0 +1,198 @@
+#include "MultiAddressProbe.h"
+#include "DnsCache.h"
+#include <QPointer>
+
+MultiAddressProbe::MultiAddressProbe(QObject* parent)
+        : INetProbe(parent) {
+    timeout_.setSingleShot(true);
+    QObject::connect(&timeout_, &QTimer::timeout, this, [this]{
+        if (!active_) return;
+        if (connectStartNs_ < 0) {
+            // Still waiting for DNS
+            ProbeResult r;
+            r.status = ProbeResult::Status::Timeout;
+            r.message = tr("Timeout");
+            finish_(r);
+            return;
+        }
+        for (int i = 0; i < attemptCount_; ++i) {
+            Attempt& a = attempts_[size_t(i)];
+            if (a.doneNs < 0) {
+                a.status = ProbeResult::Status::Timeout;
+                a.message = tr("Timeout");
+            }
+        }
+        finishAttempts_();
+    });
+}
+
+MultiAddressProbe::~MultiAddressProbe() {
+    abort();
+}
+
+QList<QHostAddress> MultiAddressProbe::orderAddresses(const QList<QHostAddress>& addresses, int limit) {
+    QList<QHostAddress> v6, v4;
+    for (const auto& a : addresses) {
+        if (a.protocol() == QAbstractSocket::IPv6Protocol) v6.push_back(a);
+        else v4.push_back(a);
+    }
+    // Interleave families, preferred (IPv6) first; order inside a family is the resolver's.
+    QList<QHostAddress> out;
+    int i6 = 0, i4 = 0;
+    while (i6 < v6.size() || i4 < v4.size()) {
+        if (i6 < v6.size()) out.push_back(v6[i6++]);
+        if (i4 < v4.size()) out.push_back(v4[i4++]);
+    }
+    if (limit > 0 && out.size() > limit) out = out.mid(0, limit);
+    return out;
+}
+
+void MultiAddressProbe::start(const QString& host, quint16 port, int timeoutMs) {
+    if (active_) return;
+    host_ = host;
+    port_ = port;
+    timeoutMs_ = timeoutMs;
+
+    active_ = true;
+    attemptCount_ = pending_ = 0;
+    dnsMs_ = dnsNs_ = connectStartNs_ = -1;
+    dnsCached_ = false;
+    elapsed_.restart();
+    timeout_.start(timeoutMs_);
+
+    QPointer<MultiAddressProbe> self(this);
+    const quint64 run = ++run_;
+    DnsCache::instance().lookup(host_, this, [this, self, run](const DnsAnswer& answer, bool fromCache){
+        if (!self || !active_ || run != run_) return;
+        dnsCached_ = fromCache;
+        if (answer.status != DnsAnswer::Status::Ok || answer.addresses.isEmpty()) {
+            ProbeResult r;
+            r.status = ProbeResult::Status::DnsFail;
+            r.message = answer.errorString;
+            finish_(r);
+            return;
+        }
+        dnsNs_ = elapsed_.nsecsElapsed();
+        dnsMs_ = dnsNs_ / 1000000;
+        const QList<QHostAddress> ordered = orderAddresses(answer.addresses, maxAddresses_);
+        emit progressDnsResolved(dnsMs_, ordered.first().toString());
+        connectAll_(ordered);
+    });
+}
+
+void MultiAddressProbe::connectAll_(const QList<QHostAddress>& addresses) {
+    // Sockets are created and wired once per slot and reused by later runs.
+    while (int(attempts_.size()) < addresses.size()) {
+        const int i = int(attempts_.size());
+        Attempt a;
+        a.socket = std::make_unique<QTcpSocket>();
+        QTcpSocket* s = a.socket.get();
+        QObject::connect(s, &QTcpSocket::connected, this, [this, i]{
+            settle_(i, ProbeResult::Status::Up, QString());
+        });
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+        QObject::connect(s, &QTcpSocket::errorOccurred, this, [this, i, s](QAbstractSocket::SocketError){
+            settle_(i, ProbeResult::Status::Down, s->errorString());
+        });
+#else
+        QObject::connect(s, qOverload<QAbstractSocket::SocketError>(&QAbstractSocket::error), this,
+                         [this, i, s](QAbstractSocket::SocketError){
+            settle_(i, ProbeResult::Status::Down, s->errorString());
+        });
+#endif
+        attempts_.push_back(std::move(a));
+    }
+
+    attemptCount_ = pending_ = addresses.size();
+    connectStartNs_ = elapsed_.nsecsElapsed();
+    for (int i = 0; i < attemptCount_; ++i) {
+        Attempt& a = attempts_[size_t(i)];
+        a.addr = addresses[i];
+        a.status = ProbeResult::Status::Error;
+        a.doneNs = -1;
+        a.message.clear();
+        a.socket->abort();
+    }
+    // All at once: every address gets its own, undelayed measurement.
+    for (int i = 0; i < attemptCount_; ++i) {
+        Attempt& a = attempts_[size_t(i)];
+        a.socket->connectToHost(a.addr, port_);
+    }
+}
+
+void MultiAddressProbe::settle_(int index, ProbeResult::Status status, const QString& message) {
+    if (!active_ || index >= attemptCount_) return;
+    Attempt& a = attempts_[size_t(index)];
+    if (a.doneNs >= 0) return;
+    a.doneNs = elapsed_.nsecsElapsed() - connectStartNs_;
+    a.status = status;
+    a.message = message;
+    a.socket->abort();
+    if (--pending_ == 0) finishAttempts_();
+}
+
+void MultiAddressProbe::finishAttempts_() {
+    const qint64 delayNs = qint64(kAttemptDelayMs) * 1000000;
+    const qint64 budgetNs = qint64(timeoutMs_) * 1000000 - qMax<qint64>(0, dnsNs_);
+
+    // Replay the measurements on the Happy Eyeballs timeline.
+    qint64 startNs = 0;
+    qint64 bestNs = -1;
+    int winner = -1;
+    for (int i = 0; i < attemptCount_; ++i) {
+        const Attempt& a = attempts_[size_t(i)];
+        if (a.status == ProbeResult::Status::Up) {
+            const qint64 t = startNs + a.doneNs;
+            if (t <= budgetNs && (bestNs < 0 || t < bestNs)) {
+                bestNs = t;
+                winner = i;
+            }
+        }
+        qint64 next = startNs + delayNs;
+        if (a.status != ProbeResult::Status::Up && a.doneNs >= 0) next = qMin(next, startNs + a.doneNs);
+        startNs = next;
+    }
+
+    ProbeResult r;
+    r.addresses.reserve(attemptCount_);
+    bool allTimedOut = true;
+    for (int i = 0; i < attemptCount_; ++i) {
+        const Attempt& a = attempts_[size_t(i)];
+        ProbeResult::AddressResult ar;
+        ar.ip = a.addr.toString();
+        ar.status = a.status;
+        ar.latencyNs = a.status == ProbeResult::Status::Up ? a.doneNs : -1;
+        ar.message = a.message;
+        r.addresses.push_back(ar);
+        if (a.status != ProbeResult::Status::Timeout) allTimedOut = false;
+        if (r.message.isEmpty() && a.status != ProbeResult::Status::Up) r.message = ar.ip + ": " + a.message;
+    }
+
+    if (winner >= 0) {
+        r.status = ProbeResult::Status::Up;
+        r.latencyNs = bestNs;
+        r.latencyMs = bestNs / 1000000;
+        r.ip = r.addresses[winner].ip;
+        r.phases.connectUs = bestNs / 1000;
+    } else {
+        r.status = allTimedOut ? ProbeResult::Status::Timeout : ProbeResult::Status::Down;
+        r.ip = attemptCount_ > 0 ? r.addresses.first().ip : QString();
+    }
+    r.dnsMs = dnsMs_;
+    finish_(r);
+}
+
+void MultiAddressProbe::abort() {
+    if (!active_) return;
+    active_ = false;
+    timeout_.stop();
+    for (int i = 0; i < attemptCount_; ++i) attempts_[size_t(i)].socket->abort();
+}
+
+void MultiAddressProbe::finish_(ProbeResult r) {
+    r.dnsCached = dnsCached_;
+    r.phases.dnsUs = dnsNs_ >= 0 ? dnsNs_ / 1000 : -1;
+    r.phases.totalUs = elapsed_.nsecsElapsed() / 1000;
+    abort();
+    emit finished(r);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "INetProbe.h"
+#include <QHostAddress>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <memory>
+#include <vector>
+
+// TCP connect to every resolved address of a name at once (or to the first
+// `maxAddresses` of them). Addresses are ordered as in RFC 8305: families
+// interleaved, IPv6 first. Each attempt is timed on its own and reported in
+// ProbeResult::addresses. The headline result is what a Happy Eyeballs client
+// would have seen with these measurements: attempt i starts 250 ms after attempt
+// i-1, or as soon as i-1 fails, and the earliest success wins. latencyMs/Ns is
+// that user-perceived connect time, without DNS; `ip` is the winning address.
+class MultiAddressProbe : public INetProbe {
+    Q_OBJECT
+public:
+    static constexpr int kAttemptDelayMs = 250;  // RFC 8305 Connection Attempt Delay
+
+    explicit MultiAddressProbe(QObject* parent = nullptr);
+    ~MultiAddressProbe() override;
+
+    void start(const QString& host, quint16 port, int timeoutMs) override;
+    void abort() override;
+    void configure(const ProbeTarget& target) override { maxAddresses_ = target.maxAddresses; }
+
+    // RFC 8305 section 4 ordering, truncated to `limit` (0 — all)
+    static QList<QHostAddress> orderAddresses(const QList<QHostAddress>& addresses, int limit);
+
+private:
+    struct Attempt {
+        std::unique_ptr<QTcpSocket> socket;
+        QHostAddress addr;
+        ProbeResult::Status status = ProbeResult::Status::Error;
+        qint64 doneNs = -1;               // от начала connect-фазы; -1 — ещё идёт
+        QString message;
+    };
+
+    void connectAll_(const QList<QHostAddress>& addresses);
+    void settle_(int index, ProbeResult::Status status, const QString& message);
+    void finish_(ProbeResult r);
+    void finishAttempts_();
+
+    std::vector<Attempt> attempts_;       // сокеты переживают запуски
+    int attemptCount_ = 0;                // используются первые attemptCount_
+    int pending_ = 0;
+    QTimer timeout_;
+    QElapsedTimer elapsed_;
+    qint64 connectStartNs_ = -1;
+
+    QString host_;
+    quint16 port_ = 0;
+    int timeoutMs_ = 3000;
+    int maxAddresses_ = 0;
+    qint64 dnsMs_ = -1;
+    qint64 dnsNs_ = -1;
+    bool dnsCached_ = false;
+    bool active_ = false;
+    quint64 run_ = 0;                     // номер запуска: отсекает колбэки прошлых запусков
+};
@@ -0,0 +1,106 @@
+#include "NativeTcpConnectProbe.h"
+#include "EpollConnectEngine.h"
+#include "DnsCache.h"
+#include <QPointer>
+#include <cerrno>
+#include <cstring>
+
+NativeTcpConnectProbe::NativeTcpConnectProbe(QObject* parent)
+        : INetProbe(parent) {
+    timeout_.setSingleShot(true);
+
+    // Backstop for a slow DNS phase; the engine enforces the connect deadline itself.
+    QObject::connect(&timeout_, &QTimer::timeout, this, [this]{
+        if (!active_) return;
+        ProbeResult r;
+        r.status = ProbeResult::Status::Timeout;
+        r.message = tr("Timeout");
+        r.dnsMs = dnsMs_;
+        r.ip = ip_;
+        finish_(r);
+    });
+}
+
+NativeTcpConnectProbe::~NativeTcpConnectProbe() {
+    abort();
+}
+
+void NativeTcpConnectProbe::start(const QString& host, quint16 port, int timeoutMs) {
+    if (active_) return;
+    host_ = host;
+    port_ = port;
+    timeoutMs_ = timeoutMs;
+
+    active_ = true;
+    ip_.clear();
+    dnsMs_ = dnsNs_ = -1;
+    dnsCached_ = false;
+    elapsed_.restart();
+
+    // Slightly later than the engine deadline so that the engine normally reports first.
+    timeout_.start(timeoutMs_ + 50);
+
+    QPointer<NativeTcpConnectProbe> self(this);
+    const quint64 run = ++run_;
+    DnsCache::instance().lookup(host_, this, [this, self, run](const DnsAnswer& answer, bool fromCache){
+        if (!self || !active_ || run != run_) return;
+        dnsCached_ = fromCache;
+        if (answer.status != DnsAnswer::Status::Ok || answer.addresses.isEmpty()) {
+            ProbeResult r;
+            r.status = ProbeResult::Status::DnsFail;
+            r.message = answer.errorString;
+            finish_(r);
+            return;
+        }
+        QHostAddress addr;
+        for (const auto& a : answer.addresses) {
+            if (a.protocol() == QAbstractSocket::IPv4Protocol) { addr = a; break; }
+        }
+        if (addr.isNull()) addr = answer.addresses.first();
+        ip_ = addr.toString();
+        dnsNs_ = elapsed_.nsecsElapsed();
+        dnsMs_ = dnsNs_ / 1000000;
+        emit progressDnsResolved(dnsMs_, ip_);
+
+        const int left = qMax(1, timeoutMs_ - int(dnsMs_));
+        ticket_ = EpollConnectEngine::instance().connect(addr, port_, left,
+                [this, self, run](const EpollConnectEngine::Result& res){
+            if (!self || !active_ || run != run_) return;
+            ticket_ = 0;
+            ProbeResult r;
+            r.dnsMs = dnsMs_;
+            r.ip = ip_;
+            if (res.error == 0) {
+                r.status = ProbeResult::Status::Up;
+                r.latencyNs = res.latencyNs;
+                r.latencyMs = res.latencyNs / 1000000;
+                r.phases.connectUs = res.latencyNs / 1000;
+            } else if (res.error == ETIMEDOUT) {
+                r.status = ProbeResult::Status::Timeout;
+                r.message = tr("Timeout");
+            } else {
+                r.status = ProbeResult::Status::Down;
+                r.message = QString::fromLocal8Bit(std::strerror(res.error));
+            }
+            finish_(r);
+        });
+    });
+}
+
+void NativeTcpConnectProbe::abort() {
+    if (!active_) return;
+    active_ = false;
+    timeout_.stop();
+    if (ticket_) {
+        EpollConnectEngine::instance().cancel(ticket_);
+        ticket_ = 0;
+    }
+}
+
+void NativeTcpConnectProbe::finish_(ProbeResult r) {
+    r.dnsCached = dnsCached_;
+    r.phases.dnsUs = dnsNs_ >= 0 ? dnsNs_ / 1000 : -1;
+    r.phases.totalUs = elapsed_.nsecsElapsed() / 1000;
+    abort();
+    emit finished(r);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "INetProbe.h"
+#include <QTimer>
+#include <QElapsedTimer>
+
+// TCP connect probe backed by EpollConnectEngine (Linux): the connect itself runs on
+// the engine thread and is timed there in nanoseconds.
+class NativeTcpConnectProbe : public INetProbe {
+    Q_OBJECT
+public:
+    explicit NativeTcpConnectProbe(QObject* parent = nullptr);
+    ~NativeTcpConnectProbe() override;
+
+    void start(const QString& host, quint16 port, int timeoutMs) override;
+    void abort() override;
+
+private:
+    void finish_(ProbeResult r);
+
+    QTimer timeout_;
+    QElapsedTimer elapsed_;
+
+    QString host_;
+    quint16 port_ = 0;
+    int timeoutMs_ = 3000;
+    QString ip_;
+    qint64 dnsMs_ = -1;
+    bool dnsCached_ = false;
+    qint64 dnsNs_ = -1;
+
+    quint64 ticket_ = 0;                  // заявка в EpollConnectEngine, 0 — нет
+    bool active_ = false;
+    quint64 run_ = 0;                     // номер запуска: отсекает колбэки прошлых запусков
+};
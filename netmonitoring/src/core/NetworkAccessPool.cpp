@@ -0,0 +1,28 @@
+#include "NetworkAccessPool.h"
+#include <QNetworkAccessManager>
+#include <QThreadStorage>
+
+namespace {
+
+// Deleted with its thread by QThreadStorage, and the managers with it
+struct Managers {
+    QNetworkAccessManager* managers[NetworkAccessPool::kMaxSlots] = {};
+    ~Managers() {
+        for (auto* nam : managers) delete nam;
+    }
+};
+
+} // namespace
+
+QNetworkAccessManager* NetworkAccessPool::forCurrentThread(int slot) {
+    static QThreadStorage<Managers*> storage;
+    if (!storage.hasLocalData()) storage.setLocalData(new Managers());
+    QNetworkAccessManager*& nam = storage.localData()->managers[qBound(0, slot, kMaxSlots - 1)];
+    if (!nam) {
+        nam = new QNetworkAccessManager();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+        nam->setAutoDeleteReplies(false);
+#endif
+    }
+    return nam;
+}
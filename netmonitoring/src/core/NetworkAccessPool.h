@@ -0,0 +1,16 @@
+#pragma once
+
+class QNetworkAccessManager;
+
+// One QNetworkAccessManager per thread, shared by every HTTP probe on that thread.
+// QNAM keeps its own per-host connection pool, so sharing it lets keep-alive
+// connections and TLS sessions outlive a single probe.
+// HTTP/2 puts every request to a host on one connection per manager; probes that
+// want several connections to a host spread their requests over `slot`s, each a
+// manager of its own.
+class NetworkAccessPool {
+public:
+    static constexpr int kMaxSlots = 16;
+
+    static QNetworkAccessManager* forCurrentThread(int slot = 0);
+};
@@ -0,0 +1,102 @@
+#include "ProbePool.h"
+#include "TcpConnectProbe.h"
+#include "HttpHeadProbe.h"
+#include "HttpMultiProbe.h"
+#include "MultiAddressProbe.h"
+#include "TlsHandshakeProbe.h"
+#include "ScriptProbe.h"
+#ifdef QT_NETMON_HAVE_EPOLL
+#include "NativeTcpConnectProbe.h"
+#include "UdpProbe.h"
+#endif
+
+ProbePool::ProbePool(QObject* parent)
+        : QObject(parent) {}
+
+INetProbe* ProbePool::acquire(ProbeTarget::Mode mode) {
+    INetProbe* probe = nullptr;
+    auto& free = idle_[int(mode)];
+    if (!free.isEmpty()) {
+        probe = free.takeLast();
+        ++stats_.reused;
+    } else {
+        probe = create_(mode, this);
+        ++stats_.created;
+        if (init_) init_(probe);
+    }
+    busy_.insert(probe, mode);
+    return probe;
+}
+
+void ProbePool::release(INetProbe* probe) {
+    auto it = busy_.find(probe);
+    if (it == busy_.end()) return;
+    const ProbeTarget::Mode mode = it.value();
+    busy_.erase(it);
+    ++stats_.released;
+
+    // No-op after finished(); cuts an in-flight probe short otherwise.
+    probe->abort();
+    probe->setTag(0);
+
+    auto& free = idle_[int(mode)];
+    if (free.size() < maxIdlePerMode_) {
+        free.push_back(probe);
+    } else {
+        // May be the sender of the signal being handled right now.
+        probe->deleteLater();
+        ++stats_.destroyed;
+    }
+}
+
+void ProbePool::clearIdle() {
+    for (auto it = idle_.begin(); it != idle_.end(); ++it) {
+        for (INetProbe* probe : it.value()) {
+            probe->deleteLater();
+            ++stats_.destroyed;
+        }
+        it.value().clear();
+    }
+}
+
+ProbePool::Stats ProbePool::stats() const {
+    Stats s = stats_;
+    for (auto it = idle_.cbegin(); it != idle_.cend(); ++it) s.idle += it.value().size();
+    s.busy = busy_.size();
+    return s;
+}
+
+INetProbe* ProbePool::create_(ProbeTarget::Mode mode, QObject* parent) {
+    switch (mode) {
+        case ProbeTarget::Mode::TcpConnect:
+            return new TcpConnectProbe(parent);
+        case ProbeTarget::Mode::HttpHead:
+            return new HttpHeadProbe(parent);
+        case ProbeTarget::Mode::TcpConnectNative:
+#ifdef QT_NETMON_HAVE_EPOLL
+            return new NativeTcpConnectProbe(parent);
+#else
+            return new TcpConnectProbe(parent);   // no epoll: portable Qt engine
+#endif
+        case ProbeTarget::Mode::TcpMultiAddress:
+            return new MultiAddressProbe(parent);
+        case ProbeTarget::Mode::UdpEcho:
+        case ProbeTarget::Mode::UdpDns:
+#ifdef QT_NETMON_HAVE_EPOLL
+            return new UdpProbe(mode == ProbeTarget::Mode::UdpDns, parent);
+#else
+            return new TcpConnectProbe(parent);   // no sendmmsg: echo and DNS also listen on TCP
+#endif
+        case ProbeTarget::Mode::TlsHandshake:
+#ifndef QT_NO_SSL
+            return new TlsHandshakeProbe(parent);
+#else
+            return new TcpConnectProbe(parent);   // Qt built without SSL
+#endif
+        case ProbeTarget::Mode::Script:
+            return new ScriptProbe(parent);
+        case ProbeTarget::Mode::HttpMulti:
+            return new HttpMultiProbe(parent);
+    }
+    return new TcpConnectProbe(parent);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <functional>
+#include "INetProbe.h"
+#include "ProbeTarget.h"
+
+// Recycles probe instances per mode. A probe is created once, wired up once by
+// the initializer, and afterwards only changes hands between acquire() and release().
+// The pool owns every probe it created (they are its QObject children).
+class ProbePool : public QObject {
+    Q_OBJECT
+public:
+    using Initializer = std::function<void(INetProbe*)>;
+
+    struct Stats {
+        quint64 created = 0;              // новые экземпляры
+        quint64 reused = 0;               // выдачи из простаивающих
+        quint64 released = 0;
+        quint64 destroyed = 0;            // сверх лимита простаивающих
+        int idle = 0;
+        int busy = 0;
+    };
+
+    explicit ProbePool(QObject* parent = nullptr);
+
+    void setInitializer(Initializer init) { init_ = std::move(init); }
+    void setMaxIdlePerMode(int n) { maxIdlePerMode_ = qMax(0, n); }
+
+    INetProbe* acquire(ProbeTarget::Mode mode);
+    void release(INetProbe* probe);
+    void clearIdle();
+
+    Stats stats() const;
+
+private:
+    static INetProbe* create_(ProbeTarget::Mode mode, QObject* parent);
+
+    Initializer init_;
+    QHash<int, QVector<INetProbe*>> idle_;          // режим -> свободные
+    QHash<INetProbe*, ProbeTarget::Mode> busy_;
+    int maxIdlePerMode_ = 1024;
+    Stats stats_;
+};
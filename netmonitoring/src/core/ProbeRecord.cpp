@@ -0,0 +1,170 @@
+#include "ProbeRecord.h"
+#include <QHash>
+#include <QHostAddress>
+#include <QMutex>
+#include <QVector>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+struct TextTable {
+    QMutex mutex;
+    QHash<QString, quint16> codes;
+    QVector<QString> texts{QString(), QStringLiteral("(message dropped)")};
+};
+
+TextTable& table() {
+    static TextTable t;
+    return t;
+}
+
+// Words that name a particular host, address, URL or count (anything with a digit,
+// or a '.', ':' or '/' inside it) become "*", so "Host a.example not found" and
+// "Host b.example not found" share one entry.
+QString templateOf(const QString& text) {
+    QString out;
+    out.reserve(text.size());
+    int i = 0;
+    while (i < text.size()) {
+        if (text.at(i).isSpace()) {
+            out += text.at(i++);
+            continue;
+        }
+        int end = i;
+        bool variable = false;
+        while (end < text.size() && !text.at(end).isSpace()) {
+            const QChar c = text.at(end);
+            const bool inner = end + 1 < text.size() && !text.at(end + 1).isSpace();
+            if (c.isDigit() || (inner && (c == '.' || c == ':' || c == '/'))) variable = true;
+            ++end;
+        }
+        if (variable) {
+            // Punctuation closing the word stays, e.g. "203.0.113.7:" -> "*:"
+            int keep = end;
+            while (keep > i && (text.at(keep - 1) == ':' || text.at(keep - 1) == ',' || text.at(keep - 1) == ';')) --keep;
+            out += QLatin1Char('*');
+            out.append(text.constData() + keep, end - keep);
+        } else {
+            out.append(text.constData() + i, end - i);
+        }
+        i = end;
+    }
+    return out;
+}
+
+qint32 clampUs(qint64 us) {
+    return us < 0 ? -1 : qint32(qMin<qint64>(us, std::numeric_limits<qint32>::max()));
+}
+
+// Dotted quad without going through QHostAddress (which allocates); false otherwise
+bool parseIPv4(const QString& s, quint8* out) {
+    int part = 0;
+    int value = -1;
+    for (QChar c : s) {
+        if (c == '.') {
+            if (value < 0 || part == 3) return false;
+            out[part++] = quint8(value);
+            value = -1;
+        } else if (c >= '0' && c <= '9') {
+            value = (value < 0 ? 0 : value * 10) + (c.unicode() - '0');
+            if (value > 255) return false;
+        } else {
+            return false;
+        }
+    }
+    if (value < 0 || part != 3) return false;
+    out[3] = quint8(value);
+    return true;
+}
+
+} // namespace
+
+quint16 ProbeText::intern(const QString& text) {
+    if (text.isEmpty()) return kNone;
+    // Probe threads keep asking for the same few texts; they get their codes
+    // from a per-thread map without touching the shared table.
+    thread_local QHash<QString, quint16> seen;
+    auto known = seen.constFind(text);
+    if (known != seen.constEnd()) return known.value();
+
+    const QString pattern = templateOf(text);
+    quint16 code = kOverflow;
+    {
+        TextTable& t = table();
+        QMutexLocker lock(&t.mutex);
+        auto it = t.codes.constFind(pattern);
+        if (it != t.codes.constEnd()) {
+            code = it.value();
+        } else if (t.texts.size() < kCapacity) {
+            code = quint16(t.texts.size());
+            t.texts.push_back(pattern);
+            t.codes.insert(pattern, code);
+        }
+    }
+    if (seen.size() >= kCapacity) seen.clear();
+    seen.insert(text, code);
+    return code;
+}
+
+QString ProbeText::text(quint16 code) {
+    TextTable& t = table();
+    QMutexLocker lock(&t.mutex);
+    return code < t.texts.size() ? t.texts.at(code) : QString();
+}
+
+ProbeRecord ProbeRecord::from(quint32 target, const ProbeResult& r, qint64 finishedMs) {
+    ProbeRecord rec;
+    rec.target = target;
+    rec.status = quint8(r.status);
+    rec.finishedMs = finishedMs;
+    if (r.latencyNs >= 0) rec.latencyNs = r.latencyNs;
+    else if (r.latencyMs >= 0) rec.latencyNs = r.latencyMs * 1000000;
+    rec.dnsUs = clampUs(r.phases.dnsUs >= 0 ? r.phases.dnsUs : r.dnsMs >= 0 ? r.dnsMs * 1000 : -1);
+    rec.connectUs = clampUs(r.phases.connectUs);
+    rec.tlsUs = clampUs(r.phases.tlsUs);
+    rec.ttfbUs = clampUs(r.phases.ttfbUs);
+    rec.totalUs = clampUs(r.phases.totalUs);
+    rec.jitterUs = clampUs(r.jitterUs);
+    rec.packetsSent = qint16(qBound(-1, r.packetsSent, 32767));
+    rec.packetsReceived = qint16(qBound(-1, r.packetsReceived, 32767));
+    if (r.httpCode) rec.httpCode = qint16(qBound(0, *r.httpCode, 32767));
+    if (r.dnsCached) rec.flags |= DnsCached;
+    if (r.phases.reusedConnection) rec.flags |= ReusedConnection;
+    if (r.tls) {
+        rec.flags |= HasTls;
+        if (r.tls->resumeOffered) rec.flags |= TlsResumeOffered;
+        if (r.tls->resumed) rec.flags |= TlsResumed;
+        rec.certNotAfterMs = r.tls->certNotAfterMs;
+    }
+    if (!r.ip.isEmpty()) {
+        if (parseIPv4(r.ip, rec.addr)) {
+            rec.family = 4;
+        } else {
+            const QHostAddress a(r.ip);
+            if (a.protocol() == QAbstractSocket::IPv6Protocol) {
+                const Q_IPV6ADDR v6 = a.toIPv6Address();
+                std::memcpy(rec.addr, &v6, 16);
+                rec.family = 6;
+            }
+        }
+    }
+    rec.message = ProbeText::intern(r.message);
+    return rec;
+}
+
+QString ProbeRecord::ipText() const {
+    if (family == 4) {
+        return QStringLiteral("%1.%2.%3.%4").arg(addr[0]).arg(addr[1]).arg(addr[2]).arg(addr[3]);
+    }
+    if (family == 6) {
+        Q_IPV6ADDR v6;
+        std::memcpy(&v6, addr, 16);
+        return QHostAddress(v6).toString();
+    }
+    return QString();
+}
+
+QString ProbeRecord::messageText() const {
+    return message == ProbeText::kNone ? QString() : ProbeText::text(message);
+}
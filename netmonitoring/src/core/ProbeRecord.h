@@ -0,0 +1,61 @@
+#pragma once
+#include <QtGlobal>
+#include <QString>
+#include <type_traits>
+#include "ProbeResult.h"
+
+// Compact, trivially copyable form of a finished probe: everything the statistics,
+// exporters, history and tables need, without a single heap allocation. The
+// address is kept in binary and the message as an interned code (ProbeText); the
+// text is rendered only when something displays it. Built once per result, on the
+// worker thread that ran the probe; details such as per-address attempts or the
+// TLS protocol stay in the ProbeResult.
+struct ProbeRecord {
+    enum Flags : quint8 { DnsCached = 0x1, ReusedConnection = 0x2, HasTls = 0x4, TlsResumeOffered = 0x8,
+                        TlsResumed = 0x10 };
+
+    quint32 target = 0;                   // TargetId
+    quint8 status = quint8(ProbeResult::Status::Error);
+    quint8 flags = 0;
+    quint8 family = 0;                    // 0 — адреса нет, 4 или 6
+    quint16 message = 0;                  // код ProbeText, 0 — пусто
+    qint16 httpCode = -1;                 // -1 — не HTTP
+    quint8 addr[16] = {};                 // IPv4 — первые 4 байта
+    qint64 finishedMs = 0;                // время завершения, мс от эпохи
+    qint64 latencyNs = -1;
+    qint32 dnsUs = -1;
+    qint32 connectUs = -1;
+    qint32 tlsUs = -1;
+    qint32 ttfbUs = -1;
+    qint32 totalUs = -1;
+    qint32 jitterUs = -1;                 // udp-*
+    qint16 packetsSent = -1;              // udp-*
+    qint16 packetsReceived = -1;
+    qint64 certNotAfterMs = -1;           // tls
+
+    static ProbeRecord from(quint32 target, const ProbeResult& r, qint64 finishedMs);
+
+    ProbeResult::Status statusValue() const { return ProbeResult::Status(status); }
+    bool isUp() const { return statusValue() == ProbeResult::Status::Up; }
+    qint64 latencyUs() const { return latencyNs < 0 ? -1 : latencyNs / 1000; }
+    QString ipText() const;
+    QString messageText() const;
+};
+static_assert(std::is_trivially_copyable<ProbeRecord>::value, "ProbeRecord must stay a plain record");
+static_assert(sizeof(ProbeRecord) <= 96, "ProbeRecord must stay compact");
+
+// Process-wide table of probe messages. A failure text is stored once and travels
+// as a 16-bit code. Only the template is kept: words naming a host, address, URL
+// or number are replaced by "*", so the table holds the fixed wording and does not
+// fill up with one entry per host; the exact text stays in the ProbeResult. Past
+// kCapacity distinct templates new ones all map to kOverflow. Thread-safe; repeats
+// are answered from a per-thread map without the table's lock.
+class ProbeText {
+public:
+    static constexpr quint16 kNone = 0;
+    static constexpr quint16 kOverflow = 1;
+    static constexpr int kCapacity = 4096;
+
+    static quint16 intern(const QString& text);
+    static QString text(quint16 code);
+};
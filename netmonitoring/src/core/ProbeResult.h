@@ -1,14 +1,74 @@
 #pragma once
 #include <QString>
+#include <QVector>
 #include <optional>
 
+// Фазы проверки в микросекундах; -1 — фаза не измерялась или не было
+struct PhaseTimings {
+    qint64 dnsUs = -1;                    // резолв имени
+    qint64 connectUs = -1;                // TCP connect
+    qint64 tlsUs = -1;                    // TLS handshake
+    qint64 ttfbUs = -1;                   // от отправки запроса до первого байта ответа
+    qint64 totalUs = -1;                  // вся проверка, включая DNS
+    bool reusedConnection = false;        // запрос ушёл по уже открытому соединению
+};
+
 struct ProbeResult {
     enum class Status { Up, Down, DnsFail, Timeout, Error };
 
+    // Попытка на один адрес имени (режим tcp-multi)
+    struct AddressResult {
+        QString ip;
+        Status status = Status::Error;
+        qint64 latencyNs = -1;            // connect до этого адреса
+        QString message;
+    };
+
+    // TLS-рукопожатие (режим tls)
+    struct TlsInfo {
+        QString protocol;                 // TLSv1.3, TLSv1.2, ...
+        QString cipher;
+        bool resumeOffered = false;       // в ClientHello ушла сохранённая сессия
+        bool resumed = false;             // сервер её принял: рукопожатие сокращённое
+        qint64 certNotAfterMs = -1;       // срок действия сертификата сервера, мс с эпохи
+        QString verifyError;              // первая ошибка проверки цепочки; пусто — всё верно
+    };
+
+    // Запрос одного пути (режим http-multi)
+    struct PathResult {
+        QString path;
+        Status status = Status::Error;
+        int httpCode = -1;
+        qint64 ttfbUs = -1;               // от отправки запроса до заголовков ответа
+        qint64 totalUs = -1;              // до конца ответа
+        bool http2 = false;               // ответ пришёл по HTTP/2
+        QString message;
+    };
+
     Status status = Status::Error;
     qint64 latencyMs = -1;                // время до успеха/ответа
+    qint64 latencyNs = -1;                // то же в нс, если проба меряет точнее миллисекунды
     qint64 dnsMs = -1;                    // длительность DNS-резолва (если замерялась)
+    bool dnsCached = false;               // ответ DNS взят из кэша
     std::optional<int> httpCode;          // для HTTP-режима
     QString ip;                           // выбранный IP (если известен)
     QString message;                      // текст ошибки/детали
+    PhaseTimings phases;
+    QVector<AddressResult> addresses;     // по адресу на попытку; пусто в одноадресных режимах
+    int packetsSent = -1;                 // udp-*: пакетов в серии; -1 — не UDP
+    int packetsReceived = -1;             // udp-*: из них с ответом
+    qint64 jitterUs = -1;                 // udp-*: среднее |RTT(i) - RTT(i-1)| по ответам
+    std::optional<TlsInfo> tls;           // есть, если рукопожатие завершилось
+    QVector<PathResult> paths;            // http-multi: по пути на запрос
 };
+
+inline const char* probeStatusName(ProbeResult::Status s) {
+    switch (s) {
+        case ProbeResult::Status::Up:      return "UP";
+        case ProbeResult::Status::Down:    return "DOWN";
+        case ProbeResult::Status::DnsFail: return "DNS_FAIL";
+        case ProbeResult::Status::Timeout: return "TIMEOUT";
+        case ProbeResult::Status::Error:   return "ERROR";
+    }
+    return "ERROR";
+}
@@ -0,0 +1,273 @@
+#include "ProbeScheduler.h"
+#include "RateLimiter.h"
+#include "SelfMetrics.h"
+#include "TraceRecorder.h"
+#include <QRandomGenerator>
+
+ProbeScheduler::ProbeScheduler(QObject* parent)
+        : QObject(parent) {
+    QObject::connect(&wheel_, &TimingWheel::expired, this, &ProbeScheduler::onDue_);
+    clock_.start();
+    throttle_.setSingleShot(true);
+    QObject::connect(&throttle_, &QTimer::timeout, this, &ProbeScheduler::pump_);
+
+    // Pooled probes are wired once; the tag tells which target a signal belongs to.
+    pool_.setInitializer([this](INetProbe* probe){
+        QObject::connect(probe, &INetProbe::progressDnsResolved, this,
+                         [this, probe](qint64 dnsMs, const QString& ip){
+                             if (probe->tag() != 0) emit probeDnsResolved(probe->tag(), dnsMs, ip);
+                         });
+        QObject::connect(probe, &INetProbe::finished, this,
+                         [this, probe](const ProbeResult& r){ onProbeFinished_(probe, r); });
+    });
+}
+
+ProbeScheduler::~ProbeScheduler() {
+    clear();
+}
+
+void ProbeScheduler::setTarget(TargetId id, const ProbeTarget& target) {
+    auto it = targets_.find(id);
+    if (it == targets_.end()) {
+        TargetState st;
+        st.cfg = target;
+        st.adapt.configure(target);
+        st.cycleStartMs = clock_.elapsed();
+        TargetState& added = targets_.emplace(id, std::move(st)).first->second;
+        if (running_) schedule_(id, added, jitter_(target.intervalMs));
+        return;
+    }
+    TargetState& st = it->second;
+    const bool intervalChanged = (st.cfg.intervalMs != target.intervalMs);
+    const bool policyChanged = intervalChanged || st.cfg.adaptive != target.adaptive
+            || st.cfg.minIntervalMs != target.minIntervalMs || st.cfg.maxIntervalMs != target.maxIntervalMs;
+    st.cfg = target;
+    if (policyChanged) st.adapt.configure(target);
+    if (running_ && intervalChanged) {
+        st.cycleStartMs = clock_.elapsed();
+        schedule_(id, st, jitter_(target.intervalMs));
+    }
+}
+
+void ProbeScheduler::removeTarget(TargetId id) {
+    auto it = targets_.find(id);
+    if (it == targets_.end()) return;
+    wheel_.cancel(id);
+    // Queued ids are skipped lazily by pump_(), in-flight probes are cut short here.
+    if (it->second.inFlight) release_(it->second);
+    targets_.erase(it);
+    pump_();
+}
+
+void ProbeScheduler::clear() {
+    wheel_.clear();
+    ready_.clear();
+    blocked_.clear();
+    for (auto& kv : targets_) {
+        if (kv.second.inFlight) release_(kv.second);
+    }
+    targets_.clear();
+    perHost_.clear();
+    inFlight_ = 0;
+}
+
+void ProbeScheduler::setMaxConcurrent(int n) {
+    maxConcurrent_ = qMax(1, n);
+    pump_();
+}
+
+void ProbeScheduler::setMaxPerHost(int n) {
+    maxPerHost_ = qMax(1, n);
+    // Let pump_() re-check everything that was parked behind the old limit.
+    for (auto it = blocked_.begin(); it != blocked_.end(); ++it) {
+        for (TargetId id : it.value()) ready_.push_back(id);
+    }
+    blocked_.clear();
+    pump_();
+}
+
+void ProbeScheduler::start() {
+    if (running_) return;
+    running_ = true;
+    for (auto& kv : targets_) {
+        kv.second.cycleStartMs = clock_.elapsed();
+        schedule_(kv.first, kv.second, jitter_(kv.second.cfg.intervalMs));
+    }
+    wheel_.start();
+}
+
+void ProbeScheduler::stop() {
+    if (!running_) return;
+    running_ = false;
+    wheel_.stop();
+    wheel_.clear();
+    throttle_.stop();
+    ready_.clear();
+    blocked_.clear();
+    for (auto& kv : targets_) kv.second.queued = false;
+}
+
+void ProbeScheduler::runNow(TargetId id) {
+    auto it = targets_.find(id);
+    if (it == targets_.end()) return;
+    if (it->second.inFlight || it->second.queued) return;
+    enqueue_(id, it->second, SelfMetrics::nowUs());
+    pump_();
+}
+
+void ProbeScheduler::rephase(TargetId id, int delayMs) {
+    auto it = targets_.find(id);
+    if (!running_ || it == targets_.end()) return;
+    schedule_(id, it->second, delayMs);
+}
+
+int ProbeScheduler::currentIntervalMs(TargetId id) const {
+    auto it = targets_.find(id);
+    return it == targets_.end() ? -1 : intervalOf_(it->second);
+}
+
+int ProbeScheduler::queued() const {
+    int n = int(ready_.size());
+    for (auto it = blocked_.cbegin(); it != blocked_.cend(); ++it) n += int(it.value().size());
+    return n;
+}
+
+void ProbeScheduler::onDue_(const QVector<quint32>& ids) {
+    SelfMetrics::Scope cost(SelfMetrics::WheelTick);
+    for (TargetId id : ids) {
+        auto it = targets_.find(id);
+        if (it == targets_.end()) continue;
+        TargetState& st = it->second;
+        const qint64 dueUs = st.deadlineUs;
+        // Fixed cadence: the next deadline does not drift with probe duration.
+        st.cycleStartMs = clock_.elapsed();
+        schedule_(id, st, intervalOf_(st));
+        if (st.inFlight || st.queued) {
+            ++skipped_;
+            continue;
+        }
+        enqueue_(id, st, dueUs);
+    }
+    pump_();
+}
+
+void ProbeScheduler::schedule_(TargetId id, TargetState& st, qint64 delayMs) {
+    st.deadlineUs = SelfMetrics::nowUs() + delayMs * 1000;
+    wheel_.schedule(id, delayMs);
+}
+
+void ProbeScheduler::enqueue_(TargetId id, TargetState& st, qint64 dueUs) {
+    st.queued = true;
+    st.dueUs = dueUs;
+    st.enqueuedUs = SelfMetrics::nowUs();
+    ready_.push_back(id);
+}
+
+void ProbeScheduler::pump_() {
+    while (inFlight_ < maxConcurrent_ && !ready_.empty()) {
+        const TargetId id = ready_.front();
+        ready_.pop_front();
+
+        auto it = targets_.find(id);
+        if (it == targets_.end() || !it->second.queued) continue;
+        TargetState& st = it->second;
+
+        if (perHost_.value(st.cfg.host) >= maxPerHost_) {
+            blocked_[st.cfg.host].push_back(id);
+            continue;
+        }
+        int retryMs = 0;
+        if (!RateLimiter::instance().tryAcquire(&retryMs)) {
+            // Over the global budget: keep the place in line and come back later.
+            ready_.push_front(id);
+            ++throttled_;
+            if (!throttle_.isActive()) throttle_.start(retryMs);
+            break;
+        }
+        st.holdsSlot = true;
+        launch_(id, st);
+    }
+}
+
+void ProbeScheduler::launch_(TargetId id, TargetState& st) {
+    SelfMetrics::Scope cost(SelfMetrics::Launch);
+    st.launchedUs = SelfMetrics::nowUs();
+    // Skew below one wheel tick is the wheel's resolution; beyond it, queueing or a busy loop.
+    SelfMetrics::instance().recordLaunch(qMax<qint64>(0, st.launchedUs - st.dueUs), st.launchedUs - st.enqueuedUs);
+    st.queued = false;
+    st.inFlight = true;
+    st.activeHost = st.cfg.host;
+    ++perHost_[st.activeHost];
+    ++inFlight_;
+
+    st.probe = pool_.acquire(st.cfg.mode);
+    st.probe->setTag(id);
+
+    emit probeStarted(id);
+    st.probe->configure(st.cfg);
+    st.probe->start(st.cfg.host, st.cfg.port, st.cfg.timeoutMs);
+}
+
+void ProbeScheduler::release_(TargetState& st) {
+    st.inFlight = false;
+    --inFlight_;
+    if (st.holdsSlot) {
+        RateLimiter::instance().release();
+        st.holdsSlot = false;
+    }
+
+    auto busy = perHost_.find(st.activeHost);
+    if (busy != perHost_.end() && --busy.value() <= 0) perHost_.erase(busy);
+
+    // Hand the freed per-host slot to the oldest target still waiting for it.
+    auto waiting = blocked_.find(st.activeHost);
+    if (waiting != blocked_.end()) {
+        auto& q = waiting.value();
+        while (!q.empty()) {
+            const TargetId next = q.front();
+            q.pop_front();
+            if (contains(next)) { ready_.push_front(next); break; }
+        }
+        if (q.empty()) blocked_.erase(waiting);
+    }
+    st.activeHost.clear();
+
+    // Aborts the probe if it is still running; release() never deletes synchronously.
+    if (st.probe) pool_.release(st.probe);
+    st.probe = nullptr;
+}
+
+void ProbeScheduler::onProbeFinished_(INetProbe* probe, const ProbeResult& r) {
+    const TargetId id = probe->tag();
+    auto it = targets_.find(id);
+    if (it == targets_.end() || it->second.probe != probe) return;
+    SelfMetrics::Scope cost(SelfMetrics::Finish);
+    TargetState& st = it->second;
+    TraceRecorder& trace = TraceRecorder::instance();
+    if (trace.isEnabled()) {
+        const QString name = QStringLiteral("%1:%2").arg(st.cfg.host).arg(st.cfg.port);
+        trace.asyncSpan(QStringLiteral("queued"), "probe", id, st.dueUs, st.launchedUs);
+        trace.asyncSpan(name, "probe", id, st.launchedUs, SelfMetrics::nowUs(),
+                        QByteArray("\"mode\":\"") + probeModeName(st.cfg.mode) + "\",\"status\":\""
+                        + probeStatusName(r.status) + '"');
+    }
+    release_(st);
+    if (st.cfg.adaptive) {
+        const int before = st.adapt.intervalMs();
+        const int next = st.adapt.update(r);
+        // The pending deadline was set with the old interval when this cycle began.
+        if (running_ && next != before) {
+            schedule_(id, st, qMax<qint64>(0, next - (clock_.elapsed() - st.cycleStartMs)));
+        }
+    }
+    emit probeFinished(id, r);
+    pump_();
+}
+
+int ProbeScheduler::intervalOf_(const TargetState& st) const {
+    return st.cfg.adaptive ? st.adapt.intervalMs() : st.cfg.intervalMs;
+}
+
+int ProbeScheduler::jitter_(int intervalMs) const {
+    return int(QRandomGenerator::global()->bounded(qMax(1, intervalMs)));
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <deque>
+#include <unordered_map>
+#include "ProbeTarget.h"
+#include "ProbeResult.h"
+#include "TimingWheel.h"
+#include "ProbePool.h"
+#include "AdaptiveInterval.h"
+
+// Runs probes for a table of targets. Every target keeps a fixed phase inside its
+// interval (random on first schedule), all deadlines live on one TimingWheel, and
+// the number of probes in flight is capped globally and per host. Targets with
+// `adaptive` set take their interval from AdaptiveInterval after every result.
+// Every launch also needs a token and a slot from the process-wide RateLimiter;
+// without them the queue waits, in order, until the limiter says to retry.
+// Each launch reports to SelfMetrics how late it is against its deadline (wheel
+// tick lateness plus queueing) so the scheduler's own delay is never read as RTT.
+class ProbeScheduler : public QObject {
+    Q_OBJECT
+public:
+    using TargetId = quint32;
+
+    explicit ProbeScheduler(QObject* parent = nullptr);
+    ~ProbeScheduler() override;
+
+    void setTarget(TargetId id, const ProbeTarget& target);   // add or update
+    void removeTarget(TargetId id);
+    void clear();
+    bool contains(TargetId id) const { return targets_.count(id) != 0; }
+    int targetCount() const { return int(targets_.size()); }
+
+    void setMaxConcurrent(int n);
+    void setMaxPerHost(int n);
+    int maxConcurrent() const { return maxConcurrent_; }
+    int maxPerHost() const { return maxPerHost_; }
+
+    bool isRunning() const { return running_; }
+    void start();
+    void stop();
+    void runNow(TargetId id);
+    void rephase(TargetId id, int delayMs);
+
+    int inFlight() const { return inFlight_; }
+    int queued() const;
+    quint64 skipped() const { return skipped_; }
+    quint64 throttled() const { return throttled_; }
+    int currentIntervalMs(TargetId id) const;
+    ProbePool::Stats poolStats() const { return pool_.stats(); }
+
+signals:
+    void probeStarted(quint32 id);
+    void probeDnsResolved(quint32 id, qint64 dnsMs, const QString& ip);
+    void probeFinished(quint32 id, const ProbeResult& result);
+
+private:
+    struct TargetState {
+        ProbeTarget cfg;
+        INetProbe* probe = nullptr;       // из пула, пока проверка идёт
+        QString activeHost;               // хост, под который занят слот per-host
+        bool inFlight = false;
+        bool queued = false;
+        bool holdsSlot = false;           // занят слот RateLimiter
+        AdaptiveInterval adapt;           // только при cfg.adaptive
+        qint64 cycleStartMs = 0;          // когда назначен текущий срок на колесе
+        qint64 deadlineUs = 0;            // срок на колесе (SelfMetrics::nowUs)
+        qint64 dueUs = 0;                 // срок, по которому стоит в очереди текущая проверка
+        qint64 enqueuedUs = 0;
+        qint64 launchedUs = 0;
+    };
+
+    void onDue_(const QVector<quint32>& ids);
+    void schedule_(TargetId id, TargetState& st, qint64 delayMs);
+    void enqueue_(TargetId id, TargetState& st, qint64 dueUs);
+    void pump_();
+    void launch_(TargetId id, TargetState& st);
+    void release_(TargetState& st);
+    void onProbeFinished_(INetProbe* probe, const ProbeResult& r);
+    int jitter_(int intervalMs) const;
+    int intervalOf_(const TargetState& st) const;
+
+    std::unordered_map<TargetId, TargetState> targets_;
+    ProbePool pool_;
+    TimingWheel wheel_;
+    QTimer throttle_;                     // повтор pump_() после отказа RateLimiter
+    QElapsedTimer clock_;
+    std::deque<TargetId> ready_;
+    QHash<QString, std::deque<TargetId>> blocked_;   // ждут свободного слота своего хоста
+    QHash<QString, int> perHost_;
+
+    int maxConcurrent_ = 256;
+    int maxPerHost_ = 4;
+    int inFlight_ = 0;
+    quint64 skipped_ = 0;
+    quint64 throttled_ = 0;
+    bool running_ = false;
+};
@@ -0,0 +1,203 @@
+#include "ProbeScript.h"
+
+namespace {
+
+struct Preset { const char* name; const char* script; };
+constexpr Preset kPresets[] = {
+    {"redis", "connect; send \"PING\\r\\n\"; expect \"+PONG\""},
+    {"smtp",  "connect; expect \"220\"; send \"QUIT\\r\\n\"; expect \"221\""},
+    {"http",  "connect; http HEAD /"},
+    {"https", "connect; tls; http HEAD /"},
+};
+
+struct Token {
+    QByteArray text;
+    bool quoted = false;
+};
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Splits into steps on ';' outside quotes, and steps into tokens; quoted tokens come unescaped.
+bool tokenize(const QByteArray& src, QVector<QVector<Token>>* steps, QString* error) {
+    QVector<Token> step;
+    Token tok;
+    bool inToken = false;
+    auto endToken = [&] {
+        if (inToken) step.push_back(tok);
+        tok = Token();
+        inToken = false;
+    };
+    for (int i = 0; i < src.size(); ++i) {
+        const char c = src[i];
+        if (c == '"') {
+            if (inToken) {
+                *error = QStringLiteral("quote inside a word at %1").arg(i + 1);
+                return false;
+            }
+            tok.quoted = true;
+            inToken = true;
+            for (++i; ; ++i) {
+                if (i >= src.size()) {
+                    *error = QStringLiteral("unterminated string");
+                    return false;
+                }
+                char q = src[i];
+                if (q == '"') break;
+                if (q == '\\') {
+                    if (++i >= src.size()) continue;
+                    switch (src[i]) {
+                        case 'r': q = '\r'; break;
+                        case 'n': q = '\n'; break;
+                        case 't': q = '\t'; break;
+                        case '0': q = '\0'; break;
+                        case 'x': {
+                            const int hi = i + 1 < src.size() ? hexDigit(src[i + 1]) : -1;
+                            const int lo = i + 2 < src.size() ? hexDigit(src[i + 2]) : -1;
+                            if (hi < 0 || lo < 0) {
+                                *error = QStringLiteral("bad \\x escape at %1").arg(i);
+                                return false;
+                            }
+                            q = char(hi * 16 + lo);
+                            i += 2;
+                            break;
+                        }
+                        default: q = src[i]; break;        // \\ and \"
+                    }
+                }
+                tok.text.append(q);
+            }
+            endToken();
+        } else if (c == ';') {
+            endToken();
+            if (!step.isEmpty()) steps->push_back(step);
+            step.clear();
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            endToken();
+        } else {
+            tok.text.append(c);
+            inToken = true;
+        }
+    }
+    endToken();
+    if (!step.isEmpty()) steps->push_back(step);
+    return true;
+}
+
+bool isNumber(const Token& t) {
+    if (t.quoted || t.text.isEmpty()) return false;
+    for (char c : t.text) {
+        if (c < '0' || c > '9') return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool ProbeScript::usesTls() const {
+    for (const Step& s : steps) {
+        if (s.op == Op::Tls) return true;
+    }
+    return false;
+}
+
+bool ProbeScript::parse(const QString& text, ProbeScript* out, QString* error) {
+    QString why;
+    if (!error) error = &why;
+    *out = ProbeScript();
+
+    QByteArray src = text.trimmed().toUtf8();
+    for (const Preset& p : kPresets) {
+        if (src == p.name) {
+            src = p.script;
+            break;
+        }
+    }
+
+    QVector<QVector<Token>> tokens;
+    if (!tokenize(src, &tokens, error)) return false;
+    if (tokens.isEmpty()) {
+        *error = QStringLiteral("empty script");
+        return false;
+    }
+
+    for (int n = 0; n < tokens.size(); ++n) {
+        QVector<Token> words = tokens[n];
+        const QByteArray verb = words.first().text.toLower();
+        auto fail = [&](const QString& what) {
+            *error = QStringLiteral("step %1 (%2): %3").arg(n + 1).arg(QString::fromUtf8(verb), what);
+            return false;
+        };
+        if (words.first().quoted) return fail(QStringLiteral("expected a step name"));
+
+        Step step;
+        if (words.size() > 1 && isNumber(words.last())) {
+            step.timeoutMs = words.last().text.toInt();
+            words.removeLast();
+        }
+        const int args = words.size() - 1;
+
+        if (verb == "connect" || verb == "tls") {
+            step.op = verb == "tls" ? Op::Tls : Op::Connect;
+            if (args != 0) return fail(QStringLiteral("takes no arguments"));
+        } else if (verb == "send" || verb == "expect") {
+            step.op = verb == "send" ? Op::Send : Op::Expect;
+            if (args != 1 || !words[1].quoted) return fail(QStringLiteral("takes one quoted string"));
+            if (words[1].text.isEmpty()) return fail(QStringLiteral("empty string"));
+            step.data = words[1].text;
+        } else if (verb == "http") {
+            step.op = Op::Http;
+            if (args > 2) return fail(QStringLiteral("takes [method] [path]"));
+            step.method = "HEAD";
+            step.data = "/";
+            for (int i = 1; i <= args; ++i) {
+                if (words[i].text.startsWith('/')) step.data = words[i].text;
+                else step.method = words[i].text.toUpper();
+            }
+        } else {
+            return fail(QStringLiteral("unknown step"));
+        }
+
+        if (step.op == Op::Connect && !out->steps.isEmpty()) return fail(QStringLiteral("only as the first step"));
+        if (step.op != Op::Connect && out->steps.isEmpty()) out->steps.push_back(Step());
+        out->steps.push_back(step);
+    }
+
+    if (out->steps.size() > kMaxSteps) {
+        *error = QStringLiteral("more than %1 steps").arg(kMaxSteps);
+        *out = ProbeScript();
+        return false;
+    }
+    return true;
+}
+
+QString ProbeScript::describe(const Step& step) {
+    auto quoted = [](const QByteArray& bytes) {
+        QString s;
+        for (char c : bytes) {
+            switch (c) {
+                case '\r': s += QLatin1String("\\r"); break;
+                case '\n': s += QLatin1String("\\n"); break;
+                case '\t': s += QLatin1String("\\t"); break;
+                case '"':  s += QLatin1String("\\\""); break;
+                case '\\': s += QLatin1String("\\\\"); break;
+                default:
+                    if (uchar(c) < 0x20 || uchar(c) >= 0x7f) s += QStringLiteral("\\x%1").arg(uint(uchar(c)), 2, 16, QLatin1Char('0'));
+                    else s += QLatin1Char(c);
+            }
+        }
+        return QStringLiteral("\"%1\"").arg(s);
+    };
+    switch (step.op) {
+        case Op::Connect: return QStringLiteral("connect");
+        case Op::Tls:     return QStringLiteral("tls");
+        case Op::Send:    return QStringLiteral("send ") + quoted(step.data);
+        case Op::Expect:  return QStringLiteral("expect ") + quoted(step.data);
+        case Op::Http:    return QStringLiteral("http %1 %2").arg(QString::fromLatin1(step.method), QString::fromUtf8(step.data));
+    }
+    return QString();
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Multi-step check of the script mode, compiled once from a line such as
+//     connect; send "PING\r\n"; expect "+PONG" 500
+// Steps run in order over one connection:
+//   connect               DNS and TCP connect (implied when the script starts otherwise)
+//   tls                   TLS handshake on the open connection
+//   send "bytes"          \r \n \t \0 \\ \" and \xHH escapes
+//   expect "bytes"        waits until the reply contains them, consumes through the match
+//   http [method] [path]  one HTTP/1.1 request, waits for the headers; 4xx/5xx is DOWN
+// A trailing number is the step's own timeout in ms, inside the target's timeout.
+// A name alone picks a preset: redis, smtp, http, https.
+struct ProbeScript {
+    enum class Op : quint8 { Connect, Tls, Send, Expect, Http };
+
+    struct Step {
+        Op op = Op::Connect;
+        int timeoutMs = 0;                // 0 — только общий таймаут пробы
+        QByteArray data;                  // send/expect: байты, http: путь
+        QByteArray method;                // http
+    };
+
+    static constexpr int kMaxSteps = 32;
+
+    QVector<Step> steps;
+
+    bool isEmpty() const { return steps.isEmpty(); }
+    bool usesTls() const;
+
+    static bool parse(const QString& text, ProbeScript* out, QString* error = nullptr);
+    // One step for messages: expect "+PONG"
+    static QString describe(const Step& step);
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+
+struct ProbeTarget {
+    enum class Mode { TcpConnect = 0, HttpHead = 1, TcpConnectNative = 2, TcpMultiAddress = 3,
+                      UdpEcho = 4, UdpDns = 5, TlsHandshake = 6, Script = 7,
+                      HttpMulti = 8 };
+
+    QString host;                         // имя или IP
+    quint16 port = 80;
+    Mode mode = Mode::TcpConnect;
+    int intervalMs = 5000;                // период проверок
+    bool adaptive = false;                // подстраивать период под поведение цели
+    int minIntervalMs = 0;                // adaptive: нижняя граница, 0 — intervalMs/4 (не меньше 500)
+    int maxIntervalMs = 0;                // adaptive: верхняя граница, 0 — intervalMs*8
+    int timeoutMs = 3000;                 // таймаут одной проверки
+    bool keepAlive = false;               // HTTP: переиспользовать соединения между проверками
+    int maxAddresses = 0;                 // tcp-multi: сколько адресов проверять, 0 — все
+    int udpPackets = 5;                   // udp-*: пакетов в серии на одну проверку
+    int udpSpacingMs = 20;                // udp-*: интервал между пакетами серии
+    QString udpQuery;                     // udp-dns: имя в запросе, пусто — корень
+    bool tlsResume = true;                // tls: предлагать сохранённую сессию (resumption)
+    bool tlsInsecure = false;             // tls, script: непроверенный сертификат не считать ошибкой
+    QString script;                       // script: шаги проверки (ProbeScript) или имя пресета
+    QStringList paths;                    // http-multi: пути на хосте, пусто — "/"
+    int httpConnections = 1;              // http-multi: соединений на хост, запросы делятся между ними
+};
+
+inline const char* probeModeName(ProbeTarget::Mode m) {
+    switch (m) {
+        case ProbeTarget::Mode::TcpConnect: return "tcp";
+        case ProbeTarget::Mode::HttpHead:   return "http";
+        case ProbeTarget::Mode::TcpConnectNative: return "tcp-native";
+        case ProbeTarget::Mode::TcpMultiAddress: return "tcp-multi";
+        case ProbeTarget::Mode::UdpEcho:    return "udp-echo";
+        case ProbeTarget::Mode::UdpDns:     return "udp-dns";
+        case ProbeTarget::Mode::TlsHandshake: return "tls";
+        case ProbeTarget::Mode::Script:     return "script";
+        case ProbeTarget::Mode::HttpMulti:  return "http-multi";
+    }
+    return "tcp";
+}
+
+inline bool parseProbeMode(const QString& name, ProbeTarget::Mode* out) {
+    const QString n = name.trimmed().toLower();
+    if (n == QLatin1String("tcp")) { *out = ProbeTarget::Mode::TcpConnect; return true; }
+    if (n == QLatin1String("http")) { *out = ProbeTarget::Mode::HttpHead; return true; }
+    if (n == QLatin1String("tcp-native")) { *out = ProbeTarget::Mode::TcpConnectNative; return true; }
+    if (n == QLatin1String("tcp-multi")) { *out = ProbeTarget::Mode::TcpMultiAddress; return true; }
+    if (n == QLatin1String("udp-echo")) { *out = ProbeTarget::Mode::UdpEcho; return true; }
+    if (n == QLatin1String("udp-dns")) { *out = ProbeTarget::Mode::UdpDns; return true; }
+    if (n == QLatin1String("tls")) { *out = ProbeTarget::Mode::TlsHandshake; return true; }
+    if (n == QLatin1String("script")) { *out = ProbeTarget::Mode::Script; return true; }
+    if (n == QLatin1String("http-multi")) { *out = ProbeTarget::Mode::HttpMulti; return true; }
+    return false;
+}
+
+// Identity of a target in a target list: reloads match entries on it
+inline QString probeTargetKey(const ProbeTarget& t) {
+    return QStringLiteral("%1://%2:%3").arg(QString::fromLatin1(probeModeName(t.mode)), t.host.toLower())
+            .arg(t.port);
+}
+
+inline bool operator==(const ProbeTarget& a, const ProbeTarget& b) {
+    return a.host == b.host && a.port == b.port && a.mode == b.mode
+        && a.intervalMs == b.intervalMs && a.adaptive == b.adaptive
+        && a.minIntervalMs == b.minIntervalMs && a.maxIntervalMs == b.maxIntervalMs
+        && a.timeoutMs == b.timeoutMs && a.keepAlive == b.keepAlive
+        && a.maxAddresses == b.maxAddresses && a.udpPackets == b.udpPackets
+        && a.udpSpacingMs == b.udpSpacingMs && a.udpQuery == b.udpQuery
+        && a.tlsResume == b.tlsResume && a.tlsInsecure == b.tlsInsecure
+        && a.script == b.script && a.paths == b.paths
+        && a.httpConnections == b.httpConnections;
+}
+
+inline bool operator!=(const ProbeTarget& a, const ProbeTarget& b) {
+    return !(a == b);
+}
@@ -0,0 +1,265 @@
+#include "ProbeWorkerPool.h"
+#include <QDateTime>
+#include <QHash>
+#include <QSemaphore>
+#include <QThread>
+#include "DnsCache.h"
+#include "SelfMetrics.h"
+
+// Owns the shard's scheduler for the lifetime of its event loop: everything the
+// scheduler creates (wheel timer, probes, sockets) gets this thread's affinity.
+class ProbeWorkerPool::ShardThread : public QThread {
+public:
+    ShardThread(ProbeWorkerPool* pool, Shard* shard, int index)
+            : pool_(pool)
+            , shard_(shard) {
+        setObjectName(QStringLiteral("probe-shard-%1").arg(index));
+    }
+
+    void startAndWait() {
+        start();
+        ready_.acquire();
+    }
+
+protected:
+    void run() override {
+        ProbeScheduler scheduler;
+        LoopLagProbe lag(objectName());
+        pool_->wire_(*shard_, scheduler);
+        shard_->scheduler.store(&scheduler, std::memory_order_release);
+        ready_.release();
+        exec();
+        shard_->scheduler.store(nullptr, std::memory_order_release);
+    }
+
+private:
+    ProbeWorkerPool* pool_;
+    Shard* shard_;
+    QSemaphore ready_;
+};
+
+ProbeWorkerPool::ProbeWorkerPool(QObject* parent)
+        : QObject(parent) {
+    // Shard probes share the cache; it has to come to life on this thread, not theirs.
+    DnsCache::instance();
+    build_(0);
+}
+
+ProbeWorkerPool::~ProbeWorkerPool() {
+    teardown_();
+}
+
+void ProbeWorkerPool::setThreadCount(int n) {
+    n = qBound(0, n, 64);
+    if (n == threads_) return;
+    const bool wasRunning = running_;
+    teardown_();
+    build_(n);
+
+    // Re-place every target on the new layout; the schedulers start empty.
+    for (auto& kv : placement_) {
+        kv.second.shard = shardFor_(kv.second.cfg.host);
+        const TargetId id = kv.first;
+        const ProbeTarget cfg = kv.second.cfg;
+        post_(kv.second.shard, [id, cfg](ProbeScheduler& s){ s.setTarget(id, cfg); });
+    }
+    running_ = false;
+    if (wasRunning) start();
+}
+
+void ProbeWorkerPool::build_(int threads) {
+    threads_ = threads;
+    const int count = qMax(1, threads);
+    shards_.reserve(size_t(count));
+    for (int i = 0; i < count; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+        Shard& shard = *shards_.back();
+        if (threads == 0) {
+            shard.local = std::make_unique<ProbeScheduler>();
+            wire_(shard, *shard.local);
+            shard.scheduler.store(shard.local.get(), std::memory_order_release);
+        } else {
+            shard.thread = new ShardThread(this, &shard, i);
+            shard.thread->startAndWait();
+        }
+    }
+    const int limit = shardLimit_();
+    for (int i = 0; i < count; ++i) {
+        const int perHost = maxPerHost_;
+        post_(i, [limit, perHost](ProbeScheduler& s){
+            s.setMaxConcurrent(limit);
+            s.setMaxPerHost(perHost);
+        });
+    }
+}
+
+void ProbeWorkerPool::teardown_() {
+    for (auto& shard : shards_) {
+        if (shard->thread) {
+            shard->thread->quit();
+            shard->thread->wait();
+            delete shard->thread;
+        }
+        shard->local.reset();
+    }
+    // Events still queued belong to schedulers that no longer exist.
+    shards_.clear();
+}
+
+void ProbeWorkerPool::wire_(Shard& shard, ProbeScheduler& scheduler) {
+    // Emitted in the shard's thread; the connections are direct.
+    ProbeScheduler* s = &scheduler;
+    Shard* sh = &shard;
+    QObject::connect(s, &ProbeScheduler::probeStarted, s, [this, sh, s](quint32 id){
+        if (id != detailTarget_.load(std::memory_order_relaxed)) return;
+        Event e;
+        e.kind = Event::Kind::Started;
+        e.id = id;
+        push_(*sh, *s, std::move(e));
+    });
+    QObject::connect(s, &ProbeScheduler::probeDnsResolved, s, [this, sh, s](quint32 id, qint64 dnsMs, const QString& ip){
+        if (id != detailTarget_.load(std::memory_order_relaxed)) return;
+        Event e;
+        e.kind = Event::Kind::Dns;
+        e.id = id;
+        e.dnsMs = dnsMs;
+        e.ip = ip;
+        push_(*sh, *s, std::move(e));
+    });
+    QObject::connect(s, &ProbeScheduler::probeFinished, s, [this, sh, s](quint32 id, const ProbeResult& r){
+        Event e;
+        e.kind = Event::Kind::Finished;
+        e.id = id;
+        e.record = ProbeRecord::from(id, r, QDateTime::currentMSecsSinceEpoch());
+        if (detailAll_.load(std::memory_order_relaxed) || id == detailTarget_.load(std::memory_order_relaxed)
+            || !r.addresses.isEmpty() || !r.paths.isEmpty()) {
+            e.result = std::make_shared<const ProbeResult>(r);
+        }
+        push_(*sh, *s, std::move(e));
+    });
+}
+
+void ProbeWorkerPool::push_(Shard& shard, ProbeScheduler& scheduler, Event&& e) {
+    shard.queue.push(std::move(e));
+    shard.inFlight.store(scheduler.inFlight(), std::memory_order_relaxed);
+    shard.queued.store(scheduler.queued(), std::memory_order_relaxed);
+    shard.skipped.store(scheduler.skipped(), std::memory_order_relaxed);
+    // Only the first event after a drain posts a wakeup; the rest ride along.
+    if (!wakePending_.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, [this]{ drain_(); }, Qt::QueuedConnection);
+    }
+}
+
+template <typename Fn>
+void ProbeWorkerPool::post_(int shard, Fn fn) {
+    ProbeScheduler* s = shards_[size_t(shard)]->scheduler.load(std::memory_order_acquire);
+    if (!s) return;
+    if (threads_ == 0) {
+        fn(*s);
+        return;
+    }
+    // Queued to the scheduler's thread; posts to one shard keep their order.
+    QMetaObject::invokeMethod(s, [s, fn]{ fn(*s); }, Qt::QueuedConnection);
+}
+
+int ProbeWorkerPool::shardFor_(const QString& host) const {
+    return int(qHash(host) % uint(shards_.size()));
+}
+
+int ProbeWorkerPool::shardLimit_() const {
+    const int n = int(shards_.size());
+    return qMax(1, (maxConcurrent_ + n - 1) / n);
+}
+
+void ProbeWorkerPool::setTarget(TargetId id, const ProbeTarget& target) {
+    const int shard = shardFor_(target.host);
+    auto it = placement_.find(id);
+    if (it != placement_.end() && it->second.shard != shard) {
+        // The host moved to another shard: the old one forgets the target.
+        post_(it->second.shard, [id](ProbeScheduler& s){ s.removeTarget(id); });
+    }
+    Placement& p = placement_[id];
+    p.cfg = target;
+    p.shard = shard;
+    post_(shard, [id, target](ProbeScheduler& s){ s.setTarget(id, target); });
+}
+
+void ProbeWorkerPool::removeTarget(TargetId id) {
+    auto it = placement_.find(id);
+    if (it == placement_.end()) return;
+    post_(it->second.shard, [id](ProbeScheduler& s){ s.removeTarget(id); });
+    placement_.erase(it);
+}
+
+void ProbeWorkerPool::clear() {
+    placement_.clear();
+    for (int i = 0; i < int(shards_.size()); ++i) post_(i, [](ProbeScheduler& s){ s.clear(); });
+}
+
+void ProbeWorkerPool::setMaxConcurrent(int n) {
+    maxConcurrent_ = qMax(1, n);
+    const int limit = shardLimit_();
+    for (int i = 0; i < int(shards_.size()); ++i) {
+        post_(i, [limit](ProbeScheduler& s){ s.setMaxConcurrent(limit); });
+    }
+}
+
+void ProbeWorkerPool::setMaxPerHost(int n) {
+    maxPerHost_ = qMax(1, n);
+    const int perHost = maxPerHost_;
+    for (int i = 0; i < int(shards_.size()); ++i) {
+        post_(i, [perHost](ProbeScheduler& s){ s.setMaxPerHost(perHost); });
+    }
+}
+
+void ProbeWorkerPool::start() {
+    if (running_) return;
+    running_ = true;
+    for (int i = 0; i < int(shards_.size()); ++i) post_(i, [](ProbeScheduler& s){ s.start(); });
+}
+
+void ProbeWorkerPool::stop() {
+    if (!running_) return;
+    running_ = false;
+    for (int i = 0; i < int(shards_.size()); ++i) post_(i, [](ProbeScheduler& s){ s.stop(); });
+}
+
+void ProbeWorkerPool::runNow(TargetId id) {
+    auto it = placement_.find(id);
+    if (it == placement_.end()) return;
+    post_(it->second.shard, [id](ProbeScheduler& s){ s.runNow(id); });
+}
+
+void ProbeWorkerPool::rephase(TargetId id, int delayMs) {
+    auto it = placement_.find(id);
+    if (!running_ || it == placement_.end()) return;
+    post_(it->second.shard, [id, delayMs](ProbeScheduler& s){ s.rephase(id, delayMs); });
+}
+
+ProbeWorkerPool::Stats ProbeWorkerPool::stats() const {
+    Stats st;
+    st.threads = threads_;
+    st.events = events_;
+    st.batches = batches_;
+    for (const auto& shard : shards_) {
+        st.inFlight += shard->inFlight.load(std::memory_order_relaxed);
+        st.queued += shard->queued.load(std::memory_order_relaxed);
+        st.skipped += shard->skipped.load(std::memory_order_relaxed);
+    }
+    return st;
+}
+
+void ProbeWorkerPool::drain_() {
+    // Cleared before reading, so an event pushed from now on posts a new wakeup.
+    // A plain store could be reordered after the pops below and lose that wakeup.
+    wakePending_.exchange(false, std::memory_order_acq_rel);
+    QVector<Event> batch;
+    Event e;
+    for (auto& shard : shards_) {
+        while (shard->queue.pop(e)) batch.push_back(std::move(e));
+    }
+    if (batch.isEmpty()) return;
+    events_ += quint64(batch.size());
+    ++batches_;
+    emit eventsReady(batch);
+}
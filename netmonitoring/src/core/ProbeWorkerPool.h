@@ -0,0 +1,118 @@
+#pragma once
+#include <QObject>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "ProbeRecord.h"
+#include "ProbeScheduler.h"
+#include "SpscQueue.h"
+
+// Spreads the target table over ProbeSchedulers that run on worker threads, each
+// with its own event loop, timing wheel and probe pool. A target's shard follows
+// from its host, so the per-host cap stays exact; the global cap is split evenly.
+// Workers report through one lock-free queue per shard, and the owner's thread
+// gets a single queued wakeup per drain, however many events piled up meanwhile.
+// With zero threads the one shard runs on the owner's thread (same delivery path).
+// A finished probe travels as a ProbeRecord; the full ProbeResult rides along only
+// for the detail target, for results with per-address or per-path details, or for
+// every result while setResultDetail(true). Started and Dns events are sent for
+// the detail target only.
+class ProbeWorkerPool : public QObject {
+    Q_OBJECT
+public:
+    using TargetId = ProbeScheduler::TargetId;
+
+    struct Event {
+        enum class Kind : quint8 { Started, Dns, Finished };
+        Kind kind = Kind::Finished;
+        TargetId id = 0;
+        qint64 dnsMs = -1;                // Dns
+        QString ip;                       // Dns
+        ProbeRecord record;               // Finished, собран в потоке шарда
+        std::shared_ptr<const ProbeResult> result;   // Finished, только если нужен целиком
+    };
+
+    struct Stats {
+        int threads = 0;
+        int inFlight = 0;
+        int queued = 0;
+        quint64 skipped = 0;
+        quint64 events = 0;
+        quint64 batches = 0;              // доставки в поток владельца
+    };
+
+    explicit ProbeWorkerPool(QObject* parent = nullptr);
+    ~ProbeWorkerPool() override;
+
+    // Moves every target to the new shard layout; 0 runs probes on this object's thread
+    void setThreadCount(int n);
+    int threadCount() const { return threads_; }
+
+    void setTarget(TargetId id, const ProbeTarget& target);   // add or update
+    void removeTarget(TargetId id);
+    void clear();
+    int targetCount() const { return int(placement_.size()); }
+
+    void setMaxConcurrent(int n);
+    void setMaxPerHost(int n);
+    int maxConcurrent() const { return maxConcurrent_; }
+    int maxPerHost() const { return maxPerHost_; }
+
+    bool isRunning() const { return running_; }
+    void start();
+    void stop();
+    void runNow(TargetId id);
+    void rephase(TargetId id, int delayMs);
+
+    void setResultDetail(bool all) { detailAll_.store(all, std::memory_order_relaxed); }
+    void setDetailTarget(TargetId id) { detailTarget_.store(id, std::memory_order_relaxed); }
+
+    Stats stats() const;
+
+signals:
+    void eventsReady(const QVector<ProbeWorkerPool::Event>& events);
+
+private:
+    class ShardThread;
+
+    struct Shard {
+        std::unique_ptr<ProbeScheduler> local;   // только при нуле потоков
+        ShardThread* thread = nullptr;
+        std::atomic<ProbeScheduler*> scheduler{nullptr};
+        SpscQueue<Event> queue;
+        // Снимки счётчиков планировщика, пишет поток шарда
+        std::atomic<int> inFlight{0};
+        std::atomic<int> queued{0};
+        std::atomic<quint64> skipped{0};
+    };
+
+    struct Placement {
+        ProbeTarget cfg;
+        int shard = 0;
+    };
+
+    void build_(int threads);
+    void teardown_();
+    void wire_(Shard& shard, ProbeScheduler& scheduler);
+    void push_(Shard& shard, ProbeScheduler& scheduler, Event&& e);
+    template <typename Fn> void post_(int shard, Fn fn);
+    int shardFor_(const QString& host) const;
+    int shardLimit_() const;
+    void drain_();
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::unordered_map<TargetId, Placement> placement_;
+    std::atomic<bool> wakePending_{false};
+    std::atomic<bool> detailAll_{false};
+    std::atomic<TargetId> detailTarget_{0};
+    int threads_ = 0;
+    int maxConcurrent_ = 256;
+    int maxPerHost_ = 4;
+    bool running_ = false;
+    quint64 events_ = 0;
+    quint64 batches_ = 0;
+};
+
+Q_DECLARE_METATYPE(ProbeWorkerPool::Event)
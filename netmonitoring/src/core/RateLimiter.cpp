@@ -0,0 +1,78 @@
+#include "RateLimiter.h"
+#include <cmath>
+
+namespace {
+
+// A full slot table frees up when some probe finishes; poll at this pace.
+constexpr int kSlotRetryMs = 5;
+
+} // namespace
+
+RateLimiter& RateLimiter::instance() {
+    static RateLimiter limiter;
+    return limiter;
+}
+
+RateLimiter::RateLimiter() {
+    clock_.start();
+}
+
+void RateLimiter::setRate(double perSec, int burst) {
+    QMutexLocker lock(&mutex_);
+    rate_ = qMax(0.0, perSec);
+    // Default burst: a tenth of a second's worth, so a due batch is not released at once.
+    burst_ = burst > 0 ? double(burst) : qMax(1.0, std::ceil(rate_ / 10));
+    tokens_ = burst_;
+    refilledNs_ = clock_.nsecsElapsed();
+}
+
+void RateLimiter::setMaxInFlight(int n) {
+    QMutexLocker lock(&mutex_);
+    maxInFlight_ = qMax(0, n);
+}
+
+double RateLimiter::rate() const {
+    QMutexLocker lock(&mutex_);
+    return rate_;
+}
+
+int RateLimiter::maxInFlight() const {
+    QMutexLocker lock(&mutex_);
+    return maxInFlight_;
+}
+
+void RateLimiter::refill_(qint64 nowNs) {
+    tokens_ = qMin(burst_, tokens_ + double(nowNs - refilledNs_) * rate_ / 1e9);
+    refilledNs_ = nowNs;
+}
+
+bool RateLimiter::tryAcquire(int* retryMs) {
+    QMutexLocker lock(&mutex_);
+    if (maxInFlight_ > 0 && stats_.inFlight >= maxInFlight_) {
+        ++stats_.slotLimited;
+        *retryMs = kSlotRetryMs;
+        return false;
+    }
+    if (rate_ > 0) {
+        refill_(clock_.nsecsElapsed());
+        if (tokens_ < 1.0) {
+            ++stats_.rateLimited;
+            *retryMs = qMax(1, int(std::ceil((1.0 - tokens_) * 1000.0 / rate_)));
+            return false;
+        }
+        tokens_ -= 1.0;
+    }
+    ++stats_.inFlight;
+    ++stats_.granted;
+    return true;
+}
+
+void RateLimiter::release() {
+    QMutexLocker lock(&mutex_);
+    if (stats_.inFlight > 0) --stats_.inFlight;
+}
+
+RateLimiter::Stats RateLimiter::stats() const {
+    QMutexLocker lock(&mutex_);
+    return stats_;
+}
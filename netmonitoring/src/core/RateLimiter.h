@@ -0,0 +1,44 @@
+#pragma once
+#include <QtGlobal>
+#include <QMutex>
+#include <QElapsedTimer>
+
+// Process-wide budget for outbound probes, shared by the schedulers of every worker
+// shard. A token bucket caps the launch rate (refilled at `rate` per second, holding
+// at most `burst` tokens) and a counter caps probes in flight, i.e. open sockets.
+// A probe needs a token and a slot to start; zero disables either limit.
+class RateLimiter {
+public:
+    struct Stats {
+        quint64 granted = 0;
+        quint64 rateLimited = 0;          // отказы: нет токена
+        quint64 slotLimited = 0;          // отказы: все слоты заняты
+        int inFlight = 0;
+    };
+
+    static RateLimiter& instance();
+
+    void setRate(double perSec, int burst);
+    void setMaxInFlight(int n);
+    double rate() const;
+    int maxInFlight() const;
+
+    // Takes a token and a slot, or neither; on refusal *retryMs is when to ask again.
+    bool tryAcquire(int* retryMs);
+    void release();                       // returns the slot of a finished probe
+
+    Stats stats() const;
+
+private:
+    RateLimiter();
+    void refill_(qint64 nowNs);
+
+    mutable QMutex mutex_;
+    QElapsedTimer clock_;
+    double rate_ = 0;                     // токенов в секунду, 0 — без ограничения
+    double burst_ = 1;
+    double tokens_ = 1;
+    qint64 refilledNs_ = 0;
+    int maxInFlight_ = 0;                 // 0 — без ограничения
+    Stats stats_;
+};
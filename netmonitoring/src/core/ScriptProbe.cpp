@@ -0,0 +1,318 @@
+#include "ScriptProbe.h"
+#include "DnsCache.h"
+#include <QDateTime>
+#include <QHostAddress>
+#ifndef QT_NO_SSL
+#include <QSslCertificate>
+#include <QSslCipher>
+#include <QSslSocket>
+#include "TlsHandshakeProbe.h"
+#endif
+
+ScriptProbe::ScriptProbe(QObject* parent)
+        : INetProbe(parent) {
+    timeout_.setSingleShot(true);
+    stepTimeout_.setSingleShot(true);
+    QObject::connect(&timeout_, &QTimer::timeout, this, [this]{
+        if (active_) fail_(ProbeResult::Status::Timeout, tr("timeout"));
+    });
+    QObject::connect(&stepTimeout_, &QTimer::timeout, this, [this]{
+        if (active_) fail_(ProbeResult::Status::Timeout, tr("step timeout"));
+    });
+}
+
+ScriptProbe::~ScriptProbe() {
+    abort();
+}
+
+void ScriptProbe::configure(const ProbeTarget& target) {
+    insecure_ = target.tlsInsecure;
+    if (target.script == scriptText_ && (!script_.isEmpty() || !scriptError_.isEmpty())) return;
+    // Compiled once per script text, not per run.
+    scriptText_ = target.script;
+    scriptError_.clear();
+    if (!ProbeScript::parse(scriptText_, &script_, &scriptError_)) {
+        scriptError_ = tr("Script: %1").arg(scriptError_);
+    }
+}
+
+void ScriptProbe::start(const QString& host, quint16 port, int timeoutMs) {
+    if (active_) return;
+    host_ = host;
+    port_ = port;
+
+    active_ = true;
+    ip_.clear();
+    dnsMs_ = -1;
+    dnsCached_ = false;
+    step_ = 0;
+    waiting_ = false;
+    inbox_.clear();
+    httpCode_ = -1;
+    verifyError_.clear();
+    tls_ = ProbeResult::TlsInfo();
+    hasTls_ = false;
+    dnsNs_ = connectStartNs_ = connectedNs_ = encryptedNs_ = firstSendNs_ = firstByteNs_ = -1;
+    elapsed_.restart();
+    timeout_.start(timeoutMs);
+    const quint64 run = ++run_;
+
+    if (script_.isEmpty()) {
+        // Reported like any other result: asynchronously, never from inside start().
+        const QString why = scriptError_.isEmpty() ? tr("Script: empty") : scriptError_;
+        QPointer<ScriptProbe> self(this);
+        QMetaObject::invokeMethod(this, [this, self, run, why]{
+            if (!self || !active_ || run != run_) return;
+            ProbeResult r;
+            r.status = ProbeResult::Status::Error;
+            r.message = why;
+            finish_(r);
+        }, Qt::QueuedConnection);
+        return;
+    }
+    advance_();
+}
+
+void ScriptProbe::advance_() {
+    while (active_ && step_ < script_.steps.size()) {
+        const ProbeScript::Step& s = script_.steps[step_];
+        const bool entering = !waiting_;
+        if (entering) {
+            waiting_ = true;
+            if (s.timeoutMs > 0) stepTimeout_.start(s.timeoutMs);
+            else stepTimeout_.stop();
+        }
+        if (!execute_(s, entering)) return;   // resumed by the next socket event
+        waiting_ = false;
+        ++step_;
+    }
+    if (!active_) return;
+
+    ProbeResult r;
+    r.status = ProbeResult::Status::Up;
+    r.latencyNs = elapsed_.nsecsElapsed() - connectStartNs_;
+    r.latencyMs = r.latencyNs / 1000000;
+    finish_(r);
+}
+
+bool ScriptProbe::execute_(const ProbeScript::Step& s, bool entering) {
+    switch (s.op) {
+        case ProbeScript::Op::Connect:
+            if (entering) {
+                QPointer<ScriptProbe> self(this);
+                const quint64 run = run_;
+                DnsCache::instance().lookup(host_, this, [this, self, run](const DnsAnswer& answer, bool fromCache){
+                    if (!self || !active_ || run != run_) return;
+                    dnsCached_ = fromCache;
+                    if (answer.status != DnsAnswer::Status::Ok || answer.addresses.isEmpty()) {
+                        fail_(ProbeResult::Status::DnsFail, answer.errorString);
+                        return;
+                    }
+                    QHostAddress addr;
+                    for (const auto& a : answer.addresses) {
+                        if (a.protocol() == QAbstractSocket::IPv4Protocol) { addr = a; break; }
+                    }
+                    if (addr.isNull()) addr = answer.addresses.first();
+                    ip_ = addr.toString();
+                    dnsNs_ = elapsed_.nsecsElapsed();
+                    dnsMs_ = dnsNs_ / 1000000;
+                    emit progressDnsResolved(dnsMs_, ip_);
+                    connect_(addr);
+                });
+            }
+            return connectedNs_ >= 0;
+
+        case ProbeScript::Op::Tls:
+#ifndef QT_NO_SSL
+            if (entering) {
+                auto* ssl = qobject_cast<QSslSocket*>(socket_.data());
+                ssl->setPeerVerifyName(host_);
+                ssl->startClientEncryption();
+            }
+            return encryptedNs_ >= 0;
+#else
+            fail_(ProbeResult::Status::Error, tr("built without TLS"));
+            return false;
+#endif
+
+        case ProbeScript::Op::Send:
+            if (firstSendNs_ < 0) firstSendNs_ = elapsed_.nsecsElapsed();
+            socket_->write(s.data);
+            return true;
+
+        case ProbeScript::Op::Expect:
+            return expect_(s.data);
+
+        case ProbeScript::Op::Http:
+            if (entering) {
+                QByteArray req;
+                req.reserve(128);
+                req += s.method + ' ' + s.data + " HTTP/1.1\r\nHost: " + host_.toUtf8();
+                const bool defaultPort = port_ == (encryptedNs_ >= 0 ? 443 : 80);
+                if (!defaultPort) req += ':' + QByteArray::number(port_);
+                req += "\r\nUser-Agent: SimpleQtNetMon/1.0\r\nAccept: */*\r\n\r\n";
+                if (firstSendNs_ < 0) firstSendNs_ = elapsed_.nsecsElapsed();
+                socket_->write(req);
+            }
+            return http_();
+    }
+    return false;
+}
+
+bool ScriptProbe::expect_(const QByteArray& needle) {
+    const int at = inbox_.indexOf(needle);
+    if (at < 0) return false;
+    inbox_.remove(0, at + needle.size());
+    return true;
+}
+
+bool ScriptProbe::http_() {
+    const int end = inbox_.indexOf("\r\n\r\n");
+    if (end < 0) return false;
+    // HTTP/1.1 200 OK
+    const int lineEnd = inbox_.indexOf("\r\n");
+    const QList<QByteArray> status = inbox_.left(lineEnd).split(' ');
+    bool ok = false;
+    const int code = status.size() >= 2 && status[0].startsWith("HTTP/") ? status[1].toInt(&ok) : 0;
+    if (!ok || code < 100 || code > 999) {
+        fail_(ProbeResult::Status::Down, tr("not an HTTP response"));
+        return false;
+    }
+    httpCode_ = code;
+    // Headers are consumed; a body stays for the steps that follow.
+    inbox_.remove(0, end + 4);
+    if (code >= 400) {
+        fail_(ProbeResult::Status::Down, tr("HTTP %1").arg(code));
+        return false;
+    }
+    return true;
+}
+
+void ScriptProbe::connect_(const QHostAddress& addr) {
+    makeSocket_();
+    connectStartNs_ = elapsed_.nsecsElapsed();
+    socket_->connectToHost(addr, port_);
+}
+
+void ScriptProbe::makeSocket_() {
+    dropSocket_();
+    // A fresh socket per run: QSslSocket keeps session state between connections.
+#ifndef QT_NO_SSL
+    if (script_.usesTls()) {
+        auto* ssl = new QSslSocket(this);
+        QObject::connect(ssl, &QSslSocket::encrypted, this, [this, ssl]{
+            if (!active_ || socket_.data() != ssl) return;
+            encryptedNs_ = elapsed_.nsecsElapsed();
+            hasTls_ = true;
+            tls_.protocol = TlsHandshakeProbe::protocolName(ssl->sessionProtocol());
+            tls_.cipher = ssl->sessionCipher().name();
+            const QSslCertificate cert = ssl->peerCertificate();
+            if (!cert.isNull()) tls_.certNotAfterMs = cert.expiryDate().toMSecsSinceEpoch();
+            tls_.verifyError = verifyError_;
+            if (!verifyError_.isEmpty() && !insecure_) {
+                fail_(ProbeResult::Status::Down, tr("certificate: %1").arg(verifyError_));
+                return;
+            }
+            advance_();
+        });
+        QObject::connect(ssl, qOverload<const QList<QSslError>&>(&QSslSocket::sslErrors), this,
+                         [this, ssl](const QList<QSslError>& errors){
+            if (!active_ || socket_.data() != ssl) return;
+            // The verdict comes with encrypted(), so the handshake is timed either way.
+            if (verifyError_.isEmpty() && !errors.isEmpty()) verifyError_ = errors.first().errorString();
+            ssl->ignoreSslErrors();
+        });
+        socket_ = ssl;
+    } else
+#endif
+    {
+        socket_ = new QTcpSocket(this);
+    }
+
+    QTcpSocket* s = socket_;
+    QObject::connect(s, &QTcpSocket::connected, this, [this, s]{
+        if (!active_ || s != socket_) return;
+        connectedNs_ = elapsed_.nsecsElapsed();
+        advance_();
+    });
+    QObject::connect(s, &QTcpSocket::readyRead, this, [this, s]{
+        if (!active_ || s != socket_) return;
+        onReadyRead_();
+    });
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    QObject::connect(s, &QTcpSocket::errorOccurred, this, [this, s](QAbstractSocket::SocketError){
+        if (!active_ || s != socket_) return;
+        onError_();
+    });
+#else
+    QObject::connect(s, qOverload<QAbstractSocket::SocketError>(&QAbstractSocket::error), this,
+                     [this, s](QAbstractSocket::SocketError){
+        if (!active_ || s != socket_) return;
+        onError_();
+    });
+#endif
+}
+
+void ScriptProbe::dropSocket_() {
+    if (!socket_) return;
+    QObject::disconnect(socket_, nullptr, this, nullptr);
+    socket_->abort();
+    socket_->deleteLater();
+    socket_ = nullptr;
+}
+
+void ScriptProbe::onReadyRead_() {
+    if (firstByteNs_ < 0) firstByteNs_ = elapsed_.nsecsElapsed();
+    inbox_ += socket_->readAll();
+    // An expected string never shows up in a stream that keeps coming; keep the tail only.
+    if (inbox_.size() > kMaxBuffered) inbox_.remove(0, inbox_.size() - kMaxBuffered);
+    if (waiting_) advance_();
+}
+
+void ScriptProbe::onError_() {
+    // A reply the server sent right before closing still counts.
+    if (socket_->bytesAvailable() > 0) onReadyRead_();
+    if (!active_) return;
+    fail_(ProbeResult::Status::Down, socket_->errorString());
+}
+
+void ScriptProbe::fail_(ProbeResult::Status status, const QString& why) {
+    ProbeResult r;
+    r.status = status;
+    if (step_ < script_.steps.size()) {
+        r.message = tr("Step %1 (%2): %3").arg(step_ + 1).arg(ProbeScript::describe(script_.steps[step_]), why);
+    } else {
+        r.message = why;
+    }
+    finish_(r);
+}
+
+void ScriptProbe::abort() {
+    if (!active_) return;
+    active_ = false;
+    timeout_.stop();
+    stepTimeout_.stop();
+    dropSocket_();
+}
+
+void ScriptProbe::finish_(ProbeResult r) {
+    r.dnsMs = dnsMs_;
+    r.dnsCached = dnsCached_;
+    r.ip = ip_;
+    if (httpCode_ > 0) r.httpCode = httpCode_;
+    if (hasTls_) r.tls = tls_;
+
+    auto us = [](qint64 fromNs, qint64 toNs) -> qint64 {
+        return (fromNs >= 0 && toNs >= fromNs) ? (toNs - fromNs) / 1000 : -1;
+    };
+    const qint64 readyNs = encryptedNs_ >= 0 ? encryptedNs_ : connectedNs_;
+    const qint64 ttfbFromNs = (firstSendNs_ >= 0 && firstSendNs_ <= firstByteNs_) ? firstSendNs_ : readyNs;
+    PhaseTimings& p = r.phases;
+    p.dnsUs = dnsNs_ >= 0 ? dnsNs_ / 1000 : -1;
+    p.connectUs = us(connectStartNs_, connectedNs_);
+    p.tlsUs = us(connectedNs_, encryptedNs_);
+    p.ttfbUs = us(ttfbFromNs, firstByteNs_);
+    p.totalUs = elapsed_.nsecsElapsed() / 1000;
+    abort();
+    emit finished(r);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "INetProbe.h"
+#include "ProbeScript.h"
+#include <QByteArray>
+#include <QPointer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class QHostAddress;
+
+// Runs a ProbeScript (mode script): connect, optional TLS, then send/expect and
+// HTTP steps over the one connection, each with an optional timeout of its own.
+// The run is a resumable step machine: between socket events its whole state is
+// the step index, the unread reply bytes and a few phase marks, so a run costs
+// one socket on top of the probe object that ProbePool keeps for reuse. A failing
+// step names itself in the message (step 3 (expect "+PONG"): timeout). Phases:
+// connectUs, tlsUs, ttfbUs (first reply byte, from the first send, or from the
+// channel being ready when the server speaks first); latency runs from the start
+// of the connect to the end of the last step.
+class ScriptProbe : public INetProbe {
+    Q_OBJECT
+public:
+    explicit ScriptProbe(QObject* parent = nullptr);
+    ~ScriptProbe() override;
+
+    void start(const QString& host, quint16 port, int timeoutMs) override;
+    void abort() override;
+    void configure(const ProbeTarget& target) override;
+
+private:
+    static constexpr int kMaxBuffered = 64 * 1024;   // непрочитанный ответ, дальше — хвост
+
+    void advance_();
+    bool execute_(const ProbeScript::Step& s, bool entering);
+    bool expect_(const QByteArray& needle);
+    bool http_();
+    void connect_(const QHostAddress& addr);
+    void makeSocket_();
+    void dropSocket_();
+    void onReadyRead_();
+    void onError_();
+    void fail_(ProbeResult::Status status, const QString& why);
+    void finish_(ProbeResult r);
+
+    ProbeScript script_;
+    QString scriptText_;
+    QString scriptError_;                 // разбор не удался: каждая проба — ERROR
+    bool insecure_ = false;
+
+    QPointer<QTcpSocket> socket_;
+    QTimer timeout_;
+    QTimer stepTimeout_;
+    QElapsedTimer elapsed_;
+
+    QString host_;
+    quint16 port_ = 0;
+    QString ip_;
+    qint64 dnsMs_ = -1;
+    bool dnsCached_ = false;
+    bool active_ = false;
+    quint64 run_ = 0;                     // номер запуска: отсекает колбэки прошлых запусков
+
+    // Состояние прогона
+    int step_ = 0;                        // текущий шаг
+    bool waiting_ = false;                // шаг начат и ждёт события сокета
+    QByteArray inbox_;                    // принятое и ещё не поглощённое
+    int httpCode_ = -1;
+    QString verifyError_;
+    ProbeResult::TlsInfo tls_;
+    bool hasTls_ = false;
+
+    // Отметки фаз, нс от начала проверки; -1 — событие не наступило
+    qint64 dnsNs_ = -1;
+    qint64 connectStartNs_ = -1;
+    qint64 connectedNs_ = -1;
+    qint64 encryptedNs_ = -1;
+    qint64 firstSendNs_ = -1;
+    qint64 firstByteNs_ = -1;
+};
@@ -0,0 +1,128 @@
+#include "SelfMetrics.h"
+#include "TraceRecorder.h"
+#include <chrono>
+
+SelfMetrics& SelfMetrics::instance() {
+    static SelfMetrics metrics;
+    return metrics;
+}
+
+qint64 SelfMetrics::nowUs() {
+    using namespace std::chrono;
+    static const steady_clock::time_point origin = steady_clock::now();
+    return duration_cast<microseconds>(steady_clock::now() - origin).count();
+}
+
+const char* SelfMetrics::siteName(Site site) {
+    switch (site) {
+        case WheelTick: return "wheel_tick";
+        case Launch:    return "launch";
+        case Finish:    return "finish";
+        case Deliver:   return "deliver";
+        case SiteCount: break;
+    }
+    return "unknown";
+}
+
+void SelfMetrics::recordLoopLag(const QString& loop, qint64 lagUs) {
+    QMutexLocker lock(&mutex_);
+    Distribution& d = loopLag_[loop];
+    d.hist.record(lagUs);
+    d.sumUs += lagUs;
+}
+
+SelfMetrics::LaunchSlot& SelfMetrics::launchSlot_() {
+    // Goes back to the free list when its thread ends
+    struct Holder {
+        SelfMetrics* owner = nullptr;
+        LaunchSlot* slot = nullptr;
+        ~Holder() {
+            if (!slot) return;
+            QMutexLocker lock(&owner->mutex_);
+            owner->freeSlots_.push_back(slot);
+        }
+    };
+    thread_local Holder holder;
+    if (!holder.slot) {
+        QMutexLocker lock(&mutex_);
+        if (!freeSlots_.empty()) {
+            holder.slot = freeSlots_.back();
+            freeSlots_.pop_back();
+        } else {
+            launchSlots_.push_back(std::make_unique<LaunchSlot>());
+            holder.slot = launchSlots_.back().get();
+        }
+        holder.owner = this;
+    }
+    return *holder.slot;
+}
+
+void SelfMetrics::recordLaunch(qint64 skewUs, qint64 waitUs) {
+    LaunchSlot& slot = launchSlot_();
+    QMutexLocker lock(&slot.mutex);
+    slot.scheduleSkew.hist.record(skewUs);
+    slot.scheduleSkew.sumUs += skewUs;
+    slot.queueWait.hist.record(waitUs);
+    slot.queueWait.sumUs += waitUs;
+}
+
+void SelfMetrics::recordSite(Site site, qint64 us) {
+    AtomicSite& s = sites_[site];
+    s.calls.fetch_add(1, std::memory_order_relaxed);
+    s.totalUs.fetch_add(us, std::memory_order_relaxed);
+    qint64 max = s.maxUs.load(std::memory_order_relaxed);
+    while (us > max && !s.maxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
+}
+
+SelfMetrics::Snapshot SelfMetrics::snapshot() const {
+    Snapshot snap;
+    {
+        QMutexLocker lock(&mutex_);
+        snap.loopLag = loopLag_;
+        for (const auto& slot : launchSlots_) {
+            QMutexLocker slotLock(&slot->mutex);
+            snap.scheduleSkew.hist.merge(slot->scheduleSkew.hist);
+            snap.scheduleSkew.sumUs += slot->scheduleSkew.sumUs;
+            snap.queueWait.hist.merge(slot->queueWait.hist);
+            snap.queueWait.sumUs += slot->queueWait.sumUs;
+        }
+    }
+    for (int i = 0; i < SiteCount; ++i) {
+        snap.sites[i].calls = sites_[i].calls.load(std::memory_order_relaxed);
+        snap.sites[i].totalUs = sites_[i].totalUs.load(std::memory_order_relaxed);
+        snap.sites[i].maxUs = sites_[i].maxUs.load(std::memory_order_relaxed);
+    }
+    return snap;
+}
+
+SelfMetrics::Scope::Scope(Site site)
+        : site_(site)
+        , startUs_(nowUs()) {}
+
+SelfMetrics::Scope::~Scope() {
+    const qint64 durUs = nowUs() - startUs_;
+    SelfMetrics::instance().recordSite(site_, durUs);
+    TraceRecorder& trace = TraceRecorder::instance();
+    if (trace.isEnabled()) trace.complete(siteName(site_), "self", startUs_, durUs);
+}
+
+LoopLagProbe::LoopLagProbe(const QString& loop, QObject* parent)
+        : QObject(parent)
+        , loop_(loop) {
+    timer_.setTimerType(Qt::PreciseTimer);
+    timer_.setSingleShot(true);
+    QObject::connect(&timer_, &QTimer::timeout, this, &LoopLagProbe::onBeat_);
+    expectedUs_ = SelfMetrics::nowUs() + kPeriodMs * 1000;
+    timer_.start(kPeriodMs);
+}
+
+void LoopLagProbe::onBeat_() {
+    const qint64 now = SelfMetrics::nowUs();
+    const qint64 lagUs = qMax<qint64>(0, now - expectedUs_);
+    // Re-armed by hand: a repeating timer would catch up on its own schedule.
+    expectedUs_ = now + kPeriodMs * 1000;
+    timer_.start(kPeriodMs);
+    SelfMetrics::instance().recordLoopLag(loop_, lagUs);
+    TraceRecorder& trace = TraceRecorder::instance();
+    if (trace.isEnabled()) trace.counter("loop_lag_us", loop_, lagUs);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "LatencyHistogram.h"
+
+// The monitor's own health, so that overload of this process is not mistaken for
+// network latency. Per event loop: how late a fixed heartbeat timer fires
+// (LoopLagProbe). Per probe: how far the launch trailed its deadline on the timing
+// wheel, and how long it sat in the launch queue. Per callback site: calls and wall
+// time spent in our own code; sites nest (a wheel tick includes the launches it
+// triggers). Durations are microseconds. Thread-safe: every worker shard records
+// into the one instance, launches into a slot of its own thread that snapshot()
+// sums, so shards never wait on each other.
+class SelfMetrics {
+public:
+    enum Site { WheelTick, Launch, Finish, Deliver, SiteCount };
+
+    struct Distribution {
+        LatencyHistogram hist;
+        qint64 sumUs = 0;
+    };
+
+    struct SiteStats {
+        quint64 calls = 0;
+        qint64 totalUs = 0;
+        qint64 maxUs = 0;
+    };
+
+    struct Snapshot {
+        QMap<QString, Distribution> loopLag;      // по имени цикла: main, probe-shard-N
+        Distribution scheduleSkew;                // срок на колесе -> start() пробы
+        Distribution queueWait;                   // постановка в очередь -> start()
+        SiteStats sites[SiteCount];
+    };
+
+    // Adds its own lifetime to a site, and a span to the trace while tracing
+    class Scope {
+    public:
+        explicit Scope(Site site);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Site site_;
+        qint64 startUs_;
+    };
+
+    static SelfMetrics& instance();
+    // Monotonic microseconds, one clock for every thread
+    static qint64 nowUs();
+    static const char* siteName(Site site);
+
+    void recordLoopLag(const QString& loop, qint64 lagUs);
+    void recordLaunch(qint64 skewUs, qint64 waitUs);
+    void recordSite(Site site, qint64 us);
+
+    Snapshot snapshot() const;
+
+private:
+    SelfMetrics() = default;
+
+    struct AtomicSite {
+        std::atomic<quint64> calls{0};
+        std::atomic<qint64> totalUs{0};
+        std::atomic<qint64> maxUs{0};
+    };
+
+    // Launch distributions of one thread; slots of finished threads are reused and
+    // keep their counts
+    struct LaunchSlot {
+        QMutex mutex;                     // чужой поток берёт его только в snapshot()
+        Distribution scheduleSkew;
+        Distribution queueWait;
+    };
+
+    LaunchSlot& launchSlot_();
+
+    mutable QMutex mutex_;
+    QMap<QString, Distribution> loopLag_;
+    std::vector<std::unique_ptr<LaunchSlot>> launchSlots_;   // под mutex_
+    std::vector<LaunchSlot*> freeSlots_;                      // слоты завершившихся потоков
+    AtomicSite sites_[SiteCount];         // без мьютекса: пишутся на каждом колбэке
+};
+
+// Heartbeat on the event loop of the thread it lives in: a precise timer asks to
+// fire every kPeriodMs, and whatever it is late by is time the loop was busy with
+// something else. Reported to SelfMetrics under `loop`.
+class LoopLagProbe : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int kPeriodMs = 100;
+
+    explicit LoopLagProbe(const QString& loop, QObject* parent = nullptr);
+
+private:
+    void onBeat_();
+
+    QString loop_;
+    QTimer timer_;
+    qint64 expectedUs_ = 0;
+};
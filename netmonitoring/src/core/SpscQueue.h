@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <utility>
+
+// Unbounded single-producer/single-consumer queue without locks. Items go into
+// fixed-size chunks; the producer links a new chunk when the tail one is full and
+// the consumer frees chunks it has read past. push() and pop() must each be called
+// from one thread only (they may be different threads).
+template <typename T, int ChunkSize = 256>
+class SpscQueue {
+public:
+    SpscQueue() : head_(new Chunk), tail_(head_) {}
+    ~SpscQueue() {
+        while (head_) {
+            Chunk* next = head_->next.load(std::memory_order_relaxed);
+            delete head_;
+            head_ = next;
+        }
+    }
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side
+    void push(T value) {
+        Chunk* c = tail_;
+        int n = c->written.load(std::memory_order_relaxed);
+        if (n == ChunkSize) {
+            Chunk* fresh = new Chunk;
+            c->next.store(fresh, std::memory_order_release);
+            tail_ = c = fresh;
+            n = 0;
+        }
+        c->items[n] = std::move(value);
+        c->written.store(n + 1, std::memory_order_release);
+    }
+
+    // Consumer side; false when nothing is published yet
+    bool pop(T& out) {
+        Chunk* c = head_;
+        int n = c->written.load(std::memory_order_acquire);
+        if (c->read == n) {
+            if (n < ChunkSize) return false;
+            Chunk* next = c->next.load(std::memory_order_acquire);
+            if (!next) return false;
+            // The producer has moved on to `next` and never touches `c` again.
+            delete c;
+            head_ = c = next;
+            n = c->written.load(std::memory_order_acquire);
+            if (c->read == n) return false;
+        }
+        out = std::move(c->items[c->read]);
+        c->items[c->read] = T();           // не держим строки результата до освобождения чанка
+        ++c->read;
+        return true;
+    }
+
+private:
+    struct Chunk {
+        T items[ChunkSize];
+        std::atomic<int> written{0};      // опубликовано производителем
+        std::atomic<Chunk*> next{nullptr};
+        int read = 0;                     // только потребитель
+    };
+
+    Chunk* head_;                         // потребитель
+    Chunk* tail_;                         // производитель
+};
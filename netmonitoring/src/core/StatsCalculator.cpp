@@ -1,2 +1,56 @@
 #include "StatsCalculator.h"
-// Intentionally empty: all inline in header (kept cpp for build systems that expect it)
+
+void StatsCalculator::setMaxSamples(int n) {
+    n = qMax(0, n);
+    if (n == max_) return;
+
+    // Rare operation: replay the newest samples that still fit into a fresh ring.
+    std::vector<qint64> keep;
+    const int kept = qMin(size_, n);
+    keep.reserve(kept);
+    for (int i = size_ - kept; i < size_; ++i) keep.push_back(ring_[(head_ + i) % max_]);
+
+    clear();
+    max_ = n;
+    for (qint64 v : keep) addSample(v);
+}
+
+void StatsCalculator::clear() {
+    ring_.clear();
+    head_ = 0;
+    size_ = 0;
+    sum_ = 0;
+    minQ_.clear();
+    maxQ_.clear();
+    hist_.clear();
+}
+
+void StatsCalculator::addSample(qint64 ms) {
+    if (ms < 0 || max_ <= 0) return;
+    if (ring_.size() != size_t(max_)) ring_.assign(size_t(max_), 0);
+    if (size_ == max_) evictOldest_();
+
+    ring_[(head_ + size_) % max_] = ms;
+    ++size_;
+    sum_ += ms;
+    hist_.record(ms);
+
+    const quint64 seq = seq_++;
+    while (!minQ_.empty() && minQ_.back().second >= ms) minQ_.pop_back();
+    minQ_.emplace_back(seq, ms);
+    while (!maxQ_.empty() && maxQ_.back().second <= ms) maxQ_.pop_back();
+    maxQ_.emplace_back(seq, ms);
+}
+
+void StatsCalculator::evictOldest_() {
+    const qint64 v = ring_[head_];
+    const quint64 oldestSeq = seq_ - quint64(size_);
+
+    head_ = (head_ + 1) % max_;
+    --size_;
+    sum_ -= v;
+    hist_.remove(v);
+
+    if (!minQ_.empty() && minQ_.front().first == oldestSeq) minQ_.pop_front();
+    if (!maxQ_.empty() && maxQ_.front().first == oldestSeq) maxQ_.pop_front();
+}
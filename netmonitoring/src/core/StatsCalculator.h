@@ -1,39 +1,41 @@
 #pragma once
-#include <QVector>
-#include <algorithm>
+#include <QtGlobal>
+#include <deque>
+#include <utility>
+#include <vector>
+#include "LatencyHistogram.h"
 
+// Sliding window over the last N samples. The window is a fixed-capacity ring;
+// sum, min and max (monotonic deques) and the histogram are updated on insert and
+// eviction, so adding a sample and every query are O(1) amortized.
 class StatsCalculator {
 public:
-    void setMaxSamples(int n) { max_ = n; trim_(); }
-    void clear() { samples_.clear(); }
+    void setMaxSamples(int n);
+    void clear();
 
-    void addSample(qint64 ms) {
-        if (ms < 0) return;
-        samples_.push_back(ms);
-        trim_();
-    }
+    void addSample(qint64 ms);
 
-    bool empty() const { return samples_.isEmpty(); }
+    bool empty() const { return size_ == 0; }
 
-    qint64 min() const {
-        if (samples_.isEmpty()) return -1;
-        return *std::min_element(samples_.cbegin(), samples_.cend());
-    }
-    qint64 max() const {
-        if (samples_.isEmpty()) return -1;
-        return *std::max_element(samples_.cbegin(), samples_.cend());
-    }
-    qint64 avg() const {
-        if (samples_.isEmpty()) return -1;
-        long long sum = 0; for (auto v : samples_) sum += v; return sum / samples_.size();
-    }
-    int count() const { return samples_.size(); }
+    qint64 min() const { return empty() ? -1 : minQ_.front().second; }
+    qint64 max() const { return empty() ? -1 : maxQ_.front().second; }
+    qint64 avg() const { return empty() ? -1 : sum_ / size_; }
+    int count() const { return size_; }
+
+    // q in percent: 50, 90, 99, 99.9
+    qint64 percentile(double q) const { return hist_.percentile(q); }
+    const LatencyHistogram& histogram() const { return hist_; }
 
 private:
-    void trim_() {
-        while (samples_.size() > max_) samples_.erase(samples_.begin());
-    }
+    void evictOldest_();
 
-    QVector<qint64> samples_;
+    std::vector<qint64> ring_;
+    int head_ = 0;                                  // индекс самого старого отсчёта
+    int size_ = 0;
     int max_ = 50;
-};
\ No newline at end of file
+    quint64 seq_ = 0;                               // номер следующего отсчёта
+    long long sum_ = 0;
+    std::deque<std::pair<quint64, qint64>> minQ_;   // (номер, значение), значения возрастают
+    std::deque<std::pair<quint64, qint64>> maxQ_;   // (номер, значение), значения убывают
+    LatencyHistogram hist_;
+};
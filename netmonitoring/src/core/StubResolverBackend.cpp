@@ -0,0 +1,37 @@
+#include "StubResolverBackend.h"
+#include <QTimer>
+
+StubResolverBackend::StubResolverBackend(QObject* parent)
+        : IResolverBackend(parent) {}
+
+void StubResolverBackend::setAnswer(const QString& name, const DnsAnswer& answer, int delayMs) {
+    table_.insert(name.toLower(), Record{answer, delayMs});
+}
+
+void StubResolverBackend::setAddress(const QString& name, const QHostAddress& addr, quint32 ttlSec, int delayMs) {
+    DnsAnswer a;
+    a.status = DnsAnswer::Status::Ok;
+    a.addresses.push_back(addr);
+    a.ttlSec = ttlSec;
+    setAnswer(name, a, delayMs);
+}
+
+void StubResolverBackend::removeAnswer(const QString& name) {
+    table_.remove(name.toLower());
+}
+
+void StubResolverBackend::resolve(const QString& name) {
+    const QString key = name.toLower();
+    ++queries_;
+    ++perName_[key];
+
+    Record rec;
+    auto it = table_.constFind(key);
+    if (it != table_.constEnd()) {
+        rec = it.value();
+    } else {
+        rec.answer.status = DnsAnswer::Status::NxDomain;
+        rec.answer.errorString = QStringLiteral("Host %1 not found").arg(name);
+    }
+    QTimer::singleShot(rec.delayMs, this, [this, name, rec]{ emit resolved(name, rec.answer); });
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "IResolverBackend.h"
+#include <QHash>
+
+// Offline stand-in for a DNS server: answers come from a table filled by the
+// caller, with an optional artificial delay. Unknown names answer NXDOMAIN.
+class StubResolverBackend : public IResolverBackend {
+    Q_OBJECT
+public:
+    explicit StubResolverBackend(QObject* parent = nullptr);
+
+    void setAnswer(const QString& name, const DnsAnswer& answer, int delayMs = 0);
+    void setAddress(const QString& name, const QHostAddress& addr, quint32 ttlSec, int delayMs = 0);
+    void removeAnswer(const QString& name);
+
+    void resolve(const QString& name) override;
+
+    int queryCount() const { return queries_; }
+    int queryCount(const QString& name) const { return perName_.value(name.toLower()); }
+
+private:
+    struct Record {
+        DnsAnswer answer;
+        int delayMs = 0;
+    };
+
+    QHash<QString, Record> table_;
+    QHash<QString, int> perName_;
+    int queries_ = 0;
+};
@@ -0,0 +1,99 @@
+#include "SystemResolverBackend.h"
+#include <QDnsLookup>
+#include <QHostInfo>
+#include <QTimer>
+#include <memory>
+
+namespace {
+
+// Single-label and .local names are served by the hosts file and mDNS; a DNS
+// NXDOMAIN says nothing about them.
+bool dnsIsAuthority(const QString& name) {
+    return name.contains(QLatin1Char('.')) && !name.endsWith(QLatin1String(".local"), Qt::CaseInsensitive);
+}
+
+} // namespace
+
+SystemResolverBackend::SystemResolverBackend(QObject* parent)
+        : IResolverBackend(parent) {}
+
+void SystemResolverBackend::resolve(const QString& name) {
+    QHostAddress literal;
+    if (literal.setAddress(name)) {
+        DnsAnswer a;
+        a.status = DnsAnswer::Status::Ok;
+        a.addresses.push_back(literal);
+        a.ttlSec = kLiteralTtlSec;
+        QTimer::singleShot(0, this, [this, name, a]{ emit resolved(name, a); });
+        return;
+    }
+
+    struct Pending {
+        int outstanding = 2;
+        QList<QHostAddress> v4, v6;
+        quint32 ttl = 0;
+        bool haveTtl = false;
+        bool transportError = false;      // не NXDOMAIN/NODATA: сервер не ответил по существу
+        QString errorString;
+    };
+    auto pending = std::make_shared<Pending>();
+
+    for (const auto type : {QDnsLookup::A, QDnsLookup::AAAA}) {
+        auto* lookup = new QDnsLookup(type, name, this);
+        QObject::connect(lookup, &QDnsLookup::finished, this, [this, name, lookup, pending]{
+            if (lookup->error() == QDnsLookup::NoError) {
+                for (const auto& rec : lookup->hostAddressRecords()) {
+                    auto& list = (lookup->type() == QDnsLookup::A) ? pending->v4 : pending->v6;
+                    list.push_back(rec.value());
+                    pending->ttl = pending->haveTtl ? qMin(pending->ttl, rec.timeToLive()) : rec.timeToLive();
+                    pending->haveTtl = true;
+                }
+            } else {
+                if (lookup->error() != QDnsLookup::NotFoundError) pending->transportError = true;
+                pending->errorString = lookup->errorString();
+            }
+            lookup->deleteLater();
+            if (--pending->outstanding > 0) return;
+
+            if (pending->v4.isEmpty() && pending->v6.isEmpty()) {
+                // The hosts file and search domains are only known to the system
+                // resolver, so by default it gets asked after an NXDOMAIN too.
+                if (pending->transportError || !nxDomainFinal_ || !dnsIsAuthority(name)) {
+                    fallback_(name);
+                    return;
+                }
+                DnsAnswer a;
+                a.status = DnsAnswer::Status::NxDomain;
+                a.errorString = pending->errorString.isEmpty()
+                        ? QStringLiteral("Host %1 has no address records").arg(name)
+                        : pending->errorString;
+                emit resolved(name, a);
+                return;
+            }
+            DnsAnswer a;
+            a.status = DnsAnswer::Status::Ok;
+            a.addresses = pending->v4 + pending->v6;
+            a.ttlSec = pending->ttl;
+            emit resolved(name, a);
+        });
+        lookup->lookup();
+    }
+}
+
+void SystemResolverBackend::fallback_(const QString& name) {
+    // DNS could not be asked, or the name is not its to answer. The system resolver
+    // still knows about the hosts file and mDNS.
+    QHostInfo::lookupHost(name, this, [this, name](const QHostInfo& info){
+        DnsAnswer a;
+        if (info.error() == QHostInfo::NoError && !info.addresses().isEmpty()) {
+            a.status = DnsAnswer::Status::Ok;
+            a.addresses = info.addresses();
+            a.ttlSec = kFallbackTtlSec;
+        } else {
+            a.status = (info.error() == QHostInfo::HostNotFound) ? DnsAnswer::Status::NxDomain
+                                                                 : DnsAnswer::Status::ServFail;
+            a.errorString = info.errorString();
+        }
+        emit resolved(name, a);
+    });
+}
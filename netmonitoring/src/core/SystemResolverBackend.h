@@ -0,0 +1,27 @@
+#pragma once
+#include "IResolverBackend.h"
+
+// Resolves through QDnsLookup (A + AAAA) to get record TTLs. Names DNS gives no
+// address for fall back to QHostInfo with a fixed TTL: it also knows the hosts
+// file, search domains and mDNS. With setNxDomainFinal(true) an NXDOMAIN for a
+// dotted, non-.local name is taken as is, which saves the second query for names
+// that do not exist; transport errors (no server, timeout, unsupported platform)
+// still fall back.
+class SystemResolverBackend : public IResolverBackend {
+    Q_OBJECT
+public:
+    static constexpr quint32 kFallbackTtlSec = 60;
+    static constexpr quint32 kLiteralTtlSec = 86400;
+
+    explicit SystemResolverBackend(QObject* parent = nullptr);
+
+    void setNxDomainFinal(bool on) { nxDomainFinal_ = on; }
+    bool nxDomainFinal() const { return nxDomainFinal_; }
+
+    void resolve(const QString& name) override;
+
+private:
+    void fallback_(const QString& name);
+
+    bool nxDomainFinal_ = false;
+};
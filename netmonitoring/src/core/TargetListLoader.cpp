@@ -0,0 +1,480 @@
+#include "TargetListLoader.h"
+#include "ProbeScript.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSet>
+#include <QStringList>
+
+namespace {
+
+constexpr qint64 kChunkBytes = 64 * 1024;
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
+constexpr auto kSkipEmpty = Qt::SkipEmptyParts;
+#else
+constexpr auto kSkipEmpty = QString::SkipEmptyParts;
+#endif
+
+bool parseBool(const QString& v, bool* out) {
+    const QString s = v.trimmed().toLower();
+    if (s == QLatin1String("1") || s == QLatin1String("true") || s == QLatin1String("yes")) { *out = true; return true; }
+    if (s == QLatin1String("0") || s == QLatin1String("false") || s == QLatin1String("no")) { *out = false; return true; }
+    return false;
+}
+
+bool parseInt(const QString& v, int min, int* out) {
+    bool ok = false;
+    const int n = v.trimmed().toInt(&ok);
+    if (!ok || n < min) return false;
+    *out = n;
+    return true;
+}
+
+// Splits one CSV record; double quotes protect commas, "" is a literal quote
+QStringList splitCsv(const QString& line) {
+    QStringList cells;
+    QString cell;
+    bool quoted = false;
+    for (int i = 0; i < line.size(); ++i) {
+        const QChar c = line.at(i);
+        if (quoted) {
+            if (c == '"') {
+                if (i + 1 < line.size() && line.at(i + 1) == '"') { cell += '"'; ++i; }
+                else quoted = false;
+            } else {
+                cell += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            cells.push_back(cell.trimmed());
+            cell.clear();
+        } else {
+            cell += c;
+        }
+    }
+    cells.push_back(cell.trimmed());
+    return cells;
+}
+
+// Feeds the file to `fn` line by line (without the line break), one chunk at a time.
+// Stops early and returns false when fn does.
+template <typename Fn>
+bool forEachLine(QFile& f, qint64* bytes, Fn fn) {
+    QByteArray chunk(int(kChunkBytes), Qt::Uninitialized);
+    QByteArray carry;                     // начало строки, не уместившейся в прошлый кусок
+    int lineNo = 0;
+    for (;;) {
+        const qint64 n = f.read(chunk.data(), kChunkBytes);
+        if (n < 0) return false;
+        if (n == 0) break;
+        *bytes += n;
+        const char* p = chunk.constData();
+        qint64 start = 0;
+        for (qint64 i = 0; i < n; ++i) {
+            if (p[i] != '\n') continue;
+            QByteArray line;
+            if (carry.isEmpty()) {
+                line = QByteArray::fromRawData(p + start, int(i - start));
+            } else {
+                carry.append(p + start, int(i - start));
+                line.swap(carry);
+            }
+            if (line.endsWith('\r')) line.chop(1);
+            if (!fn(line, ++lineNo)) return false;
+            start = i + 1;
+        }
+        carry.append(p + start, int(n - start));
+    }
+    if (carry.endsWith('\r')) carry.chop(1);
+    return carry.isEmpty() || fn(carry, ++lineNo);
+}
+
+// Cuts a JSON array of objects, or a stream of objects (JSON Lines), into one
+// buffer per object without building the whole document.
+class JsonObjectSplitter {
+public:
+    // Calls fn(objectBytes, firstLine) for each complete object in [p, p + n)
+    template <typename Fn>
+    bool feed(const char* p, qint64 n, QString* error, Fn fn) {
+        qint64 from = collecting_ ? 0 : -1;
+        for (qint64 i = 0; i < n; ++i) {
+            const char c = p[i];
+            if (c == '\n') ++line_;
+            if (inString_) {
+                if (escape_) escape_ = false;
+                else if (c == '\\') escape_ = true;
+                else if (c == '"') inString_ = false;
+                continue;
+            }
+            switch (c) {
+                case '"':
+                    if (!collecting_) return fail_(error, "string outside an object");
+                    inString_ = true;
+                    break;
+                case '[':
+                    if (!collecting_) {
+                        if (started_) return fail_(error, "nested array outside an object");
+                        array_ = true;
+                        started_ = true;
+                    }
+                    ++depth_;
+                    break;
+                case '{':
+                    if (!collecting_) {
+                        collecting_ = true;
+                        started_ = true;
+                        from = i;
+                        objLine_ = line_;
+                        obj_.clear();
+                    }
+                    ++depth_;
+                    break;
+                case '}':
+                case ']':
+                    if (--depth_ < 0) return fail_(error, "unbalanced brackets");
+                    if (collecting_ && depth_ == (array_ ? 1 : 0)) {
+                        if (c != '}') return fail_(error, "unbalanced brackets");
+                        obj_.append(p + from, int(i + 1 - from));
+                        collecting_ = false;
+                        from = -1;
+                        if (!fn(obj_, objLine_)) return false;
+                    }
+                    break;
+                case ' ': case '\t': case '\r': case '\n': case ',':
+                    break;
+                default:
+                    if (!collecting_) return fail_(error, "unexpected character");
+                    break;
+            }
+        }
+        if (collecting_ && from >= 0) obj_.append(p + from, int(n - from));
+        return true;
+    }
+
+    bool finish(QString* error) {
+        if (collecting_ || inString_ || depth_ != 0) return fail_(error, "unexpected end of file");
+        return true;
+    }
+
+private:
+    bool fail_(QString* error, const char* what) {
+        *error = QStringLiteral("line %1: %2").arg(line_).arg(QLatin1String(what));
+        return false;
+    }
+
+    QByteArray obj_;
+    int depth_ = 0;
+    int line_ = 1;
+    int objLine_ = 1;
+    bool inString_ = false;
+    bool escape_ = false;
+    bool array_ = false;
+    bool started_ = false;
+    bool collecting_ = false;
+};
+
+QString jsonValueText(const QJsonValue& v, bool* ok) {
+    *ok = true;
+    switch (v.type()) {
+        case QJsonValue::String: return v.toString();
+        case QJsonValue::Bool:   return v.toBool() ? QStringLiteral("true") : QStringLiteral("false");
+        case QJsonValue::Double: return QString::number(v.toDouble(), 'g', 15);
+        case QJsonValue::Null:   return QString();
+        default:                 *ok = false; return QString();
+    }
+}
+
+// http-multi paths, every one absolute
+bool setPaths(ProbeTarget* t, const QStringList& paths) {
+    for (const QString& p : paths) {
+        if (!p.startsWith('/')) return false;
+    }
+    t->paths = paths;
+    return true;
+}
+
+// A JSON array is taken item by item, so a path may hold commas and spaces
+bool setPathsJson(ProbeTarget* t, const QJsonArray& array) {
+    QStringList paths;
+    for (const QJsonValue& item : array) {
+        if (!item.isString()) return false;
+        paths << item.toString();
+    }
+    return setPaths(t, paths);
+}
+
+TargetListLoader::Format sniff(const QString& path, QFile& f) {
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == QLatin1String("json") || suffix == QLatin1String("jsonl") || suffix == QLatin1String("ndjson")) {
+        return TargetListLoader::Format::Json;
+    }
+    if (suffix == QLatin1String("csv")) return TargetListLoader::Format::Csv;
+    const QByteArray head = f.peek(4096);
+    for (char c : head) {
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') continue;
+        return (c == '[' || c == '{') ? TargetListLoader::Format::Json : TargetListLoader::Format::Text;
+    }
+    return TargetListLoader::Format::Text;
+}
+
+} // namespace
+
+bool TargetListLoader::parseSpec(const QString& spec, ProbeTarget* target) {
+    const QString s = spec.trimmed();
+    if (s.isEmpty()) return false;
+
+    QString host = s;
+    QString port;
+    if (s.startsWith('[')) {
+        const int close = int(s.indexOf(']'));
+        if (close < 0) return false;
+        host = s.mid(1, close - 1);
+        if (close + 1 < s.size()) {
+            if (s.at(close + 1) != ':') return false;
+            port = s.mid(close + 2);
+        }
+    } else if (s.count(':') == 1) {
+        const int colon = int(s.indexOf(':'));
+        host = s.left(colon);
+        port = s.mid(colon + 1);
+    }
+
+    if (host.isEmpty()) return false;
+    if (!port.isEmpty()) {
+        bool ok = false;
+        const uint p = port.toUInt(&ok);
+        if (!ok || p == 0 || p > 65535) return false;
+        target->port = static_cast<quint16>(p);
+    }
+    target->host = host;
+    return true;
+}
+
+bool TargetListLoader::setField(ProbeTarget* t, const QString& name, const QString& value) {
+    auto is = [&name](const char* field) { return name.compare(QLatin1String(field), Qt::CaseInsensitive) == 0; };
+    const bool empty = value.trimmed().isEmpty();
+    int n = 0;
+    bool b = false;
+
+    if (is("host")) {
+        if (!empty) t->host = value.trimmed();
+        return true;
+    }
+    if (is("target")) return empty || parseSpec(value, t);
+    if (is("port")) {
+        if (empty) return true;
+        if (!parseInt(value, 1, &n) || n > 65535) return false;
+        t->port = static_cast<quint16>(n);
+        return true;
+    }
+    if (is("mode")) return empty || parseProbeMode(value, &t->mode);
+    if (is("interval")) {
+        // Seconds, as the CLI's --interval
+        if (empty) return true;
+        bool ok = false;
+        const double sec = value.trimmed().toDouble(&ok);
+        if (!ok || sec <= 0) return false;
+        t->intervalMs = qMax(1, int(sec * 1000));
+        return true;
+    }
+
+    struct IntField { const char* name; int ProbeTarget::* field; int min; };
+    static const IntField ints[] = {
+        {"intervalMs", &ProbeTarget::intervalMs, 1},
+        {"timeoutMs", &ProbeTarget::timeoutMs, 1},
+        {"timeout", &ProbeTarget::timeoutMs, 1},
+        {"minIntervalMs", &ProbeTarget::minIntervalMs, 0},
+        {"maxIntervalMs", &ProbeTarget::maxIntervalMs, 0},
+        {"maxAddresses", &ProbeTarget::maxAddresses, 0},
+        {"udpPackets", &ProbeTarget::udpPackets, 1},
+        {"udpSpacingMs", &ProbeTarget::udpSpacingMs, 0},
+        {"httpConnections", &ProbeTarget::httpConnections, 1},
+    };
+    for (const auto& f : ints) {
+        if (!is(f.name)) continue;
+        if (empty) return true;
+        if (!parseInt(value, f.min, &n)) return false;
+        t->*f.field = n;
+        return true;
+    }
+
+    struct BoolField { const char* name; bool ProbeTarget::* field; };
+    static const BoolField bools[] = {
+        {"keepAlive", &ProbeTarget::keepAlive},
+        {"adaptive", &ProbeTarget::adaptive},
+        {"tlsResume", &ProbeTarget::tlsResume},
+        {"tlsInsecure", &ProbeTarget::tlsInsecure},
+    };
+    for (const auto& f : bools) {
+        if (!is(f.name)) continue;
+        if (empty) return true;
+        if (!parseBool(value, &b)) return false;
+        t->*f.field = b;
+        return true;
+    }
+
+    if (is("udpQuery")) {
+        t->udpQuery = value.trimmed();
+        return true;
+    }
+    if (is("paths")) {
+        // "/a,/b" or "/a /b"; JSON lists come as arrays (setPathsJson)
+        if (empty) return true;
+        return setPaths(t, value.split(QRegularExpression(QStringLiteral("[,\\s]+")), kSkipEmpty));
+    }
+    if (is("script")) {
+        // Checked here, so a typo fails the load instead of every probe
+        ProbeScript script;
+        if (!empty && !ProbeScript::parse(value, &script)) return false;
+        t->script = value.trimmed();
+        return true;
+    }
+    return false;
+}
+
+bool TargetListLoader::load(const QString& path, const ProbeTarget& defaults, Result* out, QString* error,
+                            Format format) {
+    QElapsedTimer elapsed;
+    elapsed.start();
+    *out = Result();
+
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error) *error = QStringLiteral("%1: %2").arg(path, f.errorString());
+        return false;
+    }
+    if (format == Format::Auto) format = sniff(path, f);
+
+    QSet<QString> seen;
+    auto add = [out, &seen](const ProbeTarget& t) {
+        const QString key = probeTargetKey(t);
+        if (seen.contains(key)) {
+            ++out->duplicates;
+            return;
+        }
+        seen.insert(key);
+        out->targets.push_back(t);
+    };
+
+    QString why;
+    int whyLine = 0;
+    bool ok = true;
+
+    if (format == Format::Json) {
+        JsonObjectSplitter splitter;
+        QByteArray chunk(int(kChunkBytes), Qt::Uninitialized);
+        for (;;) {
+            const qint64 n = f.read(chunk.data(), kChunkBytes);
+            if (n < 0) { why = f.errorString(); ok = false; break; }
+            if (n == 0) { ok = splitter.finish(&why); break; }
+            out->bytes += n;
+            ok = splitter.feed(chunk.constData(), n, &why, [&](const QByteArray& bytes, int line){
+                QJsonParseError perr;
+                const QJsonDocument doc = QJsonDocument::fromJson(bytes, &perr);
+                if (!doc.isObject()) {
+                    why = QStringLiteral("line %1: %2").arg(line).arg(perr.errorString());
+                    return false;
+                }
+                const QJsonObject o = doc.object();
+                ProbeTarget t = defaults;
+                t.host.clear();
+                for (auto it = o.constBegin(); it != o.constEnd(); ++it) {
+                    bool valueOk = false;
+                    if (it.value().isArray()) {
+                        valueOk = it.key().compare(QLatin1String("paths"), Qt::CaseInsensitive) == 0
+                                  && setPathsJson(&t, it.value().toArray());
+                    } else {
+                        const QString text = jsonValueText(it.value(), &valueOk);
+                        valueOk = valueOk && setField(&t, it.key(), text);
+                    }
+                    if (!valueOk) {
+                        why = QStringLiteral("line %1: bad field \"%2\"").arg(line).arg(it.key());
+                        return false;
+                    }
+                }
+                if (t.host.isEmpty()) {
+                    why = QStringLiteral("line %1: entry without host").arg(line);
+                    return false;
+                }
+                add(t);
+                return true;
+            });
+            if (!ok) break;
+        }
+    } else if (format == Format::Csv) {
+        QStringList columns;
+        ok = forEachLine(f, &out->bytes, [&](const QByteArray& raw, int lineNo){
+            whyLine = lineNo;
+            const QString line = QString::fromUtf8(raw);
+            const QString trimmed = line.trimmed();
+            if (trimmed.isEmpty() || trimmed.startsWith('#')) return true;
+            const QStringList cells = splitCsv(line);
+            if (columns.isEmpty()) {
+                ProbeTarget probe;
+                for (const QString& c : cells) {
+                    if (!setField(&probe, c, QString())) {
+                        why = QStringLiteral("unknown column \"%1\"").arg(c);
+                        return false;
+                    }
+                }
+                columns = cells;
+                return true;
+            }
+            if (cells.size() > columns.size()) {
+                why = QStringLiteral("%1 cells for %2 columns").arg(cells.size()).arg(columns.size());
+                return false;
+            }
+            ProbeTarget t = defaults;
+            t.host.clear();
+            for (int i = 0; i < cells.size(); ++i) {
+                if (!setField(&t, columns.at(i), cells.at(i))) {
+                    why = QStringLiteral("bad %1 \"%2\"").arg(columns.at(i), cells.at(i));
+                    return false;
+                }
+            }
+            if (t.host.isEmpty()) {
+                why = QStringLiteral("row without host");
+                return false;
+            }
+            add(t);
+            return true;
+        });
+        if (!ok && why.isEmpty()) why = f.errorString();
+    } else {
+        ok = forEachLine(f, &out->bytes, [&](const QByteArray& raw, int lineNo){
+            whyLine = lineNo;
+            QString line = QString::fromUtf8(raw);
+            const int hash = int(line.indexOf('#'));
+            if (hash >= 0) line.truncate(hash);
+            const QStringList parts = line.simplified().split(' ', kSkipEmpty);
+            if (parts.isEmpty()) return true;
+
+            ProbeTarget t = defaults;
+            bool lineOk = parts.size() <= 2 && parseSpec(parts.at(0), &t);
+            if (lineOk && parts.size() > 1) lineOk = parseProbeMode(parts.at(1), &t.mode);
+            if (!lineOk) {
+                why = QStringLiteral("bad target line");
+                return false;
+            }
+            add(t);
+            return true;
+        });
+        if (!ok && why.isEmpty()) why = f.errorString();
+    }
+
+    out->elapsedMs = elapsed.elapsed();
+    if (!ok) {
+        if (error) {
+            *error = whyLine > 0 ? QStringLiteral("%1:%2: %3").arg(path).arg(whyLine).arg(why)
+                                 : QStringLiteral("%1: %2").arg(path, why);
+        }
+        return false;
+    }
+    return true;
+}
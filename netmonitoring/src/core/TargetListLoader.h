@@ -0,0 +1,36 @@
+#pragma once
+#include <QString>
+#include <QVector>
+#include "ProbeTarget.h"
+
+// Streams a target list from disk: the file is read in fixed-size chunks and never
+// held whole, so lists of 100k entries load in a fraction of a second. Formats, by
+// extension or else by the first non-blank byte:
+//  - JSON: an array of objects, or one object per line (JSON Lines);
+//  - CSV: a header row naming the columns, then one target per row;
+//  - text: "host[:port] [mode]" per line.
+// JSON keys and CSV columns are ProbeTarget field names (host, port, mode,
+// intervalMs, timeoutMs, keepAlive, adaptive, script, paths, ...); "interval" is
+// also accepted in seconds and "target" as host[:port], and "paths" as a JSON
+// array or a comma-separated list. Whatever an entry leaves out comes from
+// `defaults`. Repeated entries (same probeTargetKey) keep the first occurrence.
+class TargetListLoader {
+public:
+    enum class Format { Auto, Json, Csv, Text };
+
+    struct Result {
+        QVector<ProbeTarget> targets;
+        int duplicates = 0;               // отброшенные повторы
+        qint64 bytes = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    static bool load(const QString& path, const ProbeTarget& defaults, Result* out, QString* error,
+                     Format format = Format::Auto);
+
+    // "host", "host:port", "[v6addr]:port"; without a port the target keeps its own
+    static bool parseSpec(const QString& spec, ProbeTarget* target);
+    // One field by its list name; an empty value leaves the field as it is.
+    // False for an unknown name or a bad value.
+    static bool setField(ProbeTarget* target, const QString& name, const QString& value);
+};
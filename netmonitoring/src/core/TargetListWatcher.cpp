@@ -0,0 +1,47 @@
+#include "TargetListWatcher.h"
+#include <QFileInfo>
+#include "TargetListLoader.h"
+
+TargetListWatcher::TargetListWatcher(MonitorController* controller, const QString& path,
+                                     const ProbeTarget& defaults, QObject* parent)
+        : QObject(parent)
+        , controller_(controller)
+        , path_(QFileInfo(path).absoluteFilePath())
+        , defaults_(defaults) {
+    settle_.setSingleShot(true);
+    settle_.setInterval(kSettleMs);
+    QObject::connect(&settle_, &QTimer::timeout, this, &TargetListWatcher::onSettled_);
+    QObject::connect(&watcher_, &QFileSystemWatcher::fileChanged, this, &TargetListWatcher::onChanged_);
+    QObject::connect(&watcher_, &QFileSystemWatcher::directoryChanged, this, &TargetListWatcher::onChanged_);
+}
+
+bool TargetListWatcher::reload(QString* error) {
+    const QFileInfo info(path_);
+    TargetListLoader::Result list;
+    if (!TargetListLoader::load(path_, defaults_, &list, error)) return false;
+    loadedMtime_ = info.lastModified();
+    loadedSize_ = info.size();
+    const MonitorController::ReloadStats stats = controller_->applyTargetList(list.targets);
+    emit reloaded(stats, list.duplicates, list.elapsedMs);
+    return true;
+}
+
+void TargetListWatcher::watch() {
+    watcher_.addPath(QFileInfo(path_).absolutePath());
+    watcher_.addPath(path_);
+}
+
+void TargetListWatcher::onChanged_() {
+    // After a rename-over-save the watch is gone while the path exists again
+    if (!watcher_.files().contains(path_) && QFileInfo::exists(path_)) watcher_.addPath(path_);
+    settle_.start();
+}
+
+void TargetListWatcher::onSettled_() {
+    const QFileInfo info(path_);
+    if (!info.exists()) return;           // посреди замены файла; дождёмся появления
+    // The directory fires for its other files too
+    if (info.lastModified() == loadedMtime_ && info.size() == loadedSize_) return;
+    QString error;
+    if (!reload(&error)) emit failed(error);
+}
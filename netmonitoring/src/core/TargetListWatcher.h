@@ -0,0 +1,43 @@
+#pragma once
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QTimer>
+#include "MonitorController.h"
+
+// Keeps a MonitorController in step with a target list file (TargetListLoader
+// formats). Every reload is applied as a diff, so targets that did not change keep
+// probing without a gap. Editors that save by renaming a new file over the old one
+// drop the file watch, hence the directory is watched too and the file re-added;
+// bursts of change events collapse into one reload after a short quiet period.
+// A list that fails to load leaves the running targets as they are.
+class TargetListWatcher : public QObject {
+    Q_OBJECT
+public:
+    TargetListWatcher(MonitorController* controller, const QString& path, const ProbeTarget& defaults,
+                      QObject* parent = nullptr);
+
+    QString path() const { return path_; }
+    // Loads the file and applies it now
+    bool reload(QString* error);
+    // Reload on every change of the file from here on
+    void watch();
+
+signals:
+    void reloaded(const MonitorController::ReloadStats& stats, int duplicates, qint64 elapsedMs);
+    void failed(const QString& error);
+
+private:
+    static constexpr int kSettleMs = 250;        // тишина после последнего изменения
+
+    void onChanged_();
+    void onSettled_();
+
+    MonitorController* controller_;
+    QString path_;
+    ProbeTarget defaults_;
+    QFileSystemWatcher watcher_;
+    QTimer settle_;
+    QDateTime loadedMtime_;               // чем был файл при последней загрузке
+    qint64 loadedSize_ = -1;
+};
@@ -1,4 +1,5 @@
 #include "TcpConnectProbe.h"
+#include "DnsCache.h"
 #include <QHostAddress>
 
 TcpConnectProbe::TcpConnectProbe(QObject* parent)
@@ -8,10 +9,11 @@ TcpConnectProbe::TcpConnectProbe(QObject* parent)
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
     QObject::connect(&socket_, &QTcpSocket::connected, this, [this]{
         if (!active_) return;
+        connectedNs_ = elapsed_.nsecsElapsed();
         ProbeResult r;
         r.status = ProbeResult::Status::Up;
         r.latencyMs = elapsed_.elapsed();
-        r.dnsMs = dnsElapsed_.isValid() ? dnsElapsed_.elapsed() : -1;
+        r.dnsMs = dnsMs_;
         r.ip = ip_;
         finish_(r);
     });
@@ -22,17 +24,18 @@ TcpConnectProbe::TcpConnectProbe(QObject* parent)
         ProbeResult r;
         r.status = ProbeResult::Status::Down;
         r.message = socket_.errorString();
-        r.dnsMs = dnsElapsed_.isValid() ? dnsElapsed_.elapsed() : -1;
+        r.dnsMs = dnsMs_;
         r.ip = ip_;
         finish_(r);
     });
 #else
     QObject::connect(&socket_, SIGNAL(connected()), this, [this]{
         if (!active_) return;
+        connectedNs_ = elapsed_.nsecsElapsed();
         ProbeResult r;
         r.status = ProbeResult::Status::Up;
         r.latencyMs = elapsed_.elapsed();
-        r.dnsMs = dnsElapsed_.isValid() ? dnsElapsed_.elapsed() : -1;
+        r.dnsMs = dnsMs_;
         r.ip = ip_;
         finish_(r);
     });
@@ -41,7 +44,7 @@ TcpConnectProbe::TcpConnectProbe(QObject* parent)
         ProbeResult r;
         r.status = ProbeResult::Status::Down;
         r.message = socket_.errorString();
-        r.dnsMs = dnsElapsed_.isValid() ? dnsElapsed_.elapsed() : -1;
+        r.dnsMs = dnsMs_;
         r.ip = ip_;
         finish_(r);
     });
@@ -52,7 +55,7 @@ TcpConnectProbe::TcpConnectProbe(QObject* parent)
         ProbeResult r;
         r.status = ProbeResult::Status::Timeout;
         r.message = tr("Timeout");
-        r.dnsMs = dnsElapsed_.isValid() ? dnsElapsed_.elapsed() : -1;
+        r.dnsMs = dnsMs_;
         r.ip = ip_;
         finish_(r);
     });
@@ -70,31 +73,39 @@ void TcpConnectProbe::start(const QString& host, quint16 port, int timeoutMs) {
 
     active_ = true;
     ip_.clear();
+    dnsMs_ = -1;
+    dnsCached_ = false;
+    dnsNs_ = connectStartNs_ = connectedNs_ = -1;
     elapsed_.restart();
     dnsElapsed_.restart();
 
     timeout_.start(timeoutMs_);
 
     QPointer<TcpConnectProbe> self(this);
-    QHostInfo::lookupHost(host_, this, [this, self](const QHostInfo& info){
-        if (!self || !active_) return;
-        if (info.error() != QHostInfo::NoError || info.addresses().isEmpty()) {
+    const quint64 run = ++run_;
+    DnsCache::instance().lookup(host_, this, [this, self, run](const DnsAnswer& answer, bool fromCache){
+        if (!self || !active_ || run != run_) return;
+        dnsCached_ = fromCache;
+        if (answer.status != DnsAnswer::Status::Ok || answer.addresses.isEmpty()) {
             ProbeResult r;
             r.status = ProbeResult::Status::DnsFail;
-            r.message = info.errorString();
+            r.message = answer.errorString;
             r.dnsMs = -1;
             finish_(r);
             return;
         }
         QHostAddress addr;
-        for (const auto& a : info.addresses()) {
+        for (const auto& a : answer.addresses) {
             if (a.protocol() == QAbstractSocket::IPv4Protocol) { addr = a; break; }
         }
-        if (addr.isNull()) addr = info.addresses().first();
+        if (addr.isNull()) addr = answer.addresses.first();
         ip_ = addr.toString();
-        emit progressDnsResolved(dnsElapsed_.elapsed(), ip_);
+        dnsNs_ = dnsElapsed_.nsecsElapsed();
+        dnsMs_ = dnsNs_ / 1000000;
+        emit progressDnsResolved(dnsMs_, ip_);
 
         socket_.abort();
+        connectStartNs_ = elapsed_.nsecsElapsed();
         socket_.connectToHost(addr, port_);
     });
 }
@@ -106,7 +117,11 @@ void TcpConnectProbe::abort() {
     socket_.abort();
 }
 
-void TcpConnectProbe::finish_(const ProbeResult& r) {
+void TcpConnectProbe::finish_(ProbeResult r) {
+    r.dnsCached = dnsCached_;
+    r.phases.dnsUs = dnsNs_ >= 0 ? dnsNs_ / 1000 : -1;
+    r.phases.connectUs = (connectStartNs_ >= 0 && connectedNs_ >= 0) ? (connectedNs_ - connectStartNs_) / 1000 : -1;
+    r.phases.totalUs = elapsed_.nsecsElapsed() / 1000;
     active_ = false;
     timeout_.stop();
     socket_.abort();
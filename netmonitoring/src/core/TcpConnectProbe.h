@@ -3,7 +3,6 @@
 #include <QTcpSocket>
 #include <QTimer>
 #include <QElapsedTimer>
-#include <QHostInfo>
 #include <QPointer>
 
 class TcpConnectProbe : public INetProbe {
@@ -17,7 +16,7 @@ public:
 
 private:
     void reset_();
-    void finish_(const ProbeResult& r);
+    void finish_(ProbeResult r);
 
     QTcpSocket socket_;
     QTimer timeout_;
@@ -28,5 +27,13 @@ private:
     quint16 port_ = 0;
     int timeoutMs_ = 3000;
     QString ip_;
+    qint64 dnsMs_ = -1;
+    bool dnsCached_ = false;
+
+    // Отметки фаз, нс от начала проверки; -1 — событие не наступило
+    qint64 dnsNs_ = -1;
+    qint64 connectStartNs_ = -1;
+    qint64 connectedNs_ = -1;
     bool active_ = false;
+    quint64 run_ = 0;                     // номер запуска: отсекает колбэки прошлых запусков
 };
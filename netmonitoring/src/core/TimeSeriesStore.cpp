@@ -0,0 +1,477 @@
+#include "TimeSeriesStore.h"
+#include "TsSegmentTier.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr int kBlockRecords = 128;                // записей в блоке raw-сегмента
+constexpr int kWakeBatch = 4096;                  // будить писателя раньше таймаута
+constexpr int kWriterTickMs = 1000;
+constexpr qint64 kMaintenanceMs = 60 * 1000;
+constexpr qint64 kRollGraceMs = 60 * 1000;        // запаздывающие записи после конца интервала
+constexpr qint64 kMinuteMs = 60 * 1000;
+constexpr qint64 kHourMs = 3600 * 1000;
+constexpr qint64 kMinuteSpanMs = 86400 * 1000LL;  // сегмент минутных агрегатов — сутки
+constexpr qint64 kHourSpanMs = 30 * 86400 * 1000LL;
+
+qint64 nowMs() {
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+qint64 floorTo(qint64 ms, qint64 step) {
+    return (ms / step) * step;
+}
+
+bool byTime(const TsRecord& a, const TsRecord& b) { return a.tsMs < b.tsMs; }
+bool byBucket(const TsRollup& a, const TsRollup& b) { return a.bucketMs < b.bucketMs; }
+
+} // namespace
+
+TimeSeriesStore::TimeSeriesStore() = default;
+
+TimeSeriesStore::~TimeSeriesStore() {
+    close();
+}
+
+bool TimeSeriesStore::open(const QString& dir, QString* error) {
+    close();
+    dir_ = dir;
+    if (opts_.readOnly ? !QDir(dir_).exists() : !QDir().mkpath(dir_)) {
+        if (error) *error = QString::fromLatin1(opts_.readOnly ? "no history in %1" : "cannot create %1").arg(dir_);
+        return false;
+    }
+    if (!loadSeries_(error)) return false;
+
+    const qint64 span = qMax(kHourMs, floorTo(opts_.rawSpanMs, kHourMs));
+    const bool ro = opts_.readOnly;
+    raw_ = std::make_unique<TsSegmentTier>(dir_ + QStringLiteral("/raw"), int(sizeof(TsRecord)), span, ro);
+    minute_ = std::make_unique<TsSegmentTier>(dir_ + QStringLiteral("/1m"), int(sizeof(TsRollup)), kMinuteSpanMs, ro);
+    hour_ = std::make_unique<TsSegmentTier>(dir_ + QStringLiteral("/1h"), int(sizeof(TsRollup)), kHourSpanMs, ro);
+    if (!raw_->open(error) || !minute_->open(error) || !hour_->open(error)) {
+        raw_.reset();
+        minute_.reset();
+        hour_.reset();
+        return false;
+    }
+
+    // Rollups may outlive the raw segments they came from, so look at both.
+    rolledUntilMs_ = 0;
+    for (qint64 start : raw_->sealedSegments()) {
+        if (raw_->isRolled(start)) rolledUntilMs_ = qMax(rolledUntilMs_, raw_->segmentEnd(start));
+    }
+    const QVector<qint64> minutes = minute_->sealedSegments();
+    if (!minutes.isEmpty()) {
+        const qint64 newest = minute_->segmentMaxMs(minutes.last());
+        rolledUntilMs_ = qMax(rolledUntilMs_, floorTo(newest, span) + span);
+    }
+    curSpanMs_ = -1;
+
+    {
+        QMutexLocker lock(&inboxMutex_);
+        stop_ = false;
+        flushRequested_ = flushDone_ = 0;
+    }
+    open_ = true;
+    // A reader leaves rollups and retention to the process that writes the history.
+    if (!opts_.readOnly) worker_ = std::thread([this]{ run_(); });
+    return true;
+}
+
+void TimeSeriesStore::close() {
+    if (!open_) return;
+    open_ = false;
+    {
+        QMutexLocker lock(&inboxMutex_);
+        stop_ = true;
+        wake_.wakeAll();
+    }
+    if (worker_.joinable()) worker_.join();
+
+    QMutexLocker lock(&dataMutex_);
+    raw_->close();
+    minute_->close();
+    hour_->close();
+    raw_.reset();
+    minute_.reset();
+    hour_.reset();
+    buffers_.clear();
+}
+
+bool TimeSeriesStore::loadSeries_(QString* error) {
+    QMutexLocker lock(&seriesMutex_);
+    series_.clear();
+    nextSeries_ = 1;
+    QFile f(dir_ + QStringLiteral("/series.tsv"));
+    if (!f.exists()) return true;
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (error) *error = f.errorString();
+        return false;
+    }
+    QTextStream in(&f);
+    QString line;
+    while (in.readLineInto(&line)) {
+        const int tab = int(line.indexOf('\t'));
+        if (tab <= 0) continue;
+        bool ok = false;
+        const quint32 id = line.left(tab).toUInt(&ok);
+        if (!ok || id == 0) continue;
+        series_.insert(line.mid(tab + 1), id);
+        nextSeries_ = qMax(nextSeries_, id + 1);
+    }
+    return true;
+}
+
+quint32 TimeSeriesStore::seriesId(const QString& key) {
+    QMutexLocker lock(&seriesMutex_);
+    auto it = series_.constFind(key);
+    if (it != series_.constEnd()) return it.value();
+
+    const quint32 id = nextSeries_++;
+    series_.insert(key, id);
+    if (!dir_.isEmpty() && !opts_.readOnly) {
+        // Rare (new target), so a synchronous append is fine here.
+        QFile f(dir_ + QStringLiteral("/series.tsv"));
+        if (f.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+            f.write(QStringLiteral("%1\t%2\n").arg(id).arg(key).toUtf8());
+        }
+    }
+    return id;
+}
+
+quint32 TimeSeriesStore::findSeries(const QString& key) const {
+    QMutexLocker lock(&seriesMutex_);
+    return series_.value(key, 0);
+}
+
+QString TimeSeriesStore::seriesKey(const ProbeTarget& target) {
+    return QStringLiteral("%1://%2:%3").arg(QString::fromLatin1(probeModeName(target.mode)), target.host)
+            .arg(target.port);
+}
+
+TsRecord TimeSeriesStore::toRecord(const ProbeResult& r, qint64 tsMs) {
+    TsRecord rec{};
+    rec.tsMs = tsMs;
+    qint64 us = -1;
+    if (r.latencyNs >= 0) us = r.latencyNs / 1000;
+    else if (r.latencyMs >= 0) us = r.latencyMs * 1000;
+    rec.latencyUs = qint32(qMin<qint64>(us, std::numeric_limits<qint32>::max()));
+    rec.httpCode = r.httpCode ? quint16(qBound(0, *r.httpCode, 65535)) : 0;
+    rec.status = quint8(r.status);
+    rec.flags = quint8((r.dnsCached ? TsRecord::DnsCached : 0) | (r.phases.reusedConnection ? TsRecord::ReusedConnection : 0));
+    return rec;
+}
+
+TsRecord TimeSeriesStore::toRecord(const ProbeRecord& r) {
+    TsRecord rec{};
+    rec.tsMs = r.finishedMs;
+    rec.latencyUs = qint32(qMin<qint64>(r.latencyUs(), std::numeric_limits<qint32>::max()));
+    rec.httpCode = r.httpCode > 0 ? quint16(r.httpCode) : 0;
+    rec.status = r.status;
+    rec.flags = quint8(((r.flags & ProbeRecord::DnsCached) ? TsRecord::DnsCached : 0)
+                       | ((r.flags & ProbeRecord::ReusedConnection) ? TsRecord::ReusedConnection : 0));
+    return rec;
+}
+
+void TimeSeriesStore::append(quint32 series, const ProbeResult& r, qint64 tsMs) {
+    if (!open_ || series == 0) return;
+    enqueue_(series, toRecord(r, tsMs >= 0 ? tsMs : nowMs()));
+}
+
+void TimeSeriesStore::append(quint32 series, const ProbeRecord& r) {
+    if (!open_ || series == 0) return;
+    enqueue_(series, toRecord(r));
+}
+
+void TimeSeriesStore::enqueue_(quint32 series, const TsRecord& rec) {
+    QMutexLocker lock(&inboxMutex_);
+    if (opts_.readOnly || int(inbox_.size()) >= opts_.maxPending) {
+        ++dropped_;
+        return;
+    }
+    inbox_.push_back(Pending{series, rec});
+    ++appended_;
+    if (inbox_.size() == size_t(kWakeBatch)) wake_.wakeOne();
+}
+
+void TimeSeriesStore::flush() {
+    if (!open_ || opts_.readOnly) return;
+    QMutexLocker lock(&inboxMutex_);
+    const quint64 ticket = ++flushRequested_;
+    wake_.wakeAll();
+    while (flushDone_ < ticket && !stop_) flushed_.wait(&inboxMutex_);
+}
+
+void TimeSeriesStore::run_() {
+    qint64 lastFlush = nowMs();
+    qint64 lastMaintenance = 0;
+    for (;;) {
+        std::vector<Pending> batch;
+        quint64 flushTicket = 0;
+        bool stop = false;
+        {
+            QMutexLocker lock(&inboxMutex_);
+            if (inbox_.empty() && !stop_ && flushRequested_ == flushDone_) wake_.wait(&inboxMutex_, kWriterTickMs);
+            batch.swap(inbox_);
+            flushTicket = flushRequested_;
+            stop = stop_;
+        }
+        ingest_(batch);
+
+        const qint64 now = nowMs();
+        const bool flushWanted = stop || flushTicket != flushDone_;
+        if (flushWanted || now - lastFlush >= opts_.flushIntervalMs) {
+            QMutexLocker lock(&dataMutex_);
+            flushBuffers_();
+            lastFlush = now;
+        }
+        if (!stop && now - lastMaintenance >= kMaintenanceMs) {
+            maintain_(now);
+            lastMaintenance = now;
+        }
+        if (flushWanted) {
+            QMutexLocker lock(&inboxMutex_);
+            flushDone_ = flushTicket;
+            flushed_.wakeAll();
+        }
+        if (stop) break;
+    }
+}
+
+void TimeSeriesStore::ingest_(std::vector<Pending>& batch) {
+    if (batch.empty()) return;
+    QMutexLocker lock(&dataMutex_);
+    const qint64 span = raw_->spanMs();
+    for (const Pending& p : batch) {
+        const qint64 seg = floorTo(p.rec.tsMs, span);
+        // A new interval starts: push out everything of the previous one so that
+        // each raw segment holds its own interval only and can be rolled up whole.
+        if (seg > curSpanMs_) {
+            if (curSpanMs_ >= 0) flushBuffers_();
+            curSpanMs_ = seg;
+        }
+        Buffer& buf = buffers_[p.series];
+        if (!buf.recs.empty() && buf.segStartMs != seg) writeBuffer_(p.series, buf);
+        if (buf.recs.empty()) {
+            buf.segStartMs = seg;
+            buf.recs.reserve(kBlockRecords);
+        }
+        buf.recs.push_back(p.rec);
+        if (int(buf.recs.size()) >= kBlockRecords) writeBuffer_(p.series, buf);
+    }
+}
+
+void TimeSeriesStore::writeBuffer_(quint32 series, Buffer& buf) {
+    if (buf.recs.empty()) return;
+    qint64 first = buf.recs.front().tsMs;
+    qint64 last = first;
+    for (const TsRecord& r : buf.recs) {
+        first = qMin(first, r.tsMs);
+        last = qMax(last, r.tsMs);
+    }
+    const bool ok = raw_->appendBlock(series, reinterpret_cast<const char*>(buf.recs.data()),
+                                      int(buf.recs.size()), first, last);
+    {
+        QMutexLocker lock(&statsMutex_);
+        if (ok) {
+            stats_.written += buf.recs.size();
+            ++stats_.blocks;
+        } else {
+            ++stats_.writeErrors;
+        }
+    }
+    buf.recs.clear();
+}
+
+void TimeSeriesStore::flushBuffers_() {
+    for (auto& kv : buffers_) writeBuffer_(kv.first, kv.second);
+}
+
+void TimeSeriesStore::maintain_(qint64 now) {
+    QVector<qint64> sealed;
+    {
+        QMutexLocker lock(&dataMutex_);
+        // No probes for a whole interval: close the segment so it can be rolled up.
+        if (curSpanMs_ >= 0 && raw_->segmentEnd(curSpanMs_) + kRollGraceMs <= now) {
+            flushBuffers_();
+            raw_->sealActive();
+            curSpanMs_ = -1;
+        }
+        sealed = raw_->sealedSegments();
+    }
+
+    for (qint64 start : sealed) {
+        bool due = false;
+        {
+            QMutexLocker lock(&dataMutex_);
+            due = !raw_->isRolled(start) && raw_->segmentEnd(start) + kRollGraceMs <= now;
+        }
+        if (due) rollSegment_(start);
+    }
+
+    QMutexLocker lock(&dataMutex_);
+    raw_->dropOlderThan(now - opts_.rawRetentionMs, true);
+    if (opts_.minuteRetentionMs > 0) minute_->dropOlderThan(now - opts_.minuteRetentionMs, false);
+    if (opts_.hourRetentionMs > 0) hour_->dropOlderThan(now - opts_.hourRetentionMs, false);
+}
+
+void TimeSeriesStore::rollSegment_(qint64 startMs) {
+    QVector<quint32> ids;
+    {
+        QMutexLocker lock(&dataMutex_);
+        ids = raw_->seriesIn(startMs);
+    }
+
+    std::vector<TsRecord> recs;
+    std::vector<TsRollup> minutes;
+    std::vector<TsRollup> hours;
+    for (quint32 id : ids) {
+        // One series at a time: queries get the lock in between.
+        QMutexLocker lock(&dataMutex_);
+        recs.clear();
+        raw_->scanSegment(startMs, id, [&recs](const char* data, int n){
+            const auto* r = reinterpret_cast<const TsRecord*>(data);
+            recs.insert(recs.end(), r, r + n);
+        });
+        if (!std::is_sorted(recs.begin(), recs.end(), byTime)) std::stable_sort(recs.begin(), recs.end(), byTime);
+
+        minutes.clear();
+        hours.clear();
+        aggregate_(recs.data(), int(recs.size()), kMinuteMs, minutes);
+        merge_(minutes, kHourMs, hours);
+        appendRollups_(*minute_, id, minutes);
+        appendRollups_(*hour_, id, hours);
+    }
+
+    QMutexLocker lock(&dataMutex_);
+    raw_->setRolled(startMs);
+    rolledUntilMs_ = qMax(rolledUntilMs_, raw_->segmentEnd(startMs));
+    QMutexLocker statsLock(&statsMutex_);
+    ++stats_.rolledSegments;
+}
+
+void TimeSeriesStore::appendRollups_(TsSegmentTier& tier, quint32 series, const std::vector<TsRollup>& rows) {
+    for (size_t i = 0; i < rows.size(); i += kBlockRecords) {
+        const int n = int(qMin<size_t>(kBlockRecords, rows.size() - i));
+        if (!tier.appendBlock(series, reinterpret_cast<const char*>(rows.data() + i), n,
+                              rows[i].bucketMs, rows[i + n - 1].bucketMs)) {
+            QMutexLocker lock(&statsMutex_);
+            ++stats_.writeErrors;
+        }
+    }
+}
+
+void TimeSeriesStore::aggregate_(const TsRecord* recs, int n, qint64 bucketMs, std::vector<TsRollup>& out) {
+    for (int i = 0; i < n; ++i) {
+        const TsRecord& r = recs[i];
+        const qint64 bucket = floorTo(r.tsMs, bucketMs);
+        if (out.empty() || out.back().bucketMs != bucket) out.push_back(TsRollup{bucket, 0, 0, 0, -1, -1, 0, 0});
+        TsRollup& row = out.back();
+        ++row.count;
+        if (r.status != quint8(ProbeResult::Status::Up)) continue;
+        ++row.up;
+        if (r.latencyUs < 0) continue;
+        ++row.samples;
+        row.minUs = row.minUs < 0 ? r.latencyUs : qMin(row.minUs, r.latencyUs);
+        row.maxUs = qMax(row.maxUs, r.latencyUs);
+        row.sumUs += r.latencyUs;
+    }
+}
+
+void TimeSeriesStore::merge_(const std::vector<TsRollup>& in, qint64 bucketMs, std::vector<TsRollup>& out) {
+    for (const TsRollup& r : in) {
+        const qint64 bucket = floorTo(r.bucketMs, bucketMs);
+        if (out.empty() || out.back().bucketMs != bucket) out.push_back(TsRollup{bucket, 0, 0, 0, -1, -1, 0, 0});
+        TsRollup& row = out.back();
+        row.count += r.count;
+        row.up += r.up;
+        row.samples += r.samples;
+        row.sumUs += r.sumUs;
+        if (r.minUs >= 0) row.minUs = row.minUs < 0 ? r.minUs : qMin(row.minUs, r.minUs);
+        row.maxUs = qMax(row.maxUs, r.maxUs);
+    }
+}
+
+QVector<TsRecord> TimeSeriesStore::queryRaw(quint32 series, qint64 fromMs, qint64 toMs) const {
+    QVector<TsRecord> out;
+    {
+        QMutexLocker lock(&dataMutex_);
+        if (!raw_) return out;
+        raw_->scan(series, fromMs, toMs, [&out, fromMs, toMs](const char* data, int n){
+            const auto* r = reinterpret_cast<const TsRecord*>(data);
+            for (int i = 0; i < n; ++i) {
+                if (r[i].tsMs >= fromMs && r[i].tsMs <= toMs) out.push_back(r[i]);
+            }
+        });
+        // Records still waiting for a full block
+        auto buf = buffers_.find(series);
+        if (buf != buffers_.end()) {
+            for (const TsRecord& r : buf->second.recs) {
+                if (r.tsMs >= fromMs && r.tsMs <= toMs) out.push_back(r);
+            }
+        }
+    }
+    if (!std::is_sorted(out.begin(), out.end(), byTime)) std::stable_sort(out.begin(), out.end(), byTime);
+    return out;
+}
+
+QVector<TsRollup> TimeSeriesStore::queryRollup(quint32 series, Resolution res, qint64 fromMs, qint64 toMs) const {
+    if (res == Resolution::Raw) return {};
+    const qint64 bucketMs = res == Resolution::Minute ? kMinuteMs : kHourMs;
+
+    std::vector<TsRollup> rows;
+    qint64 split = 0;
+    {
+        QMutexLocker lock(&dataMutex_);
+        if (!raw_) return {};
+        split = rolledUntilMs_;
+        const TsSegmentTier& tier = res == Resolution::Minute ? *minute_ : *hour_;
+        const qint64 from = floorTo(fromMs, bucketMs);
+        if (from < split) {
+            const qint64 to = qMin(toMs, split - 1);
+            tier.scan(series, from, to, [&rows, from, to](const char* data, int n){
+                const auto* r = reinterpret_cast<const TsRollup*>(data);
+                for (int i = 0; i < n; ++i) {
+                    if (r[i].bucketMs >= from && r[i].bucketMs <= to) rows.push_back(r[i]);
+                }
+            });
+        }
+    }
+
+    // The tail that has not been rolled up yet is aggregated from raw records.
+    if (toMs >= split) {
+        const QVector<TsRecord> tail = queryRaw(series, qMax(fromMs, split), toMs);
+        aggregate_(tail.constData(), tail.size(), bucketMs, rows);
+    }
+
+    if (!std::is_sorted(rows.begin(), rows.end(), byBucket)) std::stable_sort(rows.begin(), rows.end(), byBucket);
+    // Late blocks can split one bucket into several rows.
+    std::vector<TsRollup> merged;
+    merged.reserve(rows.size());
+    merge_(rows, bucketMs, merged);
+    return QVector<TsRollup>(merged.begin(), merged.end());
+}
+
+TimeSeriesStore::Stats TimeSeriesStore::stats() const {
+    Stats s;
+    {
+        QMutexLocker lock(&statsMutex_);
+        s = stats_;
+    }
+    {
+        QMutexLocker lock(&inboxMutex_);
+        s.appended = appended_;
+        s.dropped = dropped_;
+    }
+    {
+        QMutexLocker lock(&dataMutex_);
+        if (raw_) s.bytesOnDisk = raw_->bytesOnDisk() + minute_->bytesOnDisk() + hour_->bytesOnDisk();
+    }
+    QMutexLocker lock(&seriesMutex_);
+    s.series = series_.size();
+    return s;
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include <QtGlobal>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ProbeRecord.h"
+#include "ProbeResult.h"
+#include "ProbeTarget.h"
+
+class TsSegmentTier;
+
+// One probe result on disk
+struct TsRecord {
+    enum Flags : quint8 { DnsCached = 0x1, ReusedConnection = 0x2 };
+
+    qint64 tsMs;                          // время завершения, мс от эпохи
+    qint32 latencyUs;                     // -1 — нет задержки
+    quint16 httpCode;                     // 0 — не HTTP
+    quint8 status;                        // ProbeResult::Status
+    quint8 flags;
+};
+static_assert(sizeof(TsRecord) == 16, "TsRecord must stay compact");
+
+// Aggregate over one minute or one hour; avg latency = sumUs / samples. An UP
+// result without a latency counts in `up` but not in `samples`.
+struct TsRollup {
+    qint64 bucketMs;                      // начало интервала
+    quint32 count;
+    quint32 up;
+    quint32 samples;                      // UP с задержкой: в min/max/sumUs
+    qint32 minUs;                         // -1, если samples == 0
+    qint32 maxUs;
+    quint32 reserved;                     // 0, выравнивание sumUs
+    qint64 sumUs;
+};
+static_assert(sizeof(TsRollup) == 40, "TsRollup must stay compact");
+
+// Persistent probe history. Results are kept as compact binary records in
+// segmented, memory-mapped files (raw tier), with background rollups into
+// per-minute and per-hour tiers and per-tier retention.
+//  - append() only queues the record: a writer thread buffers records per series
+//    and writes them as blocks, so the probe path never touches the disk;
+//  - every segment indexes its blocks per series, so a range query reads only
+//    the blocks of one target that overlap the range;
+//  - rollup queries cover the not yet rolled-up tail by aggregating raw records.
+// Series ids are stable across restarts (see seriesId()).
+class TimeSeriesStore {
+public:
+    enum class Resolution { Raw, Minute, Hour };
+
+    struct Options {
+        qint64 rawSpanMs = 3600 * 1000LL;                   // один raw-сегмент — час (кратно часу)
+        qint64 rawRetentionMs = 7 * 86400 * 1000LL;
+        qint64 minuteRetentionMs = 90 * 86400 * 1000LL;
+        qint64 hourRetentionMs = 0;                         // 0 — хранить всегда
+        int flushIntervalMs = 30000;                        // неполные блоки пишутся не реже
+        int maxPending = 1 << 20;                           // сверх этого новые записи теряются
+        bool readOnly = false;                              // только запросы: без записи, свёрток и удаления
+    };
+
+    struct Stats {
+        quint64 appended = 0;
+        quint64 dropped = 0;              // очередь переполнена
+        quint64 written = 0;              // записей на диске (raw)
+        quint64 blocks = 0;
+        quint64 rolledSegments = 0;
+        quint64 writeErrors = 0;
+        int series = 0;
+        quint64 bytesOnDisk = 0;
+    };
+
+    TimeSeriesStore();
+    ~TimeSeriesStore();
+
+    void setOptions(const Options& opts) { opts_ = opts; }   // before open()
+    bool open(const QString& dir, QString* error);
+    void close();
+    bool isOpen() const { return open_; }
+    QString dir() const { return dir_; }
+
+    // Stable id for a key like "tcp://host:80"; new keys are registered on disk
+    quint32 seriesId(const QString& key);
+    quint32 findSeries(const QString& key) const;     // 0 — ключ неизвестен; ничего не регистрирует
+    static QString seriesKey(const ProbeTarget& target);
+
+    // Never blocks on I/O; safe from any thread
+    void append(quint32 series, const ProbeResult& r, qint64 tsMs = -1);
+    void append(quint32 series, const ProbeRecord& r);
+    void flush();                         // waits until queued records are on disk
+
+    QVector<TsRecord> queryRaw(quint32 series, qint64 fromMs, qint64 toMs) const;
+    QVector<TsRollup> queryRollup(quint32 series, Resolution res, qint64 fromMs, qint64 toMs) const;
+
+    Stats stats() const;
+
+    static TsRecord toRecord(const ProbeResult& r, qint64 tsMs);
+    static TsRecord toRecord(const ProbeRecord& r);
+
+private:
+    struct Pending {
+        quint32 series;
+        TsRecord rec;
+    };
+
+    struct Buffer {
+        std::vector<TsRecord> recs;
+        qint64 segStartMs = 0;
+    };
+
+    void run_();
+    void ingest_(std::vector<Pending>& batch);
+    void writeBuffer_(quint32 series, Buffer& buf);
+    void flushBuffers_();
+    void maintain_(qint64 nowMs);
+    void rollSegment_(qint64 startMs);
+    void enqueue_(quint32 series, const TsRecord& rec);
+    void appendRollups_(TsSegmentTier& tier, quint32 series, const std::vector<TsRollup>& rows);
+    bool loadSeries_(QString* error);
+    static void aggregate_(const TsRecord* recs, int n, qint64 bucketMs, std::vector<TsRollup>& out);
+    static void merge_(const std::vector<TsRollup>& in, qint64 bucketMs, std::vector<TsRollup>& out);
+
+    Options opts_;
+    QString dir_;
+
+    // Probe-path queue
+    mutable QMutex inboxMutex_;
+    QWaitCondition wake_;
+    QWaitCondition flushed_;
+    std::vector<Pending> inbox_;
+    quint64 flushRequested_ = 0;
+    quint64 flushDone_ = 0;
+    quint64 appended_ = 0;
+    quint64 dropped_ = 0;
+    bool stop_ = false;
+    std::atomic<bool> open_{false};
+    std::thread worker_;
+
+    // Tiers and per-series write buffers; the writer and queries take this lock
+    mutable QMutex dataMutex_;
+    std::unique_ptr<TsSegmentTier> raw_;
+    std::unique_ptr<TsSegmentTier> minute_;
+    std::unique_ptr<TsSegmentTier> hour_;
+    std::unordered_map<quint32, Buffer> buffers_;
+    qint64 rolledUntilMs_ = 0;            // всё раньше уже есть в минутных/часовых агрегатах
+    qint64 curSpanMs_ = -1;               // raw-интервал, в который идут свежие записи
+
+    mutable QMutex seriesMutex_;
+    QHash<QString, quint32> series_;
+    quint32 nextSeries_ = 1;
+
+    mutable QMutex statsMutex_;
+    Stats stats_;
+};
@@ -0,0 +1,75 @@
+#include "TimingWheel.h"
+
+TimingWheel::TimingWheel(int tickMs, int slotCount, QObject* parent)
+        : QObject(parent)
+        , tickMs_(qMax(1, tickMs)) {
+    slots_.resize(qMax(1, slotCount));
+    clock_.start();
+    timer_.setTimerType(Qt::PreciseTimer);
+    timer_.setInterval(tickMs_);
+    QObject::connect(&timer_, &QTimer::timeout, this, &TimingWheel::onTick_);
+}
+
+void TimingWheel::schedule(quint32 id, qint64 delayMs) {
+    const qint64 ticks = (qMax<qint64>(0, delayMs) + tickMs_ - 1) / tickMs_;
+    const qint64 deadline = qMax(cursor_ + 1, nowTick_() + ticks);
+    const quint32 gen = ++nextGen_;
+    live_.insert(id, gen);
+    slots_[int(deadline % slots_.size())].push_back(Entry{id, gen, deadline});
+}
+
+void TimingWheel::cancel(quint32 id) {
+    // Stale entries stay in their slot and are dropped when the slot comes round.
+    live_.remove(id);
+}
+
+void TimingWheel::clear() {
+    live_.clear();
+    for (auto& slot : slots_) slot.clear();
+}
+
+void TimingWheel::start() {
+    if (timer_.isActive()) return;
+    timer_.start();
+}
+
+void TimingWheel::stop() {
+    timer_.stop();
+}
+
+qint64 TimingWheel::nowTick_() const {
+    return clock_.elapsed() / tickMs_;
+}
+
+void TimingWheel::onTick_() {
+    // A late timer catches up on every missed tick; a full turn covers all slots.
+    const qint64 now = nowTick_();
+    if (now <= cursor_) return;
+    const qint64 steps = qMin<qint64>(now - cursor_, slots_.size());
+
+    for (qint64 i = 1; i <= steps; ++i) {
+        auto& slot = slots_[int((cursor_ + i) % slots_.size())];
+        for (int k = 0; k < slot.size();) {
+            const Entry e = slot[k];
+            auto it = live_.find(e.id);
+            const bool stale = (it == live_.end() || it.value() != e.gen);
+            if (stale || e.deadline <= now) {
+                if (!stale) {
+                    due_.push_back(e.id);
+                    live_.erase(it);
+                }
+                slot[k] = slot.last();
+                slot.removeLast();
+                continue;
+            }
+            ++k;
+        }
+    }
+    cursor_ = now;
+
+    if (!due_.isEmpty()) {
+        QVector<quint32> batch;
+        batch.swap(due_);
+        emit expired(batch);
+    }
+}
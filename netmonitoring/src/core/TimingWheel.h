@@ -0,0 +1,47 @@
+#pragma once
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QHash>
+
+// Hashed timing wheel: a single QTimer drives any number of per-id deadlines.
+// Deadlines are tracked in ticks; ids due in the same tick are reported as one batch.
+class TimingWheel : public QObject {
+    Q_OBJECT
+public:
+    explicit TimingWheel(int tickMs = 10, int slotCount = 512, QObject* parent = nullptr);
+
+    void schedule(quint32 id, qint64 delayMs);   // replaces a pending deadline for the same id
+    void cancel(quint32 id);
+    void clear();
+
+    void start();
+    void stop();
+    bool isActive() const { return timer_.isActive(); }
+
+    int tickMs() const { return tickMs_; }
+    int size() const { return live_.size(); }
+
+signals:
+    void expired(const QVector<quint32>& ids);
+
+private:
+    struct Entry {
+        quint32 id;
+        quint32 gen;
+        qint64 deadline;                  // в тиках от создания колеса
+    };
+
+    void onTick_();
+    qint64 nowTick_() const;
+
+    int tickMs_;
+    QVector<QVector<Entry>> slots_;
+    QHash<quint32, quint32> live_;        // id -> актуальное поколение записи
+    quint32 nextGen_ = 0;
+    qint64 cursor_ = 0;                   // последний обработанный тик
+    QElapsedTimer clock_;
+    QTimer timer_;
+    QVector<quint32> due_;
+};
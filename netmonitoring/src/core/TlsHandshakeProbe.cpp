@@ -0,0 +1,257 @@
+#include "TlsHandshakeProbe.h"
+#include "TlsSessionCache.h"
+#include "DnsCache.h"
+#include <QDateTime>
+#include <QSslCertificate>
+#include <QSslCipher>
+#include <QSslConfiguration>
+
+#ifndef QT_NO_SSL
+
+namespace {
+
+// How long a finished probe keeps its connection open for a TLS 1.3 ticket, which
+// the server sends after the handshake.
+constexpr int kTicketWaitMs = 500;
+
+// QSslSocket does not say whether the server took the offered session. Either of
+// two traces shows it did: the socket still holds the session it was given, or the
+// server sent no chain (a restored session carries the peer certificate, not the
+// chain). A full handshake leaves neither.
+bool sessionResumed(const QSslSocket& s, const QByteArray& offered) {
+    if (offered.isEmpty()) return false;
+    if (s.sslConfiguration().sessionTicket() == offered) return true;
+    return !s.peerCertificate().isNull() && s.peerCertificateChain().isEmpty();
+}
+
+} // namespace
+
+QString TlsHandshakeProbe::protocolName(QSsl::SslProtocol p) {
+    switch (p) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        case QSsl::TlsV1_3: return QStringLiteral("TLSv1.3");
+#endif
+        case QSsl::TlsV1_2: return QStringLiteral("TLSv1.2");
+#if QT_VERSION < QT_VERSION_CHECK(6, 3, 0)
+        case QSsl::TlsV1_1: return QStringLiteral("TLSv1.1");
+        case QSsl::TlsV1_0: return QStringLiteral("TLSv1.0");
+#endif
+        default:            return QStringLiteral("unknown");
+    }
+}
+
+TlsHandshakeProbe::TlsHandshakeProbe(QObject* parent)
+        : INetProbe(parent) {
+    timeout_.setSingleShot(true);
+    QObject::connect(&timeout_, &QTimer::timeout, this, [this]{
+        if (!active_) return;
+        ProbeResult r;
+        r.status = ProbeResult::Status::Timeout;
+        r.message = connectedNs_ >= 0 ? tr("TLS handshake timeout") : tr("Timeout");
+        r.dnsMs = dnsMs_;
+        r.ip = ip_;
+        finish_(r);
+    });
+}
+
+TlsHandshakeProbe::~TlsHandshakeProbe() {
+    abort();
+}
+
+void TlsHandshakeProbe::configure(const ProbeTarget& target) {
+    resume_ = target.tlsResume;
+    insecure_ = target.tlsInsecure;
+}
+
+void TlsHandshakeProbe::start(const QString& host, quint16 port, int timeoutMs) {
+    if (active_) return;
+    host_ = host;
+    port_ = port;
+    timeoutMs_ = timeoutMs;
+    sessionKey_ = QStringLiteral("%1:%2").arg(host_.toLower()).arg(port_);
+
+    active_ = true;
+    ip_.clear();
+    verifyError_.clear();
+    resumeOffered_ = false;
+    offered_.clear();
+    dnsMs_ = -1;
+    dnsCached_ = false;
+    dnsNs_ = connectStartNs_ = connectedNs_ = encryptedNs_ = -1;
+    elapsed_.restart();
+    timeout_.start(timeoutMs_);
+
+    QPointer<TlsHandshakeProbe> self(this);
+    const quint64 run = ++run_;
+    DnsCache::instance().lookup(host_, this, [this, self, run](const DnsAnswer& answer, bool fromCache){
+        if (!self || !active_ || run != run_) return;
+        dnsCached_ = fromCache;
+        if (answer.status != DnsAnswer::Status::Ok || answer.addresses.isEmpty()) {
+            ProbeResult r;
+            r.status = ProbeResult::Status::DnsFail;
+            r.message = answer.errorString;
+            finish_(r);
+            return;
+        }
+        QHostAddress addr;
+        for (const auto& a : answer.addresses) {
+            if (a.protocol() == QAbstractSocket::IPv4Protocol) { addr = a; break; }
+        }
+        if (addr.isNull()) addr = answer.addresses.first();
+        ip_ = addr.toString();
+        dnsNs_ = elapsed_.nsecsElapsed();
+        dnsMs_ = dnsNs_ / 1000000;
+        emit progressDnsResolved(dnsMs_, ip_);
+
+        connect_(addr);
+    });
+}
+
+void TlsHandshakeProbe::connect_(const QHostAddress& addr) {
+    dropSocket_();
+    // A fresh socket per probe: QSslSocket keeps session state between connections.
+    socket_ = new QSslSocket(this);
+
+    QSslConfiguration cfg = socket_->sslConfiguration();
+    cfg.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    if (resume_) {
+        const QByteArray ticket = TlsSessionCache::instance().lookup(sessionKey_);
+        if (!ticket.isEmpty()) {
+            cfg.setSessionTicket(ticket);
+            resumeOffered_ = true;
+            offered_ = ticket;
+        }
+    }
+    socket_->setSslConfiguration(cfg);
+    // We connect to the resolved IP; SNI and verification use the name.
+    socket_->setPeerVerifyName(host_);
+
+    QSslSocket* s = socket_;
+    QObject::connect(s, &QSslSocket::connected, this, [this, s]{
+        if (!active_ || s != socket_) return;
+        connectedNs_ = elapsed_.nsecsElapsed();
+        s->startClientEncryption();
+    });
+    QObject::connect(s, &QSslSocket::encrypted, this, [this, s]{
+        if (!active_ || s != socket_) return;
+        onEncrypted_();
+    });
+    QObject::connect(s, qOverload<const QList<QSslError>&>(&QSslSocket::sslErrors), this,
+                     [this, s](const QList<QSslError>& errors){
+        if (!active_ || s != socket_) return;
+        // Finish the handshake anyway so it gets timed; the verdict comes in onEncrypted_().
+        if (verifyError_.isEmpty() && !errors.isEmpty()) verifyError_ = errors.first().errorString();
+        s->ignoreSslErrors();
+    });
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    QObject::connect(s, &QSslSocket::errorOccurred, this, [this, s](QAbstractSocket::SocketError){
+        if (!active_ || s != socket_) return;
+        onError_();
+    });
+#else
+    QObject::connect(s, qOverload<QAbstractSocket::SocketError>(&QAbstractSocket::error), this,
+                     [this, s](QAbstractSocket::SocketError){
+        if (!active_ || s != socket_) return;
+        onError_();
+    });
+#endif
+
+    connectStartNs_ = elapsed_.nsecsElapsed();
+    s->connectToHost(addr, port_);
+}
+
+void TlsHandshakeProbe::onEncrypted_() {
+    encryptedNs_ = elapsed_.nsecsElapsed();
+    QSslSocket* s = socket_;
+
+    ProbeResult r;
+    r.dnsMs = dnsMs_;
+    r.ip = ip_;
+    r.latencyNs = encryptedNs_ - connectStartNs_;
+    r.latencyMs = r.latencyNs / 1000000;
+
+    ProbeResult::TlsInfo tls;
+    tls.protocol = protocolName(s->sessionProtocol());
+    tls.cipher = s->sessionCipher().name();
+    tls.resumeOffered = resumeOffered_;
+    tls.resumed = sessionResumed(*s, offered_);
+    const QSslCertificate cert = s->peerCertificate();
+    if (!cert.isNull()) tls.certNotAfterMs = cert.expiryDate().toMSecsSinceEpoch();
+    tls.verifyError = verifyError_;
+    r.tls = tls;
+
+    if (verifyError_.isEmpty() || insecure_) {
+        r.status = ProbeResult::Status::Up;
+    } else {
+        r.status = ProbeResult::Status::Down;
+        r.message = tr("Certificate: %1").arg(verifyError_);
+    }
+
+    if (resume_) {
+        // TLS 1.2 tickets are known now; a TLS 1.3 server sends one right after the
+        // handshake, so the connection stays open a little longer to catch it.
+        const QSslConfiguration cfg = s->sslConfiguration();
+        TlsSessionCache::instance().store(sessionKey_, cfg.sessionTicket(), cfg.sessionTicketLifeTimeHint());
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+        QObject::disconnect(s, nullptr, this, nullptr);
+        socket_ = nullptr;
+        const QString key = sessionKey_;
+        QObject::connect(s, &QSslSocket::newSessionTicketReceived, s, [s, key]{
+            const QSslConfiguration c = s->sslConfiguration();
+            TlsSessionCache::instance().store(key, c.sessionTicket(), c.sessionTicketLifeTimeHint());
+            s->abort();
+            s->deleteLater();
+        });
+        QObject::connect(s, &QSslSocket::disconnected, s, &QObject::deleteLater);
+        QTimer::singleShot(kTicketWaitMs, s, [s]{
+            s->abort();
+            s->deleteLater();
+        });
+#endif
+    }
+    finish_(r);
+}
+
+void TlsHandshakeProbe::onError_() {
+    QSslSocket* s = socket_;
+    ProbeResult r;
+    r.dnsMs = dnsMs_;
+    r.ip = ip_;
+    r.status = ProbeResult::Status::Down;
+    if (connectedNs_ >= 0) {
+        // A rejected or stale ticket must not break every following probe.
+        if (resumeOffered_) TlsSessionCache::instance().remove(sessionKey_);
+        r.message = tr("TLS: %1").arg(s->errorString());
+    } else {
+        r.message = s->errorString();
+    }
+    finish_(r);
+}
+
+void TlsHandshakeProbe::dropSocket_() {
+    if (!socket_) return;
+    QObject::disconnect(socket_, nullptr, this, nullptr);
+    socket_->abort();
+    socket_->deleteLater();
+    socket_ = nullptr;
+}
+
+void TlsHandshakeProbe::abort() {
+    if (!active_) return;
+    active_ = false;
+    timeout_.stop();
+    dropSocket_();
+}
+
+void TlsHandshakeProbe::finish_(ProbeResult r) {
+    r.dnsCached = dnsCached_;
+    PhaseTimings& p = r.phases;
+    p.dnsUs = dnsNs_ >= 0 ? dnsNs_ / 1000 : -1;
+    p.connectUs = connectedNs_ >= 0 ? (connectedNs_ - connectStartNs_) / 1000 : -1;
+    p.tlsUs = encryptedNs_ >= 0 ? (encryptedNs_ - connectedNs_) / 1000 : -1;
+    p.totalUs = elapsed_.nsecsElapsed() / 1000;
+    abort();
+    emit finished(r);
+}
+
+#endif // QT_NO_SSL
@@ -0,0 +1,64 @@
+#pragma once
+#include "INetProbe.h"
+#include <QPointer>
+#include <QSslSocket>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#ifndef QT_NO_SSL
+
+// TCP connect followed by a TLS handshake on a QSslSocket, timed separately
+// (phases.connectUs, phases.tlsUs). latencyMs/Ns is connect + handshake, the time
+// to a usable secure channel. ProbeResult::tls carries the negotiated protocol
+// and cipher, the certificate expiry, whether a saved session was offered and
+// whether the server resumed it.
+// With tlsResume the session ticket of the previous handshake to the same
+// endpoint comes from TlsSessionCache, so repeat probes time the resumed
+// handshake. A certificate that fails verification makes the probe DOWN unless
+// tlsInsecure is set; the handshake is timed either way.
+class TlsHandshakeProbe : public INetProbe {
+    Q_OBJECT
+public:
+    explicit TlsHandshakeProbe(QObject* parent = nullptr);
+    ~TlsHandshakeProbe() override;
+
+    void start(const QString& host, quint16 port, int timeoutMs) override;
+    void abort() override;
+    void configure(const ProbeTarget& target) override;
+
+    static QString protocolName(QSsl::SslProtocol p);   // TLSv1.3, TLSv1.2, ...
+
+private:
+    void connect_(const QHostAddress& addr);
+    void onEncrypted_();
+    void onError_();
+    void dropSocket_();
+    void finish_(ProbeResult r);
+
+    QPointer<QSslSocket> socket_;
+    QTimer timeout_;
+    QElapsedTimer elapsed_;
+
+    QString host_;
+    quint16 port_ = 0;
+    int timeoutMs_ = 3000;
+    bool resume_ = true;
+    bool insecure_ = false;
+    QString sessionKey_;                  // host:port в TlsSessionCache
+    bool resumeOffered_ = false;
+    QByteArray offered_;                  // предложенная сессия, для сравнения после рукопожатия
+    QString verifyError_;
+    QString ip_;
+    qint64 dnsMs_ = -1;
+    bool dnsCached_ = false;
+    bool active_ = false;
+    quint64 run_ = 0;                     // номер запуска: отсекает колбэки прошлых запусков
+
+    // Отметки фаз, нс от начала проверки; -1 — событие не наступило
+    qint64 dnsNs_ = -1;
+    qint64 connectStartNs_ = -1;
+    qint64 connectedNs_ = -1;
+    qint64 encryptedNs_ = -1;
+};
+
+#endif // QT_NO_SSL
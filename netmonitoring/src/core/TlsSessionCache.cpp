@@ -0,0 +1,81 @@
+#include "TlsSessionCache.h"
+
+namespace {
+
+// No hint from the server: RFC 5077 suggests tickets are good for hours.
+constexpr int kDefaultLifetimeSec = 2 * 3600;
+// TLS 1.3 caps ticket lifetime at seven days (RFC 8446, 4.6.1)
+constexpr int kMaxLifetimeSec = 7 * 24 * 3600;
+
+} // namespace
+
+TlsSessionCache& TlsSessionCache::instance() {
+    static TlsSessionCache cache;
+    return cache;
+}
+
+TlsSessionCache::TlsSessionCache() {
+    clock_.start();
+}
+
+QByteArray TlsSessionCache::lookup(const QString& key) {
+    QMutexLocker lock(&mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        ++stats_.misses;
+        return {};
+    }
+    const qint64 now = clock_.elapsed();
+    if (it->expiresAtMs <= now) {
+        entries_.erase(it);
+        ++stats_.misses;
+        return {};
+    }
+    it->usedAtMs = now;
+    ++stats_.hits;
+    return it->ticket;
+}
+
+void TlsSessionCache::store(const QString& key, const QByteArray& ticket, int lifetimeHintSec) {
+    if (ticket.isEmpty()) return;
+    const int lifetime = lifetimeHintSec > 0 ? qMin(lifetimeHintSec, kMaxLifetimeSec) : kDefaultLifetimeSec;
+
+    QMutexLocker lock(&mutex_);
+    const qint64 now = clock_.elapsed();
+    if (!entries_.contains(key) && entries_.size() >= capacity_) {
+        // Full: a linear scan is fine, it only runs when a new endpoint shows up.
+        auto victim = entries_.begin();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->expiresAtMs <= now) { victim = it; break; }
+            if (it->usedAtMs < victim->usedAtMs) victim = it;
+        }
+        if (victim != entries_.end()) entries_.erase(victim);
+    }
+    Entry& e = entries_[key];
+    e.ticket = ticket;
+    e.expiresAtMs = now + qint64(lifetime) * 1000;
+    e.usedAtMs = now;
+    ++stats_.stored;
+}
+
+void TlsSessionCache::remove(const QString& key) {
+    QMutexLocker lock(&mutex_);
+    entries_.remove(key);
+}
+
+void TlsSessionCache::clear() {
+    QMutexLocker lock(&mutex_);
+    entries_.clear();
+}
+
+void TlsSessionCache::setCapacity(int entries) {
+    QMutexLocker lock(&mutex_);
+    capacity_ = qMax(1, entries);
+}
+
+TlsSessionCache::Stats TlsSessionCache::stats() const {
+    QMutexLocker lock(&mutex_);
+    Stats s = stats_;
+    s.entries = entries_.size();
+    return s;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QString>
+
+// Process-wide store of TLS session tickets, keyed by "host:port". A probe offers
+// the saved ticket in its next ClientHello to the same endpoint so the server can
+// resume the session instead of running a full handshake. Tickets live for the
+// server's lifetime hint; when the cache is full the least recently used one goes.
+// Thread-safe: probes on every worker thread share it.
+class TlsSessionCache {
+public:
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 stored = 0;
+        int entries = 0;
+    };
+
+    static TlsSessionCache& instance();
+
+    QByteArray lookup(const QString& key);
+    void store(const QString& key, const QByteArray& ticket, int lifetimeHintSec);
+    void remove(const QString& key);
+    void clear();
+
+    void setCapacity(int entries);
+    Stats stats() const;
+
+private:
+    TlsSessionCache();
+
+    struct Entry {
+        QByteArray ticket;
+        qint64 expiresAtMs = 0;
+        qint64 usedAtMs = 0;
+    };
+
+    mutable QMutex mutex_;
+    QHash<QString, Entry> entries_;
+    QElapsedTimer clock_;
+    int capacity_ = 4096;
+    Stats stats_;
+};
@@ -0,0 +1,186 @@
+#include "TraceRecorder.h"
+#include <QCoreApplication>
+#include <QThread>
+#include "SelfMetrics.h"
+
+TraceRecorder& TraceRecorder::instance() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+QByteArray TraceRecorder::jsonString(const QString& s) {
+    const QByteArray raw = s.toUtf8();
+    QByteArray out;
+    out.reserve(raw.size() + 2);
+    out += '"';
+    for (char c : raw) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (uchar(c) < 0x20) {
+            out += "\\u00";
+            out += "0123456789abcdef"[(c >> 4) & 0xf];
+            out += "0123456789abcdef"[c & 0xf];
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+    return out;
+}
+
+TraceRecorder::ThreadBuffer& TraceRecorder::threadBuffer_() {
+    // When its thread ends the leftovers go to the writer's queue and the slot to
+    // the free list
+    struct Holder {
+        TraceRecorder* owner = nullptr;
+        ThreadBuffer* tb = nullptr;
+        ~Holder() {
+            if (!tb) return;
+            QMutexLocker lock(&owner->queueMutex_);
+            {
+                QMutexLocker bufLock(&tb->mutex);
+                if (!tb->buf.isEmpty()) owner->full_.push_back(std::move(tb->buf));
+                tb->buf = QByteArray();
+            }
+            owner->freeBuffers_.push_back(tb);
+        }
+    };
+    thread_local Holder holder;
+    if (!holder.tb) {
+        QMutexLocker lock(&queueMutex_);
+        if (!freeBuffers_.empty()) {
+            holder.tb = freeBuffers_.back();
+            freeBuffers_.pop_back();
+        } else {
+            buffers_.push_back(std::make_unique<ThreadBuffer>());
+            holder.tb = buffers_.back().get();
+        }
+        holder.tb->tid = nextTid_++;
+        holder.tb->namedIn = 0;
+        holder.owner = this;
+    }
+    return *holder.tb;
+}
+
+std::vector<QByteArray> TraceRecorder::collect_() {
+    std::vector<QByteArray> out;
+    QMutexLocker lock(&queueMutex_);
+    out.swap(full_);
+    for (const auto& tb : buffers_) {
+        QMutexLocker bufLock(&tb->mutex);
+        if (tb->buf.isEmpty()) continue;
+        out.push_back(std::move(tb->buf));
+        tb->buf = QByteArray();
+    }
+    return out;
+}
+
+bool TraceRecorder::start(const QString& path, QString* error) {
+    QMutexLocker lock(&fileMutex_);
+    close_();
+    collect_();                           // built after the last file was closed
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) *error = file_.errorString();
+        return false;
+    }
+    generation_.fetch_add(1, std::memory_order_release);
+    // The array opens with the process name, so every event after it takes a comma.
+    file_.write("[\n{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":"
+                + jsonString(QCoreApplication::applicationName()) + "}}");
+    enabled_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void TraceRecorder::stop() {
+    QMutexLocker lock(&fileMutex_);
+    close_();
+}
+
+void TraceRecorder::close_() {
+    enabled_.store(false, std::memory_order_relaxed);
+    if (!file_.isOpen()) return;
+    for (const QByteArray& chunk : collect_()) file_.write(chunk);
+    file_.write("\n]\n");
+    file_.close();
+}
+
+void TraceRecorder::flush() {
+    QMutexLocker lock(&fileMutex_);
+    if (!file_.isOpen()) return;
+    for (const QByteArray& chunk : collect_()) file_.write(chunk);
+    file_.flush();
+}
+
+void TraceRecorder::queue_(QByteArray&& chunk) {
+    {
+        QMutexLocker lock(&queueMutex_);
+        full_.push_back(std::move(chunk));
+    }
+    // Only the first full buffer after a write posts one; the rest ride along.
+    if (writePending_.exchange(true, std::memory_order_acq_rel)) return;
+    QCoreApplication* app = QCoreApplication::instance();
+    if (!app) {
+        writePending_.store(false, std::memory_order_relaxed);   // остаётся до flush()/stop()
+        return;
+    }
+    QMetaObject::invokeMethod(app, [this]{ write_(); }, Qt::QueuedConnection);
+}
+
+void TraceRecorder::write_() {
+    writePending_.exchange(false, std::memory_order_acq_rel);
+    std::vector<QByteArray> chunks;
+    {
+        QMutexLocker lock(&queueMutex_);
+        chunks.swap(full_);
+    }
+    QMutexLocker lock(&fileMutex_);
+    if (!file_.isOpen()) return;
+    for (const QByteArray& chunk : chunks) file_.write(chunk);
+}
+
+void TraceRecorder::append_(const char* ph, qint64 ts, const QByteArray& body) {
+    if (!isEnabled()) return;             // остановлен, пока событие собиралось
+    ThreadBuffer& tb = threadBuffer_();
+    const quint32 gen = generation_.load(std::memory_order_acquire);
+    QByteArray chunk;
+    {
+        QMutexLocker lock(&tb.mutex);
+        if (tb.namedIn != gen) {
+            tb.namedIn = gen;
+            QString name = QThread::currentThread()->objectName();
+            if (name.isEmpty()) {
+                name = QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread()
+                        ? QStringLiteral("main") : QStringLiteral("thread-%1").arg(tb.tid);
+            }
+            tb.buf += ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" + QByteArray::number(tb.tid)
+                    + ",\"name\":\"thread_name\",\"args\":{\"name\":" + jsonString(name) + "}}";
+        }
+        tb.buf += ",\n{\"ph\":\"";
+        tb.buf += ph;
+        tb.buf += "\",\"pid\":1,\"tid\":" + QByteArray::number(tb.tid) + ",\"ts\":" + QByteArray::number(ts);
+        tb.buf += body;
+        if (tb.buf.size() >= kFlushBytes) chunk.swap(tb.buf);
+    }
+    events_.fetch_add(1, std::memory_order_relaxed);
+    if (!chunk.isEmpty()) queue_(std::move(chunk));
+}
+
+void TraceRecorder::complete(const char* name, const char* cat, qint64 startUs, qint64 durUs) {
+    append_("X", startUs, ",\"dur\":" + QByteArray::number(durUs)
+            + ",\"name\":\"" + name + "\",\"cat\":\"" + cat + "\"}");
+}
+
+void TraceRecorder::asyncSpan(const QString& name, const char* cat, quint64 id, qint64 startUs, qint64 endUs,
+                              const QByteArray& args) {
+    const QByteArray common = ",\"name\":" + jsonString(name) + ",\"cat\":\"" + cat
+            + "\",\"id\":" + QByteArray::number(id);
+    append_("b", startUs, common + (args.isEmpty() ? QByteArray() : ",\"args\":{" + args + '}') + '}');
+    append_("e", endUs, common + '}');
+}
+
+void TraceRecorder::counter(const char* name, const QString& series, qint64 value) {
+    append_("C", SelfMetrics::nowUs(), ",\"name\":\"" + QByteArray(name) + "\",\"args\":{"
+            + jsonString(series) + ':' + QByteArray::number(value) + "}}");
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Optional span tracing in the Chrome trace event format (a JSON array), which
+// chrome://tracing and ui.perfetto.dev open as is. Off by default, and then every
+// call site costs one relaxed load of isEnabled(). Each thread appends to a buffer
+// of its own; one that grows past kFlushBytes is queued for the writer, which runs
+// on the application thread, so probe threads never touch the file. flush() also
+// collects the partly filled buffers, so a long run streams to disk; stop() closes
+// the array. Times come from SelfMetrics::nowUs().
+class TraceRecorder {
+public:
+    static constexpr int kFlushBytes = 64 * 1024;   // на поток
+
+    static TraceRecorder& instance();
+
+    // start(), stop() and flush() belong to the application thread
+    bool start(const QString& path, QString* error);
+    void stop();
+    void flush();
+    bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+    quint64 events() const { return events_.load(std::memory_order_relaxed); }
+
+    // Synchronous span on the calling thread (must nest with its other spans)
+    void complete(const char* name, const char* cat, qint64 startUs, qint64 durUs);
+    // Span that may overlap others on the thread, e.g. one probe among many in flight.
+    // `args` is the inside of a JSON object ("k":"v",...) or empty.
+    void asyncSpan(const QString& name, const char* cat, quint64 id, qint64 startUs, qint64 endUs,
+                   const QByteArray& args = QByteArray());
+    // One sample of a counter track; `series` names the line within it
+    void counter(const char* name, const QString& series, qint64 value);
+
+    static QByteArray jsonString(const QString& s);
+
+private:
+    // Events of one thread not yet queued; slots of finished threads are reused
+    struct ThreadBuffer {
+        QMutex mutex;                     // чужой поток берёт его только в flush()/stop()
+        QByteArray buf;
+        int tid = 0;                      // Chrome хочет небольшие целые id потоков
+        quint32 namedIn = 0;              // поколение файла, где уже есть thread_name
+    };
+
+    TraceRecorder() = default;
+    ThreadBuffer& threadBuffer_();
+    void append_(const char* ph, qint64 ts, const QByteArray& body);
+    void queue_(QByteArray&& chunk);
+    void write_();
+    std::vector<QByteArray> collect_();   // очередь и недописанные буферы всех потоков
+    void close_();
+
+    QMutex fileMutex_;                    // file_; берётся только в потоке приложения
+    QFile file_;
+    std::atomic<bool> enabled_{false};
+    std::atomic<quint32> generation_{0};  // номер файла: имена потоков пишутся в каждый
+    std::atomic<quint64> events_{0};
+    std::atomic<bool> writePending_{false};
+
+    QMutex queueMutex_;                   // full_ и список буферов потоков
+    std::vector<QByteArray> full_;        // ждут записи
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::vector<ThreadBuffer*> freeBuffers_;
+    int nextTid_ = 1;
+};
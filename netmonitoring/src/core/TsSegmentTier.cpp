@@ -0,0 +1,415 @@
+#include "TsSegmentTier.h"
+#include <QDir>
+#include <QFileInfo>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// On-disk layout is host-endian: the store is local state, not an exchange format.
+constexpr quint32 kBlockMagic = 0x4b425354;   // "TSBK"
+constexpr quint32 kIndexMagic = 0x58495354;   // "TSIX"
+constexpr quint16 kIndexVersion = 1;
+constexpr quint16 kIndexRolled = 0x1;
+
+struct BlockHeader {
+    quint32 magic;
+    quint32 series;
+    quint32 count;
+    quint32 recordSize;
+    qint64 firstMs;
+    qint64 lastMs;
+};
+static_assert(sizeof(BlockHeader) == 32, "block header layout");
+
+struct IndexHeader {
+    quint32 magic;
+    quint16 version;
+    quint16 flags;
+    quint32 recordSize;
+    quint32 entries;
+    quint64 dataSize;
+    qint64 startMs;
+    qint64 minMs;
+    qint64 maxMs;
+};
+static_assert(sizeof(IndexHeader) == 48, "index header layout");
+
+struct IndexEntry {
+    quint32 series;
+    quint32 count;
+    quint64 offset;
+    qint64 firstMs;
+    qint64 lastMs;
+};
+static_assert(sizeof(IndexEntry) == 32, "index entry layout");
+
+constexpr qint64 kNoMin = std::numeric_limits<qint64>::max();
+constexpr qint64 kNoMax = std::numeric_limits<qint64>::min();
+
+} // namespace
+
+TsSegmentTier::TsSegmentTier(QString dir, int recordSize, qint64 spanMs, bool readOnly)
+        : dir_(std::move(dir))
+        , recordSize_(recordSize)
+        , spanMs_(qMax<qint64>(1000, spanMs))
+        , readOnly_(readOnly) {}
+
+TsSegmentTier::~TsSegmentTier() {
+    close();
+}
+
+QString TsSegmentTier::dataPath_(qint64 startMs) const {
+    return QStringLiteral("%1/seg-%2.dat").arg(dir_).arg(startMs);
+}
+
+QString TsSegmentTier::indexPath_(qint64 startMs) const {
+    return QStringLiteral("%1/seg-%2.idx").arg(dir_).arg(startMs);
+}
+
+bool TsSegmentTier::open(QString* error) {
+    close();
+    segments_.clear();
+    if (readOnly_) {
+        if (!QDir(dir_).exists()) return true;   // уровень ещё ни разу не писался
+    } else if (!QDir().mkpath(dir_)) {
+        error_ = QStringLiteral("cannot create %1").arg(dir_);
+        if (error) *error = error_;
+        return false;
+    }
+    const QStringList files = QDir(dir_).entryList({QStringLiteral("seg-*.dat")}, QDir::Files);
+    for (const QString& name : files) {
+        bool ok = false;
+        const qint64 start = name.mid(4, name.size() - 8).toLongLong(&ok);
+        if (!ok) continue;
+        if (!load_(start) && error) {
+            *error = error_;
+            return false;
+        }
+    }
+    return true;
+}
+
+void TsSegmentTier::close() {
+    if (active_) seal_(*active_);
+    active_ = nullptr;
+}
+
+bool TsSegmentTier::load_(qint64 startMs) {
+    auto seg = std::make_unique<Segment>();
+    seg->startMs = startMs;
+    seg->file = std::make_unique<QFile>(dataPath_(startMs));
+    seg->size = quint64(seg->file->size());
+    seg->minMs = kNoMin;
+    seg->maxMs = kNoMax;
+
+    if (!readIndex_(*seg)) {
+        // Unsealed segment of an earlier run, or the writer's active one when read-only:
+        // rebuild the index from block headers.
+        if (!recover_(*seg)) return false;
+        if (seg->size > 0 && !readOnly_ && !writeIndex_(*seg)) return false;
+    }
+    if (seg->size == 0) {
+        if (readOnly_) return true;
+        QFile::remove(dataPath_(startMs));
+        QFile::remove(indexPath_(startMs));
+        return true;
+    }
+    if (!seg->file->open(QIODevice::ReadOnly)) {
+        error_ = seg->file->errorString();
+        return false;
+    }
+    seg->map = seg->file->map(0, qint64(seg->size));
+    if (!seg->map) {
+        error_ = seg->file->errorString();
+        return false;
+    }
+    seg->sealed = true;
+    segments_.emplace(startMs, std::move(seg));
+    return true;
+}
+
+bool TsSegmentTier::readIndex_(Segment& seg) {
+    QFile f(indexPath_(seg.startMs));
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    const QByteArray bytes = f.readAll();
+    if (bytes.size() < int(sizeof(IndexHeader))) return false;
+
+    IndexHeader h;
+    std::memcpy(&h, bytes.constData(), sizeof(h));
+    if (h.magic != kIndexMagic || h.version != kIndexVersion || h.recordSize != quint32(recordSize_)
+        || h.dataSize != seg.size || h.startMs != seg.startMs
+        || quint64(bytes.size()) != sizeof(IndexHeader) + quint64(h.entries) * sizeof(IndexEntry)) {
+        return false;
+    }
+
+    const char* p = bytes.constData() + sizeof(IndexHeader);
+    for (quint32 i = 0; i < h.entries; ++i, p += sizeof(IndexEntry)) {
+        IndexEntry e;
+        std::memcpy(&e, p, sizeof(e));
+        if (e.offset + quint64(e.count) * quint64(recordSize_) > seg.size) return false;
+        seg.index[e.series].push_back(BlockRef{e.offset, e.count, e.firstMs, e.lastMs});
+    }
+    seg.minMs = h.minMs;
+    seg.maxMs = h.maxMs;
+    seg.rolled = (h.flags & kIndexRolled) != 0;
+    return true;
+}
+
+bool TsSegmentTier::recover_(Segment& seg) {
+    seg.index.clear();
+    seg.minMs = kNoMin;
+    seg.maxMs = kNoMax;
+    seg.rolled = false;
+    if (seg.size == 0) return true;
+
+    QFile& f = *seg.file;
+    if (!f.open(readOnly_ ? QIODevice::ReadOnly : QIODevice::ReadWrite)) {
+        error_ = f.errorString();
+        return false;
+    }
+    const uchar* base = f.map(0, qint64(seg.size));
+    if (!base) {
+        error_ = f.errorString();
+        f.close();
+        return false;
+    }
+
+    quint64 pos = 0;
+    while (pos + sizeof(BlockHeader) <= seg.size) {
+        BlockHeader h;
+        std::memcpy(&h, base + pos, sizeof(h));
+        const quint64 payload = quint64(h.count) * quint64(recordSize_);
+        if (h.magic != kBlockMagic || h.recordSize != quint32(recordSize_) || h.count == 0
+            || pos + sizeof(BlockHeader) + payload > seg.size) {
+            break;                        // torn tail, or a block the writer is still writing
+        }
+        const quint64 offset = pos + sizeof(BlockHeader);
+        seg.index[h.series].push_back(BlockRef{offset, h.count, h.firstMs, h.lastMs});
+        seg.minMs = qMin(seg.minMs, h.firstMs);
+        seg.maxMs = qMax(seg.maxMs, h.lastMs);
+        pos = offset + payload;
+    }
+    f.unmap(const_cast<uchar*>(base));
+
+    // A reader only leaves the tail out; truncating is up to the writer.
+    if (pos < seg.size && !readOnly_ && !f.resize(qint64(pos))) {
+        error_ = f.errorString();
+        f.close();
+        return false;
+    }
+    f.close();
+    seg.size = pos;
+    return true;
+}
+
+bool TsSegmentTier::writeIndex_(const Segment& seg) {
+    quint32 entries = 0;
+    for (auto it = seg.index.cbegin(); it != seg.index.cend(); ++it) entries += quint32(it.value().size());
+
+    QByteArray bytes;
+    bytes.resize(int(sizeof(IndexHeader) + quint64(entries) * sizeof(IndexEntry)));
+    IndexHeader h{kIndexMagic, kIndexVersion, quint16(seg.rolled ? kIndexRolled : 0), quint32(recordSize_),
+                  entries, seg.size, seg.startMs, seg.minMs, seg.maxMs};
+    std::memcpy(bytes.data(), &h, sizeof(h));
+    char* p = bytes.data() + sizeof(IndexHeader);
+    for (auto it = seg.index.cbegin(); it != seg.index.cend(); ++it) {
+        for (const BlockRef& b : it.value()) {
+            const IndexEntry e{it.key(), b.count, b.offset, b.firstMs, b.lastMs};
+            std::memcpy(p, &e, sizeof(e));
+            p += sizeof(e);
+        }
+    }
+
+    // Write-then-rename: a crash leaves either the old index or none, never a torn one.
+    const QString path = indexPath_(seg.startMs);
+    QFile f(path + QStringLiteral(".tmp"));
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate) || f.write(bytes) != bytes.size()) {
+        error_ = f.errorString();
+        return false;
+    }
+    f.close();
+    QFile::remove(path);
+    if (!QFile::rename(f.fileName(), path)) {
+        error_ = QStringLiteral("cannot rename %1").arg(f.fileName());
+        return false;
+    }
+    return true;
+}
+
+bool TsSegmentTier::openActive_(qint64 startMs) {
+    auto it = segments_.find(startMs);
+    if (it != segments_.end()) {
+        Segment& seg = *it->second;
+        if (seg.rolled) {
+            error_ = QStringLiteral("segment %1 is already rolled up").arg(startMs);
+            return false;
+        }
+        // Same span as before a restart: reopen the sealed segment for appending.
+        if (seg.map) seg.file->unmap(const_cast<uchar*>(seg.map));
+        seg.map = nullptr;
+        seg.file->close();
+        if (!seg.file->open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+            error_ = seg.file->errorString();
+            return false;
+        }
+        QFile::remove(indexPath_(startMs));
+        seg.sealed = false;
+        active_ = &seg;
+        return true;
+    }
+
+    auto seg = std::make_unique<Segment>();
+    seg->startMs = startMs;
+    seg->minMs = kNoMin;
+    seg->maxMs = kNoMax;
+    seg->file = std::make_unique<QFile>(dataPath_(startMs));
+    if (!seg->file->open(QIODevice::ReadWrite | QIODevice::Unbuffered | QIODevice::Truncate)) {
+        error_ = seg->file->errorString();
+        return false;
+    }
+    active_ = seg.get();
+    segments_.emplace(startMs, std::move(seg));
+    return true;
+}
+
+bool TsSegmentTier::appendBlock(quint32 series, const char* records, int count, qint64 firstMs, qint64 lastMs) {
+    if (count <= 0) return true;
+    if (readOnly_) {
+        error_ = QStringLiteral("%1 is open read-only").arg(dir_);
+        return false;
+    }
+    const qint64 start = (firstMs / spanMs_) * spanMs_;
+    // Late records for an older span go to the active segment; its bounds widen instead.
+    if (!active_ || start > active_->startMs) {
+        if (active_) seal_(*active_);
+        active_ = nullptr;
+        if (!openActive_(start)) return false;
+    }
+
+    Segment& seg = *active_;
+    const BlockHeader h{kBlockMagic, series, quint32(count), quint32(recordSize_), firstMs, lastMs};
+    const qint64 payload = qint64(count) * recordSize_;
+    QFile& f = *seg.file;
+    if (!f.seek(qint64(seg.size))
+        || f.write(reinterpret_cast<const char*>(&h), sizeof(h)) != qint64(sizeof(h))
+        || f.write(records, payload) != payload) {
+        error_ = f.errorString();
+        // Cut a partial block off so the next append starts on a boundary again.
+        f.resize(qint64(seg.size));
+        return false;
+    }
+
+    const quint64 offset = seg.size + sizeof(BlockHeader);
+    seg.index[series].push_back(BlockRef{offset, quint32(count), firstMs, lastMs});
+    seg.size = offset + quint64(payload);
+    seg.minMs = qMin(seg.minMs, firstMs);
+    seg.maxMs = qMax(seg.maxMs, lastMs);
+    return true;
+}
+
+void TsSegmentTier::sealActive() {
+    if (active_) seal_(*active_);
+    active_ = nullptr;
+}
+
+void TsSegmentTier::seal_(Segment& seg) {
+    if (seg.sealed) return;
+    seg.file->close();
+    if (seg.size == 0) {
+        QFile::remove(dataPath_(seg.startMs));
+        segments_.erase(seg.startMs);
+        return;
+    }
+    writeIndex_(seg);
+    if (seg.file->open(QIODevice::ReadOnly)) seg.map = seg.file->map(0, qint64(seg.size));
+    seg.sealed = true;
+}
+
+void TsSegmentTier::scan(quint32 series, qint64 fromMs, qint64 toMs, const BlockFn& fn) const {
+    for (const auto& kv : segments_) {
+        const Segment& seg = *kv.second;
+        if (seg.size == 0 || seg.maxMs < fromMs || seg.minMs > toMs) continue;
+        visit_(seg, series, fromMs, toMs, fn);
+    }
+}
+
+void TsSegmentTier::scanSegment(qint64 startMs, quint32 series, const BlockFn& fn) const {
+    auto it = segments_.find(startMs);
+    if (it == segments_.end()) return;
+    visit_(*it->second, series, std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max(), fn);
+}
+
+void TsSegmentTier::visit_(const Segment& seg, quint32 series, qint64 fromMs, qint64 toMs, const BlockFn& fn) const {
+    auto it = seg.index.constFind(series);
+    if (it == seg.index.constEnd()) return;
+    for (const BlockRef& b : it.value()) {
+        if (b.lastMs < fromMs || b.firstMs > toMs) continue;
+        if (seg.map) {
+            fn(reinterpret_cast<const char*>(seg.map + b.offset), int(b.count));
+            continue;
+        }
+        // Active segment: the file is still growing, read the block through the handle.
+        const qint64 bytes = qint64(b.count) * recordSize_;
+        if (!seg.file->seek(qint64(b.offset))) continue;
+        scratch_.resize(int(bytes));
+        if (seg.file->read(scratch_.data(), bytes) != bytes) continue;
+        fn(scratch_.constData(), int(b.count));
+    }
+}
+
+QVector<qint64> TsSegmentTier::sealedSegments() const {
+    QVector<qint64> out;
+    for (const auto& kv : segments_) {
+        if (kv.second->sealed) out.push_back(kv.first);
+    }
+    return out;
+}
+
+qint64 TsSegmentTier::segmentMaxMs(qint64 startMs) const {
+    auto it = segments_.find(startMs);
+    return it != segments_.end() ? it->second->maxMs : kNoMax;
+}
+
+bool TsSegmentTier::isRolled(qint64 startMs) const {
+    auto it = segments_.find(startMs);
+    return it != segments_.end() && it->second->rolled;
+}
+
+void TsSegmentTier::setRolled(qint64 startMs) {
+    auto it = segments_.find(startMs);
+    if (readOnly_ || it == segments_.end() || !it->second->sealed || it->second->rolled) return;
+    it->second->rolled = true;
+    writeIndex_(*it->second);
+}
+
+QVector<quint32> TsSegmentTier::seriesIn(qint64 startMs) const {
+    auto it = segments_.find(startMs);
+    if (it == segments_.end()) return {};
+    return it->second->index.keys().toVector();
+}
+
+int TsSegmentTier::dropOlderThan(qint64 ms, bool rolledOnly) {
+    int dropped = 0;
+    if (readOnly_) return dropped;
+    for (auto it = segments_.begin(); it != segments_.end();) {
+        Segment& seg = *it->second;
+        if (!seg.sealed || seg.maxMs >= ms || (rolledOnly && !seg.rolled)) {
+            ++it;
+            continue;
+        }
+        if (seg.map) seg.file->unmap(const_cast<uchar*>(seg.map));
+        seg.file->close();
+        QFile::remove(dataPath_(seg.startMs));
+        QFile::remove(indexPath_(seg.startMs));
+        it = segments_.erase(it);
+        ++dropped;
+    }
+    return dropped;
+}
+
+quint64 TsSegmentTier::bytesOnDisk() const {
+    quint64 total = 0;
+    for (const auto& kv : segments_) total += kv.second->size;
+    return total;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <QtGlobal>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include <map>
+#include <memory>
+
+// One resolution level of TimeSeriesStore: a directory of append-only segment files,
+// each covering an aligned time span. A segment is a sequence of blocks (header plus
+// fixed-size records of one series). The per-series block index is kept in memory and
+// written to a sidecar .idx when the segment is sealed; a segment without a valid .idx
+// (crash) is recovered by scanning its blocks. Sealed segments are memory-mapped.
+// A read-only tier never changes the directory: it maps whatever is there, indexes
+// segments without a .idx in memory and leaves out a block still being written.
+// Not thread-safe: TimeSeriesStore serializes every call.
+class TsSegmentTier {
+public:
+    using BlockFn = std::function<void(const char* records, int count)>;
+
+    TsSegmentTier(QString dir, int recordSize, qint64 spanMs, bool readOnly = false);
+    ~TsSegmentTier();
+
+    bool open(QString* error);
+    void close();                         // seals the active segment
+
+    // Appends one block of `count` records; the segment is chosen by firstMs
+    bool appendBlock(quint32 series, const char* records, int count, qint64 firstMs, qint64 lastMs);
+    void sealActive();
+
+    // Calls fn for every block of `series` that overlaps [fromMs, toMs], oldest segment first
+    void scan(quint32 series, qint64 fromMs, qint64 toMs, const BlockFn& fn) const;
+
+    // Sealed segments in start order; the raw tier marks them once rolled up
+    QVector<qint64> sealedSegments() const;
+    qint64 segmentEnd(qint64 startMs) const { return startMs + spanMs_; }
+    qint64 segmentMaxMs(qint64 startMs) const;
+    bool isRolled(qint64 startMs) const;
+    void setRolled(qint64 startMs);
+    QVector<quint32> seriesIn(qint64 startMs) const;
+    void scanSegment(qint64 startMs, quint32 series, const BlockFn& fn) const;
+
+    // Deletes sealed segments whose newest record is older than `ms`
+    int dropOlderThan(qint64 ms, bool rolledOnly);
+
+    QString errorString() const { return error_; }
+    qint64 spanMs() const { return spanMs_; }
+    int recordSize() const { return recordSize_; }
+    quint64 bytesOnDisk() const;
+
+private:
+    struct BlockRef {
+        quint64 offset;                   // начало записей (сразу за заголовком блока)
+        quint32 count;
+        qint64 firstMs;
+        qint64 lastMs;
+    };
+
+    struct Segment {
+        qint64 startMs = 0;
+        qint64 minMs = 0;                 // реальные границы записей сегмента
+        qint64 maxMs = 0;
+        quint64 size = 0;
+        bool sealed = false;
+        bool rolled = false;
+        QHash<quint32, QVector<BlockRef>> index;
+        std::unique_ptr<QFile> file;
+        const uchar* map = nullptr;       // только у запечатанных
+    };
+
+    QString dataPath_(qint64 startMs) const;
+    QString indexPath_(qint64 startMs) const;
+    bool load_(qint64 startMs);
+    bool readIndex_(Segment& seg);
+    bool recover_(Segment& seg);
+    bool writeIndex_(const Segment& seg);
+    bool openActive_(qint64 startMs);
+    void seal_(Segment& seg);
+    void visit_(const Segment& seg, quint32 series, qint64 fromMs, qint64 toMs, const BlockFn& fn) const;
+
+    QString dir_;
+    int recordSize_;
+    qint64 spanMs_;
+    bool readOnly_;                       // только чтение: ни записи, ни удаления
+    std::map<qint64, std::unique_ptr<Segment>> segments_;
+    Segment* active_ = nullptr;
+    mutable QByteArray scratch_;          // чтение из ещё не запечатанного сегмента
+    QString error_;
+};
@@ -0,0 +1,525 @@
+#include "UdpEngine.h"
+#include <QObject>
+#include <QHash>
+#include <QThreadStorage>
+#include <QtEndian>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+namespace {
+
+constexpr quint64 kWakeTag = 0;
+constexpr quint64 kV4Tag = 1;
+constexpr quint64 kV6Tag = 2;
+constexpr int kMaxEvents = 16;
+constexpr int kRecvBatch = 64;
+constexpr int kSendBatch = 1024;          // UIO_MAXIOV
+constexpr int kMaxDatagram = 1500;
+constexpr quint64 kDnsKeyBit = quint64(1) << 63;
+const char kEchoMagic[4] = {'N', 'M', 'U', '1'};
+
+qint64 monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+socklen_t toSockaddr(const QHostAddress& addr, quint16 port, sockaddr_storage* out) {
+    std::memset(out, 0, sizeof(*out));
+    if (addr.protocol() == QAbstractSocket::IPv6Protocol) {
+        auto* sa = reinterpret_cast<sockaddr_in6*>(out);
+        sa->sin6_family = AF_INET6;
+        sa->sin6_port = htons(port);
+        const Q_IPV6ADDR v6 = addr.toIPv6Address();
+        std::memcpy(&sa->sin6_addr, &v6, sizeof(sa->sin6_addr));
+        return sizeof(sockaddr_in6);
+    }
+    auto* sa = reinterpret_cast<sockaddr_in*>(out);
+    sa->sin_family = AF_INET;
+    sa->sin_port = htons(port);
+    sa->sin_addr.s_addr = htonl(addr.toIPv4Address());
+    return sizeof(sockaddr_in);
+}
+
+bool sameEndpoint(const sockaddr_storage& a, const sockaddr_storage& b) {
+    if (a.ss_family != b.ss_family) return false;
+    if (a.ss_family == AF_INET) {
+        const auto& x = reinterpret_cast<const sockaddr_in&>(a);
+        const auto& y = reinterpret_cast<const sockaddr_in&>(b);
+        return x.sin_port == y.sin_port && x.sin_addr.s_addr == y.sin_addr.s_addr;
+    }
+    const auto& x = reinterpret_cast<const sockaddr_in6&>(a);
+    const auto& y = reinterpret_cast<const sockaddr_in6&>(b);
+    return x.sin6_port == y.sin6_port && std::memcmp(&x.sin6_addr, &y.sin6_addr, sizeof(x.sin6_addr)) == 0;
+}
+
+// QNAME + QTYPE + QCLASS; the root name asks for NS, anything else for A
+QByteArray dnsQuestion(const QByteArray& name) {
+    QByteArray q;
+    for (const QByteArray& label : name.split('.')) {
+        if (label.isEmpty()) continue;
+        q += char(qMin(label.size(), 63));
+        q += label.left(63);
+    }
+    q += '\0';
+    const bool root = q.size() == 1;
+    q += '\0';
+    q += char(root ? 2 : 1);
+    q += '\0';
+    q += char(1);
+    return q;
+}
+
+} // namespace
+
+// Per-thread receiver of engine results. Lives in the submitting thread.
+class UdpEngine::Sink : public QObject {
+public:
+    Sink(UdpEngine* engine, quint32 id) : engine_(engine), id_(id) {}
+    ~Sink() override { engine_->unregisterSink_(id_); }
+
+    quint32 id() const { return id_; }
+
+    void add(quint64 ticket, Callback cb) { callbacks_.insert(ticket, std::move(cb)); }
+    void remove(quint64 ticket) { callbacks_.remove(ticket); }
+
+    // Worker thread, with the engine's sink registry locked.
+    void post(std::vector<Result>& batch) {
+        QMutexLocker lock(&inboxMutex_);
+        if (inbox_.empty()) inbox_.swap(batch);
+        else inbox_.insert(inbox_.end(), batch.begin(), batch.end());
+        if (!drainPosted_) {
+            drainPosted_ = true;
+            QMetaObject::invokeMethod(this, [this]{ drain_(); }, Qt::QueuedConnection);
+        }
+    }
+
+private:
+    void drain_() {
+        std::vector<Result> batch;
+        {
+            QMutexLocker lock(&inboxMutex_);
+            batch.swap(inbox_);
+            drainPosted_ = false;
+        }
+        for (const Result& r : batch) {
+            auto it = callbacks_.find(r.ticket);
+            if (it == callbacks_.end()) continue;   // cancelled
+            Callback cb = std::move(it.value());
+            callbacks_.erase(it);
+            cb(r);
+        }
+    }
+
+    UdpEngine* engine_;
+    quint32 id_;
+    QHash<quint64, Callback> callbacks_;
+    QMutex inboxMutex_;
+    std::vector<Result> inbox_;
+    bool drainPosted_ = false;
+};
+
+UdpEngine& UdpEngine::instance() {
+    static UdpEngine engine;
+    return engine;
+}
+
+UdpEngine::UdpEngine() {
+    epfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    evfd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = kWakeTag;
+    ::epoll_ctl(epfd_, EPOLL_CTL_ADD, evfd_, &ev);
+
+    worker_ = std::thread([this]{ run_(); });
+}
+
+UdpEngine::~UdpEngine() {
+    stop_ = true;
+    wake_();
+    if (worker_.joinable()) worker_.join();
+    if (fd4_ >= 0) ::close(fd4_);
+    if (fd6_ >= 0) ::close(fd6_);
+    ::close(evfd_);
+    ::close(epfd_);
+}
+
+UdpEngine::Sink* UdpEngine::sinkForCurrentThread_() {
+    static QThreadStorage<Sink*> storage;
+    if (!storage.hasLocalData()) {
+        auto* sink = new Sink(this, nextSink_++);
+        QMutexLocker lock(&sinkMutex_);
+        sinks_.emplace(sink->id(), sink);
+        storage.setLocalData(sink);
+    }
+    return storage.localData();
+}
+
+void UdpEngine::unregisterSink_(quint32 id) {
+    QMutexLocker lock(&sinkMutex_);
+    sinks_.erase(id);
+}
+
+quint64 UdpEngine::send(const Train& train, Callback cb) {
+    Sink* sink = sinkForCurrentThread_();
+    const quint64 ticket = nextTicket_++;
+    sink->add(ticket, std::move(cb));
+
+    bool wake = false;
+    {
+        QMutexLocker lock(&queueMutex_);
+        submitQ_.push_back(Submit{ticket, train, sink->id()});
+        wake = !wakePending_;
+        wakePending_ = true;
+    }
+    // One eventfd write per batch of submissions, not per train.
+    if (wake) wake_();
+    return ticket;
+}
+
+void UdpEngine::cancel(quint64 ticket) {
+    sinkForCurrentThread_()->remove(ticket);
+    bool wake = false;
+    {
+        QMutexLocker lock(&queueMutex_);
+        cancelQ_.push_back(ticket);
+        wake = !wakePending_;
+        wakePending_ = true;
+    }
+    if (wake) wake_();
+}
+
+UdpEngine::Stats UdpEngine::stats() const {
+    QMutexLocker lock(&statsMutex_);
+    return stats_;
+}
+
+void UdpEngine::wake_() {
+    const quint64 one = 1;
+    [[maybe_unused]] const ssize_t n = ::write(evfd_, &one, sizeof(one));
+}
+
+void UdpEngine::run_() {
+    epoll_event events[kMaxEvents];
+    while (!stop_) {
+        const int n = ::epoll_wait(epfd_, events, kMaxEvents, nextTimeoutMs_(monotonicNs()));
+        for (int i = 0; i < n; ++i) {
+            const quint64 tag = events[i].data.u64;
+            if (tag == kWakeTag) {
+                quint64 counter;
+                [[maybe_unused]] const ssize_t r = ::read(evfd_, &counter, sizeof(counter));
+            } else {
+                receive_(tag == kV4Tag ? fd4_ : fd6_);
+            }
+        }
+        drainQueues_();
+        service_(monotonicNs());
+        flush_();
+    }
+}
+
+int UdpEngine::nextTimeoutMs_(qint64 nowNs) const {
+    if (timers_.empty()) return -1;
+    const qint64 left = timers_.top().first - nowNs;
+    if (left <= 0) return 0;
+    return int((left + 999999) / 1000000);
+}
+
+void UdpEngine::drainQueues_() {
+    std::vector<Submit> submits;
+    std::vector<quint64> cancels;
+    {
+        QMutexLocker lock(&queueMutex_);
+        submits.swap(submitQ_);
+        cancels.swap(cancelQ_);
+        wakePending_ = false;
+    }
+    for (quint64 ticket : cancels) {
+        auto it = trains_.find(ticket);
+        if (it == trains_.end()) continue;
+        dropKeys_(it->second);
+        trains_.erase(it);
+    }
+    for (const Submit& s : submits) begin_(s);
+    delta_.trains += submits.size();
+}
+
+int UdpEngine::socketFor_(int family) {
+    int& fd = family == AF_INET6 ? fd6_ : fd4_;
+    if (fd >= 0) return fd;
+    fd = ::socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (family == AF_INET6) {
+        const int on = 1;
+        ::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on));
+    }
+    // Replies of many targets arrive together: room for a burst between two reads.
+    const int buf = 4 << 20;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = family == AF_INET6 ? kV6Tag : kV4Tag;
+    ::epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev);
+    return fd;
+}
+
+void UdpEngine::begin_(const Submit& s) {
+    TrainState t;
+    t.sink = s.sink;
+    t.peerLen = toSockaddr(s.train.addr, s.train.port, &t.peer);
+    t.family = t.peer.ss_family;
+    t.payload = s.train.payload;
+    if (t.payload == Payload::Dns) t.dnsQuestion = dnsQuestion(s.train.dnsName);
+    t.payloadBytes = qBound(12, s.train.payloadBytes, kMaxDatagram);
+    t.packets = qMax(1, s.train.packets);
+    t.spacingNs = qint64(qMax(0, s.train.spacingMs)) * 1000000LL;
+    t.timeoutNs = qint64(qMax(1, s.train.timeoutMs)) * 1000000LL;
+    t.keys.assign(size_t(t.packets), 0);
+    t.sentNs.assign(size_t(t.packets), -1);
+    t.rttNs.assign(size_t(t.packets), -1);
+
+    if (socketFor_(t.family) < 0) {
+        t.error = errno;
+        t.next = t.packets;               // нечего отправлять: серия завершается сразу
+    }
+    t.nextSendNs = monotonicNs();
+    timers_.emplace(t.nextSendNs, s.ticket);
+    trains_.emplace(s.ticket, std::move(t));
+}
+
+quint64 UdpEngine::allocKey_(Payload payload) {
+    if (payload == Payload::Echo) return nextSeq_++ & ~kDnsKeyBit;
+    // 16-bit DNS IDs are scarce: skip the ones still waiting for a reply.
+    for (int i = 0; i < 65536; ++i) {
+        const quint64 key = kDnsKeyBit | nextDnsId_++;
+        if (!packets_.count(key)) return key;
+    }
+    return 0;
+}
+
+void UdpEngine::dropKeys_(TrainState& t) {
+    for (quint64& key : t.keys) {
+        if (key) packets_.erase(key);
+        key = 0;
+    }
+}
+
+void UdpEngine::service_(qint64 nowNs) {
+    // Trains whose send or reply deadline has come
+    std::vector<quint64> due;
+    while (!timers_.empty() && timers_.top().first <= nowNs) {
+        due.push_back(timers_.top().second);
+        timers_.pop();
+    }
+    if (due.empty()) return;
+    std::sort(due.begin(), due.end());
+    due.erase(std::unique(due.begin(), due.end()), due.end());
+
+    struct Out {
+        quint64 ticket;
+        int index;
+        QByteArray data;
+    };
+    std::vector<Out> out4, out6;
+
+    for (quint64 ticket : due) {
+        auto it = trains_.find(ticket);
+        if (it == trains_.end()) continue;   // finished or cancelled
+        TrainState& t = it->second;
+
+        // Unanswered packets past their deadline are lost.
+        for (int i = 0; i < t.next; ++i) {
+            if (t.keys[size_t(i)] && t.sentNs[size_t(i)] + t.timeoutNs <= nowNs) {
+                packets_.erase(t.keys[size_t(i)]);
+                t.keys[size_t(i)] = 0;
+                --t.open;
+            }
+        }
+
+        if (t.next < t.packets && t.nextSendNs <= nowNs) {
+            const int index = t.next++;
+            const quint64 key = allocKey_(t.payload);
+            QByteArray data;
+            if (t.payload == Payload::Echo) {
+                data.fill('\0', t.payloadBytes);
+                std::memcpy(data.data(), kEchoMagic, 4);
+                const quint64 be = qToBigEndian(key);
+                std::memcpy(data.data() + 4, &be, sizeof(be));
+            } else {
+                const quint16 id = quint16(key);
+                const char header[12] = {char(id >> 8), char(id & 0xff), 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0};
+                data = QByteArray(header, 12) + t.dnsQuestion;
+            }
+            if (key) {
+                t.keys[size_t(index)] = key;
+                packets_.emplace(key, PacketRef{ticket, index});
+                (t.family == AF_INET6 ? out6 : out4).push_back(Out{ticket, index, data});
+            }
+            if (t.next < t.packets) {
+                t.nextSendNs = nowNs + t.spacingNs;
+                timers_.emplace(t.nextSendNs, ticket);
+            }
+        }
+
+    }
+
+    // Every due packet of every train, one sendmmsg per family and batch.
+    for (std::vector<Out>* out : {&out4, &out6}) {
+        if (out->empty()) continue;
+        const int fd = out == &out6 ? fd6_ : fd4_;
+        for (size_t base = 0; base < out->size(); base += kSendBatch) {
+            const size_t n = qMin(out->size() - base, size_t(kSendBatch));
+            std::vector<mmsghdr> msgs(n);
+            std::vector<iovec> iov(n);
+            for (size_t i = 0; i < n; ++i) {
+                Out& o = (*out)[base + i];
+                TrainState& t = trains_.at(o.ticket);
+                iov[i].iov_base = o.data.data();
+                iov[i].iov_len = size_t(o.data.size());
+                std::memset(&msgs[i], 0, sizeof(mmsghdr));
+                msgs[i].msg_hdr.msg_name = &t.peer;
+                msgs[i].msg_hdr.msg_namelen = t.peerLen;
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            size_t done = 0;
+            int err = 0;
+            while (done < n) {
+                const qint64 sentAt = monotonicNs();
+                const int rc = ::sendmmsg(fd, msgs.data() + done, unsigned(n - done), 0);
+                ++delta_.sendCalls;
+                if (rc <= 0) {
+                    err = rc < 0 ? errno : EAGAIN;
+                    break;
+                }
+                for (int i = 0; i < rc; ++i) {
+                    const Out& o = (*out)[base + done + size_t(i)];
+                    TrainState& t = trains_.at(o.ticket);
+                    t.sentNs[size_t(o.index)] = sentAt;
+                    ++t.open;
+                    timers_.emplace(sentAt + t.timeoutNs, o.ticket);
+                }
+                done += size_t(rc);
+            }
+            delta_.sent += done;
+            // The rest never left: no reply to wait for.
+            for (size_t i = done; i < n; ++i) {
+                const Out& o = (*out)[base + i];
+                auto it = trains_.find(o.ticket);
+                if (it == trains_.end()) continue;
+                TrainState& t = it->second;
+                packets_.erase(t.keys[size_t(o.index)]);
+                t.keys[size_t(o.index)] = 0;
+                t.error = err;
+            }
+        }
+    }
+
+    // Complete trains: everything sent and every packet answered or expired.
+    for (quint64 ticket : due) {
+        auto it = trains_.find(ticket);
+        if (it != trains_.end() && it->second.next >= it->second.packets && it->second.open == 0) finish_(ticket);
+    }
+}
+
+void UdpEngine::receive_(int fd) {
+    if (fd < 0) return;
+    char buffers[kRecvBatch][kMaxDatagram];
+    iovec iov[kRecvBatch];
+    sockaddr_storage from[kRecvBatch];
+    mmsghdr msgs[kRecvBatch];
+
+    for (;;) {
+        for (int i = 0; i < kRecvBatch; ++i) {
+            iov[i].iov_base = buffers[i];
+            iov[i].iov_len = kMaxDatagram;
+            std::memset(&msgs[i], 0, sizeof(mmsghdr));
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        const int n = ::recvmmsg(fd, msgs, kRecvBatch, MSG_DONTWAIT, nullptr);
+        if (n <= 0) return;
+        const qint64 now = monotonicNs();
+        ++delta_.recvCalls;
+
+        for (int i = 0; i < n; ++i) {
+            const char* p = buffers[i];
+            const unsigned len = msgs[i].msg_len;
+            quint64 key = 0;
+            if (len >= 12 && std::memcmp(p, kEchoMagic, 4) == 0) {
+                quint64 be;
+                std::memcpy(&be, p + 4, sizeof(be));
+                key = qFromBigEndian(be);
+            } else if (len >= 12 && (quint8(p[2]) & 0x80)) {
+                // DNS response: QR bit set
+                key = kDnsKeyBit | (quint16(quint8(p[0])) << 8 | quint8(p[1]));
+            }
+            auto ref = key ? packets_.find(key) : packets_.end();
+            if (ref == packets_.end()) {
+                ++delta_.unmatched;
+                continue;
+            }
+            auto it = trains_.find(ref->second.ticket);
+            if (it == trains_.end() || !sameEndpoint(from[i], it->second.peer)) {
+                ++delta_.unmatched;
+                continue;
+            }
+            TrainState& t = it->second;
+            const int index = ref->second.index;
+            packets_.erase(ref);
+            t.keys[size_t(index)] = 0;
+            t.rttNs[size_t(index)] = now - t.sentNs[size_t(index)];
+            --t.open;
+            ++delta_.received;
+            if (t.next >= t.packets && t.open == 0) finish_(it->first);
+        }
+        if (n < kRecvBatch) return;
+    }
+}
+
+void UdpEngine::finish_(quint64 ticket) {
+    auto it = trains_.find(ticket);
+    if (it == trains_.end()) return;
+    TrainState& t = it->second;
+    dropKeys_(t);
+    Result r;
+    r.ticket = ticket;
+    r.error = t.error;
+    for (qint64 s : t.sentNs) r.sent += s >= 0 ? 1 : 0;
+    r.rttNs = std::move(t.rttNs);
+    outbox_[t.sink].push_back(std::move(r));
+    trains_.erase(it);
+}
+
+void UdpEngine::flush_() {
+    if (!outbox_.empty()) {
+        QMutexLocker lock(&sinkMutex_);
+        for (auto& kv : outbox_) {
+            auto sink = sinks_.find(kv.first);
+            if (sink == sinks_.end()) continue;   // submitting thread is gone
+            sink->second->post(kv.second);
+        }
+        outbox_.clear();
+    }
+
+    QMutexLocker lock(&statsMutex_);
+    stats_.trains += delta_.trains;
+    stats_.sent += delta_.sent;
+    stats_.received += delta_.received;
+    stats_.unmatched += delta_.unmatched;
+    stats_.sendCalls += delta_.sendCalls;
+    stats_.recvCalls += delta_.recvCalls;
+    delta_ = Stats();
+}
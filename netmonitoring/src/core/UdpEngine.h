@@ -0,0 +1,144 @@
+#pragma once
+#include <QtGlobal>
+#include <QByteArray>
+#include <QHostAddress>
+#include <QMutex>
+#include <atomic>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sys/socket.h>
+
+// Linux-only UDP request/response engine. Probes submit a train of packets to one
+// destination; a dedicated thread owns one unconnected socket per address family
+// and sends the due packets of every train in one sendmmsg() call, reads replies
+// with recvmmsg() and matches them to packets by sequence number (the DNS ID for
+// DNS queries). RTTs are taken with CLOCK_MONOTONIC. Finished trains are handed
+// back in batches, one queued event per submitting thread, and the callbacks run
+// in the thread that submitted them (it needs an event loop).
+class UdpEngine {
+public:
+    enum class Payload { Echo, Dns };
+
+    struct Train {
+        QHostAddress addr;
+        quint16 port = 0;
+        Payload payload = Payload::Echo;
+        QByteArray dnsName;               // Dns: имя в запросе, пусто — корень (NS)
+        int packets = 5;
+        int spacingMs = 20;               // между отправками внутри серии
+        int timeoutMs = 1000;             // ожидание ответа на каждый пакет
+        int payloadBytes = 32;            // Echo: размер датаграммы
+    };
+
+    struct Result {
+        quint64 ticket = 0;
+        int error = 0;                    // errno отправки; 0 — серия отправлена
+        int sent = 0;
+        std::vector<qint64> rttNs;        // по пакету; -1 — ответа нет
+    };
+    using Callback = std::function<void(const Result&)>;
+
+    struct Stats {
+        quint64 trains = 0;
+        quint64 sent = 0;
+        quint64 received = 0;
+        quint64 unmatched = 0;            // чужие, поздние и повторные ответы
+        quint64 sendCalls = 0;            // вызовы sendmmsg
+        quint64 recvCalls = 0;            // вызовы recvmmsg с данными
+    };
+
+    static UdpEngine& instance();
+    ~UdpEngine();
+
+    quint64 send(const Train& train, Callback cb);
+    void cancel(quint64 ticket);          // the callback is never called after this
+
+    Stats stats() const;
+
+private:
+    class Sink;
+
+    struct Submit {
+        quint64 ticket;
+        Train train;
+        quint32 sink;
+    };
+
+    struct TrainState {
+        quint32 sink = 0;
+        int family = 0;
+        sockaddr_storage peer;
+        socklen_t peerLen = 0;
+        Payload payload = Payload::Echo;
+        QByteArray dnsQuestion;           // закодированная секция вопроса
+        int payloadBytes = 32;
+        int packets = 0;
+        int next = 0;                     // следующий пакет к отправке
+        int open = 0;                     // отправлены и ждут ответа
+        qint64 spacingNs = 0;
+        qint64 timeoutNs = 0;
+        qint64 nextSendNs = 0;
+        std::vector<quint64> keys;        // ключ сопоставления по пакету
+        std::vector<qint64> sentNs;
+        std::vector<qint64> rttNs;
+        int error = 0;
+    };
+
+    struct PacketRef {
+        quint64 ticket;
+        int index;
+    };
+
+    UdpEngine();
+    Sink* sinkForCurrentThread_();
+    void unregisterSink_(quint32 id);
+    void wake_();
+
+    // Worker thread only
+    void run_();
+    void drainQueues_();
+    void begin_(const Submit& s);
+    int socketFor_(int family);
+    void service_(qint64 nowNs);          // отправки и истечения по таймерам
+    void receive_(int fd);
+    void finish_(quint64 ticket);
+    void flush_();
+    quint64 allocKey_(Payload payload);
+    void dropKeys_(TrainState& t);
+    int nextTimeoutMs_(qint64 nowNs) const;
+
+    int epfd_ = -1;
+    int evfd_ = -1;
+    int fd4_ = -1;
+    int fd6_ = -1;
+    std::thread worker_;
+    std::atomic<bool> stop_{false};
+    std::atomic<quint64> nextTicket_{1};
+    std::atomic<quint32> nextSink_{1};
+
+    QMutex queueMutex_;                   // submit/cancel очереди
+    std::vector<Submit> submitQ_;
+    std::vector<quint64> cancelQ_;
+    bool wakePending_ = false;
+
+    QMutex sinkMutex_;                    // реестр получателей
+    std::unordered_map<quint32, Sink*> sinks_;
+
+    std::unordered_map<quint64, TrainState> trains_;
+    std::unordered_map<quint64, PacketRef> packets_;   // ключ -> пакет в ожидании ответа
+    // Моменты следующей отправки и истечения ожидания: (время, билет)
+    std::priority_queue<std::pair<qint64, quint64>, std::vector<std::pair<qint64, quint64>>,
+                        std::greater<std::pair<qint64, quint64>>> timers_;
+    quint64 nextSeq_ = 1;
+    quint16 nextDnsId_ = 1;
+    std::unordered_map<quint32, std::vector<Result>> outbox_;
+
+    Stats delta_;                         // счётчики текущего прохода цикла
+
+    mutable QMutex statsMutex_;
+    Stats stats_;
+};
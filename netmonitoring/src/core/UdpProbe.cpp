@@ -0,0 +1,137 @@
+#include "UdpProbe.h"
+#include "UdpEngine.h"
+#include "DnsCache.h"
+#include <QPointer>
+#include <cstring>
+
+UdpProbe::UdpProbe(bool dns, QObject* parent)
+        : INetProbe(parent), dns_(dns) {
+    timeout_.setSingleShot(true);
+
+    // Bounds the DNS phase only; once the train is with UdpEngine, the engine times
+    // out every packet itself and always reports back.
+    QObject::connect(&timeout_, &QTimer::timeout, this, [this]{
+        if (!active_) return;
+        ProbeResult r;
+        r.status = ProbeResult::Status::Timeout;
+        r.message = tr("Timeout");
+        r.dnsMs = dnsMs_;
+        r.ip = ip_;
+        finish_(r);
+    });
+}
+
+UdpProbe::~UdpProbe() {
+    abort();
+}
+
+void UdpProbe::configure(const ProbeTarget& target) {
+    packets_ = qBound(1, target.udpPackets, 1000);
+    spacingMs_ = qMax(0, target.udpSpacingMs);
+    query_ = target.udpQuery.toLatin1();
+}
+
+void UdpProbe::start(const QString& host, quint16 port, int timeoutMs) {
+    if (active_) return;
+    host_ = host;
+    port_ = port;
+    timeoutMs_ = timeoutMs;
+
+    active_ = true;
+    ip_.clear();
+    dnsMs_ = dnsNs_ = -1;
+    dnsCached_ = false;
+    elapsed_.restart();
+
+    timeout_.start(timeoutMs_);
+
+    QPointer<UdpProbe> self(this);
+    const quint64 run = ++run_;
+    DnsCache::instance().lookup(host_, this, [this, self, run](const DnsAnswer& answer, bool fromCache){
+        if (!self || !active_ || run != run_) return;
+        dnsCached_ = fromCache;
+        if (answer.status != DnsAnswer::Status::Ok || answer.addresses.isEmpty()) {
+            ProbeResult r;
+            r.status = ProbeResult::Status::DnsFail;
+            r.message = answer.errorString;
+            finish_(r);
+            return;
+        }
+        QHostAddress addr;
+        for (const auto& a : answer.addresses) {
+            if (a.protocol() == QAbstractSocket::IPv4Protocol) { addr = a; break; }
+        }
+        if (addr.isNull()) addr = answer.addresses.first();
+        ip_ = addr.toString();
+        dnsNs_ = elapsed_.nsecsElapsed();
+        dnsMs_ = dnsNs_ / 1000000;
+        // A lossy train ends right at its last packet's timeout; a backstop due at the
+        // same moment would turn it into a whole-probe TIMEOUT without loss figures.
+        timeout_.stop();
+        emit progressDnsResolved(dnsMs_, ip_);
+
+        UdpEngine::Train train;
+        train.addr = addr;
+        train.port = port_;
+        train.payload = dns_ ? UdpEngine::Payload::Dns : UdpEngine::Payload::Echo;
+        train.dnsName = query_;
+        train.packets = packets_;
+        train.spacingMs = spacingMs_;
+        train.timeoutMs = qMax(1, timeoutMs_ - int(dnsMs_));
+        ticket_ = UdpEngine::instance().send(train, [this, self, run](const UdpEngine::Result& res){
+            if (!self || !active_ || run != run_) return;
+            ticket_ = 0;
+            ProbeResult r;
+            r.dnsMs = dnsMs_;
+            r.ip = ip_;
+            r.packetsSent = res.sent;
+            r.packetsReceived = 0;
+
+            qint64 sumNs = 0;
+            qint64 jitterSumNs = 0;
+            qint64 prevNs = -1;
+            for (qint64 rtt : res.rttNs) {
+                if (rtt < 0) continue;
+                sumNs += rtt;
+                if (prevNs >= 0) jitterSumNs += qAbs(rtt - prevNs);
+                prevNs = rtt;
+                ++r.packetsReceived;
+            }
+
+            if (r.packetsReceived > 0) {
+                r.status = ProbeResult::Status::Up;
+                r.latencyNs = sumNs / r.packetsReceived;
+                r.latencyMs = r.latencyNs / 1000000;
+                r.jitterUs = r.packetsReceived > 1 ? jitterSumNs / (r.packetsReceived - 1) / 1000 : 0;
+                if (r.packetsReceived < r.packetsSent) {
+                    r.message = tr("Lost %1 of %2").arg(r.packetsSent - r.packetsReceived).arg(r.packetsSent);
+                }
+            } else if (res.error != 0) {
+                r.status = ProbeResult::Status::Down;
+                r.message = QString::fromLocal8Bit(std::strerror(res.error));
+            } else {
+                r.status = ProbeResult::Status::Timeout;
+                r.message = tr("Timeout");
+            }
+            finish_(r);
+        });
+    });
+}
+
+void UdpProbe::abort() {
+    if (!active_) return;
+    active_ = false;
+    timeout_.stop();
+    if (ticket_) {
+        UdpEngine::instance().cancel(ticket_);
+        ticket_ = 0;
+    }
+}
+
+void UdpProbe::finish_(ProbeResult r) {
+    r.dnsCached = dnsCached_;
+    r.phases.dnsUs = dnsNs_ >= 0 ? dnsNs_ / 1000 : -1;
+    r.phases.totalUs = elapsed_.nsecsElapsed() / 1000;
+    abort();
+    emit finished(r);
+}
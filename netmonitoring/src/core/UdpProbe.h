@@ -0,0 +1,42 @@
+#pragma once
+#include "INetProbe.h"
+#include <QTimer>
+#include <QElapsedTimer>
+
+// UDP request/response probe backed by UdpEngine (Linux). One sample is a train of
+// `udpPackets` datagrams `udpSpacingMs` apart: echo packets (RFC 862 server) or
+// DNS queries. latencyMs/Ns is the mean RTT of the answered packets; the result
+// also carries the loss (packetsSent vs packetsReceived) and the jitter, the mean
+// difference between consecutive RTTs as in RFC 3550.
+class UdpProbe : public INetProbe {
+    Q_OBJECT
+public:
+    explicit UdpProbe(bool dns, QObject* parent = nullptr);
+    ~UdpProbe() override;
+
+    void start(const QString& host, quint16 port, int timeoutMs) override;
+    void abort() override;
+    void configure(const ProbeTarget& target) override;
+
+private:
+    void finish_(ProbeResult r);
+
+    QTimer timeout_;                      // только на фазу DNS
+    QElapsedTimer elapsed_;
+
+    const bool dns_;
+    QString host_;
+    quint16 port_ = 0;
+    int timeoutMs_ = 3000;
+    int packets_ = 5;
+    int spacingMs_ = 20;
+    QByteArray query_;
+    QString ip_;
+    qint64 dnsMs_ = -1;
+    bool dnsCached_ = false;
+    qint64 dnsNs_ = -1;
+
+    quint64 ticket_ = 0;                  // заявка в UdpEngine, 0 — нет
+    bool active_ = false;
+    quint64 run_ = 0;                     // номер запуска: отсекает колбэки прошлых запусков
+};
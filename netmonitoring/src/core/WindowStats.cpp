@@ -0,0 +1,98 @@
+#include "WindowStats.h"
+#include <cmath>
+
+int WindowStats::binOf(qint64 us) {
+    if (us < kFirstBinUs) return 0;
+    const int bin = 1 + int(2 * std::log2(double(us) / double(kFirstBinUs)));
+    return qMin(bin, kBins - 1);
+}
+
+qint64 WindowStats::binUpperUs(int bin) {
+    // Bin i >= 1 holds [0.5 ms * √2^(i-1), 0.5 ms * √2^i); the last one is open.
+    return qint64(std::ceil(double(kFirstBinUs) * std::pow(2.0, bin / 2.0)));
+}
+
+qint64 WindowStats::Summary::percentileUs(double q) const {
+    if (samples == 0) return -1;
+    const quint64 rank = qMax<quint64>(1, quint64(std::ceil(q / 100.0 * double(samples))));
+    quint64 seen = 0;
+    for (int b = 0; b < kBins; ++b) {
+        seen += bins[size_t(b)];
+        if (seen >= rank) return b == kBins - 1 ? maxUs : qBound(minUs, binUpperUs(b), maxUs);
+    }
+    return maxUs;
+}
+
+template <typename B>
+void WindowStats::record_(B& b, quint32 slot, const ProbeRecord& r) {
+    if (b.slot != slot) {
+        b = B();
+        b.slot = slot;
+    }
+    ++b.probes;
+    if (!r.isUp()) {
+        ++b.errors[r.status - 1];
+        return;
+    }
+    ++b.up;
+    const qint64 us = r.latencyUs();
+    if (us < 0) return;
+    const quint32 v = quint32(qMin<qint64>(us, 0xffffffffLL));
+    b.minUs = qMin(b.minUs, v);
+    b.maxUs = qMax(b.maxUs, v);
+    b.sumUs += v;
+    ++b.bins[binOf(us)];
+}
+
+void WindowStats::add(const ProbeRecord& r) {
+    const qint64 sec = r.finishedMs / 1000;
+    // Each tier gets the result directly: the minute and hour buckets are the rollups
+    // of the seconds without ever walking them.
+    record_(sec_[size_t(sec % 60)], quint32(sec), r);
+    record_(min_[size_t(sec / 60 % 60)], quint32(sec / 60), r);
+    record_(hour_[size_t(sec / 3600 % 24)], quint32(sec / 3600), r);
+}
+
+template <typename B, size_t N>
+void WindowStats::merge_(const std::array<B, N>& ring, qint64 newest, qint64 count, Summary* out) {
+    for (qint64 slot = newest - count + 1; slot <= newest; ++slot) {
+        const B& b = ring[size_t(slot % qint64(N))];
+        if (b.slot != quint32(slot)) continue;    // пусто или вытеснено
+        out->probes += b.probes;
+        out->up += b.up;
+        for (int i = 0; i < 4; ++i) out->errors[i] += b.errors[i];
+        quint64 samples = 0;
+        for (int i = 0; i < kBins; ++i) {
+            out->bins[size_t(i)] += b.bins[i];
+            samples += b.bins[i];
+        }
+        if (samples == 0) continue;
+        out->minUs = out->minUs < 0 ? qint64(b.minUs) : qMin(out->minUs, qint64(b.minUs));
+        out->maxUs = qMax(out->maxUs, qint64(b.maxUs));
+        out->avgUs += qint64(b.sumUs);            // сумма; делится в конце
+        out->samples += samples;
+    }
+}
+
+WindowStats::Summary WindowStats::query(int windowSec, qint64 nowMs) const {
+    Summary s;
+    const qint64 sec = nowMs / 1000;
+    windowSec = qBound(1, windowSec, 24 * 3600);
+    s.windowSec = windowSec;
+    s.avgUs = 0;
+    if (windowSec <= 60) {
+        merge_(sec_, sec, windowSec, &s);
+    } else if (windowSec <= 3600) {
+        merge_(min_, sec / 60, (windowSec + 59) / 60, &s);
+    } else {
+        merge_(hour_, sec / 3600, (windowSec + 3599) / 3600, &s);
+    }
+    s.avgUs = s.samples ? s.avgUs / qint64(s.samples) : -1;
+    return s;
+}
+
+void WindowStats::clear() {
+    sec_.fill(SecBucket());
+    min_.fill(MinBucket());
+    hour_.fill(HourBucket());
+}
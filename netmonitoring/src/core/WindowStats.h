@@ -0,0 +1,72 @@
+#pragma once
+#include <QtGlobal>
+#include <array>
+#include "ProbeRecord.h"
+
+// Time-windowed aggregates of one target's results: availability, errors by kind
+// and latency percentiles over the last minute, hour or day, whatever the probe
+// interval. Every result lands in three rings of fixed buckets (60 per-second,
+// 60 per-minute, 24 per-hour), so memory per target is constant, about 16 KB, and
+// a query merges at most 60 buckets and never touches raw samples. A window is
+// answered from the finest tier that spans it: the current bucket plus the whole
+// ones before it (5 min = this minute and the 4 before). Latency goes into kBins
+// log bins at √2 steps from 0.5 ms; a percentile reports its bin's upper bound,
+// capped by the window's maximum.
+class WindowStats {
+public:
+    static constexpr int kBins = 32;
+    static constexpr qint64 kFirstBinUs = 500;
+
+    struct Summary {
+        int windowSec = 0;
+        quint64 probes = 0;
+        quint64 up = 0;
+        quint64 errors[4] = {};           // по Status: Down, DnsFail, Timeout, Error
+        quint64 samples = 0;              // задержек в окне (успешные проверки)
+        qint64 minUs = -1;
+        qint64 maxUs = -1;
+        qint64 avgUs = -1;
+        std::array<quint64, kBins> bins{};
+
+        quint64 failed() const { return probes - up; }
+        // Percent of probes that were UP; -1 without probes
+        double availability() const { return probes ? 100.0 * double(up) / double(probes) : -1; }
+        // q in percent; -1 without samples
+        qint64 percentileUs(double q) const;
+    };
+
+    void add(const ProbeRecord& r);
+    // windowSec is rounded up to the tier's bucket and capped at 24 h
+    Summary query(int windowSec, qint64 nowMs) const;
+    void clear();
+
+    static int binOf(qint64 us);
+    static qint64 binUpperUs(int bin);
+
+private:
+    template <typename Count>
+    struct Bucket {
+        quint32 slot = 0;                 // номер секунды/минуты/часа с эпохи; 0 — пусто
+        Count probes = 0;
+        Count up = 0;
+        Count errors[4] = {};
+        quint32 minUs = 0xffffffff;
+        quint32 maxUs = 0;
+        quint64 sumUs = 0;
+        Count bins[kBins] = {};
+    };
+
+    // Счётчики по 16 бит: даже при интервале 1 мс в минуте меньше 65536 проверок
+    using SecBucket = Bucket<quint16>;
+    using MinBucket = Bucket<quint16>;
+    using HourBucket = Bucket<quint32>;
+
+    template <typename B>
+    static void record_(B& b, quint32 slot, const ProbeRecord& r);
+    template <typename B, size_t N>
+    static void merge_(const std::array<B, N>& ring, qint64 newest, qint64 count, Summary* out);
+
+    std::array<SecBucket, 60> sec_;
+    std::array<MinBucket, 60> min_;
+    std::array<HourBucket, 24> hour_;
+};
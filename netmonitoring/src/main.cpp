@@ -6,7 +6,7 @@ int main(int argc, char* argv[]) {
 
     NetworkMonitorWidget w;
     w.setWindowTitle(QObject::tr("Simple Network Monitor (Qt)"));
-    w.resize(700, 460);
+    w.resize(800, 620);
     w.show();
 
     return app.exec();
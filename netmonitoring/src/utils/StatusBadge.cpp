@@ -1,2 +1,85 @@
 #include "StatusBadge.h"
-// Function is inline in header; cpp is kept for build systems expecting a .cpp
+#include <QEvent>
+#include <QPainter>
+#include <QPainterPath>
+
+namespace {
+
+constexpr int kRadius = 8;
+constexpr int kPadX = 10;
+constexpr int kPadY = 6;
+constexpr int kMargin = 8;
+
+QPalette makePalette(const QColor& background) {
+    QPalette p;
+    p.setColor(QPalette::Window, background);
+    p.setColor(QPalette::WindowText, Qt::white);
+    return p;
+}
+
+} // namespace
+
+StatusBadge::StatusBadge(QWidget* parent)
+        : QWidget(parent) {
+    QFont f = font();
+    f.setWeight(QFont::DemiBold);
+    setFont(f);
+    setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+}
+
+const QPalette& StatusBadge::tonePalette(Tone tone) {
+    static const QPalette palettes[int(Tone::ToneCount)] = {
+        makePalette(QColor("#777")),      // Idle
+        makePalette(QColor("#777")),      // Busy
+        makePalette(QColor("#2e7d32")),   // Up
+        makePalette(QColor("#ef6c00")),   // Warn
+        makePalette(QColor("#c62828")),   // Down
+    };
+    return palettes[int(tone)];
+}
+
+void StatusBadge::setStatus(const QString& text, Tone tone) {
+    if (text == text_ && tone == tone_) return;
+    if (text != text_) {
+        text_ = text;
+        const QSize old = hint_;
+        hint_ = QSize();
+        // Only a wider or narrower text needs a relayout; a new tone is just a repaint.
+        if (sizeHint() != old) updateGeometry();
+    }
+    tone_ = tone;
+    update();
+}
+
+QSize StatusBadge::sizeHint() const {
+    if (!hint_.isValid()) {
+        const QFontMetrics fm(font());
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+        const int w = fm.horizontalAdvance(text_);
+#else
+        const int w = fm.width(text_);
+#endif
+        hint_ = QSize(w + 2 * (kPadX + kMargin), fm.height() + 2 * (kPadY + kMargin));
+    }
+    return hint_;
+}
+
+void StatusBadge::paintEvent(QPaintEvent*) {
+    const QPalette& pal = tonePalette(tone_);
+    QPainter p(this);
+    p.setRenderHint(QPainter::Antialiasing);
+    const QRectF pill = QRectF(rect()).adjusted(kMargin, kMargin, -kMargin, -kMargin);
+    p.setPen(Qt::NoPen);
+    p.setBrush(pal.color(QPalette::Window));
+    p.drawRoundedRect(pill, kRadius, kRadius);
+    p.setPen(pal.color(QPalette::WindowText));
+    p.drawText(pill, Qt::AlignCenter, text_);
+}
+
+void StatusBadge::changeEvent(QEvent* event) {
+    if (event->type() == QEvent::FontChange) {
+        hint_ = QSize();
+        updateGeometry();
+    }
+    QWidget::changeEvent(event);
+}
@@ -1,19 +1,33 @@
 #pragma once
 
-#include <QLabel>
-#include <QColor>
-
-inline void setStatusBadge(QLabel *label, const QString &text, const QColor &color) {
-    label->setText(text);
-    label->setAlignment(Qt::AlignCenter);
-    label->setMargin(8);
-    label->setStyleSheet(QString(
-            "QLabel {"
-            "  border-radius: 8px;"
-            "  padding: 6px 10px;"
-            "  font-weight: 600;"
-            "  background: %1;"
-            "  color: white;"
-            "}")
-                                 .arg(color.name()));
-}
\ No newline at end of file
+#include <QWidget>
+#include <QString>
+
+// Rounded status pill painted by hand. Each tone's palette is built once and
+// shared; a status change only swaps the tone and text and schedules a repaint,
+// with no stylesheet to parse and no re-polish.
+class StatusBadge : public QWidget {
+    Q_OBJECT
+public:
+    enum class Tone { Idle, Busy, Up, Warn, Down, ToneCount };
+
+    explicit StatusBadge(QWidget* parent = nullptr);
+
+    void setStatus(const QString& text, Tone tone);
+    QString text() const { return text_; }
+    Tone tone() const { return tone_; }
+
+    QSize sizeHint() const override;
+    QSize minimumSizeHint() const override { return sizeHint(); }
+
+    static const QPalette& tonePalette(Tone tone);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void changeEvent(QEvent* event) override;
+
+private:
+    QString text_;
+    Tone tone_ = Tone::Idle;
+    mutable QSize hint_;                  // пересчитывается при смене текста/шрифта
+};
@@ -0,0 +1,276 @@
+#include "LatencyChart.h"
+#include <QDateTime>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QWheelEvent>
+#include <cmath>
+
+namespace {
+
+constexpr int kLeftMargin = 56;
+constexpr int kRightMargin = 8;
+constexpr int kTopMargin = 8;
+constexpr int kBottomMargin = 20;
+constexpr int kStatusH = 6;                       // полоса статуса под графиком
+constexpr qint64 kMaxMsPerPx = 24 * 3600 * 1000LL;
+
+const QColor kLatencyColor("#1565c0");
+const QColor kUpColor("#2e7d32");
+const QColor kFailColor("#c62828");
+
+qint64 floorDiv(qint64 a, qint64 b) {
+    const qint64 q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+double niceCeil(double v) {
+    if (v <= 0) return 10.0;
+    v *= 1.1;
+    const double mag = std::pow(10.0, std::floor(std::log10(v)));
+    for (double m : {1.0, 2.0, 5.0, 10.0}) {
+        if (m * mag >= v) return m * mag;
+    }
+    return 10.0 * mag;
+}
+
+QString scaleText(qint64 msPerPx) {
+    if (msPerPx < 1000) return QObject::tr("1 px = %1 мс").arg(msPerPx);
+    if (msPerPx < 60000) return QObject::tr("1 px = %1 с").arg(double(msPerPx) / 1000.0, 0, 'g', 3);
+    return QObject::tr("1 px = %1 мин").arg(double(msPerPx) / 60000.0, 0, 'g', 3);
+}
+
+} // namespace
+
+LatencyChart::LatencyChart(QWidget* parent)
+        : QWidget(parent) {
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMouseTracking(false);
+    frameTimer_.setSingleShot(true);
+    frameTimer_.setInterval(16);
+    QObject::connect(&frameTimer_, &QTimer::timeout, this, [this]{ update(); });
+}
+
+void LatencyChart::append(qint64 tsMs, double latencyMs, bool up) {
+    series_.append(tsMs, latencyMs, up);
+    const qint64 ts = series_.lastTs();
+    if (!dirty_ || ts < dirtyFromTs_) dirtyFromTs_ = ts;
+    dirty_ = true;
+    scheduleFrame_();
+}
+
+void LatencyChart::clear() {
+    series_.clear();
+    follow_ = true;
+    dirty_ = false;
+    invalidate_();
+}
+
+void LatencyChart::setFollowing(bool on) {
+    if (follow_ == on) return;
+    follow_ = on;
+    update();
+}
+
+void LatencyChart::setMsPerPixel(qint64 ms) {
+    ms = qBound<qint64>(1, ms, kMaxMsPerPx);
+    if (ms == msPerPx_) return;
+    msPerPx_ = ms;
+    invalidate_();
+}
+
+QRect LatencyChart::plotRect_() const {
+    return rect().adjusted(kLeftMargin, kTopMargin, -kRightMargin, -kBottomMargin);
+}
+
+void LatencyChart::invalidate_() {
+    cacheValid_ = false;
+    update();
+}
+
+void LatencyChart::scheduleFrame_() {
+    // Bursts of results are drawn once per frame.
+    if (!frameTimer_.isActive()) frameTimer_.start();
+}
+
+void LatencyChart::updateView_(int width) {
+    if (!follow_) return;
+    const qint64 last = series_.empty() ? QDateTime::currentMSecsSinceEpoch() : series_.lastTs();
+    firstCol_ = floorDiv(last, msPerPx_) - width + 1;
+}
+
+double LatencyChart::visibleMax_(int width) const {
+    const int from = series_.lowerBound(firstCol_ * msPerPx_);
+    const int to = series_.lowerBound((firstCol_ + width) * msPerPx_);
+    const LatencySeries::Span s = series_.span(from, to);
+    return s.up() > 0 ? double(s.maxMs) : 0.0;
+}
+
+int LatencyChart::yFor_(double ms, int plotHeight) const {
+    const double k = yMax_ > 0 ? ms / yMax_ : 0.0;
+    return qBound(0, plotHeight - 1 - int(std::lround(k * (plotHeight - 1))), plotHeight - 1);
+}
+
+void LatencyChart::paintEvent(QPaintEvent*) {
+    QPainter p(this);
+    p.fillRect(rect(), palette().window());
+    const QRect pr = plotRect_();
+    if (pr.width() <= 0 || pr.height() <= kStatusH + 2) return;
+    const int w = pr.width();
+
+    updateView_(w);
+    const double yMax = niceCeil(visibleMax_(w));
+
+    bool full = !cacheValid_ || cache_.size() != pr.size() || yMax != cacheYMax_;
+    if (!full && qAbs(firstCol_ - cacheFirstCol_) >= w) full = true;
+
+    if (full) {
+        cache_ = QPixmap(pr.size());
+        cacheFirstCol_ = firstCol_;
+        cacheYMax_ = yMax_ = yMax;
+        renderColumns_(0, w);
+        cacheValid_ = true;
+    } else {
+        const qint64 shift = firstCol_ - cacheFirstCol_;
+        if (shift != 0) {
+            // History stays where it was drawn; only the exposed columns are new.
+            cache_.scroll(int(-shift), 0, cache_.rect());
+            cacheFirstCol_ = firstCol_;
+            if (shift > 0) renderColumns_(w - int(shift), w);
+            else renderColumns_(0, int(-shift));
+        }
+        if (dirty_) {
+            const qint64 col = floorDiv(dirtyFromTs_, msPerPx_) - firstCol_;
+            if (col < w) renderColumns_(int(qMax<qint64>(0, col)), w);
+        }
+    }
+    dirty_ = false;
+
+    p.drawPixmap(pr.topLeft(), cache_);
+
+    // Axes and labels are cheap and drawn over the cached plot every frame.
+    const int plotH = pr.height() - kStatusH - 1;
+    p.setPen(palette().color(QPalette::Mid));
+    p.drawRect(pr.adjusted(0, 0, -1, -1));
+    const QColor text = palette().color(QPalette::WindowText);
+    const QFontMetrics fm = p.fontMetrics();
+    for (double frac : {0.0, 0.5, 1.0}) {
+        const int y = pr.top() + yFor_(yMax_ * frac, plotH);
+        p.setPen(palette().color(QPalette::Midlight));
+        if (frac > 0) p.drawLine(pr.left(), y, pr.right(), y);
+        p.setPen(text);
+        const QString label = tr("%1 мс").arg(yMax_ * frac, 0, 'g', 4);
+        p.drawText(QRect(0, y - fm.height() / 2, kLeftMargin - 4, fm.height()), Qt::AlignRight | Qt::AlignVCenter, label);
+    }
+
+    const qint64 leftTs = firstCol_ * msPerPx_;
+    const qint64 rightTs = (firstCol_ + w) * msPerPx_;
+    const QString fmt = (rightTs - leftTs) > 86400 * 1000LL ? QStringLiteral("dd.MM HH:mm") : QStringLiteral("HH:mm:ss");
+    const QRect axis(pr.left(), pr.bottom() + 2, w, kBottomMargin - 2);
+    p.drawText(axis, Qt::AlignLeft | Qt::AlignVCenter, QDateTime::fromMSecsSinceEpoch(leftTs).toString(fmt));
+    p.drawText(axis, Qt::AlignRight | Qt::AlignVCenter, QDateTime::fromMSecsSinceEpoch(rightTs).toString(fmt));
+    QString hint = scaleText(msPerPx_);
+    if (!follow_) hint += tr(" · история (двойной щелчок — к текущему)");
+    p.drawText(axis, Qt::AlignHCenter | Qt::AlignVCenter, hint);
+}
+
+void LatencyChart::renderColumns_(int x0, int x1) {
+    if (x0 >= x1) return;
+    QPainter p(&cache_);
+    const int h = cache_.height();
+    const int plotH = h - kStatusH - 1;
+    p.fillRect(QRect(x0, 0, x1 - x0, h), palette().base());
+    if (series_.empty()) return;
+
+    // Line continuity across the left edge comes from the sample just before it.
+    int idx = series_.lowerBound((firstCol_ + x0) * msPerPx_);
+    bool prevOk = false;
+    int prevX = 0;
+    double prevMin = 0, prevMax = 0;
+    if (idx > 0 && series_.latencyAt(idx - 1) >= 0) {
+        prevOk = true;
+        prevX = int(floorDiv(series_.tsAt(idx - 1), msPerPx_) - firstCol_);
+        prevMin = prevMax = series_.latencyAt(idx - 1);
+    }
+
+    p.setPen(kLatencyColor);
+    for (int x = x0; x < x1 && idx < series_.size(); ++x) {
+        const int end = series_.lowerBound((firstCol_ + x + 1) * msPerPx_);
+        if (end == idx) continue;
+        const LatencySeries::Span s = series_.span(idx, end);
+        idx = end;
+
+        p.fillRect(QRect(x, plotH + 1, 1, kStatusH), s.failures ? kFailColor : kUpColor);
+        if (s.up() == 0) {
+            prevOk = false;               // a failed column breaks the line
+            continue;
+        }
+        if (prevOk && prevX == x - 1) {
+            // Min/max envelope stretched to touch the neighbour keeps the line connected.
+            const double lo = qMin<double>(s.minMs, prevMax);
+            const double hi = qMax<double>(s.maxMs, prevMin);
+            p.drawLine(x, yFor_(lo, plotH), x, yFor_(hi, plotH));
+        } else {
+            if (prevOk) {
+                p.drawLine(prevX, yFor_((prevMin + prevMax) / 2, plotH),
+                           x, yFor_((double(s.minMs) + s.maxMs) / 2, plotH));
+            }
+            p.drawLine(x, yFor_(s.minMs, plotH), x, yFor_(s.maxMs, plotH));
+        }
+        prevOk = true;
+        prevX = x;
+        prevMin = s.minMs;
+        prevMax = s.maxMs;
+    }
+}
+
+void LatencyChart::resizeEvent(QResizeEvent* event) {
+    QWidget::resizeEvent(event);
+    cacheValid_ = false;
+}
+
+void LatencyChart::wheelEvent(QWheelEvent* event) {
+    const int delta = event->angleDelta().y();
+    if (delta == 0) return;
+    const QRect pr = plotRect_();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    const int mouseX = int(event->position().x());
+#else
+    const int mouseX = event->pos().x();
+#endif
+    const int ax = qBound(0, mouseX - pr.left(), qMax(0, pr.width() - 1));
+
+    const double factor = std::pow(1.25, -double(delta) / 120.0);
+    qint64 ms = qBound<qint64>(1, qint64(std::llround(double(msPerPx_) * factor)), kMaxMsPerPx);
+    if (ms == msPerPx_) ms = qBound<qint64>(1, msPerPx_ + (delta > 0 ? -1 : 1), kMaxMsPerPx);
+
+    // Keep the time under the cursor in place (in live view the right edge stays pinned).
+    const qint64 anchorTs = (firstCol_ + ax) * msPerPx_;
+    msPerPx_ = ms;
+    firstCol_ = floorDiv(anchorTs, msPerPx_) - ax;
+    invalidate_();
+    event->accept();
+}
+
+void LatencyChart::mousePressEvent(QMouseEvent* event) {
+    if (event->button() != Qt::LeftButton) return;
+    dragging_ = true;
+    dragX_ = event->pos().x();
+    dragFirstCol_ = firstCol_;
+}
+
+void LatencyChart::mouseMoveEvent(QMouseEvent* event) {
+    if (!dragging_) return;
+    const int dx = event->pos().x() - dragX_;
+    if (dx == 0) return;
+    follow_ = false;
+    firstCol_ = dragFirstCol_ - dx;
+    update();
+}
+
+void LatencyChart::mouseReleaseEvent(QMouseEvent* event) {
+    if (event->button() == Qt::LeftButton) dragging_ = false;
+}
+
+void LatencyChart::mouseDoubleClickEvent(QMouseEvent* event) {
+    if (event->button() == Qt::LeftButton) setFollowing(true);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <QWidget>
+#include <QPixmap>
+#include <QTimer>
+#include "LatencySeries.h"
+
+// Latency/status time-series chart. Time is quantized into pixel columns and
+// every column is drawn from the min/max summary of its samples, so a frame costs
+// O(width * log n) no matter how many samples are in view. The plot is cached in a
+// pixmap: new samples only scroll it and render the freshly exposed columns.
+// Wheel zooms around the cursor, drag pans, double click returns to live view.
+class LatencyChart : public QWidget {
+    Q_OBJECT
+public:
+    explicit LatencyChart(QWidget* parent = nullptr);
+
+    void append(qint64 tsMs, double latencyMs, bool up);
+    void clear();
+    void setCapacity(int samples) { series_.setCapacity(samples); invalidate_(); }
+    const LatencySeries& series() const { return series_; }
+
+    bool isFollowing() const { return follow_; }
+    void setFollowing(bool on);
+    qint64 msPerPixel() const { return msPerPx_; }
+    void setMsPerPixel(qint64 ms);
+
+    QSize sizeHint() const override { return {600, 180}; }
+    QSize minimumSizeHint() const override { return {200, 100}; }
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+
+private:
+    QRect plotRect_() const;
+    void invalidate_();
+    void scheduleFrame_();
+    void updateView_(int width);
+    double visibleMax_(int width) const;
+    void renderColumns_(int x0, int x1);
+    int yFor_(double ms, int plotHeight) const;
+
+    LatencySeries series_;
+    QTimer frameTimer_;
+
+    qint64 msPerPx_ = 1000;               // длительность одного столбца пикселей
+    qint64 firstCol_ = 0;                 // абсолютный номер столбца у левого края
+    bool follow_ = true;                  // правый край — последний отсчёт
+    double yMax_ = 0;
+
+    // Отрисованный график и вид, для которого он отрисован
+    QPixmap cache_;
+    bool cacheValid_ = false;
+    qint64 cacheFirstCol_ = 0;
+    double cacheYMax_ = 0;
+    qint64 dirtyFromTs_ = 0;              // самый ранний отсчёт, ещё не попавший в кэш
+    bool dirty_ = false;
+
+    bool dragging_ = false;
+    int dragX_ = 0;
+    qint64 dragFirstCol_ = 0;
+};
@@ -0,0 +1,125 @@
+#include "LatencySeries.h"
+#include <algorithm>
+
+void LatencySeries::Span::add(const Span& o) {
+    if (o.up() > 0) {
+        if (up() == 0) {
+            minMs = o.minMs;
+            maxMs = o.maxMs;
+        } else {
+            minMs = qMin(minMs, o.minMs);
+            maxMs = qMax(maxMs, o.maxMs);
+        }
+    }
+    count += o.count;
+    failures += o.failures;
+}
+
+LatencySeries::Span LatencySeries::sampleSpan_(float latency) {
+    Span s;
+    s.count = 1;
+    if (latency < 0) {
+        s.failures = 1;
+    } else {
+        s.minMs = s.maxMs = latency;
+    }
+    return s;
+}
+
+void LatencySeries::setCapacity(int samples) {
+    cap_ = qMax(kFanout * 2, samples);
+    if (size() > cap_) {
+        const size_t drop = ts_.size() - size_t(cap_);
+        ts_.erase(ts_.begin(), ts_.begin() + drop);
+        lat_.erase(lat_.begin(), lat_.begin() + drop);
+        rebuild_();
+    }
+}
+
+void LatencySeries::clear() {
+    ts_.clear();
+    lat_.clear();
+    levels_.clear();
+}
+
+void LatencySeries::append(qint64 tsMs, double latencyMs, bool up) {
+    if (size() >= cap_) {
+        // Dropping half at once keeps the O(n) pyramid rebuild amortized O(1).
+        const size_t drop = size_t(cap_ / 2);
+        ts_.erase(ts_.begin(), ts_.begin() + drop);
+        lat_.erase(lat_.begin(), lat_.begin() + drop);
+        rebuild_();
+    }
+    if (!ts_.empty()) tsMs = qMax(tsMs, ts_.back());
+    ts_.push_back(tsMs);
+    lat_.push_back(up && latencyMs >= 0 ? float(latencyMs) : -1.0f);
+    addToPyramid_(size() - 1);
+}
+
+void LatencySeries::addToPyramid_(int index) {
+    const Span s = sampleSpan_(lat_[size_t(index)]);
+    for (size_t level = 0; level < levels_.size(); ++level) {
+        auto& lv = levels_[level];
+        const size_t block = size_t(index) >> (kFanoutBits * (level + 1));
+        if (block == lv.size()) lv.emplace_back();
+        lv[block].add(s);
+    }
+    // A level exists once it has one complete block; its first block covers everything so far.
+    if (ts_.size() == size_t(1) << (kFanoutBits * (levels_.size() + 1))) {
+        Span all;
+        if (levels_.empty()) {
+            for (float v : lat_) all.add(sampleSpan_(v));
+        } else {
+            for (const Span& b : levels_.back()) all.add(b);
+        }
+        levels_.push_back({all});
+    }
+}
+
+void LatencySeries::rebuild_() {
+    levels_.clear();
+    for (int level = 0;; ++level) {
+        const int shift = kFanoutBits * (level + 1);
+        if (ts_.size() < (size_t(1) << shift)) break;
+        std::vector<Span> lv((ts_.size() + (size_t(1) << shift) - 1) >> shift);
+        if (level == 0) {
+            for (size_t i = 0; i < lat_.size(); ++i) lv[i >> shift].add(sampleSpan_(lat_[i]));
+        } else {
+            const auto& below = levels_[size_t(level - 1)];
+            for (size_t i = 0; i < below.size(); ++i) lv[i >> kFanoutBits].add(below[i]);
+        }
+        levels_.push_back(std::move(lv));
+    }
+}
+
+int LatencySeries::lowerBound(qint64 tsMs) const {
+    return int(std::lower_bound(ts_.begin(), ts_.end(), tsMs) - ts_.begin());
+}
+
+LatencySeries::Span LatencySeries::span(int from, int to) const {
+    Span s;
+    int lo = qMax(0, from);
+    int hi = qMin(size(), to);
+    if (lo >= hi) return s;
+
+    auto unit = [this, &s](int level, int u) {
+        if (level == 0) s.add(sampleSpan_(lat_[size_t(u)]));
+        else s.add(levels_[size_t(level - 1)][size_t(u)]);
+    };
+
+    // Climb while a whole block of the next level fits into [lo, hi): consume the
+    // unaligned head and tail at the current level, then continue one level up.
+    int level = 0;
+    while (level < int(levels_.size())) {
+        const int sh = kFanoutBits * level;
+        const int nextSh = sh + kFanoutBits;
+        const int nextMask = (1 << nextSh) - 1;
+        if (((lo + nextMask) >> nextSh) >= (hi >> nextSh)) break;
+        while (lo & nextMask) { unit(level, lo >> sh); lo += 1 << sh; }
+        while (hi & nextMask) { hi -= 1 << sh; unit(level, hi >> sh); }
+        ++level;
+    }
+    const int sh = kFanoutBits * level;
+    for (int u = lo >> sh; u < (hi >> sh); ++u) unit(level, u);
+    return s;
+}
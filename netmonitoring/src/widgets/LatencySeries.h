@@ -0,0 +1,49 @@
+#pragma once
+#include <QtGlobal>
+#include <vector>
+
+// Append-only latency series for charting. Besides the raw samples it keeps a
+// min/max pyramid (every level aggregates kFanout entries of the level below),
+// so the summary of any index range costs O(kFanout * levels), independent of
+// how many samples the range holds. Timestamps must not decrease.
+class LatencySeries {
+public:
+    static constexpr int kFanoutBits = 4;
+    static constexpr int kFanout = 1 << kFanoutBits;
+
+    struct Span {
+        float minMs = 0;                  // только по успешным отсчётам
+        float maxMs = 0;
+        quint32 count = 0;
+        quint32 failures = 0;
+
+        quint32 up() const { return count - failures; }
+        void add(const Span& o);
+    };
+
+    void setCapacity(int samples);        // the oldest half is dropped when full
+    int capacity() const { return cap_; }
+
+    void append(qint64 tsMs, double latencyMs, bool up);
+    void clear();
+
+    int size() const { return int(ts_.size()); }
+    bool empty() const { return ts_.empty(); }
+    qint64 tsAt(int i) const { return ts_[size_t(i)]; }
+    float latencyAt(int i) const { return lat_[size_t(i)]; }   // < 0 — неуспешная проверка
+    qint64 firstTs() const { return ts_.empty() ? 0 : ts_.front(); }
+    qint64 lastTs() const { return ts_.empty() ? 0 : ts_.back(); }
+
+    int lowerBound(qint64 tsMs) const;    // first index with ts >= tsMs
+    Span span(int from, int to) const;    // samples [from, to)
+
+private:
+    static Span sampleSpan_(float latency);
+    void addToPyramid_(int index);
+    void rebuild_();
+
+    std::vector<qint64> ts_;
+    std::vector<float> lat_;
+    std::vector<std::vector<Span>> levels_;   // levels_[k] — блоки по kFanout^(k+1) отсчётов
+    int cap_ = 2'000'000;
+};
@@ -0,0 +1,90 @@
+#include "LogModel.h"
+#include <QIODevice>
+
+LogModel::LogModel(QObject* parent)
+        : QAbstractListModel(parent) {
+    ring_.resize(cap_);
+    flushTimer_.setSingleShot(true);
+    flushTimer_.setInterval(16);
+    QObject::connect(&flushTimer_, &QTimer::timeout, this, [this]{ flush(); });
+}
+
+void LogModel::setCapacity(int lines) {
+    lines = qMax(1, lines);
+    if (lines == cap_) return;
+    flush();
+
+    beginResetModel();
+    const int keep = qMin(size_, lines);
+    QVector<QString> ring(lines);
+    for (int i = 0; i < keep; ++i) ring[i] = at_(size_ - keep + i);
+    ring_.swap(ring);
+    cap_ = lines;
+    head_ = 0;
+    size_ = keep;
+    endResetModel();
+}
+
+void LogModel::append(const QString& line) {
+    pending_.append(line);
+    // A burst larger than the ring would only be trimmed again.
+    if (pending_.size() > cap_) pending_.removeFirst();
+    if (!flushTimer_.isActive()) flushTimer_.start();
+}
+
+void LogModel::clear() {
+    flushTimer_.stop();
+    pending_.clear();
+    beginResetModel();
+    for (auto& s : ring_) s.clear();
+    head_ = size_ = 0;
+    endResetModel();
+}
+
+void LogModel::flush() {
+    flushTimer_.stop();
+    if (pending_.isEmpty()) return;
+    const int n = pending_.size();
+
+    const int overflow = size_ + n - cap_;
+    if (overflow > 0) dropOldest_(qMin(overflow, size_));
+
+    beginInsertRows(QModelIndex(), size_, size_ + n - 1);
+    for (const QString& line : pending_) {
+        ring_[(head_ + size_) % cap_] = line;
+        ++size_;
+    }
+    endInsertRows();
+    pending_.clear();
+    emit flushed();
+}
+
+void LogModel::dropOldest_(int n) {
+    if (n <= 0) return;
+    beginRemoveRows(QModelIndex(), 0, n - 1);
+    for (int i = 0; i < n; ++i) ring_[(head_ + i) % cap_].clear();
+    head_ = (head_ + n) % cap_;
+    size_ -= n;
+    endRemoveRows();
+}
+
+bool LogModel::writeTo(QIODevice* dev) const {
+    for (int i = 0; i < size_; ++i) {
+        const QByteArray bytes = at_(i).toUtf8();
+        if (dev->write(bytes) != bytes.size() || dev->write("\n", 1) != 1) return false;
+    }
+    for (const QString& line : pending_) {
+        const QByteArray bytes = line.toUtf8();
+        if (dev->write(bytes) != bytes.size() || dev->write("\n", 1) != 1) return false;
+    }
+    return true;
+}
+
+int LogModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : size_;
+}
+
+QVariant LogModel::data(const QModelIndex& index, int role) const {
+    if (role != Qt::DisplayRole || !index.isValid() || index.row() >= size_) return {};
+    return at_(index.row());
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <QAbstractListModel>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+class QIODevice;
+
+// Bounded log for a virtualized view: a ring of the newest lines. Appends are
+// buffered and published to the view at most once per frame.
+class LogModel : public QAbstractListModel {
+    Q_OBJECT
+public:
+    explicit LogModel(QObject* parent = nullptr);
+
+    void setCapacity(int lines);
+    int capacity() const { return cap_; }
+
+    void append(const QString& line);
+    void clear();
+    void flush();                         // publish pending lines right away
+
+    bool writeTo(QIODevice* dev) const;   // all retained lines, oldest first
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+signals:
+    void flushed();
+
+private:
+    const QString& at_(int row) const { return ring_[(head_ + row) % cap_]; }
+    void dropOldest_(int n);
+
+    QVector<QString> ring_;
+    int cap_ = 10000;
+    int head_ = 0;                        // индекс самой старой строки
+    int size_ = 0;
+    QStringList pending_;                 // ещё не показанные строки
+    QTimer flushTimer_;
+};
@@ -3,33 +3,50 @@
 #include <QPushButton>
 #include <QLineEdit>
 #include <QSpinBox>
-#include <QPlainTextEdit>
+#include <QListView>
+#include <QTableView>
+#include <QHeaderView>
+#include <QScrollBar>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QDateTime>
 #include <QFileDialog>
 #include <QFile>
-#include <QTextStream>
 #include <QComboBox>
-#include "utils/StatusBadge.h"
+#include <QCheckBox>
+#include "LatencyChart.h"
 
 static QString nowStr() {
     return QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
 }
 
+static QString phaseMs(qint64 us) {
+    return us < 0 ? QStringLiteral("—") : QString::number(double(us) / 1000.0, 'f', 1);
+}
+
 NetworkMonitorWidget::NetworkMonitorWidget(QWidget* parent)
         : QWidget(parent) {
+    // Probes run off the UI thread, so repaints and log appends never delay their timers.
+    controller_.setWorkerThreads(1);
+    uiTimer_.setSingleShot(true);
+    uiTimer_.setInterval(16);
+    QObject::connect(&uiTimer_, &QTimer::timeout, this, &NetworkMonitorWidget::flushUi_);
     setupUi_();
     wireSignals_();
 }
 
 void NetworkMonitorWidget::setupUi_() {
-    statusLabel_ = new QLabel("—", this);
-    setStatusBadge(statusLabel_, tr("Ожидание"), QColor("#777"));
+    statusBadge_ = new StatusBadge(this);
+    statusBadge_->setStatus(tr("Ожидание"), StatusBadge::Tone::Idle);
 
     modeCombo_ = new QComboBox(this);
     modeCombo_->addItem(tr("TCP connect"));
     modeCombo_->addItem(tr("HTTP HEAD"));
+    modeCombo_->addItem(tr("TCP connect (epoll)"));
+    modeCombo_->addItem(tr("TCP connect (все адреса)"));
+    modeCombo_->addItem(tr("UDP echo"));
+    modeCombo_->addItem(tr("UDP DNS"));
+    modeCombo_->addItem(tr("TLS handshake"));
 
     hostEdit_ = new QLineEdit(QStringLiteral("red-byte.ru"), this);
     hostEdit_->setPlaceholderText(tr("Хост, например: red-byte.ru"));
@@ -43,6 +60,9 @@ void NetworkMonitorWidget::setupUi_() {
     intervalSpin_->setValue(5);
     intervalSpin_->setSuffix(tr(" сек"));
 
+    keepAliveCheck_ = new QCheckBox(tr("Keep-alive"), this);
+    keepAliveCheck_->setToolTip(tr("HTTP: переиспользовать соединение между проверками"));
+
     startStopBtn_ = new QPushButton(tr("Старт"), this);
     checkOnceBtn_ = new QPushButton(tr("Проверить сейчас"), this);
     saveLogBtn_   = new QPushButton(tr("Сохранить лог…"), this);
@@ -52,9 +72,33 @@ void NetworkMonitorWidget::setupUi_() {
     httpLabel_    = new QLabel(tr("HTTP: —"), this);
     statsLabel_   = new QLabel(tr("Статистика: —"), this);
 
-    log_ = new QPlainTextEdit(this);
-    log_->setReadOnly(true);
-    log_->setPlaceholderText(tr("Лог проверок будет здесь…"));
+    logToFileCheck_ = new QCheckBox(tr("Писать в файл"), this);
+    logToFileCheck_->setToolTip(tr("Потоковая запись лога с ротацией по размеру"));
+
+    chart_ = new LatencyChart(this);
+    chart_->setToolTip(tr("Колесо — масштаб, перетаскивание — прокрутка, двойной щелчок — к текущему"));
+
+    targetsModel_.attach(&controller_);
+    targetsView_ = new QTableView(this);
+    targetsView_->setModel(&targetsModel_);
+    targetsView_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    targetsView_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    targetsView_->verticalHeader()->hide();
+    // Fixed row height and column widths: a dataChanged never triggers a relayout
+    targetsView_->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    targetsView_->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    targetsView_->horizontalHeader()->setSectionResizeMode(TargetTableModel::TargetCol, QHeaderView::Stretch);
+
+    addTargetBtn_ = new QPushButton(tr("В таблицу"), this);
+    addTargetBtn_->setToolTip(tr("Добавить текущий хост отдельной целью"));
+    removeTargetBtn_ = new QPushButton(tr("Убрать"), this);
+
+    // Only visible rows are laid out; the model keeps the newest lines only
+    log_ = new QListView(this);
+    log_->setModel(&logModel_);
+    log_->setUniformItemSizes(true);
+    log_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    log_->setSelectionMode(QAbstractItemView::ExtendedSelection);
 
     auto *top = new QHBoxLayout();
     top->addWidget(new QLabel(tr("Режим:"), this));
@@ -68,10 +112,12 @@ void NetworkMonitorWidget::setupUi_() {
     top->addWidget(new QLabel(tr("Интервал:"), this));
     top->addWidget(intervalSpin_);
     top->addSpacing(8);
+    top->addWidget(keepAliveCheck_);
+    top->addSpacing(8);
     top->addWidget(startStopBtn_);
 
     auto *mid = new QHBoxLayout();
-    mid->addWidget(statusLabel_, 0);
+    mid->addWidget(statusBadge_, 0);
     mid->addSpacing(8);
     mid->addWidget(latencyLabel_, 1);
     mid->addSpacing(8);
@@ -85,26 +131,40 @@ void NetworkMonitorWidget::setupUi_() {
     bottom->addWidget(statsLabel_, 1);
     bottom->addStretch();
     bottom->addWidget(saveLogBtn_);
+    bottom->addWidget(logToFileCheck_);
 
     auto *layout = new QVBoxLayout(this);
     layout->addLayout(top);
     layout->addLayout(mid);
     layout->addLayout(bottom);
+    layout->addWidget(chart_, 2);
+
+    auto *targets = new QHBoxLayout();
+    targets->addWidget(targetsView_, 1);
+    auto *targetButtons = new QVBoxLayout();
+    targetButtons->addWidget(addTargetBtn_);
+    targetButtons->addWidget(removeTargetBtn_);
+    targetButtons->addStretch();
+    targets->addLayout(targetButtons);
+    layout->addLayout(targets, 1);
     layout->addWidget(log_, 1);
 }
 
 void NetworkMonitorWidget::wireSignals_() {
     QObject::connect(modeCombo_, qOverload<int>(&QComboBox::currentIndexChanged), this, [this](int idx){
-        controller_.setMode(idx == 0 ? MonitorController::Mode::TcpConnect
-                                     : MonitorController::Mode::HttpHead);
+        // Combo rows follow ProbeTarget::Mode order
+        controller_.setMode(static_cast<MonitorController::Mode>(idx));
+        chart_->clear();
     });
 
     QObject::connect(hostEdit_, &QLineEdit::textEdited, this, [this](const QString& t){
         controller_.setTarget(t.trimmed(), static_cast<quint16>(portSpin_->value()));
+        chart_->clear();
     });
 
     QObject::connect(portSpin_, qOverload<int>(&QSpinBox::valueChanged), this, [this](int p){
         controller_.setTarget(hostEdit_->text().trimmed(), static_cast<quint16>(p));
+        chart_->clear();
     });
 
     QObject::connect(intervalSpin_, qOverload<int>(&QSpinBox::valueChanged), this, [this](int s){
@@ -112,6 +172,10 @@ void NetworkMonitorWidget::wireSignals_() {
         appendLog_(tr("Интервал изменён на %1 сек.").arg(s));
     });
 
+    QObject::connect(keepAliveCheck_, &QCheckBox::toggled, this, [this](bool on){
+        controller_.setKeepAlive(on);
+    });
+
     QObject::connect(checkOnceBtn_, &QPushButton::clicked, this, [this]{ controller_.checkOnce(); });
 
     QObject::connect(startStopBtn_, &QPushButton::clicked, this, [this]{
@@ -139,76 +203,155 @@ void NetworkMonitorWidget::wireSignals_() {
             appendLog_(tr("Не удалось сохранить лог: %1").arg(f.errorString()));
             return;
         }
-        QTextStream ts(&f);
-        ts << log_->toPlainText();
+        if (!logModel_.writeTo(&f)) {
+            appendLog_(tr("Не удалось сохранить лог: %1").arg(f.errorString()));
+            return;
+        }
         f.close();
         appendLog_(tr("Лог сохранён: %1").arg(path));
     });
 
+    QObject::connect(logToFileCheck_, &QCheckBox::toggled, this, [this](bool on){
+        if (!on) {
+            if (logSink_.isOpen()) appendLog_(tr("Запись лога в файл остановлена."));
+            logSink_.close();
+            return;
+        }
+        const QString path = QFileDialog::getSaveFileName(this, tr("Писать лог в файл"),
+                                                          QStringLiteral("netlog.txt"),
+                                                          tr("Текстовые файлы (*.txt);;Все файлы (*)"),
+                                                          nullptr, QFileDialog::DontConfirmOverwrite);
+        if (path.isEmpty() || !logSink_.open(path)) {
+            if (!path.isEmpty()) appendLog_(tr("Не удалось открыть файл лога: %1").arg(logSink_.errorString()));
+            const QSignalBlocker block(logToFileCheck_);
+            logToFileCheck_->setChecked(false);
+            return;
+        }
+        appendLog_(tr("Лог пишется в %1").arg(path));
+    });
+
+    QObject::connect(log_->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int v){
+        followLog_ = v == log_->verticalScrollBar()->maximum();
+    });
+    QObject::connect(&logModel_, &LogModel::flushed, this, [this]{
+        if (followLog_) log_->scrollToBottom();
+    });
+
+    QObject::connect(addTargetBtn_, &QPushButton::clicked, this, [this]{
+        ProbeTarget t = controller_.target(controller_.primaryTarget());
+        t.host = hostEdit_->text().trimmed();
+        t.port = static_cast<quint16>(portSpin_->value());
+        if (t.host.isEmpty()) return;
+        controller_.addTarget(t);
+        appendLog_(tr("Цель %1:%2 добавлена в таблицу").arg(t.host).arg(t.port));
+    });
+
+    QObject::connect(removeTargetBtn_, &QPushButton::clicked, this, [this]{
+        QVector<MonitorController::TargetId> ids;
+        for (const QModelIndex& idx : targetsView_->selectionModel()->selectedRows()) {
+            const auto id = targetsModel_.targetAt(idx.row());
+            // The primary target follows the controls above and stays.
+            if (id != 0 && id != controller_.primaryTarget()) ids.push_back(id);
+        }
+        for (auto id : ids) controller_.removeTarget(id);
+    });
+
+    // Primary target: handlers only record the new state, flushUi_() applies it once per frame.
     QObject::connect(&controller_, &MonitorController::probeStarted, this, [this]{
-        setStatusBadge(statusLabel_, tr("Проверка…"), QColor("#777"));
-        latencyLabel_->setText(tr("Задержка: …"));
-        dnsLabel_->setText(tr("DNS: …"));
-        httpLabel_->setText(tr("HTTP: —"));
+        setBadge_(tr("Проверка…"), StatusBadge::Tone::Busy);
+        view_.latency = tr("Задержка: …");
+        view_.dns = tr("DNS: …");
+        view_.http = tr("HTTP: —");
 
         const QString host = hostEdit_->text().trimmed();
         const quint16 port = static_cast<quint16>(portSpin_->value());
         appendLog_(tr("Проверка %1 %2:%3…")
-                           .arg(modeCombo_->currentIndex() == 0 ? "TCP" : "HTTP")
+                           .arg(QString::fromLatin1(probeModeName(static_cast<ProbeTarget::Mode>(modeCombo_->currentIndex()))).toUpper())
                            .arg(host)
                            .arg(port));
     });
 
     QObject::connect(&controller_, &MonitorController::probeProgressDns, this,
                      [this](qint64 ms, const QString& ip){
-                         dnsLabel_->setText(tr("DNS: %1 мс (%2)").arg(ms).arg(ip));
+                         view_.dns = tr("DNS: %1 мс (%2)").arg(ms).arg(ip);
+                         scheduleUi_();
                      });
 
-    QObject::connect(&controller_, &MonitorController::statsUpdated, this,
-                     [this](qint64 mn, qint64 avg, qint64 mx, int n){
-                         if (n <= 0) {
-                             statsLabel_->setText(tr("Статистика: —"));
-                         } else {
-                             statsLabel_->setText(tr("Статистика: min %1 мс / avg %2 мс / max %3 мс (n=%4)")
-                                                          .arg(mn).arg(avg).arg(mx).arg(n));
-                         }
-                     });
+    QObject::connect(&controller_, &MonitorController::statsUpdated, this, [this]{
+        view_.statsDirty = true;
+        scheduleUi_();
+    });
 
     QObject::connect(&controller_, &MonitorController::probeFinished, this,
                      [this](const ProbeResult& r){
+                         const double latency = r.latencyNs >= 0 ? r.latencyNs / 1e6 : double(r.latencyMs);
+                         chart_->append(QDateTime::currentMSecsSinceEpoch(), latency,
+                                        r.status == ProbeResult::Status::Up);
+
                          switch (r.status) {
                              case ProbeResult::Status::Up:
-                                 setStatusBadge(statusLabel_, tr("UP (%1 мс)").arg(r.latencyMs), QColor("#2e7d32"));
-                                 latencyLabel_->setText(tr("Задержка: %1 мс").arg(r.latencyMs));
+                                 setBadge_(tr("UP (%1 мс)").arg(r.latencyMs), StatusBadge::Tone::Up);
+                                 view_.latency = tr("Задержка: %1 мс").arg(r.latencyMs);
                                  if (r.httpCode) {
-                                     httpLabel_->setText(tr("HTTP: %1").arg(*r.httpCode));
-                                     appendLog_(tr("HTTP OK %1, %2 мс").arg(*r.httpCode).arg(r.latencyMs));
+                                     view_.http = tr("HTTP: %1").arg(*r.httpCode);
+                                     const PhaseTimings& p = r.phases;
+                                     appendLog_(tr("HTTP OK %1, %2 мс (dns %3 / connect %4 / tls %5 / ttfb %6 мс%7)")
+                                                        .arg(*r.httpCode).arg(r.latencyMs)
+                                                        .arg(phaseMs(p.dnsUs), phaseMs(p.connectUs),
+                                                             phaseMs(p.tlsUs), phaseMs(p.ttfbUs))
+                                                        .arg(p.reusedConnection ? tr(", повторное соединение") : QString()));
+                                 } else if (r.tls) {
+                                     appendLog_(tr("TLS OK %1 %2%3, %4 мс (connect %5 / tls %6 мс), сертификат до %7")
+                                                        .arg(r.tls->protocol, r.tls->cipher)
+                                                        .arg(r.tls->resumed ? tr(", возобновление")
+                                                             : r.tls->resumeOffered ? tr(", сессия отклонена") : QString())
+                                                        .arg(r.latencyMs)
+                                                        .arg(phaseMs(r.phases.connectUs), phaseMs(r.phases.tlsUs))
+                                                        .arg(r.tls->certNotAfterMs >= 0
+                                                             ? QDateTime::fromMSecsSinceEpoch(r.tls->certNotAfterMs).toString("yyyy-MM-dd")
+                                                             : QStringLiteral("—")));
+                                 } else if (r.packetsSent >= 0) {
+                                     appendLog_(tr("UDP ответ, RTT %1 мс, потеряно %2 из %3, джиттер %4 мс")
+                                                        .arg(r.latencyNs / 1e6, 0, 'f', 3)
+                                                        .arg(r.packetsSent - r.packetsReceived).arg(r.packetsSent)
+                                                        .arg(r.jitterUs / 1e3, 0, 'f', 3));
+                                 } else if (r.latencyNs >= 0) {
+                                     appendLog_(tr("TCP ДОСТУПЕН, задержка %1 мс").arg(r.latencyNs / 1e6, 0, 'f', 3));
                                  } else {
                                      appendLog_(tr("TCP ДОСТУПЕН, задержка %1 мс").arg(r.latencyMs));
                                  }
                                  break;
                              case ProbeResult::Status::Down:
-                                 setStatusBadge(statusLabel_, tr("DOWN"), QColor("#c62828"));
-                                 latencyLabel_->setText(tr("Задержка: —"));
-                                 if (r.httpCode) httpLabel_->setText(tr("HTTP: %1").arg(*r.httpCode));
+                                 setBadge_(tr("DOWN"), StatusBadge::Tone::Down);
+                                 view_.latency = tr("Задержка: —");
+                                 if (r.httpCode) view_.http = tr("HTTP: %1").arg(*r.httpCode);
                                  appendLog_(tr("НЕДОСТУПЕН: %1").arg(r.message));
                                  break;
                              case ProbeResult::Status::DnsFail:
-                                 setStatusBadge(statusLabel_, tr("DNS FAIL"), QColor("#ef6c00"));
-                                 latencyLabel_->setText(tr("Задержка: —"));
-                                 dnsLabel_->setText(tr("DNS: FAIL"));
+                                 setBadge_(tr("DNS FAIL"), StatusBadge::Tone::Warn);
+                                 view_.latency = tr("Задержка: —");
+                                 view_.dns = tr("DNS: FAIL");
                                  appendLog_(tr("DNS ошибка: %1").arg(r.message));
                                  break;
                              case ProbeResult::Status::Timeout:
-                                 setStatusBadge(statusLabel_, tr("TIMEOUT"), QColor("#ef6c00"));
-                                 latencyLabel_->setText(tr("Задержка: —"));
+                                 setBadge_(tr("TIMEOUT"), StatusBadge::Tone::Warn);
+                                 view_.latency = tr("Задержка: —");
                                  appendLog_(tr("ТАЙМАУТ (%1 мс)").arg(3000));
                                  break;
                              case ProbeResult::Status::Error:
-                                 setStatusBadge(statusLabel_, tr("ERROR"), QColor("#c62828"));
+                                 setBadge_(tr("ERROR"), StatusBadge::Tone::Down);
                                  appendLog_(r.message.isEmpty() ? tr("Неизвестная ошибка") : r.message);
                                  break;
                          }
+
+                         // tcp-multi: one line per address with its own window average
+                         for (const auto& a : r.addresses) {
+                             const StatsCalculator& st = controller_.addressStats(controller_.primaryTarget(), a.ip);
+                             appendLog_(tr("  %1: %2%3, avg %4 мс (n=%5)")
+                                                .arg(a.ip, QString::fromLatin1(probeStatusName(a.status)))
+                                                .arg(a.latencyNs >= 0 ? tr(" %1 мс").arg(a.latencyNs / 1e6, 0, 'f', 3) : QString())
+                                                .arg(st.avg()).arg(st.count()));
+                         }
                      });
 
     controller_.setMode(MonitorController::Mode::TcpConnect);
@@ -217,5 +360,40 @@ void NetworkMonitorWidget::wireSignals_() {
 }
 
 void NetworkMonitorWidget::appendLog_(const QString& line) {
-    log_->appendPlainText(QString("[%1] %2").arg(nowStr(), line));
-}
\ No newline at end of file
+    const QString stamped = QString("[%1] %2").arg(nowStr(), line);
+    logModel_.append(stamped);
+    logSink_.write(stamped);
+}
+
+void NetworkMonitorWidget::setBadge_(const QString& text, StatusBadge::Tone tone) {
+    view_.badgeText = text;
+    view_.tone = tone;
+    scheduleUi_();
+}
+
+void NetworkMonitorWidget::scheduleUi_() {
+    if (!uiTimer_.isActive()) uiTimer_.start();
+}
+
+void NetworkMonitorWidget::flushUi_() {
+    if (!view_.badgeText.isEmpty()) statusBadge_->setStatus(view_.badgeText, view_.tone);
+    // QLabel::setText returns early on equal text, so unchanged labels cost nothing.
+    if (!view_.latency.isEmpty()) latencyLabel_->setText(view_.latency);
+    if (!view_.dns.isEmpty()) dnsLabel_->setText(view_.dns);
+    if (!view_.http.isEmpty()) httpLabel_->setText(view_.http);
+
+    if (view_.statsDirty) {
+        view_.statsDirty = false;
+        const StatsCalculator& st = controller_.stats();
+        if (st.count() <= 0) {
+            statsLabel_->setText(tr("Статистика: —"));
+        } else {
+            statsLabel_->setText(tr("Статистика: min %1 мс / avg %2 мс / max %3 мс, "
+                                    "p50 %4 / p90 %5 / p99 %6 / p99.9 %7 мс (n=%8)")
+                                         .arg(st.min()).arg(st.avg()).arg(st.max())
+                                         .arg(st.percentile(50)).arg(st.percentile(90))
+                                         .arg(st.percentile(99)).arg(st.percentile(99.9))
+                                         .arg(st.count()));
+        }
+    }
+}
@@ -1,9 +1,16 @@
 #pragma once
 #include <QWidget>
+#include <QTimer>
 #include "core/MonitorController.h"
+#include "core/LogFileSink.h"
+#include "LogModel.h"
+#include "TargetTableModel.h"
+#include "utils/StatusBadge.h"
+
+class LatencyChart;
 
 class QLabel; class QLineEdit; class QSpinBox; class QComboBox;
-class QPlainTextEdit; class QPushButton;
+class QListView; class QPushButton; class QCheckBox; class QTableView;
 
 class NetworkMonitorWidget : public QWidget {
     Q_OBJECT
@@ -14,21 +21,46 @@ private:
     void setupUi_();
     void wireSignals_();
     void appendLog_(const QString& line);
+    void setBadge_(const QString& text, StatusBadge::Tone tone);
+    void scheduleUi_();
+    void flushUi_();
 
     // UI widgets
-    QLabel* statusLabel_ = nullptr;
+    StatusBadge* statusBadge_ = nullptr;
     QComboBox* modeCombo_ = nullptr;
     QLineEdit* hostEdit_ = nullptr;
     QSpinBox* portSpin_ = nullptr;
     QSpinBox* intervalSpin_ = nullptr;
+    QCheckBox* keepAliveCheck_ = nullptr;
     QPushButton* startStopBtn_ = nullptr;
     QPushButton* checkOnceBtn_ = nullptr;
     QPushButton* saveLogBtn_ = nullptr;
+    QCheckBox* logToFileCheck_ = nullptr;
     QLabel* latencyLabel_ = nullptr;
     QLabel* dnsLabel_ = nullptr;
     QLabel* httpLabel_ = nullptr;
     QLabel* statsLabel_ = nullptr;
-    QPlainTextEdit* log_ = nullptr;
+    QListView* log_ = nullptr;
+    LatencyChart* chart_ = nullptr;
+    QTableView* targetsView_ = nullptr;
+    QPushButton* addTargetBtn_ = nullptr;
+    QPushButton* removeTargetBtn_ = nullptr;
+
+    // Primary target state; applied to the widgets at most once per frame
+    struct PrimaryView {
+        QString badgeText;
+        StatusBadge::Tone tone = StatusBadge::Tone::Idle;
+        QString latency, dns, http;
+        bool statsDirty = false;
+    };
+    PrimaryView view_;
+    QTimer uiTimer_;
+    TargetTableModel targetsModel_;
+
+    // Log storage
+    LogModel logModel_;
+    LogFileSink logSink_;
+    bool followLog_ = true;               // прокручивать к последней строке
 
     // Core controller
     MonitorController controller_;
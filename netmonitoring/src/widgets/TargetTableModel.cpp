@@ -0,0 +1,189 @@
+#include "TargetTableModel.h"
+#include <QBrush>
+#include <QColor>
+#include <algorithm>
+#include "core/MonitorController.h"
+
+static QString msText(qint64 ms) {
+    return ms < 0 ? QStringLiteral("—") : QString::number(ms);
+}
+
+static QString percentText(double pct) {
+    return pct < 0 ? QStringLiteral("—") : QString::number(pct, 'f', pct >= 99.0 ? 2 : 1);
+}
+
+TargetTableModel::TargetTableModel(QObject* parent)
+        : QAbstractTableModel(parent) {
+    flushTimer_.setSingleShot(true);
+    flushTimer_.setInterval(16);
+    QObject::connect(&flushTimer_, &QTimer::timeout, this, [this]{ flush(); });
+}
+
+void TargetTableModel::attach(MonitorController* controller) {
+    beginResetModel();
+    controller_ = controller;
+    rows_.clear();
+    rowOf_.clear();
+    dirty_.clear();
+    for (quint32 id : controller->targetIds()) {
+        Row row;
+        row.id = id;
+        refresh_(row);
+        rowOf_.insert(id, rows_.size());
+        rows_.push_back(row);
+    }
+    endResetModel();
+
+    QObject::connect(controller, &MonitorController::resultsReady, this, &TargetTableModel::onResults_);
+    QObject::connect(controller, &MonitorController::targetRemoved, this, &TargetTableModel::onRemoved_);
+}
+
+quint32 TargetTableModel::targetAt(int row) const {
+    return row >= 0 && row < rows_.size() ? rows_[row].id : 0;
+}
+
+int TargetTableModel::ensureRow_(quint32 id) {
+    auto it = rowOf_.constFind(id);
+    if (it != rowOf_.constEnd()) return it.value();
+    // Added to the controller after attach(): the row appears with its first result.
+    const int row = rows_.size();
+    beginInsertRows(QModelIndex(), row, row);
+    Row r;
+    r.id = id;
+    rows_.push_back(r);
+    rowOf_.insert(id, row);
+    endInsertRows();
+    return row;
+}
+
+void TargetTableModel::markDirty_(int row) {
+    if (rows_[row].dirty) return;
+    rows_[row].dirty = true;
+    dirty_.push_back(row);
+    if (!flushTimer_.isActive()) flushTimer_.start();
+}
+
+void TargetTableModel::onResults_(const QVector<ProbeRecord>& batch) {
+    for (const ProbeRecord& r : batch) {
+        const int row = ensureRow_(r.target);
+        Row& x = rows_[row];
+        x.hasResult = true;
+        x.status = r.statusValue();
+        x.latencyMs = r.isUp() && r.latencyNs >= 0 ? r.latencyNs / 1e6 : -1;
+        markDirty_(row);
+    }
+}
+
+void TargetTableModel::onRemoved_(quint32 id) {
+    auto it = rowOf_.find(id);
+    if (it == rowOf_.end()) return;
+    flush();
+    const int row = it.value();
+    beginRemoveRows(QModelIndex(), row, row);
+    rows_.remove(row);
+    rowOf_.erase(it);
+    for (int i = row; i < rows_.size(); ++i) rowOf_[rows_[i].id] = i;
+    endRemoveRows();
+}
+
+void TargetTableModel::refresh_(Row& row) const {
+    if (!controller_) return;
+    const ProbeTarget cfg = controller_->target(row.id);
+    row.target = QStringLiteral("%1:%2").arg(cfg.host).arg(cfg.port);
+    row.mode = cfg.mode;
+    const StatsCalculator& st = controller_->stats(row.id);
+    row.samples = st.count();
+    if (row.samples > 0) {
+        row.avgMs = st.avg();
+        row.p50Ms = st.percentile(50);
+        row.p90Ms = st.percentile(90);
+        row.p99Ms = st.percentile(99);
+    } else {
+        row.avgMs = row.p50Ms = row.p90Ms = row.p99Ms = -1;
+    }
+    row.avail1h = controller_->windowStats(row.id, 3600).availability();
+    row.avail24h = controller_->windowStats(row.id, 24 * 3600).availability();
+}
+
+void TargetTableModel::flush() {
+    flushTimer_.stop();
+    if (dirty_.isEmpty()) return;
+    std::sort(dirty_.begin(), dirty_.end());
+    // Percentiles are read here, once per row per frame, not once per result.
+    for (int row : dirty_) {
+        refresh_(rows_[row]);
+        rows_[row].dirty = false;
+    }
+    int first = dirty_.front();
+    int last = first;
+    for (int i = 1; i <= dirty_.size(); ++i) {
+        if (i < dirty_.size() && dirty_[i] == last + 1) {
+            last = dirty_[i];
+            continue;
+        }
+        emit dataChanged(index(first, 0), index(last, ColumnCount - 1), {Qt::DisplayRole, Qt::ForegroundRole});
+        if (i < dirty_.size()) first = last = dirty_[i];
+    }
+    dirty_.clear();
+}
+
+int TargetTableModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : rows_.size();
+}
+
+int TargetTableModel::columnCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant TargetTableModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= rows_.size()) return {};
+    const Row& r = rows_[index.row()];
+
+    if (role == Qt::ForegroundRole && index.column() == StatusCol && r.hasResult) {
+        // Same tones as the status badge
+        static const QBrush up(QColor("#2e7d32")), warn(QColor("#ef6c00")), down(QColor("#c62828"));
+        switch (r.status) {
+            case ProbeResult::Status::Up:      return up;
+            case ProbeResult::Status::DnsFail:
+            case ProbeResult::Status::Timeout: return warn;
+            default:                           return down;
+        }
+    }
+    if (role == Qt::TextAlignmentRole && index.column() >= LatencyCol) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    if (role != Qt::DisplayRole) return {};
+
+    switch (index.column()) {
+        case TargetCol:  return r.target;
+        case ModeCol:    return QString::fromLatin1(probeModeName(r.mode));
+        case StatusCol:  return r.hasResult ? QString::fromLatin1(probeStatusName(r.status)) : QStringLiteral("—");
+        case LatencyCol: return r.latencyMs < 0 ? QStringLiteral("—") : QString::number(r.latencyMs, 'f', 1);
+        case AvgCol:     return msText(r.avgMs);
+        case P50Col:     return msText(r.p50Ms);
+        case P90Col:     return msText(r.p90Ms);
+        case P99Col:     return msText(r.p99Ms);
+        case SamplesCol: return r.samples;
+        case Avail1hCol: return percentText(r.avail1h);
+        case Avail24hCol: return percentText(r.avail24h);
+        default:         return {};
+    }
+}
+
+QVariant TargetTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return {};
+    switch (section) {
+        case TargetCol:  return tr("Цель");
+        case ModeCol:    return tr("Режим");
+        case StatusCol:  return tr("Статус");
+        case LatencyCol: return tr("Задержка, мс");
+        case AvgCol:     return tr("avg");
+        case P50Col:     return tr("p50");
+        case P90Col:     return tr("p90");
+        case P99Col:     return tr("p99");
+        case SamplesCol: return tr("n");
+        case Avail1hCol: return tr("1 ч, %");
+        case Avail24hCol: return tr("24 ч, %");
+        default:         return {};
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QTimer>
+#include <QVector>
+#include "core/ProbeRecord.h"
+#include "core/ProbeResult.h"
+#include "core/ProbeTarget.h"
+
+class MonitorController;
+
+// One row per controller target: address, mode, last status and latency,
+// percentiles of the target's window, and availability over the last hour and
+// day. Results only update the row's cached values and mark it dirty; the view is
+// told about dirty rows at most once per frame, with one dataChanged per
+// contiguous run.
+class TargetTableModel : public QAbstractTableModel {
+    Q_OBJECT
+public:
+    enum Column { TargetCol, ModeCol, StatusCol, LatencyCol, AvgCol, P50Col, P90Col, P99Col, SamplesCol,
+                  Avail1hCol, Avail24hCol, ColumnCount };
+
+    explicit TargetTableModel(QObject* parent = nullptr);
+
+    void attach(MonitorController* controller);
+    quint32 targetAt(int row) const;
+
+    void flush();                         // publish dirty rows right away
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    struct Row {
+        quint32 id = 0;
+        QString target;                   // host:port
+        ProbeTarget::Mode mode = ProbeTarget::Mode::TcpConnect;
+        bool hasResult = false;
+        ProbeResult::Status status = ProbeResult::Status::Error;
+        double latencyMs = -1;
+        // Снимок статистики на момент последнего flush
+        qint64 avgMs = -1, p50Ms = -1, p90Ms = -1, p99Ms = -1;
+        int samples = 0;
+        double avail1h = -1, avail24h = -1;   // % UP по WindowStats
+        bool dirty = false;
+    };
+
+    int ensureRow_(quint32 id);
+    void markDirty_(int row);
+    void refresh_(Row& row) const;
+    void onResults_(const QVector<ProbeRecord>& batch);
+    void onRemoved_(quint32 id);
+
+    MonitorController* controller_ = nullptr;
+    QVector<Row> rows_;
+    QHash<quint32, int> rowOf_;
+    QVector<int> dirty_;
+    QTimer flushTimer_;
+};